@@ -10,18 +10,36 @@
 */
 
 #include "SessionManager.h"
-
-#include <cmath>        // sinf, cosf
-#include <sstream>      // stringstream
-#include <iomanip>      // setw, setfill
-
-// Helper for hex printing (just for nicer logs)
-static std::string hex32(uint32_t v)
-{
-    std::stringstream ss;
-    ss << "0x" << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << v;
-    return ss.str();
-}
+#include "debug/GDB_Client.h"
+#include "debug/ElfFile.h"
+#include "debug/FlashJob.h"
+#include "debug/DetectionCache.h"
+#include "debug/OpenOCDTcl.h"
+#include "debug/RttReader.h"
+#include "debug/SimulatedTarget.h"
+#include "debug/ItmDecoder.h"
+#include "debug/SwoSource.h"
+#include "debug/STM32Detector.h"
+#include "debug/STM32Devices.h"
+#include "recording/RecordingWriter.h"
+#include "recording/RecordingReader.h"
+#include "util/Profiler.h"
+
+#include <algorithm>    // min
+#include <cmath>        // floor
+#include <cstdarg>      // va_list
+#include <chrono>       // symbol load timing
+#include <cstdio>       // snprintf
+#include <cstring>      // memcpy
+
+// Log topics, the console filters on these
+static const LogCategory LogTarget = LogCategory::intern("target");
+static const LogCategory LogPlot = LogCategory::intern("plot");
+static const LogCategory LogRtt = LogCategory::intern("rtt");
+static const LogCategory LogSwo = LogCategory::intern("swo");
+static const LogCategory LogRec = LogCategory::intern("recording");
+static const LogCategory LogElf = LogCategory::intern("elf");
+static const LogCategory LogWatch = LogCategory::intern("watch");
 
 // ------------------------------
 // Constructor / Destructor
@@ -29,6 +47,14 @@ static std::string hex32(uint32_t v)
 SessionManager::SessionManager()
 {
     // Keep the constructor light, initialize() does the setup.
+    this->signalBuffer = std::make_unique<SignalBuffer>(this->config.plotCapacity, 0);
+    this->acquisition = std::make_unique<AcquisitionThread>();
+    this->gdbClient = std::make_unique<GDB_Client>();
+    this->elfFile = std::make_unique<ElfFile>();
+    this->flashJob = std::make_unique<FlashJob>();
+    this->detectionCache = std::make_unique<DetectionCache>();
+    this->dwarf = std::make_unique<DwarfInfo>();
+    this->logStore = std::make_unique<LogStore>(this->config.logHistoryLines, this->config.logRingSlots);
 }
 
 SessionManager::~SessionManager()
@@ -40,23 +66,20 @@ SessionManager::~SessionManager()
 // ------------------------------
 // Logging
 // ------------------------------
-void SessionManager::addLogMessage(const std::string& message)
+void SessionManager::Log(LogSource source, LogLevel level, const char* fmt, ...)
 {
-    this->logMessages.push_back(message);
-
-    // Keep it from growing forever
-    const size_t maxLines = 400;
-    if (this->logMessages.size() > maxLines)
-    {
-        this->logMessages.erase(this->logMessages.begin());
-    }
+    va_list args;
+    va_start(args, fmt);
+    this->logStore->vwrite(source, level, LogCategory(), fmt, args);
+    va_end(args);
 }
 
-void SessionManager::Log(const std::string& src, const std::string& level, const std::string& message)
+void SessionManager::Log(LogSource source, LogLevel level, LogCategory category, const char* fmt, ...)
 {
-    // Example: [GDB][INFO] Connected
-    std::string line = "[" + src + "][" + level + "] " + message;
-    this->addLogMessage(line);
+    va_list args;
+    va_start(args, fmt);
+    this->logStore->vwrite(source, level, category, fmt, args);
+    va_end(args);
 }
 
 // ------------------------------
@@ -73,7 +96,7 @@ bool SessionManager::initialize()
     this->symbolsLoaded = false;
 
     this->connectionTimer = 0.0f;
-    this->simulationTime = 0.0f;
+    this->simulationTime = 0.0;
 
     // Reset target info
     this->targetInfo.deviceName = "STM32F4";
@@ -84,180 +107,1231 @@ bool SessionManager::initialize()
     this->targetInfo.state = TargetState::HALTED;
     this->targetInfo.cpuLoad = 0.0f;
 
-    // Clear UI buffers
-    this->logMessages.clear();
-    this->timeData.clear();
-    this->plotSignals.clear();
+    // Clear UI buffers
+    this->stopAcquisition();
+    this->logStore->clear();
+    this->logStore->setMaxLines(this->config.logHistoryLines);
+    this->plotSignals.clear();
+    this->signalBuffer->reset(this->config.plotCapacity, 0);
+
+    std::string cacheErr;
+    if (!this->detectionCache->load(cacheErr))
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogTarget, "Detection cache not loaded: %s", cacheErr.c_str());
+    }
+
+    // Add 2 default signals for the plot
+    this->addPlotSignal("adc_filtered");
+    this->addPlotSignal("motor_rpm(norm)");
+
+    this->Log(LogSource::APP, LogLevel::INFO, "SessionManager initialized.");
+    this->Log(LogSource::APP, LogLevel::INFO, "Not connected yet.");
+    this->runTarget();
+
+    return true;
+}
+
+void SessionManager::shutdown()
+{
+    this->stopAcquisition();
+    this->stopRecording();
+
+    if (this->connectionState == ConnectionState::CONNECTED ||
+        this->connectionState == ConnectionState::CONNECTING)
+    {
+        this->disconnectFromTarget();
+    }
+
+    this->Log(LogSource::APP, LogLevel::INFO, "SessionManager shutdown.");
+}
+
+// ------------------------------
+// Plot signals
+// ------------------------------
+void SessionManager::addPlotSignal(const std::string& name, const ChannelFormat& format)
+{
+    PlotSignal s;
+    s.name = name;
+    s.channel = this->signalBuffer->addChannel(format);
+    s.visible = true;
+    s.source = SignalSource::forName(name, this->plotSignals.size());
+
+    this->plotSignals.push_back(s);
+}
+
+void SessionManager::setPlotCapacity(size_t samples)
+{
+    // Resizing a ring buffer means starting over, the history is dropped
+    const bool wasRunning = this->acquisition->isRunning();
+    this->stopAcquisition();
+
+    const double replayFrom = (this->replay && !this->signalBuffer->empty()) ? this->signalBuffer->timeAt(0) : 0.0;
+
+    this->config.plotCapacity = samples;
+    this->signalBuffer->reset(samples, this->plotSignals.size());
+    this->simulationTime = 0.0;
+
+    this->Log(LogSource::APP, LogLevel::INFO, LogPlot, "Plot history set to %zu samples.", this->signalBuffer->capacity());
+
+    if (this->replay)
+    {
+        this->loadReplayWindow(replayFrom);
+    }
+
+    if (wasRunning)
+    {
+        this->startAcquisition();
+    }
+}
+
+void SessionManager::setSignalScale(size_t index, double scale, double offset)
+{
+    if (index < this->plotSignals.size())
+    {
+        this->signalBuffer->setScale(this->plotSignals[index].channel, scale, offset);
+    }
+}
+
+bool SessionManager::addGeneratorSignal(GeneratorKind kind)
+{
+    if (!this->simulated || this->replay)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogPlot, "Generators only feed the simulated target's live plot.");
+        return false;
+    }
+
+    // The acquisition thread's row size is fixed, it has to start over with the new column
+    const bool wasRunning = this->acquisition->isRunning();
+    this->stopAcquisition();
+
+    const std::string name = std::string(generatorKindName(kind)) + "#" + std::to_string(this->plotSignals.size());
+    this->addPlotSignal(name);
+    this->Log(LogSource::APP, LogLevel::INFO, LogPlot, "Added generator signal %s.", name.c_str());
+
+    if (wasRunning)
+    {
+        this->startAcquisition();
+    }
+    return true;
+}
+
+void SessionManager::setSampleRate(double hz)
+{
+    if (hz <= 0.0)
+    {
+        return;
+    }
+
+    const bool wasRunning = this->acquisition->isRunning();
+    this->stopAcquisition();
+    this->config.sampleRateHz = (float)hz;
+
+    if (wasRunning)
+    {
+        this->startAcquisition();
+    }
+}
+
+// ------------------------------
+// Acquisition
+// ------------------------------
+AcquisitionThread::SampleFn SessionManager::makeSimulatedSampler() const
+{
+    // The thread gets its own copy of the source list, plotSignals stays UI thread only.
+    // The sources themselves are immutable, sharing them is fine.
+    std::vector<std::shared_ptr<const SignalSource>> sources;
+    std::vector<size_t> columns;
+    for (const auto& sig : this->plotSignals)
+    {
+        sources.push_back(sig.source);
+        columns.push_back(sig.channel);
+    }
+
+    std::vector<double> scratch;
+    return [sources, columns, scratch](double t0, double dt, size_t count, double* values, size_t stride) mutable
+    {
+        // One batch per signal, then spread over the rows
+        scratch.resize(count);
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            sources[i]->generate(t0, dt, count, scratch.data());
+
+            double* column = values + columns[i];
+            for (size_t r = 0; r < count; r++)
+            {
+                column[r * stride] = scratch[r];
+            }
+        }
+    };
+}
+
+void SessionManager::startAcquisition()
+{
+    if (this->acquisition->isRunning())
+    {
+        return;
+    }
+
+    // Going live again, the plot can't show both
+    if (this->replay)
+    {
+        this->closeReplay();
+    }
+
+    if (this->config.plotSource == PlotSource::RTT)
+    {
+        this->startRttAcquisition();
+        return;
+    }
+    if (this->config.plotSource == PlotSource::SWO)
+    {
+        this->startSwoAcquisition();
+        return;
+    }
+
+    // The generators only stand in for the simulated target, never plot them as if a real one sent them
+    if (!this->simulated)
+    {
+        this->startWatchAcquisition();
+        return;
+    }
+
+    this->acquisition->start(this->config.sampleRateHz, this->signalBuffer->channelCount(), this->makeSimulatedSampler(),
+                             this->simulationTime);
+}
+
+void SessionManager::startWatchAcquisition()
+{
+    std::vector<DwarfWatchTarget> targets;
+    std::vector<MemRegion> regions;
+    std::vector<std::string> names;
+    for (const auto& w : this->watches)
+    {
+        if (!DwarfInfo::isNumeric(w.target))
+        {
+            this->Log(LogSource::APP, LogLevel::WARN, LogPlot, "Watch '%s' is a %s, not plotted.", w.expression.c_str(), w.typeName.c_str());
+            continue;
+        }
+        targets.push_back(w.target);
+        regions.push_back(MemRegion{w.target.addr, w.target.size});
+        names.push_back(w.expression);
+    }
+
+    if (targets.empty())
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogPlot, "Sampled plotting on a real target plots the watches, add a numeric one (or use RTT or SWO).");
+        return;
+    }
+
+    // The plot shows the watches, one signal each
+    bool same = (names.size() == this->plotSignals.size());
+    for (size_t i = 0; same && i < names.size(); i++)
+    {
+        same = (names[i] == this->plotSignals[i].name);
+    }
+    if (!same)
+    {
+        this->plotSignals.clear();
+        this->signalBuffer->reset(this->config.plotCapacity, 0);
+        for (const auto& name : names)
+        {
+            this->addPlotSignal(name);
+        }
+    }
+
+    // Same plan as the watch list, but without the RSP packet cap: read_memory has no such limit
+    ReadPlan plan;
+    plan.compile(regions, this->config.watchGapBytes, 4, 0);
+
+    std::vector<TclReadRange> ranges;
+    for (const auto& r : plan.getReads())
+    {
+        ranges.push_back(TclReadRange{r.addr, r.len / 4});
+    }
+
+    this->Log(LogSource::APP, LogLevel::INFO, LogPlot, "Sampling %zu watches at %.0f Hz over TCL, %zu reads (%u bytes) per sample.",
+              targets.size(), this->config.sampleRateHz, ranges.size(), plan.transferBytes());
+
+    auto tcl = std::make_shared<OpenOCDTcl>();
+    LogStore* log = this->logStore.get();
+    const double rate = (this->config.sampleRateHz > 0.0f) ? this->config.sampleRateHz : 1.0;
+    const double simStart = this->simulationTime;
+    const auto start = std::chrono::steady_clock::now();
+    double next = 0.0;
+    std::vector<std::vector<uint32_t>> words;
+    std::vector<uint8_t> bytes;
+
+    auto stream = [=](std::vector<double>& rows) mutable
+    {
+        // Connected here and not on the UI thread, it can take a while
+        if (!tcl->isConnected() && !tcl->connect("127.0.0.1", 6666, 500))
+        {
+            log->write(LogSource::OPENOCD, LogLevel::ERROR, LogPlot, "Sampling needs the TCL port (6666): %s", tcl->getLastError().c_str());
+            return false;
+        }
+
+        // One sample per period. A round trip slower than that just samples as fast as it can.
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed < next)
+        {
+            return true;
+        }
+        next = std::max(next + 1.0 / rate, elapsed);
+
+        if (!tcl->readRanges(ranges, words))
+        {
+            log->write(LogSource::OPENOCD, LogLevel::ERROR, LogPlot, "Watch sampling stopped: %s", tcl->getLastError().c_str());
+            return false;
+        }
+
+        // Words come back little endian like target memory. A failed read only blanks its own watches.
+        for (size_t r = 0; r < words.size(); r++)
+        {
+            bytes.resize(words[r].size() * 4);
+            for (size_t w = 0; w < words[r].size(); w++)
+            {
+                for (int b = 0; b < 4; b++) bytes[w * 4 + b] = (uint8_t)(words[r][w] >> (8 * b));
+            }
+            plan.store(r, bytes.data(), bytes.size());
+        }
+
+        rows.push_back(simStart + elapsed);
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            double v;
+            rows.push_back(DwarfInfo::numericValue(targets[i], plan.regionData(i), plan.regionLen(i), v) ? v : NAN);
+        }
+        return true;
+    };
+
+    this->acquisition->startStream(rate, targets.size(), stream);
+}
+
+bool SessionManager::samplingWatches() const
+{
+    return !this->simulated && this->config.plotSource == PlotSource::SAMPLED && this->acquisition->isRunning();
+}
+
+// Connects (real target), finds the control block and attaches the reader. Runs on the
+// acquisition thread: the TCL connect, the chip detection and a RAM scan are all round trips.
+static bool attachRtt(RttReader& reader, TargetMemory& memory, OpenOCDTcl* tcl, std::vector<MemoryRange> scanRanges,
+                      bool ramKnown, const uint32_t* symAddr, unsigned channel, LogStore* log)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    if (tcl)
+    {
+        if (!tcl->connect("127.0.0.1", 6666, 500))
+        {
+            log->write(LogSource::OPENOCD, LogLevel::ERROR, LogRtt, "RTT needs the TCL port (6666): %s", tcl->getLastError().c_str());
+            return false;
+        }
+
+        // A known chip gets its real RAM ranges searched instead of the configured guess
+        DetectionResult det = (ramKnown || symAddr) ? DetectionResult() : DetectedSTM32Tcl(*tcl);
+        if (const STM32Device* dev = det.success ? findSTM32Device(det.devID) : nullptr)
+        {
+            scanRanges.assign(dev->ram, dev->ram + dev->ramCount());
+        }
+    }
+
+    uint32_t cbAddr = 0;
+    if (symAddr)
+    {
+        cbAddr = *symAddr;
+    }
+    else
+    {
+        bool found = false;
+        for (const MemoryRange& range : scanRanges)
+        {
+            if (RttReader::findControlBlock(memory, range.base, range.size, cbAddr))
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            for (const MemoryRange& range : scanRanges)
+            {
+                log->write(LogSource::APP, LogLevel::ERROR, LogRtt, "No RTT control block between 0x%08X and 0x%08X.",
+                           range.base, range.base + range.size);
+            }
+            return false;
+        }
+    }
+
+    // A failed attach is reported by stopAcquisition with the reader's error
+    if (!reader.attach(memory, cbAddr))
+    {
+        return false;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    log->write(LogSource::APP, LogLevel::INFO, LogRtt, "RTT control block at 0x%08X (%s, %.1f ms), %u up buffers, reading #%u.",
+               cbAddr, symAddr ? "_SEGGER_RTT" : "RAM scan", ms, reader.upBufferCount(), channel);
+    return true;
+}
+
+void SessionManager::startRttAcquisition()
+{
+    const size_t channels = this->signalBuffer->channelCount();
+    const unsigned channel = this->config.rttChannel;
+
+    // Simulated target = fake firmware writing into a RAM image, real target = OpenOCD's TCL port
+    // (the gdb port can't read memory while the core runs)
+    std::shared_ptr<TargetMemory> memory;
+    std::shared_ptr<SimulatedTarget> sim;
+    std::shared_ptr<OpenOCDTcl> tcl;
+    std::vector<MemoryRange> scanRanges{MemoryRange{this->config.rttRamStart, this->config.rttRamSize}};
+    bool ramKnown = false;
+    if (this->simulated)
+    {
+        sim = std::make_shared<SimulatedTarget>();
+        sim->addRegion(this->config.rttRamStart, this->config.rttRamSize);
+        // Not at the start of RAM, the scan has to actually find it
+        sim->setupRtt(this->config.rttRamStart + 0x1A40, {16384});
+        memory = sim;
+    }
+    else
+    {
+        // Connected on the acquisition thread, not here
+        tcl = std::make_shared<OpenOCDTcl>();
+        memory = tcl;
+
+        // Detected after the connect already, otherwise the thread asks the chip itself
+        if (this->targetDevice)
+        {
+            scanRanges.assign(this->targetDevice->ram, this->targetDevice->ram + this->targetDevice->ramCount());
+            ramKnown = true;
+        }
+    }
+
+    // The ELF belongs to the UI thread, look the symbol up here
+    const ElfSymbol* sym = this->symbolsLoaded ? this->elfFile->findSymbol("_SEGGER_RTT") : nullptr;
+    const bool haveSym = (sym != nullptr);
+    const uint32_t symAddr = sym ? sym->addr : 0;
+
+    auto reader = std::make_shared<RttReader>();
+    LogStore* log = this->logStore.get();
+
+    auto decoder = std::make_shared<RttRecordDecoder>();
+    decoder->reset(channels, this->simulationTime);
+
+    // Fake firmware state, only used with the simulated target
+    AcquisitionThread::SampleFn firmware = sim ? this->makeSimulatedSampler() : nullptr;
+    const double rate = (this->config.sampleRateHz > 0.0f) ? this->config.sampleRateHz : 1.0;
+    const double simStart = this->simulationTime;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t produced = 0;
+    std::vector<double> values(AcquisitionThread::MaxBatch * channels, 0.0);
+    std::vector<float> record32(channels, 0.0f);
+    std::vector<uint8_t> record(decoder->recordSize());
+    std::vector<uint8_t> bytes;
+
+    // memory is captured on purpose, the reader only keeps a reference to it
+    auto stream = [=, memory = memory](std::vector<double>& rows) mutable
+    {
+        if (!reader->isAttached() &&
+            !attachRtt(*reader, *memory, tcl.get(), scanRanges, ramKnown, haveSym ? &symAddr : nullptr, channel, log))
+        {
+            return false;
+        }
+
+        if (sim)
+        {
+            // Every sample due by now goes into the up buffer, the way SEGGER_RTT_Write would
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            uint64_t due = (uint64_t)std::floor(elapsed * rate) + 1;
+            while (produced < due)
+            {
+                const size_t n = (size_t)std::min<uint64_t>(due - produced, AcquisitionThread::MaxBatch);
+                firmware(simStart + (double)produced / rate, 1.0 / rate, n, values.data(), channels);
+                for (size_t r = 0; r < n; r++, produced++)
+                {
+                    for (size_t c = 0; c < channels; c++) record32[c] = (float)values[r * channels + c];
+                    RttRecordDecoder::encode((uint32_t)((double)produced * 1e6 / rate), record32.data(), channels, record.data());
+                    sim->rttWrite(0, record.data(), (uint32_t)record.size()); // Full ring = dropped, like the real thing
+                }
+            }
+        }
+
+        bytes.clear();
+        if (!reader->drain(channel, bytes))
+        {
+            return false;
+        }
+        decoder->feed(bytes.data(), bytes.size(), rows);
+        return true;
+    };
+
+    this->rttReader = reader;
+    this->acquisition->startStream(rate, channels, stream);
+}
+
+void SessionManager::startSwoAcquisition()
+{
+    const size_t channels = this->signalBuffer->channelCount();
+    const double rate = (this->config.sampleRateHz > 0.0f) ? this->config.sampleRateHz : 1.0;
+    const double tsHz = this->config.swoTimestampHz;
+
+    // A capture file replays fine without a target. Only a simulated target without any input
+    // gets the fake firmware below.
+    auto source = std::make_shared<SwoSource>();
+    bool sim = false;
+    if (!source->open(this->config.swoInput))
+    {
+        if (!this->simulated)
+        {
+            this->Log(LogSource::OPENOCD, LogLevel::ERROR, LogSwo, "SWO input %s: %s (is tpiu configured with -output?)",
+                      this->config.swoInput.c_str(), source->getLastError().c_str());
+            return;
+        }
+        sim = true;
+        source.reset();
+        this->Log(LogSource::APP, LogLevel::INFO, LogSwo, "SWO input %s not available, tracing the simulated target.", this->config.swoInput.c_str());
+    }
+    else
+    {
+        this->Log(LogSource::APP, LogLevel::INFO, LogSwo, "SWO stream from %s, %zu stimulus ports plotted.",
+                  this->config.swoInput.c_str(), channels);
+    }
+
+    auto rows = std::make_shared<ItmRowBuilder>();
+    rows->reset(channels, this->simulationTime, tsHz);
+    this->lastPcSamples = 0;
+    this->lastSleepSamples = 0;
+
+    AcquisitionThread::SampleFn firmware = sim ? this->makeSimulatedSampler() : nullptr;
+    const double simStart = this->simulationTime;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t produced = 0;
+    uint32_t fakePc = 0x08000400;
+    std::vector<double> values(AcquisitionThread::MaxBatch * channels, 0.0);
+    std::vector<uint8_t> bytes(64 * 1024);
+    LogStore* log = this->logStore.get(); // Outlives the stream, shutdown() stops acquisition first
+    uint64_t overflowsLogged = 0;
+    double lastOverflowLog = -1.0;
+
+    auto stream = [=](std::vector<double>& out) mutable
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t len = 0;
+
+        if (sim)
+        {
+            // What the ITM would put on the pin: the ports, a timestamp, and a PC sample now and then
+            uint64_t due = (uint64_t)std::floor(elapsed * rate) + 1;
+            const uint32_t ticks = (uint32_t)(tsHz / rate);
+            const size_t sampleBytes = 5 * (channels + 2); // Worst case per sample
+            size_t n = (size_t)std::min<uint64_t>(due - std::min(due, produced), bytes.size() / sampleBytes);
+            if (n > AcquisitionThread::MaxBatch) n = AcquisitionThread::MaxBatch;
+            if (n > 0)
+            {
+                firmware(simStart + (double)produced / rate, 1.0 / rate, n, values.data(), channels);
+            }
+            for (size_t r = 0; r < n; r++, produced++)
+            {
+                for (size_t c = 0; c < channels && c < 32; c++)
+                {
+                    float f = (float)values[r * channels + c];
+                    uint32_t bits;
+                    memcpy(&bits, &f, 4);
+                    len += ItmRowBuilder::encodeStimulus((unsigned)c, bits, bytes.data() + len);
+                }
+                len += ItmRowBuilder::encodeTimestamp(ticks, bytes.data() + len);
+                fakePc += 2;
+                if ((fakePc & 0xFF) == 0) fakePc = 0x08000400;
+                len += ItmRowBuilder::encodePcSample(fakePc, (produced % 8) != 0, bytes.data() + len);
+            }
+            rows->feed(bytes.data(), len, simStart + elapsed, out);
+            return true;
+        }
+
+        // Everything that is there, a few MB/s is only a handful of reads per wakeup
+        while (true)
+        {
+            int n = source->read(bytes.data(), bytes.size());
+            if (n < 0)
+            {
+                return false;
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            rows->feed(bytes.data(), (size_t)n, simStart + elapsed, out);
+        }
+
+        // The ITM FIFO ran over on the target, say so while it happens (at most once a second)
+        const uint64_t overflows = rows->getDecoder().overflowCount();
+        if (overflows != overflowsLogged && elapsed - lastOverflowLog >= 1.0)
+        {
+            log->write(LogSource::APP, LogLevel::WARN, LogSwo, "SWO overflow, %llu so far. Lower the sample rate or the port count.",
+                       (unsigned long long)overflows);
+            overflowsLogged = overflows;
+            lastOverflowLog = elapsed;
+        }
+        return true;
+    };
+
+    this->swoSource = source;
+    this->itmRows = rows;
+    this->acquisition->startStream(rate, channels, stream);
+}
+
+void SessionManager::setPlotSource(PlotSource source)
+{
+    if (source == this->config.plotSource)
+    {
+        return;
+    }
+
+    const bool wasRunning = this->acquisition->isRunning();
+    this->stopAcquisition();
+    this->config.plotSource = source;
+
+    if (wasRunning)
+    {
+        this->startAcquisition();
+    }
+}
+
+void SessionManager::stopAcquisition()
+{
+    // A failed stream has already stopped itself, it still needs the cleanup below
+    const bool failed = this->acquisition->hasFailed();
+    if (!this->acquisition->isRunning() && !failed)
+    {
+        return;
+    }
+
+    this->acquisition->stop();
+
+    // Whatever was still queued belongs to the plot too
+    if (this->acquisition->drain(*this->signalBuffer, this->recorder.get()) > 0)
+    {
+        double rate = this->config.sampleRateHz;
+        if (rate <= 0.0) rate = 1.0;
+
+        this->simulationTime = this->signalBuffer->timeAt(this->signalBuffer->size() - 1) + 1.0 / rate;
+    }
+
+    if (this->acquisition->droppedSamples() > 0)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogPlot, "Acquisition dropped %llu samples (UI too slow).",
+                  (unsigned long long)this->acquisition->droppedSamples());
+    }
+
+    // Thread is joined, the reader is ours again
+    if (this->rttReader)
+    {
+        // Setup failures before the attach have been logged by the thread already
+        if (failed && !this->rttReader->getLastError().empty())
+        {
+            this->Log(LogSource::APP, LogLevel::ERROR, LogRtt, "RTT stream stopped: %s", this->rttReader->getLastError().c_str());
+        }
+        this->Log(LogSource::APP, LogLevel::INFO, LogRtt, "RTT read %llu bytes.", (unsigned long long)this->rttReader->bytesRead());
+        this->rttReader.reset();
+    }
+
+    if (this->itmRows)
+    {
+        if (failed && this->swoSource)
+        {
+            this->Log(LogSource::APP, LogLevel::ERROR, LogSwo, "SWO stream stopped: %s", this->swoSource->getLastError().c_str());
+        }
+
+        const ItmDecoder& dec = this->itmRows->getDecoder();
+        this->Log(LogSource::APP, dec.overflowCount() > 0 ? LogLevel::WARN : LogLevel::INFO, LogSwo,
+                  "SWO: %llu bytes, %llu packets, %llu overflows, %llu invalid, %llu PC samples.",
+                  (unsigned long long)(this->swoSource ? this->swoSource->bytesRead() : 0),
+                  (unsigned long long)dec.packetCount(), (unsigned long long)dec.overflowCount(),
+                  (unsigned long long)dec.invalidCount(), (unsigned long long)this->itmRows->pcSampleCount());
+
+        this->itmRows.reset();
+        this->swoSource.reset();
+    }
+}
+
+// ------------------------------
+// Recording / replay
+// ------------------------------
+bool SessionManager::startRecording(const std::string& path)
+{
+    if (this->recorder)
+    {
+        return true;
+    }
+    if (this->replay)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogRec, "Close the replay before recording.");
+        return false;
+    }
+
+    std::vector<RecordingChannel> channels;
+    for (const auto& sig : this->plotSignals)
+    {
+        channels.push_back(RecordingChannel{sig.name, this->signalBuffer->format(sig.channel)});
+    }
+
+    auto writer = std::make_unique<RecordingWriter>();
+    std::string err;
+    if (!writer->open(path, channels, this->config.recordingCompress, err))
+    {
+        this->Log(LogSource::APP, LogLevel::ERROR, LogRec, "Recording: %s", err.c_str());
+        return false;
+    }
+
+    this->config.recordingPath = path;
+    this->recorder = std::move(writer);
+    this->Log(LogSource::APP, LogLevel::INFO, LogRec, "Recording %zu signals to %s.", channels.size(), path.c_str());
+    return true;
+}
+
+void SessionManager::stopRecording()
+{
+    if (!this->recorder)
+    {
+        return;
+    }
+
+    // Whatever the plot already has should be in the file too
+    if (this->acquisition->isRunning())
+    {
+        this->acquisition->drain(*this->signalBuffer, this->recorder.get());
+    }
+
+    this->recorder->close();
+
+    char dropped[64] = "";
+    if (this->recorder->droppedRows() > 0)
+    {
+        snprintf(dropped, sizeof(dropped), ", %llu samples dropped (disk too slow)", (unsigned long long)this->recorder->droppedRows());
+    }
+    const bool failed = this->recorder->hasFailed();
+    this->Log(LogSource::APP, failed ? LogLevel::ERROR : LogLevel::INFO, LogRec, "Recording stopped: %llu samples, %.1f MB%s. %s",
+              (unsigned long long)this->recorder->rowCount(), this->recorder->byteCount() / (1024.0 * 1024.0), dropped,
+              failed ? this->recorder->getLastError().c_str() : "");
+
+    this->recorder.reset();
+}
+
+bool SessionManager::openReplay(const std::string& path)
+{
+    this->stopRecording();
+    this->stopAcquisition();
+
+    auto reader = std::make_unique<RecordingReader>();
+    std::string err;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!reader->open(path, err))
+    {
+        this->Log(LogSource::APP, LogLevel::ERROR, LogRec, "Replay: %s", err.c_str());
+        return false;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    if (reader->wasRecovered())
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogRec, "Recording was not closed cleanly, index rebuilt from %zu chunks.",
+                  reader->getChunks().size());
+    }
+
+    if (!this->replay)
+    {
+        this->liveSignals.clear();
+        for (const auto& sig : this->plotSignals)
+        {
+            this->liveSignals.push_back(RecordingChannel{sig.name, this->signalBuffer->format(sig.channel)});
+        }
+    }
+
+    this->replay = std::move(reader);
+    this->plotSignals.clear();
+    this->signalBuffer->reset(this->config.plotCapacity, 0);
+    for (const auto& ch : this->replay->getChannels())
+    {
+        this->addPlotSignal(ch.name, ch.format);
+    }
+
+    this->Log(LogSource::APP, LogLevel::INFO, LogRec, "Replaying %s: %llu samples, %.1f s, %.1f MB (opened in %.1f ms).", path.c_str(),
+              (unsigned long long)this->replay->rowCount(), this->replay->lastTime() - this->replay->firstTime(),
+              this->replay->fileSize() / (1024.0 * 1024.0), ms);
+
+    this->loadReplayWindow(this->replay->firstTime());
+    return true;
+}
+
+void SessionManager::closeReplay()
+{
+    if (!this->replay)
+    {
+        return;
+    }
+
+    this->replay.reset();
+    this->plotSignals.clear();
+    this->signalBuffer->reset(this->config.plotCapacity, 0);
+    for (const auto& ch : this->liveSignals)
+    {
+        this->addPlotSignal(ch.name, ch.format);
+    }
+    this->Log(LogSource::APP, LogLevel::INFO, LogRec, "Replay closed.");
+}
+
+void SessionManager::seekReplay(double t)
+{
+    if (this->replay)
+    {
+        this->loadReplayWindow(t);
+    }
+}
+
+// Fills the plot buffer from the chunk holding t onwards, only those chunks get decoded
+void SessionManager::loadReplayWindow(double t)
+{
+    this->signalBuffer->clear();
+
+    const size_t channels = this->replay->channelCount();
+    const size_t capacity = this->signalBuffer->capacity();
+    const auto& chunks = this->replay->getChunks();
+
+    std::vector<double> times;
+    std::vector<double> values;
+    std::vector<double> row(channels);
+
+    for (size_t i = this->replay->findChunk(t); i < chunks.size() && this->signalBuffer->size() < capacity; i++)
+    {
+        if (!this->replay->readChunk(i, times, values))
+        {
+            this->Log(LogSource::APP, LogLevel::ERROR, LogRec, "Replay: chunk %zu is corrupt, stopping there.", i);
+            break;
+        }
+
+        const size_t rows = times.size();
+        for (size_t r = 0; r < rows && this->signalBuffer->size() < capacity; r++)
+        {
+            for (size_t c = 0; c < channels; c++) row[c] = values[c * rows + r];
+            this->signalBuffer->push(times[r], row.data());
+        }
+    }
+}
+
+// ------------------------------
+// Connection management
+// ------------------------------
+bool SessionManager::connectToTarget()
+{
+    if (this->connectionState == ConnectionState::CONNECTED)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, "Already connected.");
+        return true;
+    }
+
+    if (this->connectionState == ConnectionState::CONNECTING)
+    {
+        this->Log(LogSource::APP, LogLevel::INFO, "Already connecting...");
+        return true;
+    }
+
+    // Talk RSP straight to OpenOCD's gdb server if there is one
+    if (this->gdbClient->connect("127.0.0.1", this->config.gdbPort, 500))
+    {
+        this->simulated = false;
+        this->connectionState = ConnectionState::CONNECTED;
+
+        this->Log(LogSource::GDB, LogLevel::INFO, "Connected to gdb server on port %d (PacketSize %zu%s)", this->config.gdbPort,
+                  (size_t)this->gdbClient->getPacketSize(), this->gdbClient->isNoAck() ? ", no-ack mode" : "");
+
+        GdbStopReply stop;
+        if (this->gdbClient->queryStop(stop))
+        {
+            this->targetInfo.state = TargetState::HALTED;
+            this->refreshRegisters();
+        }
+
+        this->startDetection();
+        return true;
+    }
+
+    this->Log(LogSource::GDB, LogLevel::WARN, "%s, using simulated target.", this->gdbClient->getLastError().c_str());
+
+    // Fake connect
+    this->simulated = true;
+    this->connectionState = ConnectionState::CONNECTING;
+    this->connectionTimer = 0.0f;
+
+    this->Log(LogSource::OPENOCD, LogLevel::INFO, "Attempting connection (fake)...");
+    return true;
+}
+
+void SessionManager::disconnectFromTarget()
+{
+    if (this->connectionState == ConnectionState::DISCONNECTED)
+    {
+        return;
+    }
+
+    // TODO later: stop OpenOCD process
+    this->stopAcquisition();
+    this->gdbClient->disconnect();
+    this->connectionState = ConnectionState::DISCONNECTED;
+    this->targetInfo.state = TargetState::UNKNOWN;
+    this->targetDevice = nullptr; // The next connect may be another board
+
+    this->Log(LogSource::APP, LogLevel::INFO, "Disconnected from target.");
+}
+
+void SessionManager::startDetection()
+{
+    // Still busy from the last connect, its result is just as good
+    if (this->detection.valid())
+    {
+        return;
+    }
+
+    ProbeEndpoint endpoint;
+    endpoint.gdbPort = this->config.gdbPort;
+    DetectionCache* cache = this->detectionCache.get();
+
+    this->detection = std::async(std::launch::async, [endpoint, cache]()
+    {
+        PROFILE_THREAD("detect");
+
+        DiscoveryOptions options;
+        options.cache = cache;
+        options.timeoutMs = 500;
+        return probeEndpoint(endpoint, options);
+    });
+}
+
+void SessionManager::finishDetection()
+{
+    if (!this->detection.valid() || this->detection.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    const DetectedProbe probe = this->detection.get();
+    const DetectionResult& det = probe.result;
+    if (!det.success)
+    {
+        this->Log(LogSource::OPENOCD, LogLevel::WARN, LogTarget, "Could not identify the target: %s", det.errMsg.c_str());
+        return;
+    }
 
-    // Add 2 default signals for the plot
-    PlotSignal s1;
-    s1.name = "adc_filtered";
-    s1.visible = true;
+    const STM32Device* device = findSTM32Device(det.devID);
+    this->targetDevice = device;
+    if (device)
+    {
+        this->targetInfo.deviceName = device->name;
+    }
 
-    PlotSignal s2;
-    s2.name = "motor_rpm(norm)";
-    s2.visible = true;
+    this->Log(LogSource::OPENOCD, LogLevel::INFO, LogTarget, "Target is %s (%s, dev ID 0x%03X, %u KB flash, %s) on probe %s, %s in %.0f ms.",
+              device ? device->name : "an STM32", device ? cortexCoreName(device->core) : "?", det.devID,
+              (unsigned)det.flashSizeKb, det.configFileName.c_str(),
+              probe.serial.empty() ? "?" : probe.serial.c_str(), det.fromCache ? "confirmed from cache" : "probed",
+              probe.elapsedMs);
 
-    this->plotSignals.push_back(s1);
-    this->plotSignals.push_back(s2);
+    std::string err;
+    if (!this->detectionCache->save(err))
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogTarget, "Detection cache not saved: %s", err.c_str());
+    }
+}
 
-    this->Log("App", "INFO", "SessionManager initialized.");
-    this->Log("App", "INFO", "Not connected yet.");
-    this->runTarget();
+// ------------------------------
+// GDB helpers
+// ------------------------------
+void SessionManager::refreshRegisters()
+{
+    if (this->simulated)
+    {
+        return;
+    }
 
-    return true;
+    std::vector<uint32_t> regs;
+    if (!this->gdbClient->readRegisters(regs))
+    {
+        this->handleGdbError("Register read");
+        return;
+    }
+
+    // Cortex-M 'g' layout: r0-r12, sp, lr, pc, xPSR
+    if (regs.size() > 13) this->targetInfo.sp = regs[13];
+    if (regs.size() > 15) this->targetInfo.pc = regs[15];
+    if (regs.size() > 16) this->targetInfo.xpsr = regs[16];
+
+    this->refreshWatches();
 }
 
-void SessionManager::shutdown()
+void SessionManager::handleGdbError(const std::string& what)
 {
-    if (this->connectionState == ConnectionState::CONNECTED ||
-        this->connectionState == ConnectionState::CONNECTING)
+    this->Log(LogSource::GDB, LogLevel::ERROR, LogTarget, "%s failed: %s", what.c_str(), this->gdbClient->getLastError().c_str());
+
+    // Lost the server completely, nothing else will work either
+    if (!this->gdbClient->isConnected())
     {
-        this->disconnectFromTarget();
+        this->stopAcquisition();
+        this->connectionState = ConnectionState::ERROR;
+        this->targetInfo.state = TargetState::UNKNOWN;
     }
-
-    this->Log("App", "INFO", "SessionManager shutdown.");
 }
 
 // ------------------------------
-// Connection management
+// Target control (faked when there is no gdb server)
 // ------------------------------
-bool SessionManager::connectToTarget()
+void SessionManager::flashTarget()
 {
-    if (this->connectionState == ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED)
     {
-        this->Log("App", "WARN", "Already connected.");
-        return true;
+        this->Log(LogSource::APP, LogLevel::ERROR, LogTarget, "Not connected to target.");
+        return;
     }
 
-    if (this->connectionState == ConnectionState::CONNECTING)
+    if (this->elfPath.empty())
     {
-        this->Log("App", "INFO", "Already connecting...");
-        return true;
+        this->Log(LogSource::APP, LogLevel::ERROR, LogTarget, "No ELF file loaded.");
+        return;
     }
 
-    // Fake connect
-    this->connectionState = ConnectionState::CONNECTING;
-    this->connectionTimer = 0.0f;
+    if (this->simulated)
+    {
+        this->Log(LogSource::APP, LogLevel::INFO, LogTarget, "Simulated target, nothing to flash.");
+        return;
+    }
 
-    this->Log("OpenOCD", "INFO", "Attempting connection (fake)...");
-    return true;
+    if (this->flashJob->isRunning())
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogTarget, "Already flashing.");
+        return;
+    }
+
+    // The job maps the ELF and opens the TCL port itself, update() picks up the result
+    this->stopAcquisition();
+    this->flashJob->start(this->elfPath);
+    this->targetInfo.state = TargetState::UNKNOWN;
+    this->Log(LogSource::OPENOCD, LogLevel::INFO, LogTarget, "Flashing %s...", this->elfPath.c_str());
 }
 
-void SessionManager::disconnectFromTarget()
+void SessionManager::cancelFlash()
 {
-    if (this->connectionState == ConnectionState::DISCONNECTED)
+    if (this->flashJob->isRunning())
     {
-        return;
+        this->flashJob->cancel();
+        this->Log(LogSource::APP, LogLevel::INFO, LogTarget, "Cancelling flash after the current sector run...");
     }
+}
 
-    // TODO later: close GDB, stop OpenOCD process
-    this->connectionState = ConnectionState::DISCONNECTED;
-    this->targetInfo.state = TargetState::UNKNOWN;
+bool SessionManager::isFlashing() const
+{
+    return this->flashJob->isRunning();
+}
 
-    this->Log("App", "INFO", "Disconnected from target.");
+FlashPhase SessionManager::getFlashPhase() const
+{
+    return this->flashJob->getPhase();
 }
 
-// ------------------------------
-// Target control (still fake)
-// ------------------------------
-void SessionManager::flashTarget()
+float SessionManager::getFlashFraction() const
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    return this->flashJob->getFraction();
+}
+
+void SessionManager::finishFlash()
+{
+    DeltaFlashReport report;
+    std::string device;
+    if (!this->flashJob->takeReport(report, device))
     {
-        this->Log("App", "ERROR", "Not connected to target.");
         return;
     }
 
-    if (this->elfPath.empty())
+    if (!device.empty())
+    {
+        this->targetInfo.deviceName = device;
+    }
+
+    if (!report.success)
     {
-        this->Log("App", "ERROR", "No ELF file loaded.");
+        this->Log(LogSource::OPENOCD, report.cancelled ? LogLevel::WARN : LogLevel::ERROR, LogTarget,
+                  "Flash %s: %s (%zu sectors written so far).", report.cancelled ? "cancelled" : "failed",
+                  report.errMsg.c_str(), report.sectorsProgrammed);
+        this->targetInfo.state = TargetState::UNKNOWN;
         return;
     }
 
-    this->Log("GDB", "INFO", "Flashing target (not implemented yet)...");
-    this->Log("GDB", "INFO", "Flash complete (fake).");
+    if (report.bytesIgnored > 0)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogTarget, "%u bytes of the image load outside flash and were not written.",
+                  report.bytesIgnored);
+    }
+
+    if (report.fullProgram)
+    {
+        this->Log(LogSource::OPENOCD, LogLevel::INFO, LogTarget, "No sector layout, wrote the whole image (%u bytes) in %.0f ms.",
+                  report.bytesProgrammed, report.totalMs);
+    }
+    else
+    {
+        this->Log(LogSource::OPENOCD, LogLevel::INFO, LogTarget,
+                  "Flash complete: %zu of %zu sectors changed, %u bytes written, %u bytes skipped "
+                  "(compare %.0f ms %s, program %.0f ms, verify %.0f ms, total %.0f ms).",
+                  report.sectorsProgrammed, report.sectorsTotal, report.bytesProgrammed, report.bytesSkipped,
+                  report.compareMs, report.onTargetCrc ? "on target" : "read back", report.programMs, report.verifyMs,
+                  report.totalMs);
+        if (report.savedMs >= 0.0)
+        {
+            this->Log(LogSource::OPENOCD, LogLevel::INFO, LogTarget, "Skipping unchanged sectors saved about %.1f s.",
+                      report.savedMs / 1000.0);
+        }
+    }
+
+    this->targetInfo.state = TargetState::HALTED;
+    if (this->connectionState == ConnectionState::CONNECTED)
+    {
+        this->refreshRegisters();
+    }
 }
 
 void SessionManager::resetTarget()
 {
     if (this->connectionState != ConnectionState::CONNECTED)
     {
-        this->Log("App", "ERROR", "Not connected to target.");
+        this->Log(LogSource::APP, LogLevel::ERROR, LogTarget, "Not connected to target.");
         return;
     }
 
-    // Fake reset puts PC back to reset vector area
-    this->targetInfo.pc = 0x08000000;
-    this->targetInfo.state = TargetState::HALTED;
+    if (this->flashJob->isRunning())
+    {
+        return;
+    }
+
+    this->stopAcquisition();
+
+    if (!this->simulated)
+    {
+        std::string output;
+        if (!this->gdbClient->monitor("reset halt", output))
+        {
+            this->handleGdbError("Reset");
+            return;
+        }
+        this->targetInfo.state = TargetState::HALTED;
+        this->refreshRegisters();
+    }
+    else
+    {
+        // Fake reset puts PC back to reset vector area
+        this->targetInfo.pc = 0x08000000;
+        this->targetInfo.state = TargetState::HALTED;
+    }
 
-    this->Log("GDB", "INFO", "Reset target. PC=" + hex32(this->targetInfo.pc));
+    this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Reset target. PC=0x%08X", this->targetInfo.pc);
 }
 
 void SessionManager::haltTarget()
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED || this->flashJob->isRunning())
+    {
+        return;
+    }
+
+    this->stopAcquisition();
+    this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Halting target...");
+
+    if (!this->simulated)
     {
+        GdbStopReply stop;
+        if (!this->gdbClient->interrupt(stop))
+        {
+            this->handleGdbError("Halt");
+            return;
+        }
+        this->targetInfo.state = TargetState::HALTED;
+        this->refreshRegisters();
         return;
     }
 
     this->targetInfo.state = TargetState::HALTED;
-    this->Log("GDB", "INFO", "Halting target...");
 }
 
 void SessionManager::runTarget()
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED || this->flashJob->isRunning())
+    {
+        return;
+    }
+
+    if (!this->simulated && !this->gdbClient->continueTarget())
     {
+        this->handleGdbError("Continue");
         return;
     }
 
     this->targetInfo.state = TargetState::RUNNING;
-    this->Log("GDB", "INFO", "Continuing execution...");
+    this->startAcquisition();
+    this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Continuing execution...");
 }
 
 void SessionManager::stepInto()
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED || this->flashJob->isRunning())
     {
         return;
     }
 
     if (this->targetInfo.state != TargetState::HALTED)
     {
-        this->Log("GDB", "WARN", "Cannot step because target is not halted.");
+        this->Log(LogSource::GDB, LogLevel::WARN, LogTarget, "Cannot step because target is not halted.");
         return;
     }
 
     this->targetInfo.state = TargetState::STEPPING;
 
-    // Fake step (thumb) moves PC by 2
-    this->targetInfo.pc += 2;
+    if (!this->simulated)
+    {
+        GdbStopReply stop;
+        if (!this->gdbClient->step(stop))
+        {
+            // Still where it was, unless the connection went with it (handleGdbError sees to that)
+            this->targetInfo.state = TargetState::HALTED;
+            this->handleGdbError("Step");
+            return;
+        }
+        this->refreshRegisters();
+    }
+    else
+    {
+        // Fake step (thumb) moves PC by 2
+        this->targetInfo.pc += 2;
+    }
 
-    this->Log("GDB", "INFO", "Step into. PC=" + hex32(this->targetInfo.pc));
+    this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Step into. PC=0x%08X", this->targetInfo.pc);
 
     this->targetInfo.state = TargetState::HALTED;
 }
 
 void SessionManager::stepOver()
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED || this->flashJob->isRunning())
     {
         return;
     }
 
-    this->Log("GDB", "INFO", "Step over (same as stepInto for now).");
+    this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Step over (same as stepInto for now).");
     this->stepInto();
 }
 
 void SessionManager::stepOut()
 {
-    if (this->connectionState != ConnectionState::CONNECTED)
+    if (this->connectionState != ConnectionState::CONNECTED || this->flashJob->isRunning())
     {
         return;
     }
 
-    this->Log("GDB", "WARN", "Step out not implemented yet.");
+    this->Log(LogSource::GDB, LogLevel::WARN, LogTarget, "Step out not implemented yet.");
 }
 
 // ------------------------------
@@ -270,11 +1344,11 @@ bool SessionManager::loadSymbolsFromElf(const std::string& elfPath)
 
     if (this->elfPath.empty())
     {
-        this->Log("App", "ERROR", "ELF path is empty.");
+        this->Log(LogSource::APP, LogLevel::ERROR, LogElf, "ELF path is empty.");
         return false;
     }
 
-    this->Log("App", "INFO", "ELF file set: " + this->elfPath);
+    this->Log(LogSource::APP, LogLevel::INFO, LogElf, "ELF file set: %s", this->elfPath.c_str());
     return true;
 }
 
@@ -282,23 +1356,217 @@ bool SessionManager::loadSymbols()
 {
     if (this->elfPath.empty())
     {
-        this->Log("App", "ERROR", "No ELF file specified.");
+        this->Log(LogSource::APP, LogLevel::ERROR, LogElf, "No ELF file specified.");
+        return false;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Points into the old mapping, has to go before the file gets remapped. So does the
+    // watch sampler, it decodes with those types.
+    const bool resample = this->samplingWatches();
+    if (resample)
+    {
+        this->stopAcquisition();
+    }
+    this->dwarf->close();
+
+    // Mapping is cheap, the symbol index gets built on the first lookup (right below)
+    if (!this->elfFile->open(this->elfPath))
+    {
+        this->symbolsLoaded = false;
+        this->Log(LogSource::APP, LogLevel::ERROR, LogElf, "Failed to load %s: %s", this->elfPath.c_str(), this->elfFile->getLastError().c_str());
         return false;
     }
 
-    this->Log("GDB", "INFO", "Loading symbols from " + this->elfPath + " (fake)");
+    size_t count = this->elfFile->symbolCount();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
     this->symbolsLoaded = true;
-    this->Log("GDB", "INFO", "Symbols loaded successfully (fake).");
+
+    this->Log(LogSource::APP, LogLevel::INFO, LogElf, "Loaded %zu symbols, %zu sections in %.1f ms.", count,
+              this->elfFile->getSections().size(), ms);
+
+    if (count == 0)
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogElf, "No .symtab in this ELF (stripped?).");
+    }
+
+    // Only the unit headers get read here, DIEs are decoded when something is watched
+    if (this->dwarf->open(*this->elfFile))
+    {
+        this->Log(LogSource::APP, LogLevel::INFO, LogElf, "Debug info: %zu compile units%s.", this->dwarf->unitCount(),
+                  this->dwarf->hasNameIndex() ? ", .debug_names index" : "");
+    }
+    else
+    {
+        this->Log(LogSource::APP, LogLevel::WARN, LogElf, "%s, watches need it.", this->dwarf->getLastError().c_str());
+    }
+
+    // Old watches pointed at types from the previous file, resolve them again
+    std::vector<WatchEntry> old;
+    old.swap(this->watches);
+    this->watchPlanDirty = true;
+    for (const auto& w : old)
+    {
+        this->addWatch(w.expression);
+    }
+
+    if (resample)
+    {
+        this->startAcquisition();
+    }
+    return true;
+}
+
+const char* SessionManager::getSymbolAt(uint32_t addr)
+{
+    if (!this->symbolsLoaded)
+    {
+        return nullptr;
+    }
+
+    const ElfSymbol* sym = this->elfFile->findSymbolByAddress(addr);
+    return sym ? sym->name : nullptr;
+}
+
+// ------------------------------
+// Watches
+// ------------------------------
+bool SessionManager::addWatch(const std::string& expression)
+{
+    if (!this->dwarf->isOpen())
+    {
+        this->Log(LogSource::APP, LogLevel::ERROR, LogWatch, "Load an ELF with debug info before adding watches.");
+        return false;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    WatchEntry entry;
+    entry.expression = expression;
+    if (!this->dwarf->resolveWatch(expression, entry.target))
+    {
+        this->Log(LogSource::APP, LogLevel::ERROR, LogWatch, "Watch '%s': %s", expression.c_str(), this->dwarf->getLastError().c_str());
+        return false;
+    }
+    entry.typeName = DwarfInfo::typeName(entry.target.type);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    this->Log(LogSource::APP, LogLevel::INFO, LogWatch, "Watch '%s' -> %s at 0x%08X in %.2f ms (%zu/%zu units scanned, %zu types cached).",
+              expression.c_str(), entry.typeName.c_str(), entry.target.addr, ms,
+              this->dwarf->scannedUnitCount(), this->dwarf->unitCount(), this->dwarf->cachedTypeCount());
+
+    this->watches.push_back(entry);
+    this->watchPlanDirty = true;
+
+    // The plot columns are the watches, start over with the new one
+    if (this->samplingWatches())
+    {
+        this->stopAcquisition();
+        this->startAcquisition();
+    }
+
+    if (this->targetInfo.state == TargetState::HALTED)
+    {
+        this->refreshWatches();
+    }
     return true;
 }
 
+void SessionManager::removeWatch(size_t index)
+{
+    if (index < this->watches.size())
+    {
+        this->watches.erase(this->watches.begin() + index);
+        this->watchPlanDirty = true;
+
+        if (this->samplingWatches())
+        {
+            this->stopAcquisition();
+            this->startAcquisition();
+        }
+    }
+}
+
+void SessionManager::compileWatchPlan()
+{
+    std::vector<MemRegion> regions;
+    regions.reserve(this->watches.size());
+    for (const auto& w : this->watches)
+    {
+        regions.push_back(MemRegion{w.target.addr, w.target.size});
+    }
+
+    // Capped at one RSP packet worth of data so a merged read never gets split again
+    this->watchPlan.compile(regions, this->config.watchGapBytes, 4, (uint32_t)(this->gdbClient->getPacketSize() - 16) / 2);
+    this->watchPlanDirty = false;
+
+    this->Log(LogSource::APP, LogLevel::INFO, LogWatch, "Watch plan: %zu watches -> %zu reads (%u bytes for %u watched).",
+              this->watches.size(), this->watchPlan.getReads().size(), this->watchPlan.transferBytes(),
+              this->watchPlan.requestedBytes());
+}
+
+// All watches in as few bulk reads as the plan allows, only while halted (memory reads stall a running core)
+void SessionManager::refreshWatches()
+{
+    PROFILE_FUNCTION();
+
+    if (this->simulated || this->watches.empty())
+    {
+        return;
+    }
+
+    if (this->watchPlanDirty)
+    {
+        this->compileWatchPlan();
+    }
+
+    std::vector<GdbMemRange> ranges;
+    ranges.reserve(this->watchPlan.getReads().size());
+    for (const auto& r : this->watchPlan.getReads())
+    {
+        ranges.push_back(GdbMemRange{r.addr, r.len});
+    }
+
+    std::vector<std::vector<uint8_t>> data;
+    if (!this->gdbClient->readMemoryBatch(ranges, data))
+    {
+        for (auto& w : this->watches) w.value = "<error>";
+        this->handleGdbError("Watch read");
+        return;
+    }
+
+    // A refused read comes back empty, store() marks it so only its own watches show <unreadable>
+    for (size_t r = 0; r < data.size(); r++)
+    {
+        this->watchPlan.store(r, data[r].data(), data[r].size());
+    }
+
+    for (size_t i = 0; i < this->watches.size(); i++)
+    {
+        this->watches[i].value = DwarfInfo::formatValue(this->watches[i].target, this->watchPlan.regionData(i),
+                                                        this->watchPlan.regionLen(i));
+    }
+}
+
 // ------------------------------
 // Update (call once per frame)
 // ------------------------------
 void SessionManager::update(float delta)
 {
+    PROFILE_SCOPE("session.update");
+
     if (delta < 0.0f) delta = 0.0f;
 
+    {
+        PROFILE_SCOPE("log collect");
+        this->logStore->collect();
+    }
+
+    this->finishFlash();
+    this->finishDetection();
+
     // 1) Fake connection delay
     if (this->connectionState == ConnectionState::CONNECTING)
     {
@@ -312,8 +1580,8 @@ void SessionManager::update(float delta)
 
             this->targetInfo.state = TargetState::HALTED;
 
-            this->Log("OpenOCD", "INFO", "Listening on port 3333 for gdb connections");
-            this->Log("App", "INFO", "Connected to ST-LINK, target halted");
+            this->Log(LogSource::OPENOCD, LogLevel::INFO, "Listening on port 3333 for gdb connections");
+            this->Log(LogSource::APP, LogLevel::INFO, "Connected to ST-LINK, target halted");
         }
         return;
     }
@@ -326,75 +1594,78 @@ void SessionManager::update(float delta)
 
     // 3) Simulate some registers even when halted (just to show something)
     // These values are fake but stable-looking
-    if (this->targetInfo.state == TargetState::HALTED)
+    if (this->simulated && this->targetInfo.state == TargetState::HALTED)
     {
         this->targetInfo.sp = 0x20020000;
         this->targetInfo.xpsr = 0x01000000;
         this->targetInfo.cpuLoad = 0.02f;
     }
 
-    // 4) Only generate plot samples while RUNNING
+    // 4) Only collect plot samples while RUNNING
     if (this->targetInfo.state != TargetState::RUNNING)
     {
         return;
     }
 
-    this->simulationTime += delta;
-
-    float rate = this->config.sampleRateHz;
-    if (rate <= 0.0f) rate = 1.0f;
-
-    // How many samples should exist at this time?
-    int desiredCount = (int)std::floor(this->simulationTime * rate);
-
-    // Add samples until we reach desiredCount
-    while ((int)this->timeData.size() < desiredCount)
+    // A breakpoint (or anything else) may have stopped the real target
+    if (!this->simulated)
     {
-        float t = (float)this->timeData.size() / rate;
-        this->timeData.push_back(t);
-
-        // Make sure every signal gets a value
-        for (size_t i = 0; i < this->plotSignals.size(); i++)
+        GdbStopReply stop;
+        bool stopped = false;
+        if (!this->gdbClient->pollStop(stop, stopped))
         {
-            float y = 0.0f;
+            this->handleGdbError("Stop poll");
+            return;
+        }
+        if (stopped)
+        {
+            this->stopAcquisition();
+            this->targetInfo.state = TargetState::HALTED;
+            this->refreshRegisters();
+            this->Log(LogSource::GDB, LogLevel::INFO, LogTarget, "Target stopped (signal %d). PC=0x%08X", (int)stop.signal, this->targetInfo.pc);
+            return;
+        }
+    }
 
-            // Fake signal generation based on signal name
-            if (this->plotSignals[i].name == "adc_filtered")
-            {
-                y = 1.0f + 0.25f * std::sinf(t * 2.0f);
-            }
-            else if (this->plotSignals[i].name == "motor_rpm(norm)")
-            {
-                y = 0.8f + 0.20f * std::cosf(t * 1.3f);
-            }
-            else
-            {
-                // Any extra signal still gets some data
-                y = 0.5f + 0.1f * std::sinf(t * (1.0f + (float)i));
-            }
+    // Samples are produced on the acquisition thread, here we only collect them
+    if (this->acquisition->hasFailed())
+    {
+        this->stopAcquisition();
+        return;
+    }
 
-            this->plotSignals[i].data.push_back(y);
-        }
+    size_t received = 0;
+    {
+        PROFILE_SCOPE("acquisition drain");
+        received = this->acquisition->drain(*this->signalBuffer, this->recorder.get());
+    }
+    if (this->recorder && this->recorder->hasFailed())
+    {
+        this->stopRecording();
+    }
+    if (received > 0)
+    {
+        double rate = this->config.sampleRateHz;
+        if (rate <= 0.0) rate = 1.0;
+
+        this->simulationTime = this->signalBuffer->timeAt(this->signalBuffer->size() - 1) + 1.0 / rate;
 
         // Fake PC moving while running
-        this->targetInfo.pc += 4;
+        if (this->simulated) this->targetInfo.pc += 4 * (uint32_t)received;
     }
 
-    // Fake CPU load
-    this->targetInfo.cpuLoad = 0.15f;
-
-    // 5) Stop buffers from growing forever
-    const int maxSamples = 3000;
-    while ((int)this->timeData.size() > maxSamples)
+    // PC sampling tells the real load (sleep samples / all samples) and roughly where the core is
+    if (this->itmRows && this->itmRows->pcSampleCount() > this->lastPcSamples)
     {
-        this->timeData.erase(this->timeData.begin());
-
-        for (size_t i = 0; i < this->plotSignals.size(); i++)
-        {
-            if (!this->plotSignals[i].data.empty())
-            {
-                this->plotSignals[i].data.erase(this->plotSignals[i].data.begin());
-            }
-        }
+        uint64_t samples = this->itmRows->pcSampleCount();
+        uint64_t sleeps = this->itmRows->sleepSampleCount();
+        this->targetInfo.cpuLoad = 1.0f - (float)(sleeps - this->lastSleepSamples) / (float)(samples - this->lastPcSamples);
+        this->targetInfo.pc = this->itmRows->lastSampledPc();
+        this->lastPcSamples = samples;
+        this->lastSleepSamples = sleeps;
+        return;
     }
-}
+
+    // Fake CPU load
+    if (!this->itmRows) this->targetInfo.cpuLoad = 0.15f;
+}
\ No newline at end of file
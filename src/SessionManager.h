@@ -17,6 +17,29 @@
 #include <vector>
 #include <cstdint> // For uint32_t
 #include <memory> // For std::unique_ptr
+#include <future> // For std::future
+
+#include "plot/SignalBuffer.h"
+#include "plot/Decimator.h"
+#include "acquisition/AcquisitionThread.h"
+#include "acquisition/ReadPlan.h"
+#include "acquisition/SignalSource.h"
+#include "debug/DeltaFlasher.h"
+#include "debug/DwarfInfo.h"
+#include "debug/ProbeDiscovery.h"
+#include "recording/RecordingFormat.h"
+#include "util/LogStore.h"
+
+// Kept out of this header, it drags in the socket headers and those fight with raylib on Windows
+class GDB_Client;
+class ElfFile;
+class FlashJob;
+class DetectionCache;
+class RttReader;
+class SwoSource;
+class ItmRowBuilder;
+class RecordingWriter;
+class RecordingReader;
 
 /**
   * @brief Connection states for the debugging session
@@ -66,6 +89,15 @@ enum class ProbeType {STLINK, J_LINK, CMSISDAP};
  */
 enum class DebugInterface {SWD, JTAG};
 
+/**
+  * @brief Where the plot samples come from
+
+  - SAMPLED: the acquisition thread reads the signals at sampleRateHz.
+  - RTT: the firmware writes records into a SEGGER RTT up buffer.
+  - SWO: the firmware writes ITM stimulus ports, OpenOCD captures the SWO pin.
+*/
+enum class PlotSource {SAMPLED, RTT, SWO};
+
 // Data structure to hold application
 /**
   
@@ -81,6 +113,28 @@ struct AppConfig
     std::string lastProbeType = "";
 
     float sampleRateHz =20.0f;
+    int gdbPort = 3333; // OpenOCD gdb server port
+    size_t plotCapacity = 4096; // Samples kept per signal, rounded up to a power of two
+    DecimationMode plotDecimation = DecimationMode::MINMAX;
+    uint32_t watchGapBytes = 32; // Watches closer than this get read together
+
+    PlotSource plotSource = PlotSource::SAMPLED;
+
+    // SEGGER RTT streaming (records are described in debug/RttReader.h)
+    unsigned rttChannel = 0; // Up buffer index
+    uint32_t rttRamStart = 0x20000000; // Searched for the control block when the ELF has no _SEGGER_RTT
+    uint32_t rttRamSize = 0x20000;
+
+    // SWO / ITM trace (stimulus port n = plot signal n, see debug/ItmDecoder.h)
+    std::string swoInput = ":3344"; // OpenOCD's tpiu -output, host:port or a capture file to replay
+    double swoTimestampHz = 168e6; // Local timestamp clock, the core clock unless TSPrescale is set
+
+    size_t logHistoryLines = 1 << 20; // Console keeps this many, older ones are dropped in chunks
+    size_t logRingSlots = LogStore::DefaultRingSlots; // Records that fit between two frames, a full ring drops
+
+    // Session recording (format in recording/RecordingFormat.h)
+    std::string recordingPath = "session.stmrec";
+    bool recordingCompress = true; // Delta + varint chunks, about half the size of raw
 };
 
 //Target device information
@@ -101,8 +155,18 @@ struct TargetDeviceInfo
 struct PlotSignal 
 {
     std::string name = "";
-    std::vector<float> data;
+    size_t channel = 0; // Column in the SignalBuffer
     bool visible = true;
+    std::shared_ptr<const SignalSource> source; // What the simulated target produces for it
+};
+
+// One line in the Watch tab
+struct WatchEntry
+{
+    std::string expression = "";
+    std::string typeName = "";
+    std::string value = "--"; // Last value read from the target
+    DwarfWatchTarget target;
 };
 
 /**
@@ -130,22 +194,73 @@ class SessionManager
         
 
         // Plot data
-        std::vector<float> timeData;
         std::vector<PlotSignal> plotSignals;
+        std::unique_ptr<SignalBuffer> signalBuffer; // Signal buffer for data plotting
+        void addPlotSignal(const std::string& name, const ChannelFormat& format = ChannelFormat());
+
+        // Sampling runs on its own thread, update() only drains it
+        std::unique_ptr<AcquisitionThread> acquisition;
+        void startAcquisition();
+        void stopAcquisition();
+        AcquisitionThread::SampleFn makeSimulatedSampler() const;
+
+        // Set while an RTT stream runs, only touched from the UI thread once the acquisition thread is stopped
+        std::shared_ptr<RttReader> rttReader;
+        void startRttAcquisition();
+
+        // Real target in sampled mode: the numeric watches, read over the TCL port while the core runs.
+        // The thread holds DwarfType pointers, so a symbol reload stops it first.
+        void startWatchAcquisition();
+        bool samplingWatches() const;
+
+        // Same deal for an SWO stream. itmRows is also read by the UI thread (atomics only).
+        std::shared_ptr<SwoSource> swoSource;
+        std::shared_ptr<ItmRowBuilder> itmRows;
+        uint64_t lastPcSamples = 0;
+        uint64_t lastSleepSamples = 0;
+        void startSwoAcquisition();
+
+        // Everything drained from acquisition also goes here while recording
+        std::unique_ptr<RecordingWriter> recorder;
+
+        // While a recording is open the plot shows it instead of live data. The live signal
+        // names are kept so closing it can put them back.
+        std::unique_ptr<RecordingReader> replay;
+        std::vector<RecordingChannel> liveSignals;
+        void loadReplayWindow(double t);
 
         std::string elfPath = "";
         bool symbolsLoaded = false;
+        std::unique_ptr<ElfFile> elfFile; // Memory mapped firmware image + symbols
+        std::unique_ptr<DwarfInfo> dwarf; // Type info for watches, only decoded for what gets watched
+        std::unique_ptr<FlashJob> flashJob; // Flashing runs on its own thread, update() collects the result
+        void finishFlash();
+
+        // Which STM32 is on the other end, probed on a worker after each connect. Known probes are
+        // confirmed from the cache (loaded at startup, saved after each detection).
+        std::unique_ptr<DetectionCache> detectionCache;
+        std::future<DetectedProbe> detection;
+        const STM32Device* targetDevice = nullptr; // From the last detection, nullptr until one succeeds
+        void startDetection();
+        void finishDetection();
+
+        std::vector<WatchEntry> watches;
+        ReadPlan watchPlan; // Rebuilt only when the watch set changes
+        bool watchPlanDirty = true;
+        void compileWatchPlan();
+        void refreshWatches();
 
         // Timers
         float connectionTimer = 0.0f;
-        float simulationTime = 0.0f;
+        double simulationTime = 0.0; // Time stamp of the next sample
 
-        // Log stuff
-        std::vector<std::string> logMessages;
-        void addLogMessage(const std::string& message);
+        // Log stuff. Any thread may Log(), the UI thread collects once per update().
+        std::unique_ptr<LogStore> logStore;
 
-        //std::unique_ptr<GDB_Client> gdbClient; // GDB Client for target communication
-        //std::unique_ptr<SignalBuffer> signalBuffer; // Signal buffer for data plotting
+        std::unique_ptr<GDB_Client> gdbClient; // GDB Client for target communication
+        bool simulated = true; // No gdb server found, the target is faked
+        void refreshRegisters();
+        void handleGdbError(const std::string& what);
 
     public:
 
@@ -161,9 +276,14 @@ class SessionManager
         bool connectToTarget();
         void disconnectFromTarget();
         ConnectionState getConnectionState() const {return this->connectionState;}
+        bool isSimulated() const {return this->simulated;}
 
         //Target control stuff
         void flashTarget();
+        void cancelFlash();
+        bool isFlashing() const;
+        FlashPhase getFlashPhase() const;
+        float getFlashFraction() const; // Within the current phase
         void runTarget();
         void haltTarget();
         void resetTarget();
@@ -174,6 +294,15 @@ class SessionManager
         bool loadSymbolsFromElf(const std::string& elfPath);
         bool loadSymbols();
         const std::string& getElfPath() const {return this->elfPath;}
+        bool hasSymbols() const {return this->symbolsLoaded;}
+
+        // Function/object name at addr, nullptr if no symbols are loaded or nothing covers it
+        const char* getSymbolAt(uint32_t addr);
+
+        // Watch expressions: name(.member | [index])*
+        bool addWatch(const std::string& expression);
+        void removeWatch(size_t index);
+        const std::vector<WatchEntry>& getWatches() const {return this->watches;}
 
         TargetState getTargetState() const {return this->targetInfo.state;}
         const TargetDeviceInfo& getTargetInfo() const {return this->targetInfo;}
@@ -187,11 +316,34 @@ class SessionManager
         ProbeType getProbeType() const {return this->probeType;}
         DebugInterface getDebugInterface() const {return this->debugInterface;}
         const std::string& getTargetDevice() const {return this->targetInfo.deviceName;}
-        const std::vector<float>& getTimeData() const { return this->timeData; }
         const std::vector<PlotSignal>& getPlotSignals() const { return this->plotSignals; }
-
-        void Log(const std::string& src, const std::string& level, const std::string& message);
-        const std::vector<std::string>& getLogMessages() const {return this->logMessages;}
+        const SignalBuffer& getSignalBuffer() const { return *this->signalBuffer; }
+        void setPlotCapacity(size_t samples);
+        // Shown value = raw * scale + offset, takes effect on the next frame without touching stored samples
+        void setSignalScale(size_t index, double scale, double offset);
+        // Simulated target only: another plot signal fed by a synthetic generator ("chirp#3", ...)
+        bool addGeneratorSignal(GeneratorKind kind);
+        void setSampleRate(double hz);
+        uint64_t getDroppedSamples() const { return this->acquisition->droppedSamples(); }
+        void setPlotSource(PlotSource source);
+
+        bool startRecording(const std::string& path);
+        void stopRecording();
+        bool isRecording() const {return this->recorder != nullptr;}
+        const RecordingWriter* getRecorder() const {return this->recorder.get();}
+
+        // Maps the file and shows the plotCapacity samples starting at t
+        bool openReplay(const std::string& path);
+        void closeReplay();
+        void seekReplay(double t);
+        bool isReplaying() const {return this->replay != nullptr;}
+        const RecordingReader* getReplay() const {return this->replay.get();}
+
+        // printf style, formatted straight into the log ring (no allocation), fine from any thread
+        void Log(LogSource source, LogLevel level, const char* fmt, ...) LOG_PRINTF(4, 5);
+        void Log(LogSource source, LogLevel level, LogCategory category, const char* fmt, ...) LOG_PRINTF(5, 6);
+        const LogStore& getLog() const {return *this->logStore;}
+        void clearLog() {this->logStore->clear();}
 
         void update(float delta);
 };
@@ -0,0 +1,216 @@
+/* =============== AcquisitionThread.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Acquisition
+
+    Description:
+        Sampling loop + UI side drain.
+*/
+
+#include "AcquisitionThread.h"
+
+#include "plot/SignalBuffer.h"
+#include "recording/RecordingWriter.h"
+#include "util/Profiler.h"
+
+#include <algorithm> // min
+#include <chrono>
+#include <cmath> // floor
+
+AcquisitionThread::~AcquisitionThread()
+{
+    this->stop();
+}
+
+bool AcquisitionThread::start(double rateHz, size_t channels, SampleFn fn, double startTime)
+{
+    if (this->running.load() || !fn)
+    {
+        return false;
+    }
+
+    if (rateHz <= 0.0) rateHz = 1.0;
+
+    this->rateHz = rateHz;
+    this->startTime = startTime;
+    this->channels = channels;
+    this->sampleFn = std::move(fn);
+    this->resetQueue(rateHz);
+
+    this->running.store(true);
+    this->worker = std::thread(&AcquisitionThread::run, this);
+    return true;
+}
+
+bool AcquisitionThread::startStream(double expectedRateHz, size_t channels, StreamFn fn)
+{
+    if (this->running.load() || !fn)
+    {
+        return false;
+    }
+
+    this->channels = channels;
+    this->streamFn = std::move(fn);
+    this->resetQueue(expectedRateHz);
+
+    this->running.store(true);
+    this->worker = std::thread(&AcquisitionThread::runStream, this);
+    return true;
+}
+
+void AcquisitionThread::resetQueue(double rateHz)
+{
+    this->dropped.store(0);
+    this->failed.store(false);
+
+    // Room for about 2 seconds of samples, so a stalled frame (window drag, file dialog...)
+    // does not lose anything
+    size_t rows = (size_t)(rateHz * 2.0);
+    if (rows < 4096) rows = 4096;
+    this->queue.reset(rows * (this->channels + 1));
+}
+
+void AcquisitionThread::stop()
+{
+    this->running.store(false);
+
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+    this->failed.store(false);
+}
+
+void AcquisitionThread::run()
+{
+    using clock = std::chrono::steady_clock;
+    PROFILE_THREAD("acquisition");
+
+    const auto t0 = clock::now();
+    const auto minSleep = std::chrono::milliseconds(1);
+
+    const size_t rowSize = this->channels + 1;
+    const double dt = 1.0 / this->rateHz;
+    std::vector<double> rows(MaxBatch * rowSize, 0.0);
+    uint64_t k = 0; // Index of the next sample to produce
+
+    while (this->running.load(std::memory_order_relaxed))
+    {
+        // Every sample whose time has come gets produced now
+        const double elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+        const uint64_t due = (uint64_t)std::floor(elapsed * this->rateHz) + 1;
+
+        while (k < due)
+        {
+            PROFILE_SCOPE("sample batch");
+            const size_t n = (size_t)std::min<uint64_t>(due - k, MaxBatch);
+            for (size_t r = 0; r < n; r++)
+            {
+                rows[r * rowSize] = this->startTime + (double)(k + r) / this->rateHz;
+            }
+            this->sampleFn(rows[0], dt, n, rows.data() + 1, rowSize);
+
+            this->pushRows(rows.data(), n);
+            k += n;
+        }
+
+        // Sleep until the next sample is due, but never spin faster than 1 ms
+        auto next = t0 + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>((double)k / this->rateHz));
+        auto earliest = clock::now() + minSleep;
+        std::this_thread::sleep_until(next > earliest ? next : earliest);
+    }
+}
+
+void AcquisitionThread::runStream()
+{
+    PROFILE_THREAD("acquisition");
+
+    const size_t rowSize = this->channels + 1;
+    std::vector<double> rows;
+    rows.reserve(4096 * rowSize);
+
+    while (this->running.load(std::memory_order_relaxed))
+    {
+        PROFILE_SCOPE("stream poll");
+        rows.clear();
+        if (!this->streamFn(rows))
+        {
+            this->failed.store(true);
+            this->running.store(false);
+            break;
+        }
+
+        if (!rows.empty())
+        {
+            this->pushRows(rows.data(), rows.size() / rowSize);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Whole batch in one go, row by row only if the queue is nearly full
+void AcquisitionThread::pushRows(const double* rows, size_t count)
+{
+    const size_t rowSize = this->channels + 1;
+    if (this->queue.tryPush(rows, count * rowSize))
+    {
+        return;
+    }
+
+    for (size_t r = 0; r < count; r++)
+    {
+        if (!this->queue.tryPush(rows + r * rowSize, rowSize))
+        {
+            // UI is way behind, count it so it shows up instead of silently vanishing
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t AcquisitionThread::drain(SignalBuffer& buffer, RecordingWriter* recorder)
+{
+    const size_t rowSize = this->channels + 1;
+    if (buffer.channelCount() != this->channels)
+    {
+        return 0;
+    }
+
+    // Pull in chunks so the scratch buffer stays small
+    const size_t chunkRows = 1024;
+    this->drainScratch.resize(chunkRows * rowSize);
+
+    if (recorder && recorder->channelCount() != this->channels)
+    {
+        recorder = nullptr;
+    }
+
+    size_t moved = 0;
+    while (true)
+    {
+        size_t n = this->queue.pop(this->drainScratch.data(), this->drainScratch.size());
+        size_t rows = n / rowSize;
+
+        for (size_t r = 0; r < rows; r++)
+        {
+            const double* row = this->drainScratch.data() + r * rowSize;
+            buffer.push(row[0], row + 1);
+        }
+        if (recorder && rows > 0)
+        {
+            recorder->append(this->drainScratch.data(), rows);
+        }
+
+        moved += rows;
+        if (rows < chunkRows)
+        {
+            break;
+        }
+    }
+
+    return moved;
+}
+
+size_t AcquisitionThread::pendingSamples() const
+{
+    return this->queue.sizeApprox() / (this->channels + 1);
+}
@@ -0,0 +1,98 @@
+/* =============== AcquisitionThread.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Acquisition
+
+    Description:
+        Runs sampling on its own thread so the sample rate is not tied to the
+        raylib frame rate. Samples go through an SPSC queue and the UI thread
+        drains whatever piled up once per frame.
+*/
+
+#ifndef ACQUISITIONTHREAD_H
+#define ACQUISITIONTHREAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "acquisition/SpscQueue.h"
+
+class SignalBuffer;
+class RecordingWriter;
+
+/**
+  * @brief Owns the sampling thread and the queue between it and the UI
+
+  Each sample is pushed as one row of doubles: [time, ch0, ch1, ...], values raw (before
+  scale/offset, see SignalBuffer.h). The channel count is
+  fixed for a run, so adding a signal means stop() and start() again.
+  The thread wakes up every ~1 ms (or once per sample at low rates) and produces every
+  sample that is due by then in batches of up to MaxBatch rows, one SampleFn call and one
+  queue push per batch, so rates well above the frame rate (up to MHz) work fine.
+
+  startStream() is for sources that deliver samples in bursts with their own time stamps
+  (RTT): the thread just calls the source every ~1 ms and queues whatever rows it returns.
+*/
+class AcquisitionThread
+{
+    public:
+
+        // Fills the value columns of count rows for the samples at t0, t0 + dt, ... values points at
+        // the first value of the first row and rows are stride doubles apart. Called on the acquisition thread!
+        using SampleFn = std::function<void(double t0, double dt, size_t count, double* values, size_t stride)>;
+
+        // Appends complete rows [t, ch0, ch1, ...] for everything that came in since the last call.
+        // Returning false means the source is gone, the thread stops and hasFailed() is true until stop().
+        using StreamFn = std::function<bool(std::vector<double>& rows)>;
+
+    private:
+
+        SpscQueue<double> queue;
+        std::thread worker;
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> failed{false};
+
+        double rateHz = 20.0;
+        double startTime = 0.0;
+        size_t channels = 0;
+        SampleFn sampleFn;
+        StreamFn streamFn;
+
+        std::vector<double> drainScratch; // UI side only
+
+        void run();
+        void runStream();
+        void pushRows(const double* rows, size_t count);
+        void resetQueue(double rateHz);
+
+    public:
+
+        static constexpr size_t MaxBatch = 4096; // Rows per SampleFn call
+
+        AcquisitionThread() = default;
+        ~AcquisitionThread();
+
+        AcquisitionThread(const AcquisitionThread&) = delete;
+        AcquisitionThread& operator=(const AcquisitionThread&) = delete;
+
+        // startTime is the timestamp of the first sample (lets a resumed run continue the time axis)
+        bool start(double rateHz, size_t channels, SampleFn fn, double startTime = 0.0);
+        // expectedRateHz only sizes the queue
+        bool startStream(double expectedRateHz, size_t channels, StreamFn fn);
+        void stop();
+        bool isRunning() const {return this->running.load();}
+        bool hasFailed() const {return this->failed.load();}
+
+        // UI thread: moves every pending sample into the buffer, returns how many were moved.
+        // With a recorder the same rows are queued for disk too.
+        size_t drain(SignalBuffer& buffer, RecordingWriter* recorder = nullptr);
+
+        // Samples thrown away because the UI fell more than the queue length behind
+        uint64_t droppedSamples() const {return this->dropped.load();}
+        size_t pendingSamples() const;
+};
+
+#endif // ACQUISITIONTHREAD_H
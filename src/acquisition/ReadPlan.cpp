@@ -0,0 +1,120 @@
+/* =============== ReadPlan.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Watch read plan
+
+    Description:
+        Sort by address, then one greedy pass merges neighbours.
+*/
+
+#include "ReadPlan.h"
+
+#include <algorithm>
+#include <cstring>
+
+void ReadPlan::clear()
+{
+    this->reads.clear();
+    this->readOffsets.clear();
+    this->readValid.clear();
+    this->slots.clear();
+    this->staging.clear();
+    this->requested = 0;
+}
+
+void ReadPlan::compile(const std::vector<MemRegion>& regions, uint32_t gapBytes, uint32_t alignment,
+                       uint32_t maxReadBytes)
+{
+    this->clear();
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        alignment = 1;
+    }
+
+    // Widened bounds, kept 64 bit so regions at the top of the address space don't wrap
+    struct Span
+    {
+        uint64_t start;
+        uint64_t end;
+        size_t region;
+    };
+
+    std::vector<Span> spans;
+    spans.reserve(regions.size());
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        uint64_t start = regions[i].addr & ~(uint64_t)(alignment - 1);
+        uint64_t end = ((uint64_t)regions[i].addr + regions[i].len + alignment - 1) & ~(uint64_t)(alignment - 1);
+        spans.push_back(Span{start, std::max(end, start + alignment), i});
+        this->requested += regions[i].len;
+    }
+
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.start < b.start; });
+
+    this->slots.assign(regions.size(), Slot());
+
+    size_t i = 0;
+    while (i < spans.size())
+    {
+        uint64_t start = spans[i].start;
+        uint64_t end = spans[i].end;
+        size_t first = i++;
+
+        // Overlapping or within the gap: same read, unless that makes it too big
+        while (i < spans.size() && spans[i].start <= end + gapBytes)
+        {
+            uint64_t newEnd = std::max(end, spans[i].end);
+            if (maxReadBytes != 0 && newEnd - start > maxReadBytes && spans[i].start >= end)
+            {
+                break;
+            }
+            end = newEnd;
+            i++;
+        }
+
+        const uint32_t readIndex = (uint32_t)this->reads.size();
+        const uint32_t base = (uint32_t)this->staging.size();
+        this->reads.push_back(MemRegion{(uint32_t)start, (uint32_t)(end - start)});
+        this->readOffsets.push_back(base);
+        this->staging.resize(base + (size_t)(end - start));
+
+        for (size_t k = first; k < i; k++)
+        {
+            const MemRegion& r = regions[spans[k].region];
+            this->slots[spans[k].region] = Slot{readIndex, base + (uint32_t)(r.addr - start), r.len};
+        }
+    }
+
+    this->readValid.assign(this->reads.size(), false);
+}
+
+void ReadPlan::store(size_t read, const uint8_t* data, size_t len)
+{
+    if (read >= this->reads.size())
+    {
+        return;
+    }
+
+    const uint32_t want = this->reads[read].len;
+    if (!data || len < want)
+    {
+        this->readValid[read] = false;
+        return;
+    }
+
+    memcpy(this->staging.data() + this->readOffsets[read], data, want);
+    this->readValid[read] = true;
+}
+
+void ReadPlan::invalidate()
+{
+    std::fill(this->readValid.begin(), this->readValid.end(), false);
+}
+
+const uint8_t* ReadPlan::regionData(size_t region) const
+{
+    if (region >= this->slots.size() || !this->readValid[this->slots[region].read])
+    {
+        return nullptr;
+    }
+    return this->staging.data() + this->slots[region].offset;
+}
@@ -0,0 +1,77 @@
+/* =============== ReadPlan.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Watch read plan
+
+    Description:
+        Turns a set of watched (address, size) regions into the fewest bulk
+        memory reads. Regions closer than a gap threshold get merged, since
+        reading a few unused bytes is far cheaper than another round trip
+        to the probe. Replies land in one staging buffer and each region is
+        decoded straight out of it.
+*/
+
+#ifndef READPLAN_H
+#define READPLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MemRegion
+{
+    uint32_t addr = 0;
+    uint32_t len = 0;
+};
+
+/**
+  * @brief Compiled list of bulk reads for a watch set
+
+  compile() is the only expensive part (a sort), it should run when the watch set changes and not
+  per sample. Per sample it is: issue getReads(), store() each reply, read regions with regionData().
+*/
+class ReadPlan
+{
+    private:
+
+        struct Slot
+        {
+            uint32_t read = 0; // Index into reads
+            uint32_t offset = 0; // Into staging
+            uint32_t len = 0;
+        };
+
+        std::vector<MemRegion> reads;
+        std::vector<uint32_t> readOffsets; // Where each read starts in staging
+        std::vector<bool> readValid;
+        std::vector<Slot> slots; // One per compiled region, same order as the input
+        std::vector<uint8_t> staging;
+        uint32_t requested = 0;
+
+    public:
+
+        ReadPlan() = default;
+
+        /**
+          * @param gapBytes Regions at most this far apart share a read
+          * @param alignment Reads are widened to this (power of two), 4 keeps them word sized for the AP
+          * @param maxReadBytes Merging stops before a read gets bigger than this, 0 = no limit
+        */
+        void compile(const std::vector<MemRegion>& regions, uint32_t gapBytes, uint32_t alignment = 4,
+                     uint32_t maxReadBytes = 0);
+        void clear();
+
+        const std::vector<MemRegion>& getReads() const {return this->reads;}
+        size_t regionCount() const {return this->slots.size();}
+        uint32_t requestedBytes() const {return this->requested;}
+        uint32_t transferBytes() const {return (uint32_t)this->staging.size();}
+
+        // Copies the reply for read i into staging. A short or missing reply marks the read invalid.
+        void store(size_t read, const uint8_t* data, size_t len);
+        void invalidate();
+
+        // Bytes of region i from the last store(), nullptr if its read failed
+        const uint8_t* regionData(size_t region) const;
+        uint32_t regionLen(size_t region) const {return this->slots[region].len;}
+};
+
+#endif // READPLAN_H
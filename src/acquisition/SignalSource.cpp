@@ -0,0 +1,321 @@
+/* =============== SignalSource.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Synthetic signal sources
+
+    Description:
+        The generators. Batches are filled with plain loops over contiguous
+        arrays. Sine and chirp skip sin() per sample: 8 interleaved phasors are
+        rotated by a complex multiply, re-seeded exactly every 512 samples so
+        rounding never piles up. The 8 lanes are independent, so the compiler
+        can put them in vector registers.
+*/
+
+#include "SignalSource.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+constexpr double TwoPi = 6.283185307179586476925;
+constexpr size_t Lanes = 8;
+constexpr size_t Reseed = 512;
+
+inline double frac(double x)
+{
+    return x - std::floor(x);
+}
+
+// Phase given in cycles, reduced first so sin/cos don't lose digits on huge arguments
+inline void unitPhasor(double cycles, double& re, double& im)
+{
+    const double a = TwoPi * frac(cycles);
+    re = std::cos(a);
+    im = std::sin(a);
+}
+
+/**
+  * out[i] = offset + amplitude * sin(2 pi cycles(t0 + i * dt)) where cycles(t) is at most
+  * quadratic with second derivative sweep (cycles / s^2, 0 for a plain sine).
+*/
+template <typename Cycles>
+void oscillator(Cycles cycles, double sweep, double t0, double dt, size_t count, double amplitude, double offset, double* out)
+{
+    const double stride = (double)Lanes * dt;
+
+    // Phase step of a lane grows by this each time around (constant for a linear chirp)
+    double rr, ri;
+    unitPhasor(sweep * stride * stride, rr, ri);
+
+    for (size_t base = 0; base < count; base += Reseed)
+    {
+        const size_t n = std::min(Reseed, count - base);
+
+        double zr[Lanes], zi[Lanes], wr[Lanes], wi[Lanes];
+        for (size_t j = 0; j < Lanes; j++)
+        {
+            const double t = t0 + (double)(base + j) * dt;
+            const double c = cycles(t);
+            unitPhasor(c, zr[j], zi[j]);
+            unitPhasor(cycles(t + stride) - c, wr[j], wi[j]);
+        }
+
+        size_t i = 0;
+        for (; i + Lanes <= n; i += Lanes)
+        {
+            double* o = out + base + i;
+            for (size_t j = 0; j < Lanes; j++)
+            {
+                o[j] = offset + amplitude * zi[j];
+
+                const double r = zr[j] * wr[j] - zi[j] * wi[j];
+                zi[j] = zr[j] * wi[j] + zi[j] * wr[j];
+                zr[j] = r;
+
+                const double s = wr[j] * rr - wi[j] * ri;
+                wi[j] = wr[j] * ri + wi[j] * rr;
+                wr[j] = s;
+            }
+        }
+        for (size_t j = 0; i < n; i++, j++)
+        {
+            out[base + i] = offset + amplitude * zi[j];
+        }
+    }
+}
+
+// splitmix64 finalizer, good enough to make neighbouring counters look unrelated
+inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+class GeneratorBase : public SignalSource
+{
+    protected:
+
+        GeneratorParams params;
+
+    public:
+
+        explicit GeneratorBase(const GeneratorParams& params) : params(params) {}
+
+        const GeneratorParams& getParams() const override {return this->params;}
+};
+
+class SineSource : public GeneratorBase
+{
+    public:
+
+        using GeneratorBase::GeneratorBase;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            const double f = this->params.frequency;
+            const double c0 = this->params.phase / TwoPi;
+            oscillator([=](double t) {return f * t + c0;}, 0.0, t0, dt, count, this->params.amplitude,
+                       this->params.offset, out);
+        }
+};
+
+class ChirpSource : public GeneratorBase
+{
+    public:
+
+        using GeneratorBase::GeneratorBase;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            const double T = (this->params.period > 0.0) ? this->params.period : 1.0;
+            const double f0 = this->params.frequency;
+            const double k = (this->params.frequency2 - f0) / T;
+
+            // One oscillator run per sweep, the phase formula restarts at every sweep boundary
+            size_t i = 0;
+            while (i < count)
+            {
+                const double sweepStart = std::floor((t0 + (double)i * dt) / T) * T;
+                size_t end = count;
+                if (dt > 0.0)
+                {
+                    const double next = std::ceil((sweepStart + T - t0) / dt);
+                    if (next < (double)count) end = std::max(i + 1, (size_t)next);
+                }
+
+                oscillator([=](double t) {const double tau = t - sweepStart; return tau * (f0 + 0.5 * k * tau);}, k,
+                           t0 + (double)i * dt, dt, end - i, this->params.amplitude, this->params.offset, out + i);
+                i = end;
+            }
+        }
+};
+
+class NoiseSource : public GeneratorBase
+{
+    public:
+
+        using GeneratorBase::GeneratorBase;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            // Counter based: sample k always gets the same value, however the batches are cut
+            const int64_t k0 = (dt > 0.0) ? (int64_t)std::llround(t0 / dt) : 0;
+            const uint64_t key = (uint64_t)this->params.seed * 0x9E3779B97F4A7C15ull;
+
+            // Sum of 4 uniforms (16 bits each from one hash) is close enough to a gaussian,
+            // sqrt(3) makes the standard deviation 1
+            const double scale = this->params.amplitude * 1.7320508075688772 / 65536.0;
+            const double bias = this->params.offset - this->params.amplitude * 1.7320508075688772 * 2.0;
+            for (size_t i = 0; i < count; i++)
+            {
+                const uint64_t h = mix64(key + (uint64_t)(k0 + (int64_t)i));
+                const double sum = (double)(h & 0xFFFF) + (double)((h >> 16) & 0xFFFF) +
+                                   (double)((h >> 32) & 0xFFFF) + (double)(h >> 48);
+                out[i] = bias + scale * sum;
+            }
+        }
+};
+
+class StepSource : public GeneratorBase
+{
+    public:
+
+        using GeneratorBase::GeneratorBase;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            const double rate = (this->params.period > 0.0) ? 1.0 / this->params.period : 1.0;
+            const double duty = this->params.duty;
+            const double high = this->params.offset + this->params.amplitude;
+            const double low = this->params.offset;
+            for (size_t i = 0; i < count; i++)
+            {
+                out[i] = (frac((t0 + (double)i * dt) * rate) < duty) ? high : low;
+            }
+        }
+};
+
+class SawtoothSource : public GeneratorBase
+{
+    public:
+
+        using GeneratorBase::GeneratorBase;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            const double f = this->params.frequency;
+            const double c0 = this->params.phase / TwoPi;
+            const double a = this->params.amplitude;
+            const double b = this->params.offset;
+            for (size_t i = 0; i < count; i++)
+            {
+                out[i] = b + a * (2.0 * frac((t0 + (double)i * dt) * f + c0) - 1.0);
+            }
+        }
+};
+
+class BurstSource : public SineSource
+{
+    public:
+
+        using SineSource::SineSource;
+
+        void generate(double t0, double dt, size_t count, double* out) const override
+        {
+            SineSource::generate(t0, dt, count, out);
+
+            // Gate it, off means back to the offset
+            const double rate = (this->params.period > 0.0) ? 1.0 / this->params.period : 1.0;
+            const double duty = this->params.duty;
+            const double b = this->params.offset;
+            for (size_t i = 0; i < count; i++)
+            {
+                const double on = (frac((t0 + (double)i * dt) * rate) < duty) ? 1.0 : 0.0;
+                out[i] = b + (out[i] - b) * on;
+            }
+        }
+};
+
+} // namespace
+
+const char* generatorKindName(GeneratorKind kind)
+{
+    switch (kind)
+    {
+        case GeneratorKind::SINE: return "sine";
+        case GeneratorKind::CHIRP: return "chirp";
+        case GeneratorKind::NOISE: return "noise";
+        case GeneratorKind::STEP: return "step";
+        case GeneratorKind::SAWTOOTH: return "sawtooth";
+        case GeneratorKind::BURST: return "burst";
+    }
+    return "?";
+}
+
+std::shared_ptr<const SignalSource> SignalSource::create(const GeneratorParams& params)
+{
+    switch (params.kind)
+    {
+        case GeneratorKind::SINE: return std::make_shared<SineSource>(params);
+        case GeneratorKind::CHIRP: return std::make_shared<ChirpSource>(params);
+        case GeneratorKind::NOISE: return std::make_shared<NoiseSource>(params);
+        case GeneratorKind::STEP: return std::make_shared<StepSource>(params);
+        case GeneratorKind::SAWTOOTH: return std::make_shared<SawtoothSource>(params);
+        case GeneratorKind::BURST: return std::make_shared<BurstSource>(params);
+    }
+    return std::make_shared<SineSource>(params);
+}
+
+std::shared_ptr<const SignalSource> SignalSource::forName(const std::string& name, size_t index)
+{
+    GeneratorParams p;
+
+    // The two demo signals the session starts with
+    if (name == "adc_filtered")
+    {
+        p.amplitude = 0.25;
+        p.offset = 1.0;
+        p.frequency = 2.0 / TwoPi;
+        return create(p);
+    }
+    if (name == "motor_rpm(norm)")
+    {
+        p.amplitude = 0.20;
+        p.offset = 0.8;
+        p.frequency = 1.3 / TwoPi;
+        p.phase = TwoPi / 4.0; // cos
+        return create(p);
+    }
+
+    // "chirp", "chirp#2", ...
+    const std::string kind = name.substr(0, name.find('#'));
+    for (GeneratorKind k : {GeneratorKind::SINE, GeneratorKind::CHIRP, GeneratorKind::NOISE,
+                            GeneratorKind::STEP, GeneratorKind::SAWTOOTH, GeneratorKind::BURST})
+    {
+        if (kind != generatorKindName(k))
+        {
+            continue;
+        }
+
+        p.kind = k;
+        p.seed = (uint32_t)index + 1;
+        switch (k)
+        {
+            case GeneratorKind::CHIRP: p.frequency = 1.0; p.frequency2 = 50.0; p.period = 5.0; break;
+            case GeneratorKind::NOISE: p.amplitude = 0.1; break;
+            case GeneratorKind::STEP: p.period = 2.0; break;
+            case GeneratorKind::SAWTOOTH: p.frequency = 0.5; break;
+            case GeneratorKind::BURST: p.frequency = 20.0; p.duty = 0.2; break;
+            default: break;
+        }
+        return create(p);
+    }
+
+    // Any other signal still gets some data
+    p.amplitude = 0.1;
+    p.offset = 0.5;
+    p.frequency = (1.0 + (double)index) / TwoPi;
+    return create(p);
+}
@@ -0,0 +1,75 @@
+/* =============== SignalSource.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Synthetic signal sources
+
+    Description:
+        What the simulated target "measures". Each plot signal gets a source
+        when it is added (looked up by name once, not per sample), and the
+        acquisition thread asks it for a whole batch of samples at a time.
+        The generators are cheap enough to push the pipeline to MHz rates
+        without any hardware attached.
+*/
+
+#ifndef SIGNALSOURCE_H
+#define SIGNALSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class GeneratorKind {SINE, CHIRP, NOISE, STEP, SAWTOOTH, BURST};
+
+const char* generatorKindName(GeneratorKind kind);
+
+/**
+  * @brief Parameters shared by all generators
+
+  Every output is offset + amplitude * shape(t). Not every field means something to every kind:
+  - SINE: frequency, phase
+  - CHIRP: linear sweep from frequency to frequency2 over period, then starts over
+  - NOISE: seed, roughly gaussian with amplitude as the standard deviation
+  - STEP: amplitude for the first duty fraction of every period, 0 for the rest
+  - SAWTOOTH: frequency, ramps from -1 to 1
+  - BURST: a SINE that is only on for the first duty fraction of every period
+*/
+struct GeneratorParams
+{
+    GeneratorKind kind = GeneratorKind::SINE;
+    double amplitude = 1.0;
+    double offset = 0.0;
+    double frequency = 1.0; // Hz
+    double frequency2 = 10.0; // Hz, chirp end
+    double period = 1.0; // Seconds
+    double duty = 0.5; // 0..1
+    double phase = 0.0; // Radians
+    uint32_t seed = 1;
+};
+
+/**
+  * @brief One simulated signal
+
+  generate() is a pure function of time: no state is kept between calls, so one source can be
+  shared by the acquisition thread and the simulated firmware, and a batch split in two gives the
+  same samples as one big batch (up to rounding).
+*/
+class SignalSource
+{
+    public:
+
+        virtual ~SignalSource() = default;
+
+        // Writes the samples at t0, t0 + dt, ... t0 + (count - 1) * dt to out[0..count)
+        virtual void generate(double t0, double dt, size_t count, double* out) const = 0;
+
+        virtual const GeneratorParams& getParams() const = 0;
+
+        static std::shared_ptr<const SignalSource> create(const GeneratorParams& params);
+
+        // Source for a plot signal name. The demo signals keep their old shapes, a generator kind name
+        // ("chirp", "noise#3", ...) gets that generator with default parameters, anything else a
+        // slow sine that depends on index so extra signals don't sit on top of each other.
+        static std::shared_ptr<const SignalSource> forName(const std::string& name, size_t index);
+};
+
+#endif // SIGNALSOURCE_H
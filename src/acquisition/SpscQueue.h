@@ -0,0 +1,105 @@
+/* =============== SpscQueue.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Acquisition
+
+    Description:
+        Lock free single producer / single consumer ring. The acquisition
+        thread pushes, the UI thread pops, nobody ever waits on a mutex.
+*/
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <vector>
+
+/**
+  * @brief Bounded SPSC queue with bulk push/pop
+
+  head is only written by the consumer and tail only by the producer. Both just count up
+  forever and get masked when indexing, so full vs empty is never ambiguous.
+  tryPush() is all or nothing, which lets the producer push whole sample rows and the
+  consumer always sees complete rows.
+*/
+template <typename T>
+class SpscQueue
+{
+    private:
+
+        std::vector<T> slots;
+        size_t mask = 0;
+
+        alignas(64) std::atomic<size_t> head{0}; // Next slot to read (consumer)
+        alignas(64) std::atomic<size_t> tail{0}; // Next slot to write (producer)
+
+    public:
+
+        explicit SpscQueue(size_t capacity = 1024)
+        {
+            this->reset(capacity);
+        }
+
+        // Not thread safe, only call while neither side is running
+        void reset(size_t capacity)
+        {
+            size_t cap = 1;
+            while (cap < capacity)
+            {
+                cap <<= 1;
+            }
+
+            this->slots.assign(cap, T());
+            this->mask = cap - 1;
+            this->head.store(0, std::memory_order_relaxed);
+            this->tail.store(0, std::memory_order_relaxed);
+        }
+
+        size_t capacity() const {return this->slots.size();}
+
+        // Producer side
+        bool tryPush(const T* items, size_t n)
+        {
+            const size_t t = this->tail.load(std::memory_order_relaxed);
+            const size_t h = this->head.load(std::memory_order_acquire);
+
+            if (this->slots.size() - (t - h) < n)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < n; i++)
+            {
+                this->slots[(t + i) & this->mask] = items[i];
+            }
+
+            this->tail.store(t + n, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, returns how many items were copied into out
+        size_t pop(T* out, size_t maxItems)
+        {
+            const size_t h = this->head.load(std::memory_order_relaxed);
+            const size_t t = this->tail.load(std::memory_order_acquire);
+
+            size_t n = t - h;
+            if (n > maxItems) n = maxItems;
+
+            for (size_t i = 0; i < n; i++)
+            {
+                out[i] = this->slots[(h + i) & this->mask];
+            }
+
+            this->head.store(h + n, std::memory_order_release);
+            return n;
+        }
+
+        // Only a snapshot, the other side may be moving
+        size_t sizeApprox() const
+        {
+            return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+        }
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,674 @@
+/* =============== PipelineBench.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Pipeline benchmark
+
+    Description:
+        Headless benchmark of the data path, no window and no target:
+        signal store pushes, plot decimation (min/max and LTTB), log store
+        writes from several threads, ELF loading + symbol lookups and the
+        RSP packet codec. Every case reports throughput, p50 / p99 / max
+        latency and the peak RSS so far, as a table on stderr and as JSON
+        (stdout or --out) to diff between releases. Exits with 1 when a
+        case fails (lost log records, an ELF that does not load).
+
+        make bench BENCH_ARGS="--channels 4,16 --rate 10000,1000000 --out bench.json"
+*/
+
+#include "acquisition/SignalSource.h"
+#include "debug/ElfFile.h"
+#include "debug/GDB_Client.h"
+#include "plot/Decimator.h"
+#include "plot/SignalBuffer.h"
+#include "util/LogStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static double usSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+static size_t peakRssKb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    {
+        return pmc.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #ifdef __APPLE__
+        return (size_t)usage.ru_maxrss / 1024; // Bytes there
+    #else
+        return (size_t)usage.ru_maxrss;
+    #endif
+#endif
+}
+
+// ------------------------------
+// Options
+// ------------------------------
+struct BenchOptions
+{
+    std::vector<size_t> channels = {8};
+    std::vector<double> rates = {100000.0};
+    double seconds = 10.0; // Simulated seconds of samples per store run
+    size_t capacity = 1 << 20; // Samples kept per channel
+    int frames = 600; // Decimation frames per mode
+    int columns = 1600; // Plot width
+    size_t logThreads = 4;
+    size_t logRecords = 1000000; // Total, split over the threads
+    size_t symbols = 50000; // Synthetic ELF
+    std::string elfPath; // Real ELF instead of the synthetic one
+    std::string outPath; // JSON file, stdout if empty
+};
+
+static bool parseList(const char* text, std::vector<double>& out)
+{
+    out.clear();
+    const char* p = text;
+    while (*p)
+    {
+        char* end = nullptr;
+        double v = strtod(p, &end);
+        if (end == p || v <= 0.0) return false;
+        out.push_back(v);
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return false;
+    }
+    return !out.empty();
+}
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "usage: pipeline_bench [options]\n"
+        "  --channels N[,N...]   channel counts to run (default 8)\n"
+        "  --rate HZ[,HZ...]     sample rates to run (default 100000)\n"
+        "  --seconds S           simulated seconds pushed per run (default 10)\n"
+        "  --capacity N          samples kept per channel (default 1048576)\n"
+        "  --frames N            decimation frames per mode (default 600)\n"
+        "  --columns N           plot width in pixels (default 1600)\n"
+        "  --log-threads N       log producer threads (default 4)\n"
+        "  --log-records N       log records in total (default 1000000)\n"
+        "  --symbols N           symbols in the synthetic ELF (default 50000)\n"
+        "  --elf PATH            load this ELF instead of a synthetic one\n"
+        "  --out PATH            write the JSON here instead of stdout\n");
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h" || !value)
+        {
+            return false;
+        }
+        i++;
+
+        std::vector<double> list;
+        if (arg == "--channels")
+        {
+            if (!parseList(value, list)) return false;
+            opt.channels.clear();
+            for (double v : list) opt.channels.push_back((size_t)v);
+        }
+        else if (arg == "--rate")
+        {
+            if (!parseList(value, opt.rates)) return false;
+        }
+        else if (arg == "--seconds") opt.seconds = atof(value);
+        else if (arg == "--capacity") opt.capacity = (size_t)atoll(value);
+        else if (arg == "--frames") opt.frames = atoi(value);
+        else if (arg == "--columns") opt.columns = atoi(value);
+        else if (arg == "--log-threads") opt.logThreads = (size_t)atoll(value);
+        else if (arg == "--log-records") opt.logRecords = (size_t)atoll(value);
+        else if (arg == "--symbols") opt.symbols = (size_t)atoll(value);
+        else if (arg == "--elf") opt.elfPath = value;
+        else if (arg == "--out") opt.outPath = value;
+        else return false;
+    }
+
+    return opt.seconds > 0.0 && opt.capacity > 0 && opt.frames > 0 && opt.columns > 0 &&
+           opt.logThreads > 0 && opt.symbols > 0;
+}
+
+// ------------------------------
+// Results
+// ------------------------------
+struct BenchResult
+{
+    std::string name;
+    std::string params; // JSON object body, "\"channels\":8,..."
+    std::string unit; // What throughput counts
+    double items = 0.0;
+    double seconds = 0.0; // Time spent in the measured part only
+    std::vector<double> latencyUs; // One entry per measured operation
+    std::string latencyOf; // What one latency entry is
+    size_t peakRssKb = 0;
+    std::string extra; // More JSON fields for this case, ", \"dropped\": 12"
+};
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if (v.empty()) return 0.0;
+    size_t k = (size_t)(p * (double)(v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+struct LatencySummary
+{
+    double p50 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+static LatencySummary summarize(std::vector<double> v)
+{
+    LatencySummary s;
+    s.p50 = percentile(v, 0.50);
+    s.p99 = percentile(v, 0.99);
+    s.max = v.empty() ? 0.0 : *std::max_element(v.begin(), v.end());
+    return s;
+}
+
+static void printRow(const BenchResult& r)
+{
+    const LatencySummary lat = summarize(r.latencyUs);
+    const double rate = (r.seconds > 0.0) ? r.items / r.seconds : 0.0;
+    fprintf(stderr, "%-16s %-34s %12.4g %-10s p50 %9.2f us  p99 %9.2f us  max %9.2f us  rss %7zu KB\n",
+            r.name.c_str(), r.params.c_str(), rate, (r.unit + "/s").c_str(), lat.p50, lat.p99, lat.max, r.peakRssKb);
+}
+
+static void writeJson(FILE* f, const BenchOptions& opt, const std::vector<BenchResult>& results)
+{
+    fprintf(f, "{\n  \"version\": 1,\n");
+    fprintf(f, "  \"config\": {\"seconds\": %g, \"capacity\": %zu, \"frames\": %d, \"columns\": %d, "
+               "\"log_threads\": %zu, \"log_records\": %zu, \"symbols\": %zu, \"elf\": \"%s\"},\n",
+            opt.seconds, opt.capacity, opt.frames, opt.columns, opt.logThreads, opt.logRecords, opt.symbols,
+            opt.elfPath.empty() ? "synthetic" : "file");
+    fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        const LatencySummary lat = summarize(r.latencyUs);
+        fprintf(f, "    {\"name\": \"%s\", \"params\": {%s}, \"unit\": \"%s\", \"items\": %.0f, \"seconds\": %.6f, "
+                   "\"throughput_per_s\": %.6g, \"latency_of\": \"%s\", \"p50_us\": %.3f, \"p99_us\": %.3f, "
+                   "\"max_us\": %.3f, \"peak_rss_kb\": %zu%s}%s\n",
+                r.name.c_str(), r.params.c_str(), r.unit.c_str(), r.items, r.seconds,
+                (r.seconds > 0.0) ? r.items / r.seconds : 0.0, r.latencyOf.c_str(), lat.p50, lat.p99, lat.max,
+                r.peakRssKb, r.extra.c_str(), (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(f, "  ],\n  \"peak_rss_kb\": %zu\n}\n", peakRssKb());
+}
+
+// ------------------------------
+// Signal store + decimation
+// ------------------------------
+
+// Mixed storage types, like a real session (integer ADC values next to floats)
+static const SampleType ChannelTypes[] = {SampleType::F32, SampleType::I16, SampleType::U32, SampleType::F64};
+static const GeneratorKind ChannelKinds[] = {GeneratorKind::SINE, GeneratorKind::CHIRP, GeneratorKind::NOISE,
+                                             GeneratorKind::SAWTOOTH, GeneratorKind::STEP, GeneratorKind::BURST};
+
+static void benchSignals(const BenchOptions& opt, size_t channels, double rate, std::vector<BenchResult>& results)
+{
+    char params[96];
+    snprintf(params, sizeof(params), "\"channels\": %zu, \"rate_hz\": %g", channels, rate);
+
+    SignalBuffer buffer(opt.capacity, 0);
+    std::vector<std::shared_ptr<const SignalSource>> sources;
+    for (size_t c = 0; c < channels; c++)
+    {
+        ChannelFormat fmt;
+        fmt.type = ChannelTypes[c % 4];
+        buffer.addChannel(fmt);
+
+        GeneratorParams gp;
+        gp.kind = ChannelKinds[c % 6];
+        gp.amplitude = 1000.0;
+        gp.frequency = 1.0 + (double)c;
+        gp.seed = (uint32_t)c + 1;
+        sources.push_back(SignalSource::create(gp));
+    }
+
+    // One batch = 1 ms of samples, what the acquisition thread hands over at most per wakeup
+    const size_t batch = std::max<size_t>(1, (size_t)(rate / 1000.0));
+    const size_t total = (size_t)(opt.seconds * rate);
+    const double dt = 1.0 / rate;
+
+    std::vector<double> columns(channels * batch);
+    std::vector<double> row(channels);
+
+    BenchResult store;
+    store.name = "signal_store";
+    store.params = params;
+    store.unit = "samples";
+    store.latencyOf = "1 ms batch";
+    store.latencyUs.reserve(total / batch + 1);
+
+    for (size_t k = 0; k < total; k += batch)
+    {
+        const size_t n = std::min(batch, total - k);
+        const double t0 = (double)k * dt;
+        for (size_t c = 0; c < channels; c++)
+        {
+            sources[c]->generate(t0, dt, n, columns.data() + c * batch);
+        }
+
+        const auto start = Clock::now();
+        for (size_t r = 0; r < n; r++)
+        {
+            for (size_t c = 0; c < channels; c++) row[c] = columns[c * batch + r];
+            buffer.push(t0 + (double)r * dt, row.data());
+        }
+        const double us = usSince(start);
+
+        store.latencyUs.push_back(us);
+        store.seconds += us * 1e-6;
+        store.items += (double)(n * channels);
+    }
+    store.peakRssKb = peakRssKb();
+    results.push_back(store);
+
+    // Decimation, half the frames on the whole buffer (pyramid), half zoomed in (raw samples)
+    if (buffer.empty()) return;
+    const double tFirst = buffer.timeAt(0);
+    const double tLast = buffer.timeAt(buffer.size() - 1);
+    const double span = tLast - tFirst;
+
+    std::vector<DecimatedSeries> series(channels);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> pos(0.0, 1.0);
+
+    for (DecimationMode mode : {DecimationMode::MINMAX, DecimationMode::LTTB})
+    {
+        BenchResult dec;
+        dec.name = (mode == DecimationMode::MINMAX) ? "decimate_minmax" : "decimate_lttb";
+        dec.params = params;
+        dec.unit = "frames";
+        dec.latencyOf = "frame, all channels";
+        dec.latencyUs.reserve(opt.frames);
+
+        for (int f = 0; f < opt.frames; f++)
+        {
+            double xMin = tFirst, xMax = tLast;
+            if (f % 2 == 1)
+            {
+                // A window a few thousand samples wide somewhere in the history
+                const double width = std::min(span, 4.0 * opt.columns * dt);
+                xMin = tFirst + pos(rng) * (span - width);
+                xMax = xMin + width;
+            }
+
+            const auto start = Clock::now();
+            for (size_t c = 0; c < channels; c++)
+            {
+                decimateSignal(buffer, c, xMin, xMax, opt.columns, mode, series[c]);
+            }
+            const double us = usSince(start);
+
+            dec.latencyUs.push_back(us);
+            dec.seconds += us * 1e-6;
+            dec.items += 1.0;
+        }
+        dec.peakRssKb = peakRssKb();
+        results.push_back(dec);
+    }
+}
+
+// ------------------------------
+// Log store
+// ------------------------------
+// Like the app: the threads log a frame's worth, the UI collects, next frame. A frame is one ring
+// full, the most the app's ring holds between two collects. Anything dropped is a failure, not a
+// number to read past.
+static bool benchLog(const BenchOptions& opt, std::vector<BenchResult>& results)
+{
+    LogStore store(1 << 20, LogStore::DefaultRingSlots);
+    const LogCategory category = LogCategory::intern("bench");
+
+    const size_t perFrame = LogStore::DefaultRingSlots / opt.logThreads;
+    const size_t perThread = opt.logRecords / opt.logThreads;
+    std::vector<std::vector<double>> latencies(opt.logThreads);
+    for (auto& lat : latencies) lat.reserve(perThread);
+
+    BenchResult collect;
+    collect.name = "log_collect";
+    collect.latencyOf = "collect, one frame";
+
+    const auto start = Clock::now();
+    for (size_t first = 0; first < perThread; first += perFrame)
+    {
+        const size_t count = std::min(perFrame, perThread - first);
+
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < opt.logThreads; t++)
+        {
+            producers.emplace_back([&, t]()
+            {
+                std::vector<double>& lat = latencies[t];
+                for (size_t i = first; i < first + count; i++)
+                {
+                    const auto t0 = Clock::now();
+                    store.write(LogSource::APP, LogLevel::INFO, category, "thread %zu record %zu value %.3f", t, i, i * 0.5);
+                    lat.push_back(usSince(t0));
+                }
+            });
+        }
+        for (auto& p : producers) p.join();
+
+        const auto t0 = Clock::now();
+        collect.items += (double)store.collect();
+        const double us = usSince(t0);
+        collect.latencyUs.push_back(us);
+        collect.seconds += us * 1e-6;
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "\"threads\": %zu, \"ring\": %zu", opt.logThreads, LogStore::DefaultRingSlots);
+    char extra[64];
+    snprintf(extra, sizeof(extra), ", \"dropped\": %llu", (unsigned long long)store.droppedCount());
+
+    BenchResult r;
+    r.name = "log_store";
+    r.params = params;
+    r.extra = extra;
+    r.unit = "records";
+    r.latencyOf = "write";
+    r.items = (double)(perThread * opt.logThreads);
+    r.seconds = secondsSince(start);
+    for (auto& lat : latencies) r.latencyUs.insert(r.latencyUs.end(), lat.begin(), lat.end());
+    r.peakRssKb = peakRssKb();
+    results.push_back(r);
+
+    collect.params = params;
+    collect.extra = extra;
+    collect.unit = "records";
+    collect.peakRssKb = r.peakRssKb;
+    results.push_back(collect);
+
+    if (store.droppedCount() > 0)
+    {
+        fprintf(stderr, "log_store: %llu of %zu records dropped\n", (unsigned long long)store.droppedCount(),
+                perThread * opt.logThreads);
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------
+// ELF
+// ------------------------------
+
+// ELF32 with a .text section and symbols count functions / objects in shuffled order,
+// which is all ElfFile looks at
+static bool writeSyntheticElf(const std::string& path, size_t count)
+{
+    struct Sym { uint32_t name, value, size; uint8_t info, other; uint16_t shndx; };
+    struct Shdr { uint32_t name, type, flags, addr, offset, size, link, info, addralign, entsize; };
+
+    std::string strtab(1, '\0');
+    std::vector<Sym> syms(1); // Entry 0 is the null symbol
+    for (size_t i = 0; i < count; i++)
+    {
+        char name[32];
+        const bool func = (i % 2 == 0);
+        snprintf(name, sizeof(name), func ? "function_%zu" : "variable_%zu", i);
+
+        Sym s = {};
+        s.name = (uint32_t)strtab.size();
+        s.value = func ? (0x08000000u + (uint32_t)i * 16u) | 1u : 0x20000000u + (uint32_t)i * 16u;
+        s.size = 16;
+        s.info = func ? 2 : 1;
+        s.shndx = 1;
+        syms.push_back(s);
+        strtab.append(name, strlen(name) + 1);
+    }
+    std::shuffle(syms.begin() + 1, syms.end(), std::mt19937(7));
+
+    const std::string shstrtab = std::string("\0.text\0.symtab\0.strtab\0.shstrtab\0", 34);
+    const std::vector<uint8_t> text(64 * 1024, 0xBF);
+
+    std::vector<uint8_t> file(52, 0);
+    auto append = [&file](const void* p, size_t n) -> uint32_t
+    {
+        uint32_t off = (uint32_t)file.size();
+        file.insert(file.end(), (const uint8_t*)p, (const uint8_t*)p + n);
+        return off;
+    };
+
+    const uint32_t textOff = append(text.data(), text.size());
+    const uint32_t symOff = append(syms.data(), syms.size() * sizeof(Sym));
+    const uint32_t strOff = append(strtab.data(), strtab.size());
+    const uint32_t shstrOff = append(shstrtab.data(), shstrtab.size());
+
+    Shdr sh[5] = {};
+    sh[1] = {1, 1, 6, 0x08000000u, textOff, (uint32_t)text.size(), 0, 0, 4, 0};
+    sh[2] = {7, 2, 0, 0, symOff, (uint32_t)(syms.size() * sizeof(Sym)), 3, 1, 4, sizeof(Sym)};
+    sh[3] = {15, 3, 0, 0, strOff, (uint32_t)strtab.size(), 0, 0, 1, 0};
+    sh[4] = {23, 3, 0, 0, shstrOff, (uint32_t)shstrtab.size(), 0, 0, 1, 0};
+    const uint32_t shOff = append(sh, sizeof(sh));
+
+    // Header: ELFCLASS32, little endian, EXEC, ARM
+    uint8_t* h = file.data();
+    memcpy(h, "\x7f" "ELF\x01\x01\x01", 7);
+    const uint16_t half[] = {2, 40};
+    memcpy(h + 16, half, sizeof(half));
+    const uint32_t words[] = {1, 0x08000001u, 0, shOff, 0x05000200u};
+    memcpy(h + 20, words, sizeof(words));
+    const uint16_t tail[] = {52, 32, 0, sizeof(Shdr), 5, 4};
+    memcpy(h + 40, tail, sizeof(tail));
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = fwrite(file.data(), 1, file.size(), f) == file.size();
+    return (fclose(f) == 0) && ok;
+}
+
+static bool benchElf(const BenchOptions& opt, std::vector<BenchResult>& results)
+{
+    std::string path = opt.elfPath;
+    const bool synthetic = path.empty();
+    if (synthetic)
+    {
+        std::error_code ec;
+        path = (std::filesystem::temp_directory_path(ec) / "pipeline_bench.elf").string();
+        if (!writeSyntheticElf(path, opt.symbols))
+        {
+            fprintf(stderr, "can't write %s\n", path.c_str());
+            return false;
+        }
+    }
+
+    // Open + both symbol indexes, what loading a firmware costs before the first lookup
+    BenchResult load;
+    load.name = "elf_load";
+    load.unit = "loads";
+    load.latencyOf = "open + index";
+
+    ElfFile elf;
+    size_t symbolCount = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        const auto start = Clock::now();
+        if (!elf.open(path))
+        {
+            fprintf(stderr, "%s: %s\n", path.c_str(), elf.getLastError().c_str());
+            return false;
+        }
+        symbolCount = elf.symbolCount();
+        elf.findSymbol("main");
+        const double us = usSince(start);
+
+        load.latencyUs.push_back(us);
+        load.seconds += us * 1e-6;
+        load.items += 1.0;
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "\"symbols\": %zu", symbolCount);
+    load.params = params;
+    load.peakRssKb = peakRssKb();
+    results.push_back(load);
+
+    // Lookups the way the app does them: PC -> function, watch name -> symbol
+    std::vector<uint32_t> addrs;
+    std::vector<std::string> names;
+    const ElfSection* text = elf.findSection(".text");
+    std::mt19937 rng(99);
+    for (int i = 0; i < 4096; i++)
+    {
+        addrs.push_back(text ? text->addr + (uint32_t)(rng() % std::max<uint32_t>(1, text->size)) : (uint32_t)rng());
+        char name[32];
+        snprintf(name, sizeof(name), "variable_%u", (unsigned)(rng() % std::max<size_t>(1, opt.symbols)) | 1u);
+        names.push_back(name);
+    }
+
+    BenchResult lookup;
+    lookup.name = "elf_lookup";
+    lookup.params = params;
+    lookup.unit = "lookups";
+    lookup.latencyOf = "1024 lookups";
+    size_t found = 0;
+    for (int round = 0; round < 200; round++)
+    {
+        const size_t base = (size_t)(round % 4) * 1024;
+        const auto start = Clock::now();
+        for (size_t i = base; i < base + 1024; i++)
+        {
+            found += (i % 2 == 0) ? (elf.findSymbolByAddress(addrs[i]) != nullptr) : (elf.findSymbol(names[i]) != nullptr);
+        }
+        const double us = usSince(start);
+
+        lookup.latencyUs.push_back(us);
+        lookup.seconds += us * 1e-6;
+        lookup.items += 1024.0;
+    }
+    lookup.peakRssKb = peakRssKb();
+    results.push_back(lookup);
+
+    elf.close();
+    if (synthetic)
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+    return found > 0 || symbolCount == 0;
+}
+
+// ------------------------------
+// RSP codec
+// ------------------------------
+static void benchRsp(std::vector<BenchResult>& results)
+{
+    // A full 'm' reply at OpenOCD's usual PacketSize (0x3fff) is about 8 KB of data as hex
+    const size_t bytes = 8000;
+    std::vector<uint8_t> memory(bytes);
+    std::mt19937 rng(5);
+    for (auto& b : memory) b = (uint8_t)rng();
+
+    BenchResult r;
+    r.name = "rsp_codec";
+    char params[64];
+    snprintf(params, sizeof(params), "\"packet_bytes\": %zu", bytes);
+    r.params = params;
+    r.unit = "bytes";
+    r.latencyOf = "encode + frame + unframe + decode";
+
+    std::string payload;
+    std::vector<uint8_t> decoded;
+    for (int i = 0; i < 2000; i++)
+    {
+        memory[i % bytes] ^= 0x5A; // Not the same packet every time
+
+        const auto start = Clock::now();
+        const std::string packet = GDB_Client::frame(GDB_Client::bytesToHex(memory.data(), memory.size()));
+        const bool ok = GDB_Client::unframe(packet.data(), packet.size(), payload) &&
+                        GDB_Client::hexToBytes(payload, decoded);
+        const double us = usSince(start);
+
+        if (!ok || decoded.size() != bytes)
+        {
+            fprintf(stderr, "rsp_codec: round trip failed\n");
+            return;
+        }
+        r.latencyUs.push_back(us);
+        r.seconds += us * 1e-6;
+        r.items += (double)bytes;
+    }
+    r.peakRssKb = peakRssKb();
+    results.push_back(r);
+}
+
+// ------------------------------
+// Main
+// ------------------------------
+int main(int argc, char** argv)
+{
+    BenchOptions opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<BenchResult> results;
+    for (size_t channels : opt.channels)
+    {
+        for (double rate : opt.rates)
+        {
+            benchSignals(opt, channels, rate, results);
+        }
+    }
+    bool ok = benchLog(opt, results);
+    ok = benchElf(opt, results) && ok;
+    benchRsp(results);
+
+    for (const BenchResult& r : results)
+    {
+        printRow(r);
+    }
+
+    FILE* out = stdout;
+    if (!opt.outPath.empty())
+    {
+        out = fopen(opt.outPath.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "can't create %s\n", opt.outPath.c_str());
+            return 1;
+        }
+    }
+    writeJson(out, opt, results);
+    if (out != stdout) fclose(out);
+
+    return ok ? 0 : 1;
+}
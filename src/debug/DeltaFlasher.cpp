@@ -0,0 +1,693 @@
+/* =============== DeltaFlasher.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Delta flash programming
+
+    Description:
+        Image loading, sector layout, host and target CRCs and the actual
+        erase/program calls. Programming goes through "flash write_image
+        erase" on a temporary .bin per run of changed sectors, so OpenOCD's
+        own flash loader does the work (OpenOCD runs on this machine).
+*/
+
+#include "DeltaFlasher.h"
+#include "ElfFile.h"
+#include "OpenOCDTcl.h"
+#include "STM32Devices.h"
+#include "util/Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+// ------------------------------
+// CRC32
+// ------------------------------
+uint32_t DeltaFlasher::crc32(const uint8_t* data, size_t len, uint32_t crc)
+{
+    static const auto table = []()
+    {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Same CRC on the target, Thumb-1 only so it runs on every core we support.
+//   in:  r0 = address, r1 = length in bytes, r2 = 0xFFFFFFFF
+//   out: r0 = CRC before the final inversion, then BKPT halts the core
+// A nibble at a time through a 16 entry table that sits right after the code.
+static const uint16_t CrcHelperCode[] =
+{
+    0xA30B, //     adr   r3, table
+    0x260F, //     movs  r6, #15
+    0x2900, // 1:  cmp   r1, #0
+    0xD010, //     beq   2f
+    0x7804, //     ldrb  r4, [r0]
+    0x3001, //     adds  r0, #1
+    0x4062, //     eors  r2, r4
+    0x0015, //     movs  r5, r2
+    0x4035, //     ands  r5, r6
+    0x00AD, //     lsls  r5, r5, #2
+    0x595D, //     ldr   r5, [r3, r5]
+    0x0912, //     lsrs  r2, r2, #4
+    0x406A, //     eors  r2, r5
+    0x0015, //     movs  r5, r2
+    0x4035, //     ands  r5, r6
+    0x00AD, //     lsls  r5, r5, #2
+    0x595D, //     ldr   r5, [r3, r5]
+    0x0912, //     lsrs  r2, r2, #4
+    0x406A, //     eors  r2, r5
+    0x3901, //     subs  r1, #1
+    0xE7EC, //     b     1b
+    0x0010, // 2:  movs  r0, r2
+    0xBE00, //     bkpt  #0
+    0x46C0, //     nop   (table alignment)
+};
+
+std::vector<uint8_t> DeltaFlasher::crcHelperImage()
+{
+    std::vector<uint8_t> image;
+    for (uint16_t h : CrcHelperCode)
+    {
+        image.push_back((uint8_t)h);
+        image.push_back((uint8_t)(h >> 8));
+    }
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 4; k++) c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+        for (int b = 0; b < 4; b++) image.push_back((uint8_t)(c >> (8 * b)));
+    }
+    return image;
+}
+
+// ------------------------------
+// Image and layout
+// ------------------------------
+bool DeltaFlasher::loadImage(const ElfFile& elf, FlashImage& image, std::string& err)
+{
+    image = FlashImage();
+
+    std::vector<const ElfSegment*> loads;
+    for (const ElfSegment& seg : elf.getSegments())
+    {
+        if (seg.type == ElfFile::PT_LOAD && seg.fileSize > 0 && seg.data)
+        {
+            loads.push_back(&seg);
+        }
+    }
+    std::sort(loads.begin(), loads.end(), [](const ElfSegment* a, const ElfSegment* b) { return a->paddr < b->paddr; });
+
+    for (const ElfSegment* seg : loads)
+    {
+        if (!image.chunks.empty())
+        {
+            FlashImage::Chunk& last = image.chunks.back();
+            const uint64_t lastEnd = (uint64_t)last.addr + last.data.size();
+            if (seg->paddr < lastEnd)
+            {
+                char msg[96];
+                snprintf(msg, sizeof(msg), "Load segments overlap at 0x%08X", seg->paddr);
+                err = msg;
+                return false;
+            }
+            if (seg->paddr == lastEnd)
+            {
+                last.data.insert(last.data.end(), seg->data, seg->data + seg->fileSize);
+                image.totalBytes += seg->fileSize;
+                continue;
+            }
+        }
+
+        FlashImage::Chunk chunk;
+        chunk.addr = seg->paddr;
+        chunk.data.assign(seg->data, seg->data + seg->fileSize);
+        image.chunks.push_back(std::move(chunk));
+        image.totalBytes += seg->fileSize;
+    }
+
+    if (image.chunks.empty())
+    {
+        err = "No loadable segments in " + elf.getPath();
+        return false;
+    }
+    return true;
+}
+
+bool DeltaFlasher::readSectorLayout(OpenOCDTcl& tcl, const std::vector<FlashBank>& banks, const STM32Device* device,
+                                    std::vector<FlashSector>& layout, std::string& err)
+{
+    layout.clear();
+
+    for (size_t b = 0; b < banks.size(); b++)
+    {
+        const FlashBank& bank = banks[b];
+        if (bank.size == 0)
+        {
+            continue;
+        }
+
+        // "\t#  3: 0x0000c000 (0x4000 16kB) not protected", offsets are from the bank base
+        std::string info;
+        if (!tcl.eval("flash info " + std::to_string(b), info, 3000))
+        {
+            err = tcl.getLastError();
+            return false;
+        }
+
+        const size_t before = layout.size();
+        size_t pos = 0;
+        while (pos < info.size())
+        {
+            size_t end = info.find('\n', pos);
+            if (end == std::string::npos) end = info.size();
+            const std::string line = info.substr(pos, end - pos);
+            pos = end + 1;
+
+            const size_t hash = line.find('#');
+            unsigned offset = 0, size = 0;
+            if (hash != std::string::npos && sscanf(line.c_str() + hash, "#%*d: 0x%x (0x%x", &offset, &size) == 2 &&
+                size > 0 && offset < bank.size)
+            {
+                layout.push_back(FlashSector{bank.base + offset, size});
+            }
+        }
+
+        // Uniform pages we can cut ourselves. Mixed sector sizes we can't guess, that bank gets no layout.
+        if (layout.size() == before && device && !device->sectored && device->pageSize > 0)
+        {
+            for (uint32_t offset = 0; offset < bank.size; offset += device->pageSize)
+            {
+                layout.push_back(FlashSector{bank.base + offset, device->pageSize});
+            }
+        }
+    }
+
+    std::sort(layout.begin(), layout.end(), [](const FlashSector& a, const FlashSector& b) { return a.addr < b.addr; });
+    return true;
+}
+
+void DeltaFlasher::splitImage(const FlashImage& image, const std::vector<FlashSector>& layout, uint8_t fill,
+                              std::vector<FlashSector>& sectors, std::vector<uint8_t>& contents)
+{
+    sectors.clear();
+    contents.clear();
+
+    size_t c = 0;
+    for (const FlashSector& sector : layout)
+    {
+        const uint64_t sectorEnd = (uint64_t)sector.addr + sector.size;
+
+        // Chunks are sorted, skip the ones that end before this sector
+        while (c < image.chunks.size() && image.chunks[c].addr + (uint64_t)image.chunks[c].data.size() <= sector.addr)
+        {
+            c++;
+        }
+
+        bool touched = false;
+        for (size_t k = c; k < image.chunks.size() && image.chunks[k].addr < sectorEnd; k++)
+        {
+            const FlashImage::Chunk& chunk = image.chunks[k];
+            const uint64_t from = std::max<uint64_t>(chunk.addr, sector.addr);
+            const uint64_t to = std::min<uint64_t>(chunk.addr + (uint64_t)chunk.data.size(), sectorEnd);
+            if (from >= to)
+            {
+                continue;
+            }
+
+            if (!touched)
+            {
+                touched = true;
+                sectors.push_back(sector);
+                contents.resize(contents.size() + sector.size, fill);
+            }
+            uint8_t* dst = contents.data() + contents.size() - sector.size;
+            std::copy(chunk.data.begin() + (from - chunk.addr), chunk.data.begin() + (to - chunk.addr),
+                      dst + (from - sector.addr));
+        }
+    }
+}
+
+// ------------------------------
+// Target side
+// ------------------------------
+bool DeltaFlasher::targetCrcs(OpenOCDTcl& tcl, const STM32Device* device, const std::vector<FlashSector>& sectors,
+                              std::vector<uint32_t>& crcs, bool& onTarget, std::string& err)
+{
+    PROFILE_FUNCTION();
+
+    crcs.assign(sectors.size(), 0);
+    std::vector<bool> done(sectors.size(), false);
+    onTarget = false;
+
+    // The flash loader shares this RAM, so the helper is uploaded again every time
+    const std::vector<uint8_t> helper = crcHelperImage();
+    if (device && device->ram[0].size >= helper.size() && tcl.writeMemory(device->ram[0].base, helper.data(), (uint32_t)helper.size()))
+    {
+        const uint32_t at = device->ram[0].base;
+
+        // One script for all sectors. The timeout allows ~30 cycles per byte at 4 MHz (MSI after reset).
+        std::string script = "set r {}; foreach {a n t} {";
+        int totalMs = 2000;
+        char item[64];
+        for (const FlashSector& s : sectors)
+        {
+            const int t = 500 + (int)(s.size / 128);
+            totalMs += t + 50;
+            snprintf(item, sizeof(item), " 0x%X %u %d", s.addr, s.size, t);
+            script += item;
+        }
+        snprintf(item, sizeof(item), "0x%X", at);
+        script += std::string(" } { set v x; catch { "
+                              "reg r0 $a; reg r1 $n; reg r2 0xFFFFFFFF; reg primask 1; reg xPSR 0x01000000; reg pc ") +
+                  item + "; resume; wait_halt $t; regexp {0x[0-9a-fA-F]+} [reg r0] v }; lappend r $v }; set r";
+
+        std::string reply;
+        if (tcl.eval(script, reply, totalMs))
+        {
+            size_t pos = 0;
+            for (size_t i = 0; i < sectors.size() && pos < reply.size(); i++)
+            {
+                size_t end = reply.find(' ', pos);
+                if (end == std::string::npos) end = reply.size();
+                const std::string field = reply.substr(pos, end - pos);
+                pos = end + 1;
+
+                if (field.compare(0, 2, "0x") == 0)
+                {
+                    crcs[i] = ~(uint32_t)strtoul(field.c_str(), nullptr, 16);
+                    done[i] = true;
+                    onTarget = true;
+                }
+            }
+        }
+    }
+
+    // Whatever the helper didn't cover gets read back, in pieces that each fit a TCL reply timeout
+    std::vector<uint8_t> buffer;
+    for (size_t i = 0; i < sectors.size(); i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+
+        const uint32_t slice = 16 * 1024;
+        buffer.resize(std::min(slice, sectors[i].size));
+        uint32_t crc = 0;
+        for (uint32_t offset = 0; offset < sectors[i].size; offset += slice)
+        {
+            const uint32_t len = std::min(slice, sectors[i].size - offset);
+            if (!tcl.readMemory(sectors[i].addr + offset, len, buffer.data()))
+            {
+                err = "Reading back flash failed: " + tcl.getLastError();
+                return false;
+            }
+            crc = crc32(buffer.data(), len, crc);
+        }
+        crcs[i] = crc;
+    }
+    return true;
+}
+
+// One program call: a sector aligned run of changed sectors, staged in a temporary .bin that
+// OpenOCD reads itself (it runs on this machine)
+struct ProgramPiece
+{
+    uint32_t addr = 0;
+    size_t len = 0;
+    size_t sectors = 0;
+    const uint8_t* data = nullptr;
+    std::filesystem::path file;
+};
+
+static bool stagePiece(ProgramPiece& piece, std::string& err)
+{
+    PROFILE_FUNCTION();
+
+    std::error_code ec;
+    char name[64];
+    snprintf(name, sizeof(name), "stm32dbg-flash-%08X-%lld.bin", piece.addr,
+             (long long)std::chrono::steady_clock::now().time_since_epoch().count());
+    piece.file = std::filesystem::temp_directory_path(ec) / name;
+
+    std::ofstream out(piece.file, std::ios::binary);
+    out.write((const char*)piece.data, (std::streamsize)piece.len);
+    if (!out)
+    {
+        err = "Can't write " + piece.file.string();
+        return false;
+    }
+    return true;
+}
+
+static bool writeImage(OpenOCDTcl& tcl, const std::string& path, const char* addrAndType, size_t len, std::string& err)
+{
+    PROFILE_SCOPE("flash write_image");
+
+    const std::string script = "if {[catch {flash write_image erase {" + path + "} " + addrAndType +
+                               "} e]} {set r \"ERR $e\"} else {set r OK}";
+
+    // Slow parts manage a few KB/s with the erase, so allow for that
+    std::string reply;
+    if (!tcl.eval(script, reply, 30000 + (int)(len / 2)))
+    {
+        err = tcl.getLastError();
+        return false;
+    }
+    if (reply != "OK")
+    {
+        err = reply.compare(0, 4, "ERR ") == 0 ? reply.substr(4) : reply;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------
+// Flashing
+// ------------------------------
+const char* flashPhaseName(FlashPhase phase)
+{
+    switch (phase)
+    {
+        case FlashPhase::IDLE: return "Idle";
+        case FlashPhase::PREPARING: return "Preparing";
+        case FlashPhase::COMPARING: return "Comparing";
+        case FlashPhase::PROGRAMMING: return "Programming";
+        case FlashPhase::VERIFYING: return "Verifying";
+        case FlashPhase::DONE: return "Done";
+    }
+    return "?";
+}
+
+DeltaFlashReport DeltaFlasher::flash(OpenOCDTcl& tcl, const ElfFile& elf, const STM32Device* device,
+                                     FlashProgress* progress)
+{
+    PROFILE_FUNCTION();
+
+    using clock = std::chrono::steady_clock;
+    auto msSince = [](clock::time_point t) { return std::chrono::duration<double, std::milli>(clock::now() - t).count(); };
+    const auto start = clock::now();
+
+    FlashProgress unused;
+    FlashProgress& prog = progress ? *progress : unused;
+    auto enter = [&prog](FlashPhase phase, uint32_t todo)
+    {
+        prog.bytesDone.store(0);
+        prog.bytesTodo.store(todo);
+        prog.phase.store(phase);
+    };
+
+    DeltaFlashReport report;
+    std::string err;
+    std::string reply;
+    auto cancelled = [&]()
+    {
+        if (!prog.cancel.load()) return false;
+        report.cancelled = true;
+        report.errMsg = "Cancelled";
+        return true;
+    };
+
+    enter(FlashPhase::PREPARING, 0);
+
+    // Copying the segments out of the ELF happens while the target resets and reports its banks
+    FlashImage image;
+    std::string imageErr;
+    auto loading = std::async(std::launch::async, [&]() { return loadImage(elf, image, imageErr); });
+
+    if (!tcl.eval("reset halt", reply, 5000))
+    {
+        report.errMsg = "reset halt: " + tcl.getLastError();
+        return report;
+    }
+
+    std::vector<FlashBank> banks;
+    std::vector<FlashSector> layout;
+    if (!readFlashBanks(tcl, banks, err) || !readSectorLayout(tcl, banks, device, layout, err))
+    {
+        report.errMsg = "Flash layout: " + err;
+        return report;
+    }
+
+    if (!loading.get())
+    {
+        report.errMsg = imageErr;
+        return report;
+    }
+    if (cancelled())
+    {
+        return report;
+    }
+
+    // L0/L1 flash erases to zeros, everything else to ones
+    uint8_t fill = 0xFF;
+    for (const FlashBank& bank : banks)
+    {
+        if (bank.driver == "stm32lx") fill = 0x00;
+    }
+
+    // Segments that load into RAM (or anywhere else outside flash) are not ours to program
+    FlashImage inFlash;
+    for (const FlashImage::Chunk& chunk : image.chunks)
+    {
+        for (const FlashBank& bank : banks)
+        {
+            const uint64_t from = std::max<uint64_t>(chunk.addr, bank.base);
+            const uint64_t to = std::min<uint64_t>(chunk.addr + (uint64_t)chunk.data.size(), (uint64_t)bank.base + bank.size);
+            if (from < to)
+            {
+                FlashImage::Chunk part;
+                part.addr = (uint32_t)from;
+                part.data.assign(chunk.data.begin() + (from - chunk.addr), chunk.data.begin() + (to - chunk.addr));
+                inFlash.totalBytes += (uint32_t)(to - from);
+                inFlash.chunks.push_back(std::move(part));
+            }
+        }
+    }
+    std::sort(inFlash.chunks.begin(), inFlash.chunks.end(),
+              [](const FlashImage::Chunk& a, const FlashImage::Chunk& b) { return a.addr < b.addr; });
+    report.bytesIgnored = image.totalBytes - inFlash.totalBytes;
+    image = std::move(inFlash);
+
+    if (image.chunks.empty())
+    {
+        report.errMsg = "Nothing in the image loads into flash";
+        return report;
+    }
+
+    std::vector<FlashSector> sectors;
+    std::vector<uint8_t> contents;
+    splitImage(image, layout, fill, sectors, contents);
+
+    uint32_t covered = 0;
+    for (const FlashImage::Chunk& chunk : image.chunks)
+    {
+        for (const FlashSector& s : sectors)
+        {
+            const uint64_t from = std::max<uint64_t>(chunk.addr, s.addr);
+            const uint64_t to = std::min<uint64_t>(chunk.addr + (uint64_t)chunk.data.size(), (uint64_t)s.addr + s.size);
+            if (from < to) covered += (uint32_t)(to - from);
+        }
+    }
+
+    if (covered < image.totalBytes)
+    {
+        // Part of the flash image is in a bank we have no sector layout for, so we can't tell
+        // what an erase would take with it. OpenOCD programs the ELF itself the ordinary way.
+        report.fullProgram = true;
+        enter(FlashPhase::PROGRAMMING, image.totalBytes);
+        const auto t = clock::now();
+        if (!writeImage(tcl, elf.getPath(), "elf", image.totalBytes, report.errMsg))
+        {
+            return report;
+        }
+        prog.bytesDone.store(image.totalBytes);
+        report.programMs = msSince(t);
+        report.bytesTotal = report.bytesProgrammed = image.totalBytes;
+    }
+    else
+    {
+        report.sectorsTotal = sectors.size();
+        for (const FlashSector& s : sectors) report.bytesTotal += s.size;
+
+        std::vector<size_t> offsets(sectors.size());
+        size_t offset = 0;
+        for (size_t i = 0; i < sectors.size(); i++)
+        {
+            offsets[i] = offset;
+            offset += sectors[i].size;
+        }
+
+        // Compare. The host CRCs are worked out while the target does its own.
+        enter(FlashPhase::COMPARING, report.bytesTotal);
+        auto t = clock::now();
+        std::vector<uint32_t> hostCrc(sectors.size());
+        auto hashing = std::async(std::launch::async, [&]()
+        {
+            for (size_t i = 0; i < sectors.size(); i++)
+            {
+                hostCrc[i] = crc32(contents.data() + offsets[i], sectors[i].size);
+            }
+        });
+
+        std::vector<uint32_t> targetCrc;
+        const bool compared = this->targetCrcs(tcl, device, sectors, targetCrc, report.onTargetCrc, report.errMsg);
+        hashing.wait();
+        if (!compared)
+        {
+            return report;
+        }
+        prog.bytesDone.store(report.bytesTotal);
+
+        std::vector<size_t> changed;
+        for (size_t i = 0; i < sectors.size(); i++)
+        {
+            if (hostCrc[i] != targetCrc[i]) changed.push_back(i);
+        }
+        report.compareMs = msSince(t);
+
+        // Adjacent changed sectors go in one call, cut every MaxPieceBytes so progress moves
+        // and cancel gets a chance to stop between calls
+        std::vector<ProgramPiece> pieces;
+        uint32_t todo = 0;
+        for (size_t k = 0; k < changed.size(); k++)
+        {
+            const size_t i = changed[k];
+            const bool extends = !pieces.empty() && k > 0 && changed[k - 1] + 1 == i &&
+                                 pieces.back().addr + pieces.back().len == sectors[i].addr &&
+                                 pieces.back().len + sectors[i].size <= MaxPieceBytes;
+            if (!extends)
+            {
+                ProgramPiece piece;
+                piece.addr = sectors[i].addr;
+                piece.data = contents.data() + offsets[i];
+                pieces.push_back(piece);
+            }
+            pieces.back().len += sectors[i].size;
+            pieces.back().sectors++;
+            todo += sectors[i].size;
+        }
+
+        // Program. The next piece's file is written while OpenOCD erases and programs this one.
+        enter(FlashPhase::PROGRAMMING, todo);
+        t = clock::now();
+        std::string stageErr;
+        std::future<bool> staged;
+        if (!pieces.empty())
+        {
+            staged = std::async(std::launch::async, [&]() { return stagePiece(pieces[0], stageErr); });
+        }
+
+        bool ok = true;
+        for (size_t k = 0; k < pieces.size() && ok; k++)
+        {
+            if (!staged.get())
+            {
+                report.errMsg = stageErr;
+                ok = false;
+                break;
+            }
+            if (k + 1 < pieces.size() && !prog.cancel.load())
+            {
+                staged = std::async(std::launch::async, [&, k]() { return stagePiece(pieces[k + 1], stageErr); });
+            }
+
+            char where[24];
+            snprintf(where, sizeof(where), "0x%08X bin", pieces[k].addr);
+            ok = writeImage(tcl, pieces[k].file.generic_string(), where, pieces[k].len, report.errMsg);
+            if (ok)
+            {
+                report.sectorsProgrammed += pieces[k].sectors;
+                report.bytesProgrammed += (uint32_t)pieces[k].len;
+                prog.bytesDone.store(report.bytesProgrammed);
+                ok = (k + 1 == pieces.size()) || !cancelled();
+            }
+        }
+        if (staged.valid()) staged.wait();
+
+        std::error_code ec;
+        for (const ProgramPiece& piece : pieces)
+        {
+            if (!piece.file.empty()) std::filesystem::remove(piece.file, ec);
+        }
+
+        report.programMs = msSince(t);
+        report.bytesSkipped = report.bytesTotal - report.bytesProgrammed;
+        if (report.bytesProgrammed > 0)
+        {
+            this->msPerByte = report.programMs / report.bytesProgrammed;
+        }
+        if (!ok)
+        {
+            // Sectors are either done or untouched (or erased, if we failed inside one), so
+            // flashing again picks up from here
+            return report;
+        }
+
+        // Verify what was written, same CRCs again
+        if (!changed.empty())
+        {
+            enter(FlashPhase::VERIFYING, todo);
+            t = clock::now();
+            std::vector<FlashSector> written;
+            for (size_t i : changed) written.push_back(sectors[i]);
+
+            std::vector<uint32_t> after;
+            bool onTarget = false;
+            if (!this->targetCrcs(tcl, device, written, after, onTarget, report.errMsg))
+            {
+                return report;
+            }
+            for (size_t k = 0; k < changed.size(); k++)
+            {
+                if (hostCrc[changed[k]] != after[k])
+                {
+                    char msg[96];
+                    snprintf(msg, sizeof(msg), "Verify failed in sector at 0x%08X", sectors[changed[k]].addr);
+                    report.errMsg = msg;
+                    return report;
+                }
+            }
+            prog.bytesDone.store(todo);
+            report.verifyMs = msSince(t);
+        }
+    }
+
+    // Program speed of this run is the estimate for what skipping saves next time too
+    if (report.fullProgram && report.bytesProgrammed > 0)
+    {
+        this->msPerByte = report.programMs / report.bytesProgrammed;
+    }
+    if (this->msPerByte > 0.0)
+    {
+        report.savedMs = report.bytesSkipped * this->msPerByte;
+    }
+
+    // The CRC helper left the core somewhere in RAM
+    if (!tcl.eval("reset halt", reply, 5000))
+    {
+        report.errMsg = "reset halt: " + tcl.getLastError();
+        return report;
+    }
+
+    report.totalMs = msSince(start);
+    report.success = true;
+    return report;
+}
@@ -0,0 +1,133 @@
+/* =============== DeltaFlasher.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Delta flash programming
+
+    Description:
+        Programs an ELF into flash through OpenOCD, but only the erase
+        sectors whose contents actually changed. The PT_LOAD segments are
+        cut along the real sector layout (OpenOCD's "flash info"), each
+        sector gets a CRC32 on the host and one on the target, and only
+        the mismatching runs of sectors are erased and written.
+
+        The target side CRC runs on the chip itself: a small Thumb-1 routine
+        (fine on M0 up to M33) is copied into SRAM and called once per
+        sector, all in a single TCL script. If that can't be done (unknown
+        part, no RAM info) the sectors are read back instead, which is
+        slower but still beats programming them.
+*/
+
+#ifndef DELTAFLASHER_H
+#define DELTAFLASHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "STM32Detector.h"
+
+class ElfFile;
+class OpenOCDTcl;
+struct STM32Device;
+
+// One erase unit
+struct FlashSector
+{
+    uint32_t addr = 0;
+    uint32_t size = 0;
+};
+
+// What has to end up in flash, merged from the ELF's PT_LOAD segments (by load address)
+struct FlashImage
+{
+    struct Chunk
+    {
+        uint32_t addr = 0;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<Chunk> chunks; // Sorted, non overlapping, adjacent segments merged
+    uint32_t totalBytes = 0;
+};
+
+enum class FlashPhase {IDLE, PREPARING, COMPARING, PROGRAMMING, VERIFYING, DONE};
+
+const char* flashPhaseName(FlashPhase phase);
+
+// Shared between a flash in progress (writes) and the UI (reads, and sets cancel)
+struct FlashProgress
+{
+    std::atomic<FlashPhase> phase{FlashPhase::IDLE};
+    std::atomic<uint32_t> bytesDone{0}; // Within the current phase
+    std::atomic<uint32_t> bytesTodo{0};
+    std::atomic<bool> cancel{false};
+};
+
+struct DeltaFlashReport
+{
+    bool success = false;
+    bool cancelled = false;
+    std::string errMsg;
+
+    bool fullProgram = false; // No usable sector layout, everything was written
+    bool onTargetCrc = false; // CRCs came from the RAM helper (false = read back)
+
+    size_t sectorsTotal = 0; // Sectors the image touches
+    size_t sectorsProgrammed = 0;
+    uint32_t bytesTotal = 0; // Sum of those sectors
+    uint32_t bytesProgrammed = 0;
+    uint32_t bytesSkipped = 0;
+    uint32_t bytesIgnored = 0; // Image bytes outside every flash bank (RAM load segments)
+
+    double compareMs = 0.0;
+    double programMs = 0.0;
+    double verifyMs = 0.0;
+    double totalMs = 0.0;
+    double savedMs = -1.0; // Estimated programming time avoided, < 0 while we have no rate yet
+};
+
+/**
+  * @brief Sector level delta programming over OpenOCD's TCL port
+
+  Keep one around per session: it remembers how long programming took per byte, which is what
+  the "time saved" estimate is based on. The target is left halted after reset.
+*/
+class DeltaFlasher
+{
+    private:
+
+        double msPerByte = 0.0; // Measured erase + program speed of the last run that wrote anything
+
+        bool targetCrcs(OpenOCDTcl& tcl, const STM32Device* device, const std::vector<FlashSector>& sectors,
+                        std::vector<uint32_t>& crcs, bool& onTarget, std::string& err);
+
+    public:
+
+        // Largest single erase + program call, so progress moves and a cancel lands in time
+        static constexpr size_t MaxPieceBytes = 64 * 1024;
+
+        // Standard CRC32 (zlib / Ethernet), crc is the running value so it can be fed in pieces
+        static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+        // The target side of crc32(): Thumb code with its nibble table right behind, as uploaded to SRAM
+        static std::vector<uint8_t> crcHelperImage();
+
+        static bool loadImage(const ElfFile& elf, FlashImage& image, std::string& err);
+
+        // Sector layout of every bank from "flash info". Banks the driver doesn't list sectors for
+        // get the device's uniform page size, or nothing at all if the part has mixed sectors.
+        static bool readSectorLayout(OpenOCDTcl& tcl, const std::vector<FlashBank>& banks, const STM32Device* device,
+                                     std::vector<FlashSector>& layout, std::string& err);
+
+        // The sectors the image touches, with their full contents (gaps filled with the erased value)
+        static void splitImage(const FlashImage& image, const std::vector<FlashSector>& layout, uint8_t fill,
+                               std::vector<FlashSector>& sectors, std::vector<uint8_t>& contents);
+
+        // Resets and halts the target, then programs what differs. device and progress may be nullptr.
+        // Host side work (copying segments, CRCs, staging files) runs alongside the target side.
+        DeltaFlashReport flash(OpenOCDTcl& tcl, const ElfFile& elf, const STM32Device* device,
+                               FlashProgress* progress = nullptr);
+};
+
+#endif // DELTAFLASHER_H
@@ -0,0 +1,337 @@
+/* =============== DetectionCache.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Detection cache
+
+    Description:
+        File format, one probe per line, tab separated:
+            serial  devID  idcode  idcodeAddr  flashKB  config  lastSeen  banks
+        with banks as "driver@base+size" joined by ','. Numbers are hex
+        except flashKB and lastSeen. Lines of an older layout don't parse,
+        so those probes are simply probed again.
+*/
+
+#include "DetectionCache.h"
+#include "OpenOCDTcl.h"
+#include "STM32Devices.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+
+DetectionCache::DetectionCache(const std::string& path) : path(path)
+{
+}
+
+std::string DetectionCache::defaultPath()
+{
+    std::filesystem::path dir;
+#ifdef _WIN32
+    if (const char* local = getenv("LOCALAPPDATA")) dir = local;
+#else
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) dir = xdg;
+    else if (const char* home = getenv("HOME")) dir = std::filesystem::path(home) / ".cache";
+#endif
+    if (dir.empty())
+    {
+        dir = ".";
+    }
+    return (dir / "stm32-debugger" / "detection.cache").string();
+}
+
+// ------------------------------
+// File
+// ------------------------------
+static std::vector<std::string> splitOn(const std::string& s, char sep)
+{
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    while (true)
+    {
+        size_t end = s.find(sep, pos);
+        parts.push_back(s.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+        if (end == std::string::npos) break;
+        pos = end + 1;
+    }
+    return parts;
+}
+
+static bool parseLine(const std::string& line, CachedDetection& e)
+{
+    std::vector<std::string> f = splitOn(line, '\t');
+    if (f.size() != 8 || f[0].empty() || f[5].empty())
+    {
+        return false;
+    }
+
+    e.serial = f[0];
+    e.devID = (uint16_t)strtoul(f[1].c_str(), nullptr, 16);
+    e.idcode = (uint32_t)strtoul(f[2].c_str(), nullptr, 16);
+    e.idcodeAddr = (uint32_t)strtoul(f[3].c_str(), nullptr, 16);
+    e.flashSizeKb = (uint16_t)strtoul(f[4].c_str(), nullptr, 10);
+    e.configFileName = f[5];
+    e.lastSeen = strtoll(f[6].c_str(), nullptr, 10);
+
+    e.flashBanks.clear();
+    if (!f[7].empty())
+    {
+        for (const std::string& b : splitOn(f[7], ','))
+        {
+            size_t at = b.find('@');
+            size_t plus = b.find('+', at);
+            if (at == std::string::npos || plus == std::string::npos)
+            {
+                return false;
+            }
+
+            FlashBank bank;
+            bank.driver = b.substr(0, at);
+            bank.base = (uint32_t)strtoul(b.c_str() + at + 1, nullptr, 16);
+            bank.size = (uint32_t)strtoul(b.c_str() + plus + 1, nullptr, 16);
+            e.flashBanks.push_back(bank);
+        }
+    }
+    return e.devID != 0;
+}
+
+bool DetectionCache::load(std::string& err)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->entries.clear();
+    this->dirty = false;
+
+    FILE* f = fopen(this->path.c_str(), "r");
+    if (!f)
+    {
+        return true; // Nothing cached yet
+    }
+
+    std::string line;
+    char buf[1024];
+    size_t skipped = 0;
+    while (fgets(buf, sizeof(buf), f))
+    {
+        line += buf;
+        if (line.empty() || line.back() != '\n')
+        {
+            if (!feof(f)) continue; // Longer than buf, keep reading
+        }
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+
+        CachedDetection e;
+        if (!line.empty() && line[0] != '#')
+        {
+            if (parseLine(line, e)) this->entries[e.serial] = e;
+            else skipped++;
+        }
+        line.clear();
+    }
+
+    const bool readOk = !ferror(f);
+    fclose(f);
+    if (!readOk)
+    {
+        err = "read error in " + this->path;
+        return false;
+    }
+    if (skipped > 0)
+    {
+        this->dirty = true; // Rewrite without the bad lines
+    }
+    return true;
+}
+
+bool DetectionCache::save(std::string& err)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (!this->dirty)
+    {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(this->path).parent_path(), ec);
+
+    // Write next to it and rename over, so a crash never leaves half a file
+    const std::string tmp = this->path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f)
+    {
+        err = "can't create " + tmp;
+        return false;
+    }
+
+    fprintf(f, "%s\n", FileHeader);
+    for (const auto& [serial, e] : this->entries)
+    {
+        fprintf(f, "%s\t%03X\t%08X\t%08X\t%u\t%s\t%" PRId64 "\t", serial.c_str(), e.devID, e.idcode, e.idcodeAddr,
+                (unsigned)e.flashSizeKb, e.configFileName.c_str(), e.lastSeen);
+        for (size_t i = 0; i < e.flashBanks.size(); i++)
+        {
+            const FlashBank& b = e.flashBanks[i];
+            fprintf(f, "%s%s@%08X+%X", (i > 0) ? "," : "", b.driver.c_str(), b.base, b.size);
+        }
+        fputc('\n', f);
+    }
+
+    const bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok)
+    {
+        err = "write to " + tmp + " failed";
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    std::filesystem::rename(tmp, this->path, ec);
+    if (ec)
+    {
+        err = "can't replace " + this->path + ": " + ec.message();
+        return false;
+    }
+
+    this->dirty = false;
+    return true;
+}
+
+// ------------------------------
+// Entries
+// ------------------------------
+bool DetectionCache::find(const std::string& serial, CachedDetection& out) const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto it = this->entries.find(serial);
+    if (it == this->entries.end())
+    {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+void DetectionCache::store(const CachedDetection& entry)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->entries[entry.serial] = entry;
+    this->dirty = true;
+}
+
+void DetectionCache::invalidate(const std::string& serial)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (this->entries.erase(serial) > 0)
+    {
+        this->dirty = true;
+    }
+}
+
+size_t DetectionCache::size() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->entries.size();
+}
+
+// ------------------------------
+// Detection
+// ------------------------------
+
+// Word holding the 16 bit flash size register, and where in it the value sits (F2/F4 have it in the upper half)
+static bool flashSizeWord(uint16_t devID, uint32_t& addr, unsigned& shift)
+{
+    const STM32Device* device = findSTM32Device(devID);
+    if (!device || device->flashSizeReg == 0)
+    {
+        return false;
+    }
+
+    addr = device->flashSizeReg & ~3u;
+    shift = (device->flashSizeReg & 2u) * 8;
+    return true;
+}
+
+static uint16_t flashSizeFromWord(uint32_t word, unsigned shift)
+{
+    return (uint16_t)(word >> shift);
+}
+
+DetectionResult DetectionCache::detect(OpenOCDTcl& tcl, const std::string& serial, int timeoutMs)
+{
+    CachedDetection cached;
+    if (!serial.empty() && this->find(serial, cached))
+    {
+        // IDCODE and flash size in the same round trip
+        std::vector<uint32_t> addrs = {cached.idcodeAddr};
+        uint32_t sizeAddr = 0;
+        unsigned sizeShift = 0;
+        const bool hasSizeReg = flashSizeWord(cached.devID, sizeAddr, sizeShift);
+        if (hasSizeReg)
+        {
+            addrs.push_back(sizeAddr);
+        }
+
+        std::vector<uint32_t> values;
+        std::vector<bool> ok;
+        if (!tcl.readWords(addrs, values, ok, timeoutMs))
+        {
+            // The link is the problem, not the entry, so keep it
+            DetectionResult result;
+            result.errMsg = "IDCODE read failed: " + tcl.getLastError();
+            return result;
+        }
+
+        const uint16_t flashSizeKb = (hasSizeReg && ok[1]) ? flashSizeFromWord(values[1], sizeShift) : 0;
+        if (ok[0] && values[0] == cached.idcode && flashSizeKb == cached.flashSizeKb)
+        {
+            DetectionResult result;
+            result.success = true;
+            result.devID = cached.devID;
+            result.idcode = cached.idcode;
+            result.idcodeAddr = cached.idcodeAddr;
+            result.flashSizeKb = cached.flashSizeKb;
+            result.configFileName = cached.configFileName;
+            result.flashBanks = cached.flashBanks;
+            result.fromCache = true;
+
+            cached.lastSeen = (int64_t)time(nullptr);
+            this->store(cached);
+            return result;
+        }
+
+        // Another board (or another flash size of the same family) behind this probe now
+        this->invalidate(serial);
+    }
+
+    DetectionResult result = DetectedSTM32Tcl(tcl);
+    if (!result.success)
+    {
+        return result;
+    }
+
+    // Worth probing once, it is what the cache saves next time. Without banks the entry still saves the IDCODE walk.
+    std::string err;
+    readFlashBanks(tcl, result.flashBanks, err);
+
+    uint32_t sizeAddr = 0;
+    unsigned sizeShift = 0;
+    std::vector<uint32_t> values;
+    std::vector<bool> ok;
+    if (flashSizeWord(result.devID, sizeAddr, sizeShift) && tcl.readWords({sizeAddr}, values, ok, timeoutMs) && ok[0])
+    {
+        result.flashSizeKb = flashSizeFromWord(values[0], sizeShift);
+    }
+
+    if (!serial.empty())
+    {
+        CachedDetection e;
+        e.serial = serial;
+        e.devID = result.devID;
+        e.idcode = result.idcode;
+        e.idcodeAddr = result.idcodeAddr;
+        e.flashSizeKb = result.flashSizeKb;
+        e.configFileName = result.configFileName;
+        e.flashBanks = result.flashBanks;
+        e.lastSeen = (int64_t)time(nullptr);
+        this->store(e);
+    }
+    return result;
+}
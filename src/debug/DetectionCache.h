@@ -0,0 +1,85 @@
+/* =============== DetectionCache.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Detection cache
+
+    Description:
+        Remembers what was found behind each probe (by serial number): dev
+        ID, the IDCODE and where it was read, the flash size register, the
+        OpenOCD config and the flash banks. When the same probe shows up
+        again, one round trip reading that IDCODE address and the flash
+        size register confirms the board is still the same, which replaces
+        walking all IDCODE addresses and probing the flash. The flash size
+        is needed because parts of one family share a dev ID (F401xB/C and
+        F401xD/E), a board swap between them keeps the IDCODE. If either
+        read comes back different, the entry is dropped and the board is
+        probed from scratch.
+
+        The cache is a small text file (one line per probe) under the user's
+        cache directory, so it survives restarts.
+*/
+
+#ifndef DETECTIONCACHE_H
+#define DETECTIONCACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "STM32Detector.h"
+
+class OpenOCDTcl;
+
+struct CachedDetection
+{
+    std::string serial;
+    uint16_t devID = 0;
+    uint32_t idcode = 0;
+    uint32_t idcodeAddr = 0;
+    uint16_t flashSizeKb = 0; // 0 if the part has no flash size register we know of, or it could not be read
+    std::string configFileName;
+    std::vector<FlashBank> flashBanks;
+    int64_t lastSeen = 0; // Unix seconds
+};
+
+/**
+  * @brief Serial -> detection, persisted to disk
+
+  Thread safe, discovery workers share one. Nothing is written until save(), which only
+  touches the file when something changed.
+*/
+class DetectionCache
+{
+    private:
+
+        mutable std::mutex lock;
+        std::string path;
+        std::unordered_map<std::string, CachedDetection> entries;
+        bool dirty = false;
+
+    public:
+
+        static constexpr const char* FileHeader = "# STM32 Debugger detection cache v2";
+
+        explicit DetectionCache(const std::string& path = defaultPath());
+
+        // <cache dir>/stm32-debugger/detection.cache (XDG_CACHE_HOME, ~/.cache or LOCALAPPDATA)
+        static std::string defaultPath();
+
+        // A missing file is an empty cache, not an error. Lines that don't parse are skipped.
+        bool load(std::string& err);
+        bool save(std::string& err);
+
+        bool find(const std::string& serial, CachedDetection& out) const;
+        void store(const CachedDetection& entry);
+        void invalidate(const std::string& serial);
+        size_t size() const;
+        const std::string& getPath() const {return this->path;}
+
+        // Detection through the cache: confirm a known probe with one read, probe everything otherwise.
+        // An empty serial can't be cached and always gets the full probe.
+        DetectionResult detect(OpenOCDTcl& tcl, const std::string& serial, int timeoutMs = 1000);
+};
+
+#endif // DETECTIONCACHE_H
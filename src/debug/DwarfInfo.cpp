@@ -0,0 +1,1591 @@
+/* =============== DwarfInfo.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: DWARF type reader
+
+    Description:
+        DIE decoding, the two ways of finding a variable (.debug_names or a
+        lazy unit scan) and the type cache. Only the DW_* constants we
+        actually look at are listed here.
+*/
+
+#include "DwarfInfo.h"
+#include "ElfFile.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <cstring>
+
+// Tags
+static const uint16_t DW_TAG_array_type = 0x01;
+static const uint16_t DW_TAG_class_type = 0x02;
+static const uint16_t DW_TAG_enumeration_type = 0x04;
+static const uint16_t DW_TAG_member = 0x0d;
+static const uint16_t DW_TAG_pointer_type = 0x0f;
+static const uint16_t DW_TAG_reference_type = 0x10;
+static const uint16_t DW_TAG_structure_type = 0x13;
+static const uint16_t DW_TAG_typedef = 0x16;
+static const uint16_t DW_TAG_union_type = 0x17;
+static const uint16_t DW_TAG_subrange_type = 0x21;
+static const uint16_t DW_TAG_base_type = 0x24;
+static const uint16_t DW_TAG_const_type = 0x26;
+static const uint16_t DW_TAG_enumerator = 0x28;
+static const uint16_t DW_TAG_variable = 0x34;
+static const uint16_t DW_TAG_volatile_type = 0x35;
+static const uint16_t DW_TAG_restrict_type = 0x37;
+static const uint16_t DW_TAG_rvalue_reference_type = 0x42;
+static const uint16_t DW_TAG_atomic_type = 0x47;
+
+// Attributes
+static const uint16_t DW_AT_sibling = 0x01;
+static const uint16_t DW_AT_location = 0x02;
+static const uint16_t DW_AT_name = 0x03;
+static const uint16_t DW_AT_byte_size = 0x0b;
+static const uint16_t DW_AT_bit_offset = 0x0c;
+static const uint16_t DW_AT_bit_size = 0x0d;
+static const uint16_t DW_AT_const_value = 0x1c;
+static const uint16_t DW_AT_upper_bound = 0x2f;
+static const uint16_t DW_AT_abstract_origin = 0x31;
+static const uint16_t DW_AT_count = 0x37;
+static const uint16_t DW_AT_data_member_location = 0x38;
+static const uint16_t DW_AT_declaration = 0x3c;
+static const uint16_t DW_AT_encoding = 0x3e;
+static const uint16_t DW_AT_specification = 0x47;
+static const uint16_t DW_AT_type = 0x49;
+static const uint16_t DW_AT_data_bit_offset = 0x6b;
+static const uint16_t DW_AT_str_offsets_base = 0x72;
+
+// Forms
+enum : uint16_t
+{
+    DW_FORM_addr = 0x01, DW_FORM_block2 = 0x03, DW_FORM_block4 = 0x04, DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06, DW_FORM_data8 = 0x07, DW_FORM_string = 0x08, DW_FORM_block = 0x09,
+    DW_FORM_block1 = 0x0a, DW_FORM_data1 = 0x0b, DW_FORM_flag = 0x0c, DW_FORM_sdata = 0x0d,
+    DW_FORM_strp = 0x0e, DW_FORM_udata = 0x0f, DW_FORM_ref_addr = 0x10, DW_FORM_ref1 = 0x11,
+    DW_FORM_ref2 = 0x12, DW_FORM_ref4 = 0x13, DW_FORM_ref8 = 0x14, DW_FORM_ref_udata = 0x15,
+    DW_FORM_indirect = 0x16, DW_FORM_sec_offset = 0x17, DW_FORM_exprloc = 0x18, DW_FORM_flag_present = 0x19,
+    DW_FORM_strx = 0x1a, DW_FORM_addrx = 0x1b, DW_FORM_ref_sup4 = 0x1c, DW_FORM_strp_sup = 0x1d,
+    DW_FORM_data16 = 0x1e, DW_FORM_line_strp = 0x1f, DW_FORM_ref_sig8 = 0x20, DW_FORM_implicit_const = 0x21,
+    DW_FORM_loclistx = 0x22, DW_FORM_rnglistx = 0x23, DW_FORM_ref_sup8 = 0x24, DW_FORM_strx1 = 0x25,
+    DW_FORM_strx2 = 0x26, DW_FORM_strx3 = 0x27, DW_FORM_strx4 = 0x28, DW_FORM_addrx1 = 0x29,
+    DW_FORM_addrx2 = 0x2a, DW_FORM_addrx3 = 0x2b, DW_FORM_addrx4 = 0x2c,
+    DW_FORM_GNU_ref_alt = 0x1f20, DW_FORM_GNU_strp_alt = 0x1f21
+};
+
+// Base type encodings
+static const uint8_t DW_ATE_boolean = 0x02;
+static const uint8_t DW_ATE_float = 0x04;
+static const uint8_t DW_ATE_signed = 0x05;
+static const uint8_t DW_ATE_signed_char = 0x06;
+static const uint8_t DW_ATE_unsigned_char = 0x08;
+
+static const uint8_t DW_OP_addr = 0x03;
+static const uint8_t DW_OP_plus_uconst = 0x23;
+
+static const uint8_t DW_UT_type = 0x02;
+static const uint8_t DW_UT_skeleton = 0x04;
+static const uint8_t DW_UT_split_compile = 0x05;
+static const uint8_t DW_UT_split_type = 0x06;
+
+// .debug_names entry attributes
+static const uint16_t DW_IDX_compile_unit = 1;
+static const uint16_t DW_IDX_die_offset = 3;
+
+// Bounds checked little endian reader. Running off the end sets ok = false and returns zeros.
+struct DwarfCursor
+{
+    const uint8_t* base;
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    DwarfCursor(const uint8_t* data, size_t size, size_t offset)
+        : base(data), p(data + std::min(offset, size)), end(data + size)
+    {
+        if (offset > size) this->ok = false;
+    }
+
+    uint32_t offset() const {return (uint32_t)(this->p - this->base);}
+    size_t remaining() const {return (size_t)(this->end - this->p);}
+
+    bool need(size_t n)
+    {
+        if (this->remaining() < n)
+        {
+            this->ok = false;
+            this->p = this->end;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t fixed(size_t n)
+    {
+        if (!this->need(n)) return 0;
+        uint64_t v = 0;
+        for (size_t i = 0; i < n && i < 8; i++)
+        {
+            v |= (uint64_t)this->p[i] << (8 * i);
+        }
+        this->p += n;
+        return v;
+    }
+
+    uint8_t u8() {return (uint8_t)this->fixed(1);}
+    uint16_t u16() {return (uint16_t)this->fixed(2);}
+    uint32_t u32() {return (uint32_t)this->fixed(4);}
+
+    uint64_t uleb()
+    {
+        uint64_t v = 0;
+        int shift = 0;
+        while (this->p < this->end)
+        {
+            uint8_t b = *this->p++;
+            if (shift < 64) v |= (uint64_t)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80)) return v;
+        }
+        this->ok = false;
+        return v;
+    }
+
+    int64_t sleb()
+    {
+        int64_t v = 0;
+        int shift = 0;
+        while (this->p < this->end)
+        {
+            uint8_t b = *this->p++;
+            if (shift < 64) v |= (int64_t)(b & 0x7F) << shift;
+            shift += 7;
+            if (!(b & 0x80))
+            {
+                if (shift < 64 && (b & 0x40)) v |= -((int64_t)1 << shift);
+                return v;
+            }
+        }
+        this->ok = false;
+        return v;
+    }
+
+    const char* cstr()
+    {
+        const uint8_t* s = this->p;
+        while (this->p < this->end && *this->p) this->p++;
+        if (this->p >= this->end)
+        {
+            this->ok = false;
+            return "";
+        }
+        this->p++;
+        return (const char*)s;
+    }
+
+    void skip(size_t n)
+    {
+        if (this->need(n)) this->p += n;
+    }
+};
+
+// ------------------------------
+// Small lookups
+// ------------------------------
+const DwarfType* DwarfType::resolved() const
+{
+    const DwarfType* t = this;
+    for (int hops = 0; t && t->kind == DwarfTypeKind::ALIAS && hops < 32; hops++)
+    {
+        t = t->target;
+    }
+    return (t && t->kind == DwarfTypeKind::ALIAS) ? nullptr : t;
+}
+
+static uint32_t sizeOf(const DwarfType* type)
+{
+    const DwarfType* t = type ? type->resolved() : nullptr;
+    return t ? t->size : 0;
+}
+
+const DwarfInfo::Abbrev* DwarfInfo::AbbrevTable::find(uint64_t code) const
+{
+    if (code > 0 && code <= this->byCode.size())
+    {
+        return &this->byCode[code - 1];
+    }
+    auto it = this->sparse.find(code);
+    return (it != this->sparse.end()) ? &it->second : nullptr;
+}
+
+const DwarfInfo::DieAttr* DwarfInfo::Die::find(uint16_t name) const
+{
+    for (const auto& a : this->attrs)
+    {
+        if (a.name == name) return &a;
+    }
+    return nullptr;
+}
+
+bool DwarfInfo::fail(const std::string& msg)
+{
+    this->lastError = msg;
+    return false;
+}
+
+// ------------------------------
+// Open / close
+// ------------------------------
+bool DwarfInfo::open(ElfFile& elf)
+{
+    this->close();
+
+    auto grab = [&elf](const char* name, SectionView& view)
+    {
+        const ElfSection* s = elf.findSection(name);
+        if (s && s->data)
+        {
+            view.data = s->data;
+            view.size = s->size;
+        }
+    };
+
+    grab(".debug_info", this->info);
+    grab(".debug_abbrev", this->abbrev);
+    grab(".debug_str", this->str);
+    grab(".debug_line_str", this->lineStr);
+    grab(".debug_str_offsets", this->strOffsets);
+    grab(".debug_aranges", this->aranges);
+    grab(".debug_names", this->names);
+
+    if (!this->info.data || !this->abbrev.data)
+    {
+        this->close();
+        return this->fail("No .debug_info in this ELF (built without -g?)");
+    }
+
+    this->parseUnitHeaders();
+    if (this->units.empty())
+    {
+        this->close();
+        return this->fail("No readable compile units in .debug_info");
+    }
+
+    this->elf = &elf;
+    return true;
+}
+
+void DwarfInfo::close()
+{
+    this->elf = nullptr;
+    this->info = this->abbrev = this->str = this->lineStr = SectionView();
+    this->strOffsets = this->aranges = this->names = SectionView();
+
+    this->units.clear();
+    this->abbrevTables.clear();
+    this->arangeList.clear();
+    this->arangesParsed = false;
+
+    this->types.clear();
+    this->synthetic.clear();
+    this->globalIndex.clear();
+    this->declIndex.clear();
+    this->variables.clear();
+    this->scannedUnits = 0;
+}
+
+// Just the headers, a few bytes per unit. The DIEs stay untouched until someone asks.
+void DwarfInfo::parseUnitHeaders()
+{
+    DwarfCursor c(this->info.data, this->info.size, 0);
+
+    while (c.ok && c.remaining() >= 11)
+    {
+        Unit u;
+        u.offset = c.offset();
+
+        uint64_t length = c.u32();
+        if (length == 0xFFFFFFFFu)
+        {
+            length = c.fixed(8);
+            u.offsetSize = 8;
+        }
+        else if (length >= 0xFFFFFFF0u)
+        {
+            break; // Reserved values, nothing sane after this
+        }
+
+        if (length > c.remaining())
+        {
+            break;
+        }
+        const uint32_t unitEnd = c.offset() + (uint32_t)length;
+        u.end = unitEnd;
+
+        u.version = c.u16();
+        uint8_t unitType = 0;
+        if (u.version >= 5)
+        {
+            unitType = c.u8();
+            u.addrSize = c.u8();
+            u.abbrevOffset = (uint32_t)c.fixed(u.offsetSize);
+
+            if (unitType == DW_UT_skeleton || unitType == DW_UT_split_compile) c.skip(8);
+            else if (unitType == DW_UT_type || unitType == DW_UT_split_type) c.skip(8 + u.offsetSize);
+        }
+        else
+        {
+            u.abbrevOffset = (uint32_t)c.fixed(u.offsetSize);
+            u.addrSize = c.u8();
+        }
+
+        if (!c.ok || u.version < 2 || u.version > 5)
+        {
+            break;
+        }
+
+        u.firstDie = c.offset();
+        // Type units only get reached through references, never scanned for variables
+        u.scanned = (unitType == DW_UT_type || unitType == DW_UT_split_type);
+        this->units.push_back(u);
+
+        c = DwarfCursor(this->info.data, this->info.size, unitEnd);
+    }
+}
+
+const DwarfInfo::AbbrevTable* DwarfInfo::getAbbrevTable(uint32_t offset)
+{
+    auto it = this->abbrevTables.find(offset);
+    if (it != this->abbrevTables.end())
+    {
+        return it->second.get();
+    }
+
+    auto table = std::make_unique<AbbrevTable>();
+    DwarfCursor c(this->abbrev.data, this->abbrev.size, offset);
+
+    while (c.ok)
+    {
+        uint64_t code = c.uleb();
+        if (code == 0 || !c.ok) break;
+
+        Abbrev ab;
+        ab.tag = (uint16_t)c.uleb();
+        ab.hasChildren = c.u8() != 0;
+
+        while (c.ok)
+        {
+            AttrSpec spec;
+            spec.name = (uint16_t)c.uleb();
+            spec.form = (uint16_t)c.uleb();
+            if (spec.form == DW_FORM_implicit_const) spec.implicitConst = c.sleb();
+            if (spec.name == 0 && spec.form == 0) break;
+            ab.attrs.push_back(spec);
+        }
+
+        if (code == table->byCode.size() + 1)
+        {
+            table->byCode.push_back(std::move(ab));
+        }
+        else
+        {
+            table->sparse[code] = std::move(ab);
+        }
+    }
+
+    const AbbrevTable* result = table.get();
+    this->abbrevTables.emplace(offset, std::move(table));
+    return result;
+}
+
+DwarfInfo::Unit* DwarfInfo::unitFor(uint32_t dieOffset)
+{
+    auto it = std::upper_bound(this->units.begin(), this->units.end(), dieOffset,
+                               [](uint32_t off, const Unit& u) { return off < u.offset; });
+    if (it == this->units.begin())
+    {
+        return nullptr;
+    }
+    --it;
+    return (dieOffset < it->end) ? &(*it) : nullptr;
+}
+
+bool DwarfInfo::prepareUnit(Unit& unit)
+{
+    if (unit.prepared)
+    {
+        return unit.abbrevs != nullptr;
+    }
+    unit.prepared = true;
+    unit.abbrevs = this->getAbbrevTable(unit.abbrevOffset);
+
+    // Root DIE, only str_offsets_base matters here (DWARF 5 strx forms)
+    uint32_t off = unit.firstDie;
+    Die root;
+    if (this->readDie(unit, off, root))
+    {
+        const DieAttr* base = root.find(DW_AT_str_offsets_base);
+        if (base) unit.strOffsetsBase = (uint32_t)base->value;
+    }
+    return true;
+}
+
+// ------------------------------
+// DIE decoding
+// ------------------------------
+const char* DwarfInfo::readStrx(const Unit& unit, uint64_t index) const
+{
+    uint64_t at = unit.strOffsetsBase + index * unit.offsetSize;
+    if (!this->strOffsets.data || at + unit.offsetSize > this->strOffsets.size)
+    {
+        return "";
+    }
+
+    DwarfCursor c(this->strOffsets.data, this->strOffsets.size, (size_t)at);
+    uint64_t off = c.fixed(unit.offsetSize);
+    return (off < this->str.size) ? (const char*)this->str.data + off : "";
+}
+
+bool DwarfInfo::readDie(Unit& unit, uint32_t& offset, Die& die)
+{
+    if (!unit.abbrevs || offset >= unit.end)
+    {
+        return false;
+    }
+
+    DwarfCursor c(this->info.data, unit.end, offset);
+    die.offset = offset;
+    die.attrs.clear();
+
+    uint64_t code = c.uleb();
+    if (!c.ok)
+    {
+        return false;
+    }
+    if (code == 0)
+    {
+        // Null entry, ends a list of children
+        die.tag = 0;
+        die.hasChildren = false;
+        offset = c.offset();
+        return true;
+    }
+
+    const Abbrev* ab = unit.abbrevs->find(code);
+    if (!ab)
+    {
+        return false;
+    }
+    die.tag = ab->tag;
+    die.hasChildren = ab->hasChildren;
+
+    for (const AttrSpec& spec : ab->attrs)
+    {
+        DieAttr a;
+        a.name = spec.name;
+        uint16_t form = spec.form;
+        while (form == DW_FORM_indirect && c.ok)
+        {
+            form = (uint16_t)c.uleb();
+        }
+        a.form = form;
+
+        uint64_t blockLen = 0;
+        bool isBlock = false;
+
+        switch (form)
+        {
+            case DW_FORM_addr: a.value = c.fixed(unit.addrSize); break;
+
+            case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag: case DW_FORM_strx1: case DW_FORM_addrx1:
+                a.value = c.fixed(1); break;
+            case DW_FORM_data2: case DW_FORM_ref2: case DW_FORM_strx2: case DW_FORM_addrx2:
+                a.value = c.fixed(2); break;
+            case DW_FORM_strx3: case DW_FORM_addrx3:
+                a.value = c.fixed(3); break;
+            case DW_FORM_data4: case DW_FORM_ref4: case DW_FORM_ref_sup4: case DW_FORM_strx4: case DW_FORM_addrx4:
+                a.value = c.fixed(4); break;
+            case DW_FORM_data8: case DW_FORM_ref8: case DW_FORM_ref_sig8: case DW_FORM_ref_sup8:
+                a.value = c.fixed(8); break;
+            case DW_FORM_data16:
+                c.skip(16); break;
+
+            case DW_FORM_sdata: a.value = (uint64_t)c.sleb(); break;
+            case DW_FORM_udata: case DW_FORM_ref_udata: case DW_FORM_strx: case DW_FORM_addrx:
+            case DW_FORM_loclistx: case DW_FORM_rnglistx:
+                a.value = c.uleb(); break;
+
+            case DW_FORM_string: a.str = c.cstr(); break;
+
+            case DW_FORM_strp: case DW_FORM_line_strp: case DW_FORM_sec_offset: case DW_FORM_strp_sup:
+            case DW_FORM_GNU_strp_alt: case DW_FORM_GNU_ref_alt:
+                a.value = c.fixed(unit.offsetSize); break;
+            case DW_FORM_ref_addr:
+                a.value = c.fixed(unit.version <= 2 ? unit.addrSize : unit.offsetSize); break;
+
+            case DW_FORM_block1: blockLen = c.u8(); isBlock = true; break;
+            case DW_FORM_block2: blockLen = c.u16(); isBlock = true; break;
+            case DW_FORM_block4: blockLen = c.u32(); isBlock = true; break;
+            case DW_FORM_block: case DW_FORM_exprloc: blockLen = c.uleb(); isBlock = true; break;
+
+            case DW_FORM_flag_present: a.value = 1; break;
+            case DW_FORM_implicit_const: a.value = (uint64_t)spec.implicitConst; break;
+
+            default:
+                return false; // Can't know how big it is, the rest of the unit is unreadable
+        }
+
+        if (isBlock)
+        {
+            a.block = c.p;
+            a.blockLen = (uint32_t)blockLen;
+            c.skip((size_t)blockLen);
+        }
+
+        // References become absolute .debug_info offsets, strings become pointers
+        switch (form)
+        {
+            case DW_FORM_ref1: case DW_FORM_ref2: case DW_FORM_ref4: case DW_FORM_ref8: case DW_FORM_ref_udata:
+                a.value += unit.offset; break;
+            case DW_FORM_strp:
+                a.str = (a.value < this->str.size) ? (const char*)this->str.data + a.value : ""; break;
+            case DW_FORM_line_strp:
+                a.str = (a.value < this->lineStr.size) ? (const char*)this->lineStr.data + a.value : ""; break;
+            case DW_FORM_strx: case DW_FORM_strx1: case DW_FORM_strx2: case DW_FORM_strx3: case DW_FORM_strx4:
+                a.str = this->readStrx(unit, a.value); break;
+            default: break;
+        }
+
+        if (!c.ok)
+        {
+            return false;
+        }
+        die.attrs.push_back(a);
+    }
+
+    offset = c.offset();
+    return true;
+}
+
+bool DwarfInfo::readDieAt(uint32_t offset, Die& die, Unit** unitOut)
+{
+    Unit* unit = this->unitFor(offset);
+    if (!unit || !this->prepareUnit(*unit))
+    {
+        return false;
+    }
+    if (unitOut) *unitOut = unit;
+    return this->readDie(*unit, offset, die);
+}
+
+// Moves offset past parent's children. DW_AT_sibling makes that a jump, otherwise we walk them.
+bool DwarfInfo::skipChildren(Unit& unit, uint32_t& offset, const Die& parent)
+{
+    if (!parent.hasChildren)
+    {
+        return true;
+    }
+
+    const DieAttr* sib = parent.find(DW_AT_sibling);
+    if (sib && sib->form != DW_FORM_ref_addr && sib->value > parent.offset && sib->value < unit.end)
+    {
+        offset = (uint32_t)sib->value;
+        return true;
+    }
+
+    Die child;
+    int depth = 1;
+    while (depth > 0)
+    {
+        if (!this->readDie(unit, offset, child))
+        {
+            return false;
+        }
+
+        if (child.tag == 0)
+        {
+            depth--;
+        }
+        else if (child.hasChildren)
+        {
+            const DieAttr* s = child.find(DW_AT_sibling);
+            if (s && s->form != DW_FORM_ref_addr && s->value > child.offset && s->value < unit.end)
+            {
+                offset = (uint32_t)s->value;
+            }
+            else
+            {
+                depth++;
+            }
+        }
+    }
+    return true;
+}
+
+// ------------------------------
+// Finding variables
+// ------------------------------
+void DwarfInfo::parseAranges()
+{
+    this->arangesParsed = true;
+    if (!this->aranges.data)
+    {
+        return;
+    }
+
+    DwarfCursor c(this->aranges.data, this->aranges.size, 0);
+    while (c.ok && c.remaining() >= 16)
+    {
+        const uint32_t setStart = c.offset();
+        uint64_t length = c.u32();
+        uint8_t offsetSize = 4;
+        if (length == 0xFFFFFFFFu)
+        {
+            length = c.fixed(8);
+            offsetSize = 8;
+        }
+        if (length > c.remaining())
+        {
+            break;
+        }
+        const uint32_t setEnd = c.offset() + (uint32_t)length;
+
+        c.u16(); // Version
+        uint32_t unitOffset = (uint32_t)c.fixed(offsetSize);
+        uint8_t addrSize = c.u8();
+        c.u8(); // Segment selector size
+
+        // Tuples start aligned to twice the address size, counted from the start of the set
+        size_t tupleSize = 2u * addrSize;
+        if (tupleSize == 0)
+        {
+            break;
+        }
+        size_t misalign = (c.offset() - setStart) % tupleSize;
+        if (misalign) c.skip(tupleSize - misalign);
+
+        while (c.ok && c.offset() + tupleSize <= setEnd)
+        {
+            uint64_t start = c.fixed(addrSize);
+            uint64_t len = c.fixed(addrSize);
+            if (start == 0 && len == 0) break;
+            this->arangeList.push_back(Arange{(uint32_t)start, (uint32_t)(start + len), unitOffset});
+        }
+
+        c = DwarfCursor(this->aranges.data, this->aranges.size, setEnd);
+    }
+
+    std::sort(this->arangeList.begin(), this->arangeList.end(),
+              [](const Arange& a, const Arange& b) { return a.start < b.start; });
+}
+
+bool DwarfInfo::unitForAddress(uint32_t addr, uint32_t& unitOffset)
+{
+    if (!this->arangesParsed)
+    {
+        this->parseAranges();
+    }
+
+    auto it = std::upper_bound(this->arangeList.begin(), this->arangeList.end(), addr,
+                               [](uint32_t a, const Arange& r) { return a < r.start; });
+    if (it == this->arangeList.begin())
+    {
+        return false;
+    }
+    --it;
+    if (addr >= it->end)
+    {
+        return false;
+    }
+    unitOffset = it->unit;
+    return true;
+}
+
+// Top level DIEs of one unit, every named variable goes into the index. Children are skipped.
+void DwarfInfo::scanUnit(Unit& unit)
+{
+    if (unit.scanned)
+    {
+        return;
+    }
+    unit.scanned = true;
+    this->scannedUnits++;
+
+    if (!this->prepareUnit(unit))
+    {
+        return;
+    }
+
+    uint32_t off = unit.firstDie;
+    Die die;
+    if (!this->readDie(unit, off, die) || !die.hasChildren)
+    {
+        return;
+    }
+
+    Die spec;
+    while (off < unit.end)
+    {
+        if (!this->readDie(unit, off, die) || die.tag == 0)
+        {
+            break;
+        }
+
+        if (die.tag == DW_TAG_variable)
+        {
+            const DieAttr* name = die.find(DW_AT_name);
+            const char* n = name ? name->str : nullptr;
+
+            // gcc puts the name on the extern declaration and points the definition at it
+            const DieAttr* specRef = die.find(DW_AT_specification);
+            if (!n && specRef && this->readDieAt((uint32_t)specRef->value, spec))
+            {
+                const DieAttr* specName = spec.find(DW_AT_name);
+                n = specName ? specName->str : nullptr;
+            }
+
+            if (n && *n)
+            {
+                if (die.find(DW_AT_declaration))
+                {
+                    this->declIndex.emplace(std::string_view(n), die.offset);
+                }
+                else
+                {
+                    this->globalIndex.emplace(std::string_view(n), die.offset);
+                }
+            }
+        }
+
+        if (!this->skipChildren(unit, off, die))
+        {
+            break;
+        }
+    }
+}
+
+static uint32_t caseFoldingDjbHash(std::string_view name)
+{
+    uint32_t h = 5381;
+    for (char ch : name)
+    {
+        unsigned char c = (unsigned char)ch;
+        if (c >= 'A' && c <= 'Z') c = (unsigned char)(c - 'A' + 'a');
+        h = h * 33 + c;
+    }
+    return h;
+}
+
+// DWARF 5 name index. The linker may leave one index per unit, so every one of them gets checked.
+bool DwarfInfo::lookupNames(std::string_view name, uint32_t& dieOffset)
+{
+    DwarfCursor c(this->names.data, this->names.size, 0);
+
+    while (c.ok && c.remaining() >= 36)
+    {
+        uint64_t length = c.u32();
+        uint8_t offsetSize = 4;
+        if (length == 0xFFFFFFFFu)
+        {
+            length = c.fixed(8);
+            offsetSize = 8;
+        }
+        if (length > c.remaining())
+        {
+            return false;
+        }
+        const uint32_t indexEnd = c.offset() + (uint32_t)length;
+
+        c.u16(); // Version
+        c.u16(); // Padding
+        const uint32_t cuCount = c.u32();
+        const uint32_t localTuCount = c.u32();
+        const uint32_t foreignTuCount = c.u32();
+        const uint32_t bucketCount = c.u32();
+        const uint32_t nameCount = c.u32();
+        const uint32_t abbrevSize = c.u32();
+        const uint32_t augSize = c.u32();
+        c.skip((augSize + 3) & ~3u);
+
+        const uint32_t cuList = c.offset();
+        c.skip((size_t)(cuCount + localTuCount) * offsetSize + (size_t)foreignTuCount * 8);
+        const uint32_t buckets = c.offset();
+        c.skip((size_t)bucketCount * 4);
+        const uint32_t hashes = c.offset();
+        if (bucketCount) c.skip((size_t)nameCount * 4);
+        const uint32_t strOffs = c.offset();
+        c.skip((size_t)nameCount * offsetSize);
+        const uint32_t entryOffs = c.offset();
+        c.skip((size_t)nameCount * offsetSize);
+        const uint32_t abbrevs = c.offset();
+        c.skip(abbrevSize);
+        const uint32_t pool = c.offset();
+
+        if (!c.ok || pool > indexEnd)
+        {
+            return false;
+        }
+
+        auto at = [this](uint32_t off, size_t size) { return DwarfCursor(this->names.data, this->names.size, off).fixed(size); };
+
+        // Candidate name slots (1 based, 0 = none)
+        const uint32_t hash = caseFoldingDjbHash(name);
+        uint32_t first = 1, last = nameCount;
+        if (bucketCount)
+        {
+            first = (uint32_t)at(buckets + (hash % bucketCount) * 4, 4);
+            last = first ? nameCount : 0;
+        }
+
+        for (uint32_t i = first; i != 0 && i <= last; i++)
+        {
+            if (bucketCount)
+            {
+                uint32_t h = (uint32_t)at(hashes + (i - 1) * 4, 4);
+                if (h % bucketCount != hash % bucketCount) break; // Walked into the next bucket
+                if (h != hash) continue;
+            }
+
+            uint64_t strOff = at(strOffs + (i - 1) * offsetSize, offsetSize);
+            if (strOff >= this->str.size || name != (const char*)this->str.data + strOff)
+            {
+                continue;
+            }
+
+            // Walk this name's entries until a variable turns up
+            DwarfCursor e(this->names.data, indexEnd, pool + (uint32_t)at(entryOffs + (i - 1) * offsetSize, offsetSize));
+            while (e.ok)
+            {
+                uint64_t code = e.uleb();
+                if (code == 0 || !e.ok) break;
+
+                // Abbrev table is small, a linear walk per entry is fine
+                DwarfCursor a(this->names.data, pool, abbrevs);
+                uint64_t tag = 0;
+                bool found = false;
+                while (a.ok)
+                {
+                    uint64_t ac = a.uleb();
+                    if (ac == 0) break;
+                    uint64_t t = a.uleb();
+                    if (ac == code)
+                    {
+                        tag = t;
+                        found = true;
+                        break;
+                    }
+                    while (a.ok && (a.uleb() | a.uleb()) != 0) {}
+                }
+                if (!found)
+                {
+                    break;
+                }
+
+                uint64_t cuIndex = 0, die = 0;
+                bool hasDie = false;
+                while (a.ok)
+                {
+                    uint16_t idx = (uint16_t)a.uleb();
+                    uint16_t form = (uint16_t)a.uleb();
+                    if (idx == 0 && form == 0) break;
+
+                    uint64_t v = 0;
+                    switch (form)
+                    {
+                        case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag: v = e.fixed(1); break;
+                        case DW_FORM_data2: case DW_FORM_ref2: v = e.fixed(2); break;
+                        case DW_FORM_data4: case DW_FORM_ref4: v = e.fixed(4); break;
+                        case DW_FORM_data8: case DW_FORM_ref8: v = e.fixed(8); break;
+                        case DW_FORM_udata: case DW_FORM_ref_udata: v = e.uleb(); break;
+                        case DW_FORM_flag_present: v = 1; break;
+                        default: return false;
+                    }
+
+                    if (idx == DW_IDX_compile_unit) cuIndex = v;
+                    else if (idx == DW_IDX_die_offset)
+                    {
+                        die = v;
+                        hasDie = true;
+                    }
+                }
+
+                if (tag == DW_TAG_variable && hasDie && cuIndex < cuCount)
+                {
+                    dieOffset = (uint32_t)(at(cuList + (uint32_t)cuIndex * offsetSize, offsetSize) + die);
+                    return true;
+                }
+            }
+        }
+
+        c = DwarfCursor(this->names.data, this->names.size, indexEnd);
+    }
+    return false;
+}
+
+bool DwarfInfo::readVariable(uint32_t dieOffset, DwarfVariable& out)
+{
+    Die die;
+    Unit* unit = nullptr;
+    if (!this->readDieAt(dieOffset, die, &unit))
+    {
+        return false;
+    }
+
+    const DieAttr* name = die.find(DW_AT_name);
+    const DieAttr* type = die.find(DW_AT_type);
+
+    // Name and type can live on the declaration this definition points at
+    const DieAttr* specRef = die.find(DW_AT_specification);
+    if (!specRef) specRef = die.find(DW_AT_abstract_origin);
+    Die spec;
+    if (specRef && this->readDieAt((uint32_t)specRef->value, spec))
+    {
+        if (!name) name = spec.find(DW_AT_name);
+        if (!type) type = spec.find(DW_AT_type);
+    }
+
+    if (name && name->str) out.name = name->str;
+
+    // Only plain DW_OP_addr locations, anything fancier falls back to the symbol table
+    const DieAttr* loc = die.find(DW_AT_location);
+    if (loc && loc->block && loc->blockLen >= 1u + unit->addrSize && loc->block[0] == DW_OP_addr)
+    {
+        DwarfCursor c(loc->block, loc->blockLen, 1);
+        out.addr = (uint32_t)c.fixed(unit->addrSize);
+        out.hasAddr = true;
+    }
+
+    out.type = type ? this->resolveType((uint32_t)type->value) : nullptr;
+    return true;
+}
+
+const DwarfVariable* DwarfInfo::findVariable(const std::string& name)
+{
+    if (!this->elf)
+    {
+        this->fail("No debug info loaded");
+        return nullptr;
+    }
+
+    auto cached = this->variables.find(name);
+    if (cached != this->variables.end())
+    {
+        return &cached->second;
+    }
+
+    uint32_t die = 0;
+    bool found = this->names.data && this->lookupNames(name, die);
+
+    if (!found)
+    {
+        auto hit = [&]()
+        {
+            auto it = this->globalIndex.find(std::string_view(name));
+            if (it == this->globalIndex.end()) return false;
+            die = it->second;
+            return true;
+        };
+
+        found = hit();
+
+        // Some toolchains put data in .debug_aranges too, try that unit before scanning in order
+        uint32_t unitOffset = 0;
+        const ElfSymbol* sym = found ? nullptr : this->elf->findSymbol(name);
+        if (sym && this->unitForAddress(sym->addr, unitOffset))
+        {
+            Unit* unit = this->unitFor(unitOffset);
+            if (unit)
+            {
+                this->scanUnit(*unit);
+                found = hit();
+            }
+        }
+
+        for (size_t i = 0; i < this->units.size() && !found; i++)
+        {
+            if (!this->units[i].scanned)
+            {
+                this->scanUnit(this->units[i]);
+                found = hit();
+            }
+        }
+
+        if (!found)
+        {
+            auto decl = this->declIndex.find(std::string_view(name));
+            if (decl != this->declIndex.end())
+            {
+                die = decl->second;
+                found = true;
+            }
+        }
+    }
+
+    DwarfVariable var;
+    if (!found || !this->readVariable(die, var))
+    {
+        this->fail("'" + name + "' not found in the debug info");
+        return nullptr;
+    }
+
+    // Declarations and odd locations still have a symbol
+    if (!var.hasAddr)
+    {
+        const ElfSymbol* sym = this->elf->findSymbol(name);
+        if (sym)
+        {
+            var.addr = sym->addr;
+            var.hasAddr = true;
+        }
+    }
+
+    auto it = this->variables.emplace(name, var).first;
+    return &it->second;
+}
+
+// ------------------------------
+// Types
+// ------------------------------
+const DwarfType* DwarfInfo::resolveType(uint32_t dieOffset)
+{
+    auto cached = this->types.find(dieOffset);
+    if (cached != this->types.end())
+    {
+        return cached->second.get();
+    }
+
+    Unit* unit = this->unitFor(dieOffset);
+    if (!unit || !this->prepareUnit(*unit))
+    {
+        return nullptr;
+    }
+
+    // childOffset ends up right after this DIE, which is where its children start
+    Die die;
+    uint32_t childOffset = dieOffset;
+    if (!this->readDie(*unit, childOffset, die))
+    {
+        return nullptr;
+    }
+
+    // In the cache before we recurse, so a struct pointing to itself ends up pointing at this entry
+    auto owned = std::make_unique<DwarfType>();
+    DwarfType* t = owned.get();
+    this->types.emplace(dieOffset, std::move(owned));
+
+    const DieAttr* name = die.find(DW_AT_name);
+    const DieAttr* size = die.find(DW_AT_byte_size);
+    const DieAttr* typeRef = die.find(DW_AT_type);
+
+    if (name && name->str) t->name = name->str;
+    if (size) t->size = (uint32_t)size->value;
+
+    switch (die.tag)
+    {
+        case DW_TAG_base_type:
+        {
+            const DieAttr* enc = die.find(DW_AT_encoding);
+            t->kind = DwarfTypeKind::BASE;
+            t->encoding = enc ? (uint8_t)enc->value : 0;
+            break;
+        }
+
+        case DW_TAG_typedef:
+        case DW_TAG_const_type:
+        case DW_TAG_volatile_type:
+        case DW_TAG_restrict_type:
+        case DW_TAG_atomic_type:
+            t->kind = DwarfTypeKind::ALIAS;
+            t->target = typeRef ? this->resolveType((uint32_t)typeRef->value) : nullptr;
+            if (!size) t->size = sizeOf(t->target);
+            break;
+
+        case DW_TAG_pointer_type:
+        case DW_TAG_reference_type:
+        case DW_TAG_rvalue_reference_type:
+            t->kind = DwarfTypeKind::POINTER;
+            if (!size) t->size = unit->addrSize;
+            t->target = typeRef ? this->resolveType((uint32_t)typeRef->value) : nullptr;
+            break;
+
+        case DW_TAG_structure_type:
+        case DW_TAG_class_type:
+        case DW_TAG_union_type:
+            t->kind = (die.tag == DW_TAG_union_type) ? DwarfTypeKind::UNION : DwarfTypeKind::STRUCT;
+            if (die.hasChildren) this->readStructMembers(*unit, childOffset, *t);
+            break;
+
+        case DW_TAG_enumeration_type:
+            t->kind = DwarfTypeKind::ENUM;
+            t->target = typeRef ? this->resolveType((uint32_t)typeRef->value) : nullptr;
+            if (!size) t->size = sizeOf(t->target);
+            if (die.hasChildren) this->readEnumerators(*unit, childOffset, *t);
+            break;
+
+        case DW_TAG_array_type:
+        {
+            t->kind = DwarfTypeKind::ARRAY;
+            const DwarfType* element = typeRef ? this->resolveType((uint32_t)typeRef->value) : nullptr;
+            if (die.hasChildren) this->readArrayDims(*unit, childOffset, *t, element);
+            else t->target = element;
+            break;
+        }
+
+        default:
+            t->kind = DwarfTypeKind::OTHER;
+            break;
+    }
+
+    return t;
+}
+
+void DwarfInfo::readStructMembers(Unit& unit, uint32_t offset, DwarfType& type)
+{
+    Die d;
+    while (this->readDie(unit, offset, d) && d.tag != 0)
+    {
+        if (d.tag == DW_TAG_member)
+        {
+            DwarfMember m;
+            const DieAttr* name = d.find(DW_AT_name);
+            const DieAttr* loc = d.find(DW_AT_data_member_location);
+            const DieAttr* typeRef = d.find(DW_AT_type);
+            const DieAttr* bitSize = d.find(DW_AT_bit_size);
+
+            if (name && name->str) m.name = name->str;
+
+            // Plain constant, or a DWARF 2 style DW_OP_plus_uconst block
+            if (loc && loc->block)
+            {
+                DwarfCursor c(loc->block, loc->blockLen, 0);
+                if (c.u8() == DW_OP_plus_uconst) m.offset = (uint32_t)c.uleb();
+            }
+            else if (loc)
+            {
+                m.offset = (uint32_t)loc->value;
+            }
+
+            m.type = typeRef ? this->resolveType((uint32_t)typeRef->value) : nullptr;
+
+            if (bitSize)
+            {
+                // Rebase everything to a bit offset from the lsb of the byte at m.offset
+                uint64_t bits = (uint64_t)m.offset * 8;
+                const DieAttr* dataBitOffset = d.find(DW_AT_data_bit_offset);
+                const DieAttr* oldBitOffset = d.find(DW_AT_bit_offset);
+                if (dataBitOffset)
+                {
+                    bits = dataBitOffset->value;
+                }
+                else if (oldBitOffset)
+                {
+                    // DWARF 2/3 count from the msb of the storage unit
+                    const DieAttr* storage = d.find(DW_AT_byte_size);
+                    uint32_t storageBits = 8 * (storage ? (uint32_t)storage->value : sizeOf(m.type));
+                    bits += storageBits - oldBitOffset->value - bitSize->value;
+                }
+
+                m.offset = (uint32_t)(bits / 8);
+                m.bitOffset = (uint8_t)(bits % 8);
+                m.bitSize = (uint8_t)std::min<uint64_t>(bitSize->value, 56);
+            }
+
+            type.members.push_back(m);
+        }
+
+        if (!this->skipChildren(unit, offset, d))
+        {
+            break;
+        }
+    }
+}
+
+void DwarfInfo::readEnumerators(Unit& unit, uint32_t offset, DwarfType& type)
+{
+    Die d;
+    while (this->readDie(unit, offset, d) && d.tag != 0)
+    {
+        if (d.tag == DW_TAG_enumerator)
+        {
+            const DieAttr* name = d.find(DW_AT_name);
+            const DieAttr* value = d.find(DW_AT_const_value);
+            if (name && name->str && value)
+            {
+                type.enumerators.push_back(DwarfEnumerator{name->str, (int64_t)value->value});
+            }
+        }
+
+        if (!this->skipChildren(unit, offset, d))
+        {
+            break;
+        }
+    }
+}
+
+// One subrange per dimension, inner dimensions become their own (uncached) array types
+void DwarfInfo::readArrayDims(Unit& unit, uint32_t offset, DwarfType& type, const DwarfType* element)
+{
+    std::vector<uint32_t> dims;
+    Die d;
+    while (this->readDie(unit, offset, d) && d.tag != 0)
+    {
+        if (d.tag == DW_TAG_subrange_type)
+        {
+            const DieAttr* count = d.find(DW_AT_count);
+            const DieAttr* upper = d.find(DW_AT_upper_bound);
+            uint32_t n = 0; // Flexible array member / extern int x[]
+            if (count && !count->block) n = (uint32_t)count->value;
+            else if (upper && !upper->block && upper->value != (uint64_t)-1) n = (uint32_t)upper->value + 1;
+            dims.push_back(n);
+        }
+
+        if (!this->skipChildren(unit, offset, d))
+        {
+            break;
+        }
+    }
+
+    if (dims.empty())
+    {
+        type.target = element;
+        return;
+    }
+
+    const DwarfType* inner = element;
+    for (size_t i = dims.size() - 1; i > 0; i--)
+    {
+        auto sub = std::make_unique<DwarfType>();
+        sub->kind = DwarfTypeKind::ARRAY;
+        sub->count = dims[i];
+        sub->target = inner;
+        sub->size = dims[i] * sizeOf(inner);
+        inner = sub.get();
+        this->synthetic.push_back(std::move(sub));
+    }
+
+    type.count = dims[0];
+    type.target = inner;
+    if (type.size == 0) type.size = dims[0] * sizeOf(inner);
+}
+
+// ------------------------------
+// Watch expressions
+// ------------------------------
+
+// Also looks inside anonymous struct/union members (C11)
+static bool findMember(const DwarfType* type, const std::string& name, uint32_t base, DwarfMember& out)
+{
+    for (const auto& m : type->members)
+    {
+        if (name == m.name)
+        {
+            out = m;
+            out.offset += base;
+            return true;
+        }
+
+        const DwarfType* inner = m.type ? m.type->resolved() : nullptr;
+        if (*m.name == '\0' && inner &&
+            (inner->kind == DwarfTypeKind::STRUCT || inner->kind == DwarfTypeKind::UNION) &&
+            findMember(inner, name, base + m.offset, out))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isIdentChar(char c, bool first)
+{
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (!first && c >= '0' && c <= '9');
+}
+
+bool DwarfInfo::resolveWatch(const std::string& expr, DwarfWatchTarget& out)
+{
+    size_t i = 0;
+    auto skipSpace = [&]() { while (i < expr.size() && expr[i] == ' ') i++; };
+    auto ident = [&]()
+    {
+        skipSpace();
+        size_t start = i;
+        while (i < expr.size() && isIdentChar(expr[i], i == start)) i++;
+        return expr.substr(start, i - start);
+    };
+
+    std::string root = ident();
+    if (root.empty())
+    {
+        return this->fail("Expected a variable name");
+    }
+
+    const DwarfVariable* var = this->findVariable(root);
+    if (!var)
+    {
+        return false;
+    }
+    if (!var->hasAddr)
+    {
+        return this->fail("'" + root + "' has no fixed address (optimized out?)");
+    }
+
+    DwarfWatchTarget t;
+    t.addr = var->addr;
+    t.type = var->type;
+
+    while (true)
+    {
+        skipSpace();
+        if (i >= expr.size())
+        {
+            break;
+        }
+
+        const DwarfType* r = t.type ? t.type->resolved() : nullptr;
+
+        if (expr[i] == '.')
+        {
+            i++;
+            std::string field = ident();
+            if (!r || (r->kind != DwarfTypeKind::STRUCT && r->kind != DwarfTypeKind::UNION))
+            {
+                return this->fail("'" + field + "': not a struct or union");
+            }
+
+            DwarfMember m;
+            if (!findMember(r, field, 0, m))
+            {
+                return this->fail("No member named '" + field + "'");
+            }
+            t.addr += m.offset;
+            t.type = m.type;
+            t.bitSize = m.bitSize;
+            t.bitOffset = m.bitOffset;
+        }
+        else if (expr[i] == '[')
+        {
+            i++;
+            skipSpace();
+            const char* begin = expr.c_str() + i;
+            char* endp = nullptr;
+            unsigned long index = strtoul(begin, &endp, 0);
+            if (endp == begin)
+            {
+                return this->fail("Expected an array index");
+            }
+            i += (size_t)(endp - begin);
+            skipSpace();
+            if (i >= expr.size() || expr[i] != ']')
+            {
+                return this->fail("Missing ']'");
+            }
+            i++;
+
+            if (!r || r->kind != DwarfTypeKind::ARRAY)
+            {
+                return this->fail("Not an array");
+            }
+            if (r->count != 0 && index >= r->count)
+            {
+                return this->fail("Index " + std::to_string(index) + " out of range (" + std::to_string(r->count) + ")");
+            }
+            t.addr += (uint32_t)index * sizeOf(r->target);
+            t.type = r->target;
+            t.bitSize = 0;
+            t.bitOffset = 0;
+        }
+        else if (expr.compare(i, 2, "->") == 0)
+        {
+            return this->fail("Pointer dereference is not supported yet");
+        }
+        else
+        {
+            return this->fail("Unexpected '" + std::string(1, expr[i]) + "'");
+        }
+    }
+
+    if (!t.type)
+    {
+        return this->fail("No type information for '" + expr + "'");
+    }
+
+    t.size = t.bitSize ? (uint32_t)((t.bitOffset + t.bitSize + 7) / 8) : sizeOf(t.type);
+    out = t;
+    return true;
+}
+
+std::string DwarfInfo::typeName(const DwarfType* type)
+{
+    if (!type)
+    {
+        return "void";
+    }
+
+    switch (type->kind)
+    {
+        case DwarfTypeKind::ALIAS:
+            // Unnamed alias = const/volatile, those just pass through
+            return *type->name ? type->name : typeName(type->target);
+
+        case DwarfTypeKind::POINTER:
+            return typeName(type->target) + "*";
+
+        case DwarfTypeKind::ARRAY:
+        {
+            std::string dims;
+            const DwarfType* t = type;
+            for (int n = 0; t && t->kind == DwarfTypeKind::ARRAY && n < 8; n++, t = t->target)
+            {
+                dims += "[" + (t->count ? std::to_string(t->count) : std::string()) + "]";
+            }
+            return typeName(t) + dims;
+        }
+
+        case DwarfTypeKind::STRUCT: return std::string("struct ") + (*type->name ? type->name : "{...}");
+        case DwarfTypeKind::UNION: return std::string("union ") + (*type->name ? type->name : "{...}");
+        case DwarfTypeKind::ENUM: return std::string("enum ") + (*type->name ? type->name : "{...}");
+        case DwarfTypeKind::BASE: return type->name;
+        default: return *type->name ? type->name : "?";
+    }
+}
+
+// Integer bits of a watch (bit fields shifted down), sign extended when the type is signed
+static void loadBits(const DwarfWatchTarget& target, const DwarfType* t, const uint8_t* bytes, uint64_t& raw,
+                     int64_t& sval, bool& isSigned)
+{
+    raw = 0;
+    for (size_t i = 0; i < target.size && i < 8; i++)
+    {
+        raw |= (uint64_t)bytes[i] << (8 * i);
+    }
+
+    uint32_t bits = 8 * std::min<uint32_t>(target.size, 8);
+    if (target.bitSize)
+    {
+        raw = (raw >> target.bitOffset) & ((1ull << target.bitSize) - 1);
+        bits = target.bitSize;
+    }
+
+    isSigned = (t->kind == DwarfTypeKind::BASE &&
+                (t->encoding == DW_ATE_signed || t->encoding == DW_ATE_signed_char)) ||
+               (t->kind == DwarfTypeKind::ENUM && t->target && t->target->resolved() &&
+                t->target->resolved()->encoding == DW_ATE_signed);
+    sval = (int64_t)raw;
+    if (isSigned && bits < 64 && (raw >> (bits - 1)) & 1)
+    {
+        sval = (int64_t)(raw | ~((1ull << bits) - 1));
+    }
+}
+
+std::string DwarfInfo::formatValue(const DwarfWatchTarget& target, const uint8_t* bytes, size_t len)
+{
+    const DwarfType* t = target.type ? target.type->resolved() : nullptr;
+    if (!t)
+    {
+        return "?";
+    }
+    if (!bytes || len < target.size)
+    {
+        return "<unreadable>";
+    }
+
+    uint64_t raw;
+    int64_t sval;
+    bool isSigned;
+    loadBits(target, t, bytes, raw, sval, isSigned);
+
+    char buf[96];
+    switch (t->kind)
+    {
+        case DwarfTypeKind::BASE:
+            if (t->encoding == DW_ATE_float && t->size == 4)
+            {
+                float f;
+                memcpy(&f, bytes, 4);
+                snprintf(buf, sizeof(buf), "%g", f);
+            }
+            else if (t->encoding == DW_ATE_float && t->size == 8)
+            {
+                double d;
+                memcpy(&d, bytes, 8);
+                snprintf(buf, sizeof(buf), "%g", d);
+            }
+            else if (t->encoding == DW_ATE_boolean)
+            {
+                snprintf(buf, sizeof(buf), "%s", raw ? "true" : "false");
+            }
+            else if ((t->encoding == DW_ATE_signed_char || t->encoding == DW_ATE_unsigned_char) && raw >= 32 && raw < 127)
+            {
+                snprintf(buf, sizeof(buf), "%" PRId64 " '%c'", isSigned ? sval : (int64_t)raw, (char)raw);
+            }
+            else if (isSigned)
+            {
+                snprintf(buf, sizeof(buf), "%" PRId64, sval);
+            }
+            else
+            {
+                snprintf(buf, sizeof(buf), "%" PRIu64 " (0x%" PRIX64 ")", raw, raw);
+            }
+            return buf;
+
+        case DwarfTypeKind::ENUM:
+            for (const auto& e : t->enumerators)
+            {
+                if (e.value == (isSigned ? sval : (int64_t)raw))
+                {
+                    return e.name;
+                }
+            }
+            snprintf(buf, sizeof(buf), "%" PRId64, isSigned ? sval : (int64_t)raw);
+            return buf;
+
+        case DwarfTypeKind::POINTER:
+            snprintf(buf, sizeof(buf), "0x%08" PRIX64, raw);
+            return buf;
+
+        case DwarfTypeKind::STRUCT:
+        case DwarfTypeKind::UNION:
+        case DwarfTypeKind::ARRAY:
+            return "{...}";
+
+        default:
+            return "?";
+    }
+}
+
+bool DwarfInfo::isNumeric(const DwarfWatchTarget& target)
+{
+    const DwarfType* t = target.type ? target.type->resolved() : nullptr;
+    return t && target.size > 0 && target.size <= 8 &&
+           (t->kind == DwarfTypeKind::BASE || t->kind == DwarfTypeKind::ENUM || t->kind == DwarfTypeKind::POINTER);
+}
+
+bool DwarfInfo::numericValue(const DwarfWatchTarget& target, const uint8_t* bytes, size_t len, double& value)
+{
+    if (!isNumeric(target) || !bytes || len < target.size)
+    {
+        return false;
+    }
+
+    const DwarfType* t = target.type->resolved();
+    if (t->kind == DwarfTypeKind::BASE && t->encoding == DW_ATE_float && !target.bitSize && (t->size == 4 || t->size == 8))
+    {
+        if (t->size == 4)
+        {
+            float f;
+            memcpy(&f, bytes, 4);
+            value = f;
+        }
+        else
+        {
+            memcpy(&value, bytes, 8);
+        }
+        return true;
+    }
+
+    uint64_t raw;
+    int64_t sval;
+    bool isSigned;
+    loadBits(target, t, bytes, raw, sval, isSigned);
+    value = isSigned ? (double)sval : (double)raw;
+    return true;
+}
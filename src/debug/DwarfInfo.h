@@ -0,0 +1,249 @@
+/* =============== DwarfInfo.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: DWARF type reader
+
+    Description:
+        Lazy .debug_info reader for watch expressions. Nothing gets parsed
+        up front except the compile unit headers. A watched variable is found
+        through .debug_names when the firmware has it, otherwise the compile
+        units are scanned one at a time (top level DIEs only) until it shows
+        up. Only the type DIEs hanging off that variable get decoded, and they
+        are cached so the next watch on the same type costs nothing.
+*/
+
+#ifndef DWARFINFO_H
+#define DWARFINFO_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class ElfFile;
+
+/**
+  * @brief What a resolved type boils down to
+
+  - BASE: int/float/bool/char, see DwarfType::encoding
+  - ALIAS: typedef, const, volatile... points at the real type through target
+  - POINTER: target is what it points at (nullptr for void*)
+  - STRUCT / UNION: members are filled in
+  - ARRAY: count elements of target. int a[2][3] is an array of 2 arrays of 3
+  - ENUM: enumerators are filled in, the value is read like an integer
+  - OTHER: function pointers and anything else we do not dig into
+*/
+enum class DwarfTypeKind {BASE, ALIAS, POINTER, STRUCT, UNION, ARRAY, ENUM, OTHER};
+
+struct DwarfType;
+
+struct DwarfMember
+{
+    const char* name = "";
+    uint32_t offset = 0; // Byte offset in the parent struct
+    uint8_t bitSize = 0; // 0 unless it is a bit field
+    uint8_t bitOffset = 0; // From the lsb of the containing storage
+    const DwarfType* type = nullptr;
+};
+
+struct DwarfEnumerator
+{
+    const char* name = "";
+    int64_t value = 0;
+};
+
+struct DwarfType
+{
+    DwarfTypeKind kind = DwarfTypeKind::OTHER;
+    const char* name = ""; // Empty for anonymous structs, pointers and arrays
+    uint32_t size = 0;
+    uint8_t encoding = 0; // DW_ATE_* for base types
+    uint32_t count = 0; // Array element count
+    const DwarfType* target = nullptr;
+
+    std::vector<DwarfMember> members;
+    std::vector<DwarfEnumerator> enumerators;
+
+    // Skips typedefs and qualifiers
+    const DwarfType* resolved() const;
+};
+
+struct DwarfVariable
+{
+    const char* name = "";
+    uint32_t addr = 0;
+    bool hasAddr = false; // false when the DWARF only had a declaration or a location we can't evaluate
+    const DwarfType* type = nullptr;
+};
+
+// Where a watch expression like "motor.pid[1].kp" lives on the target
+struct DwarfWatchTarget
+{
+    uint32_t addr = 0;
+    uint32_t size = 0;
+    uint8_t bitSize = 0;
+    uint8_t bitOffset = 0;
+    const DwarfType* type = nullptr;
+};
+
+/**
+  * @brief Lazy DWARF 2-5 reader over an open ElfFile
+
+  Holds pointers into the ElfFile's mapping, so the ElfFile has to stay open for as long as this is used.
+  The type cache is keyed by .debug_info offset and owns every DwarfType, pointers handed out stay valid
+  until close() or the next open().
+*/
+class DwarfInfo
+{
+    private:
+
+        struct AttrSpec
+        {
+            uint16_t name = 0;
+            uint16_t form = 0;
+            int64_t implicitConst = 0;
+        };
+
+        struct Abbrev
+        {
+            uint16_t tag = 0;
+            bool hasChildren = false;
+            std::vector<AttrSpec> attrs;
+        };
+
+        struct AbbrevTable
+        {
+            std::vector<Abbrev> byCode; // Codes are nearly always 1..n
+            std::unordered_map<uint64_t, Abbrev> sparse;
+            const Abbrev* find(uint64_t code) const;
+        };
+
+        struct Unit
+        {
+            uint32_t offset = 0; // Of the unit header
+            uint32_t end = 0; // Next unit header
+            uint32_t firstDie = 0;
+            uint16_t version = 0;
+            uint8_t addrSize = 4;
+            uint8_t offsetSize = 4; // 8 for 64 bit DWARF
+            uint32_t abbrevOffset = 0;
+            uint32_t strOffsetsBase = 0;
+            bool prepared = false; // Root DIE read (str_offsets_base)
+            bool scanned = false; // Top level variables are in globalIndex
+            const AbbrevTable* abbrevs = nullptr;
+        };
+
+        struct DieAttr
+        {
+            uint16_t name = 0;
+            uint16_t form = 0;
+            uint64_t value = 0; // Constants, addresses and absolute .debug_info offsets for references
+            const char* str = nullptr;
+            const uint8_t* block = nullptr;
+            uint32_t blockLen = 0;
+        };
+
+        struct Die
+        {
+            uint32_t offset = 0;
+            uint16_t tag = 0;
+            bool hasChildren = false;
+            std::vector<DieAttr> attrs;
+
+            const DieAttr* find(uint16_t name) const;
+        };
+
+        struct SectionView
+        {
+            const uint8_t* data = nullptr;
+            uint32_t size = 0;
+        };
+
+        struct Arange
+        {
+            uint32_t start = 0;
+            uint32_t end = 0;
+            uint32_t unit = 0; // Unit header offset
+        };
+
+        ElfFile* elf = nullptr;
+        std::string lastError;
+
+        SectionView info, abbrev, str, lineStr, strOffsets, aranges, names;
+
+        std::vector<Unit> units; // Sorted by offset
+        std::unordered_map<uint32_t, std::unique_ptr<AbbrevTable>> abbrevTables;
+        std::vector<Arange> arangeList; // Sorted by start
+        bool arangesParsed = false;
+
+        // Caches
+        std::unordered_map<uint32_t, std::unique_ptr<DwarfType>> types; // By DIE offset
+        std::vector<std::unique_ptr<DwarfType>> synthetic; // Inner dimensions of multi dim arrays
+        std::unordered_map<std::string_view, uint32_t> globalIndex; // Name -> defining DIE (from scanned units)
+        std::unordered_map<std::string_view, uint32_t> declIndex; // extern declarations, used if no definition turns up
+        std::unordered_map<std::string, DwarfVariable> variables;
+        size_t scannedUnits = 0;
+
+        void parseUnitHeaders();
+        void parseAranges();
+        const AbbrevTable* getAbbrevTable(uint32_t offset);
+        Unit* unitFor(uint32_t dieOffset);
+        bool prepareUnit(Unit& unit);
+
+        bool readDie(Unit& unit, uint32_t& offset, Die& die);
+        bool readDieAt(uint32_t offset, Die& die, Unit** unitOut = nullptr);
+        bool skipChildren(Unit& unit, uint32_t& offset, const Die& parent);
+        const char* readStrx(const Unit& unit, uint64_t index) const;
+
+        void scanUnit(Unit& unit);
+        bool lookupNames(std::string_view name, uint32_t& dieOffset);
+        bool readVariable(uint32_t dieOffset, DwarfVariable& out);
+
+        const DwarfType* resolveType(uint32_t dieOffset);
+        void readStructMembers(Unit& unit, uint32_t offset, DwarfType& type);
+        void readEnumerators(Unit& unit, uint32_t offset, DwarfType& type);
+        void readArrayDims(Unit& unit, uint32_t offset, DwarfType& type, const DwarfType* element);
+
+        bool fail(const std::string& msg);
+
+    public:
+
+        DwarfInfo() = default;
+
+        DwarfInfo(const DwarfInfo&) = delete;
+        DwarfInfo& operator=(const DwarfInfo&) = delete;
+
+        // Only reads the unit headers, false if the ELF has no usable .debug_info
+        bool open(ElfFile& elf);
+        void close();
+        bool isOpen() const {return this->elf != nullptr;}
+
+        size_t unitCount() const {return this->units.size();}
+        size_t scannedUnitCount() const {return this->scannedUnits;}
+        size_t cachedTypeCount() const {return this->types.size();}
+        bool hasNameIndex() const {return this->names.data != nullptr;}
+
+        // Unit header offset covering a code address (from .debug_aranges), false if none does
+        bool unitForAddress(uint32_t addr, uint32_t& unitOffset);
+
+        // Global or file static variable by name, nullptr if it is not in the debug info
+        const DwarfVariable* findVariable(const std::string& name);
+
+        // Parses name(.member | [index])* down to an address + type
+        bool resolveWatch(const std::string& expr, DwarfWatchTarget& out);
+
+        // "uint32_t", "struct motor", "float[8]"...
+        static std::string typeName(const DwarfType* type);
+
+        // Formats raw little endian target bytes for the watch list
+        static std::string formatValue(const DwarfWatchTarget& target, const uint8_t* bytes, size_t len);
+
+        // Scalars (numbers, enums, pointers) can be plotted, structs and arrays can't
+        static bool isNumeric(const DwarfWatchTarget& target);
+        static bool numericValue(const DwarfWatchTarget& target, const uint8_t* bytes, size_t len, double& value);
+
+        const std::string& getLastError() const {return this->lastError;}
+};
+
+#endif // DWARFINFO_H
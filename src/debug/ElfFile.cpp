@@ -0,0 +1,293 @@
+/* =============== ElfFile.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: ELF loader
+
+    Description:
+        Header parsing + symbol indexes. Header structs are memcpy'd out of
+        the mapping since nothing guarantees they are aligned.
+*/
+
+#include "ElfFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Only the parts of the ELF32 layout we read
+struct Elf32Header
+{
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+};
+
+struct Elf32SectionHeader
+{
+    uint32_t name;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t addr;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t link;
+    uint32_t info;
+    uint32_t addralign;
+    uint32_t entsize;
+};
+
+struct Elf32ProgramHeader
+{
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+};
+
+struct Elf32Sym
+{
+    uint32_t name;
+    uint32_t value;
+    uint32_t size;
+    uint8_t info;
+    uint8_t other;
+    uint16_t shndx;
+};
+
+bool ElfFile::fail(const std::string& msg)
+{
+    this->lastError = msg;
+    this->close();
+    return false;
+}
+
+bool ElfFile::open(const std::string& path)
+{
+    this->close();
+    this->path = path;
+
+    std::string err;
+    if (!this->file.open(path, err))
+    {
+        return this->fail(err);
+    }
+
+    const uint8_t* base = this->file.data();
+    const size_t size = this->file.size();
+
+    Elf32Header hdr;
+    if (size < sizeof(hdr))
+    {
+        return this->fail("File too small to be an ELF");
+    }
+    memcpy(&hdr, base, sizeof(hdr));
+
+    if (memcmp(hdr.ident, "\x7f" "ELF", 4) != 0)
+    {
+        return this->fail("Not an ELF file");
+    }
+    if (hdr.ident[4] != 1 || hdr.ident[5] != 1)
+    {
+        return this->fail("Only 32 bit little endian ELF files are supported");
+    }
+
+    this->entry = hdr.entry;
+
+    // Section headers
+    if (hdr.shoff == 0 || hdr.shentsize < sizeof(Elf32SectionHeader) ||
+        (uint64_t)hdr.shoff + (uint64_t)hdr.shnum * hdr.shentsize > size)
+    {
+        return this->fail("Bad section header table");
+    }
+
+    std::vector<Elf32SectionHeader> raw(hdr.shnum);
+    for (uint16_t i = 0; i < hdr.shnum; i++)
+    {
+        memcpy(&raw[i], base + hdr.shoff + (size_t)i * hdr.shentsize, sizeof(Elf32SectionHeader));
+    }
+
+    const char* shstr = nullptr;
+    uint32_t shstrSize = 0;
+    if (hdr.shstrndx < hdr.shnum && (uint64_t)raw[hdr.shstrndx].offset + raw[hdr.shstrndx].size <= size)
+    {
+        shstr = (const char*)base + raw[hdr.shstrndx].offset;
+        shstrSize = raw[hdr.shstrndx].size;
+    }
+
+    this->sections.resize(hdr.shnum);
+    for (uint16_t i = 0; i < hdr.shnum; i++)
+    {
+        ElfSection& s = this->sections[i];
+        s.type = raw[i].type;
+        s.flags = raw[i].flags;
+        s.addr = raw[i].addr;
+        s.offset = raw[i].offset;
+        s.size = raw[i].size;
+        s.name = (shstr && raw[i].name < shstrSize) ? shstr + raw[i].name : "";
+
+        if (s.type != SHT_NOBITS && (uint64_t)s.offset + s.size <= size)
+        {
+            s.data = base + s.offset;
+        }
+    }
+
+    // Program headers (what actually gets flashed)
+    if (hdr.phoff != 0 && hdr.phentsize >= sizeof(Elf32ProgramHeader) &&
+        (uint64_t)hdr.phoff + (uint64_t)hdr.phnum * hdr.phentsize <= size)
+    {
+        for (uint16_t i = 0; i < hdr.phnum; i++)
+        {
+            Elf32ProgramHeader ph;
+            memcpy(&ph, base + hdr.phoff + (size_t)i * hdr.phentsize, sizeof(ph));
+
+            ElfSegment seg;
+            seg.type = ph.type;
+            seg.vaddr = ph.vaddr;
+            seg.paddr = ph.paddr;
+            seg.fileSize = ph.filesz;
+            seg.memSize = ph.memsz;
+            seg.flags = ph.flags;
+            if ((uint64_t)ph.offset + ph.filesz <= size)
+            {
+                seg.data = base + ph.offset;
+            }
+            this->segments.push_back(seg);
+        }
+    }
+
+    return true;
+}
+
+void ElfFile::close()
+{
+    this->file.close();
+    this->entry = 0;
+    this->sections.clear();
+    this->segments.clear();
+    this->symbols.clear();
+    this->nameIndex.clear();
+    this->symbolsBuilt = false;
+    this->nameIndexBuilt = false;
+}
+
+const ElfSection* ElfFile::findSection(const char* name) const
+{
+    for (const auto& s : this->sections)
+    {
+        if (strcmp(s.name, name) == 0)
+        {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+void ElfFile::buildSymbols()
+{
+    this->symbolsBuilt = true;
+
+    const ElfSection* symtab = this->findSection(".symtab");
+    const ElfSection* strtab = this->findSection(".strtab");
+    if (!symtab || !strtab || !symtab->data || !strtab->data)
+    {
+        return;
+    }
+
+    const size_t count = symtab->size / sizeof(Elf32Sym);
+    this->symbols.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Elf32Sym sym;
+        memcpy(&sym, symtab->data + i * sizeof(Elf32Sym), sizeof(sym));
+
+        const uint8_t type = sym.info & 0x0F;
+        if ((type != STT_FUNC && type != STT_OBJECT) || sym.value == 0 || sym.name >= strtab->size)
+        {
+            continue;
+        }
+
+        ElfSymbol s;
+        s.addr = (type == STT_FUNC) ? (sym.value & ~1u) : sym.value; // Drop the thumb bit
+        s.size = sym.size;
+        s.type = type;
+        s.name = (const char*)strtab->data + sym.name;
+        this->symbols.push_back(s);
+    }
+
+    std::sort(this->symbols.begin(), this->symbols.end(),
+              [](const ElfSymbol& a, const ElfSymbol& b) { return a.addr < b.addr; });
+}
+
+void ElfFile::buildNameIndex()
+{
+    if (!this->symbolsBuilt)
+    {
+        this->buildSymbols();
+    }
+
+    this->nameIndexBuilt = true;
+    this->nameIndex.reserve(this->symbols.size());
+    for (size_t i = 0; i < this->symbols.size(); i++)
+    {
+        // First one wins if a static name shows up in several files
+        this->nameIndex.emplace(std::string_view(this->symbols[i].name), i);
+    }
+}
+
+const ElfSymbol* ElfFile::findSymbolByAddress(uint32_t addr)
+{
+    if (!this->symbolsBuilt)
+    {
+        this->buildSymbols();
+    }
+
+    // Last symbol starting at or below addr
+    auto it = std::upper_bound(this->symbols.begin(), this->symbols.end(), addr,
+                               [](uint32_t a, const ElfSymbol& s) { return a < s.addr; });
+    if (it == this->symbols.begin())
+    {
+        return nullptr;
+    }
+    --it;
+
+    // Prefer a symbol that really covers addr, zero sized ones (asm labels) still count as nearest
+    if (it->size != 0 && addr >= it->addr + it->size)
+    {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+const ElfSymbol* ElfFile::findSymbol(std::string_view name)
+{
+    if (!this->nameIndexBuilt)
+    {
+        this->buildNameIndex();
+    }
+
+    auto it = this->nameIndex.find(name);
+    return (it != this->nameIndex.end()) ? &this->symbols[it->second] : nullptr;
+}
+
+size_t ElfFile::symbolCount()
+{
+    if (!this->symbolsBuilt)
+    {
+        this->buildSymbols();
+    }
+    return this->symbols.size();
+}
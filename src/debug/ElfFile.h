@@ -0,0 +1,109 @@
+/* =============== ElfFile.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: ELF loader
+
+    Description:
+        Reads ELF32 little endian firmware files (what arm-none-eabi-gcc
+        spits out). The file is memory mapped and nothing gets copied:
+        section data and symbol names are pointers straight into the mapping.
+        Symbol indexes are built the first time they are needed.
+*/
+
+#ifndef ELFFILE_H
+#define ELFFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "util/MappedFile.h"
+
+struct ElfSection
+{
+    const char* name = "";
+    uint32_t type = 0;
+    uint32_t flags = 0;
+    uint32_t addr = 0;   // Load address on the target (0 for debug sections)
+    uint32_t offset = 0; // Offset in the file
+    uint32_t size = 0;
+    const uint8_t* data = nullptr; // nullptr for SHT_NOBITS (.bss)
+};
+
+struct ElfSegment
+{
+    uint32_t type = 0;
+    uint32_t vaddr = 0;
+    uint32_t paddr = 0; // Where it gets flashed (LMA), differs from vaddr for .data
+    uint32_t fileSize = 0;
+    uint32_t memSize = 0;
+    uint32_t flags = 0;
+    const uint8_t* data = nullptr;
+};
+
+struct ElfSymbol
+{
+    uint32_t addr = 0; // Thumb bit already cleared for functions
+    uint32_t size = 0;
+    const char* name = "";
+    uint8_t type = 0;  // STT_FUNC / STT_OBJECT
+};
+
+/**
+  * @brief Memory mapped ELF32 reader with lazy symbol indexes
+
+  open() only maps the file and walks the section / program headers, which is a few
+  hundred entries no matter how big the debug info is. The address sorted symbol table
+  (for PC -> function) and the name hash (for watch expressions) are built on first use.
+*/
+class ElfFile
+{
+    private:
+
+        MappedFile file;
+        std::string path;
+        std::string lastError;
+
+        uint32_t entry = 0;
+        std::vector<ElfSection> sections;
+        std::vector<ElfSegment> segments;
+
+        // Built lazily
+        bool symbolsBuilt = false;
+        bool nameIndexBuilt = false;
+        std::vector<ElfSymbol> symbols; // Sorted by address
+        std::unordered_map<std::string_view, size_t> nameIndex;
+
+        void buildSymbols();
+        void buildNameIndex();
+        bool fail(const std::string& msg);
+
+    public:
+
+        static constexpr uint32_t SHT_NOBITS = 8;
+        static constexpr uint32_t PT_LOAD = 1;
+        static constexpr uint8_t STT_OBJECT = 1;
+        static constexpr uint8_t STT_FUNC = 2;
+
+        ElfFile() = default;
+
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const {return this->file.isOpen();}
+
+        const std::string& getPath() const {return this->path;}
+        const std::string& getLastError() const {return this->lastError;}
+        uint32_t getEntry() const {return this->entry;}
+
+        const std::vector<ElfSection>& getSections() const {return this->sections;}
+        const std::vector<ElfSegment>& getSegments() const {return this->segments;}
+        const ElfSection* findSection(const char* name) const;
+
+        // Function or object covering addr (falls back to the closest symbol below it). O(log n)
+        const ElfSymbol* findSymbolByAddress(uint32_t addr);
+        const ElfSymbol* findSymbol(std::string_view name);
+        size_t symbolCount();
+};
+
+#endif // ELFFILE_H
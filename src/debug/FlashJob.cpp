@@ -0,0 +1,102 @@
+/* =============== FlashJob.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Background flashing
+
+    Description:
+        Worker thread around DeltaFlasher::flash().
+*/
+
+#include "FlashJob.h"
+#include "ElfFile.h"
+#include "OpenOCDTcl.h"
+#include "STM32Detector.h"
+#include "STM32Devices.h"
+#include "util/Profiler.h"
+
+FlashJob::~FlashJob()
+{
+    this->cancel();
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+bool FlashJob::start(const std::string& elfPath, const std::string& host, int tclPort)
+{
+    if (this->running.load())
+    {
+        return false;
+    }
+    if (this->worker.joinable())
+    {
+        this->worker.join(); // Finished, but the report was never taken
+    }
+
+    this->progress.cancel.store(false);
+    this->progress.bytesDone.store(0);
+    this->progress.bytesTodo.store(0);
+    this->progress.phase.store(FlashPhase::PREPARING);
+    this->report = DeltaFlashReport();
+    this->deviceName.clear();
+
+    this->finished.store(false);
+    this->running.store(true);
+    this->worker = std::thread(&FlashJob::run, this, elfPath, host, tclPort);
+    return true;
+}
+
+void FlashJob::run(std::string elfPath, std::string host, int tclPort)
+{
+    PROFILE_THREAD("flash");
+
+    DeltaFlashReport result;
+
+    // A mapping of our own, the UI may reload symbols meanwhile
+    ElfFile elf;
+    OpenOCDTcl tcl;
+    if (!elf.open(elfPath))
+    {
+        result.errMsg = "Failed to load " + elfPath + ": " + elf.getLastError();
+    }
+    else if (!tcl.connect(host.c_str(), tclPort, 500))
+    {
+        result.errMsg = "Flashing needs the TCL port (" + std::to_string(tclPort) + "): " + tcl.getLastError();
+    }
+    else
+    {
+        DetectionResult det = DetectedSTM32Tcl(tcl);
+        const STM32Device* device = det.success ? findSTM32Device(det.devID) : nullptr;
+        if (device)
+        {
+            this->deviceName = device->name;
+        }
+        result = this->flasher.flash(tcl, elf, device, &this->progress);
+    }
+
+    this->report = std::move(result);
+    this->progress.phase.store(FlashPhase::DONE);
+    this->finished.store(true);
+    this->running.store(false);
+}
+
+float FlashJob::getFraction() const
+{
+    const uint32_t todo = this->progress.bytesTodo.load();
+    const uint32_t done = this->progress.bytesDone.load();
+    return (todo > 0) ? (float)done / (float)todo : 0.0f;
+}
+
+bool FlashJob::takeReport(DeltaFlashReport& out, std::string& device)
+{
+    if (!this->finished.exchange(false))
+    {
+        return false;
+    }
+
+    this->worker.join();
+    out = std::move(this->report);
+    device = this->deviceName;
+    this->progress.phase.store(FlashPhase::IDLE);
+    return true;
+}
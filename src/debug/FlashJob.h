@@ -0,0 +1,65 @@
+/* =============== FlashJob.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Background flashing
+
+    Description:
+        Runs a DeltaFlasher on its own thread, with its own TCL connection
+        and its own mapping of the ELF, so the UI keeps drawing while the
+        target is erased and programmed. Progress and cancel go through a
+        FlashProgress (atomics only), the report is picked up once the job
+        is done.
+*/
+
+#ifndef FLASHJOB_H
+#define FLASHJOB_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "DeltaFlasher.h"
+
+/**
+  * @brief One flash at a time on a worker thread
+
+  start() returns straight away. The UI polls getPhase() / getFraction() and calls takeReport()
+  each frame, which hands over the result exactly once when the worker has finished. cancel()
+  stops between program calls, so sectors end up either rewritten or untouched.
+*/
+class FlashJob
+{
+    private:
+
+        DeltaFlasher flasher; // Lives as long as the job, keeps the measured program speed
+        FlashProgress progress;
+        std::thread worker;
+        std::atomic<bool> running{false};
+        std::atomic<bool> finished{false};
+
+        // Written by the worker before finished is set
+        DeltaFlashReport report;
+        std::string deviceName;
+
+        void run(std::string elfPath, std::string host, int tclPort);
+
+    public:
+
+        FlashJob() = default;
+        ~FlashJob();
+
+        FlashJob(const FlashJob&) = delete;
+        FlashJob& operator=(const FlashJob&) = delete;
+
+        // False if a job is still running
+        bool start(const std::string& elfPath, const std::string& host = "127.0.0.1", int tclPort = 6666);
+        void cancel() {this->progress.cancel.store(true);}
+        bool isRunning() const {return this->running.load();}
+
+        FlashPhase getPhase() const {return this->progress.phase.load();}
+        float getFraction() const; // Within the current phase, 0..1
+
+        // True once per finished job, out then holds its report
+        bool takeReport(DeltaFlashReport& out, std::string& device);
+};
+
+#endif // FLASHJOB_H
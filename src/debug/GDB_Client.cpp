@@ -0,0 +1,725 @@
+/* =============== GDB_Client.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: GDB Remote Serial Protocol client
+
+    Description:
+        Packet format is $<payload>#<2 hex digit checksum>. Replies can be run
+        length encoded ('*') and escaped ('}'), OpenOCD uses both for big
+        memory reads. Stuff like '+' acks and '%' notifications is skipped.
+*/
+
+#include "GDB_Client.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // strtoul
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 'O' + hex is console output, but "OK" also starts with O
+static bool isConsolePacket(const std::string& payload)
+{
+    if (payload.size() < 3 || payload[0] != 'O' || (payload.size() % 2) == 0)
+    {
+        return false;
+    }
+    for (size_t i = 1; i < payload.size(); i++)
+    {
+        if (hexValue(payload[i]) < 0) return false;
+    }
+    return true;
+}
+
+// "Enn" error reply. Data replies are always an even number of hex chars, so no mix up there
+static bool isErrorReply(const std::string& payload)
+{
+    return payload.size() == 3 && payload[0] == 'E';
+}
+
+GDB_Client::~GDB_Client()
+{
+    this->disconnect();
+}
+
+bool GDB_Client::fail(const std::string& msg)
+{
+    this->lastError = msg;
+    return false;
+}
+
+bool GDB_Client::drop(const std::string& msg)
+{
+    this->disconnect();
+    return this->fail(msg);
+}
+
+// ------------------------------
+// Packet helpers
+// ------------------------------
+std::string GDB_Client::frame(const std::string& payload)
+{
+    std::string out;
+    out.reserve(payload.size() + 4);
+    out += '$';
+
+    uint8_t sum = 0;
+    for (char c : payload)
+    {
+        // These have a meaning in the framing, send them escaped
+        if (c == '$' || c == '#' || c == '}' || c == '*')
+        {
+            out += '}';
+            sum += (uint8_t)'}';
+            c = (char)(c ^ 0x20);
+        }
+        out += c;
+        sum += (uint8_t)c;
+    }
+
+    char tail[4];
+    snprintf(tail, sizeof(tail), "#%02x", sum);
+    out += tail;
+    return out;
+}
+
+bool GDB_Client::hexToBytes(const std::string& hex, std::vector<uint8_t>& out)
+{
+    if (hex.size() % 2 != 0)
+    {
+        return false;
+    }
+
+    out.resize(hex.size() / 2);
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        // 'x' means the register/byte is not available, call it 0
+        int hi = hex[2 * i] == 'x' ? 0 : hexValue(hex[2 * i]);
+        int lo = hex[2 * i + 1] == 'x' ? 0 : hexValue(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+std::string GDB_Client::bytesToHex(const uint8_t* data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string out(len * 2, '0');
+    for (size_t i = 0; i < len; i++)
+    {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+bool GDB_Client::parseStopReply(const std::string& payload, GdbStopReply& stop)
+{
+    if (payload.empty())
+    {
+        return false;
+    }
+
+    stop = GdbStopReply();
+    stop.kind = payload[0];
+    stop.raw = payload;
+
+    if (stop.kind != 'S' && stop.kind != 'T' && stop.kind != 'W' && stop.kind != 'X')
+    {
+        return false;
+    }
+
+    if (payload.size() >= 3)
+    {
+        int hi = hexValue(payload[1]);
+        int lo = hexValue(payload[2]);
+        if (hi >= 0 && lo >= 0) stop.signal = (hi << 4) | lo;
+    }
+
+    stop.exited = (stop.kind == 'W' || stop.kind == 'X');
+    return true;
+}
+
+// ------------------------------
+// Wire I/O
+// ------------------------------
+bool GDB_Client::sendRaw(const std::string& data)
+{
+    if (!this->isConnected())
+    {
+        return this->fail("Not connected");
+    }
+
+    if (!socketSendAll(this->skt, data.data(), data.size(), this->timeoutMs))
+    {
+        return this->drop("Send failed: " + socketLastError());
+    }
+    return true;
+}
+
+bool GDB_Client::sendPacket(const std::string& payload)
+{
+    return this->sendRaw(frame(payload));
+}
+
+// Pulls one complete packet out of rx if there is one
+bool GDB_Client::unframe(const char* packet, size_t len, std::string& payload)
+{
+    // '$' or '%', body, '#', two checksum digits
+    if (len < 4 || packet[len - 3] != '#')
+    {
+        return false;
+    }
+
+    const char* body = packet + 1;
+    const size_t bodyLen = len - 4;
+
+    uint8_t sum = 0;
+    for (size_t i = 0; i < bodyLen; i++)
+    {
+        sum += (uint8_t)body[i];
+    }
+    int expected = (hexValue(packet[len - 2]) << 4) | hexValue(packet[len - 1]);
+    if (expected != sum)
+    {
+        return false;
+    }
+
+    // Undo escaping and run length encoding
+    payload.clear();
+    payload.reserve(bodyLen);
+    for (size_t i = 0; i < bodyLen; i++)
+    {
+        if (body[i] == '}' && i + 1 < bodyLen)
+        {
+            payload += (char)(body[++i] ^ 0x20);
+        }
+        else if (body[i] == '*' && i + 1 < bodyLen && !payload.empty())
+        {
+            int repeat = (int)(uint8_t)body[++i] - 29;
+            if (repeat > 0) payload.append((size_t)repeat, payload.back());
+        }
+        else
+        {
+            payload += body[i];
+        }
+    }
+    return true;
+}
+
+bool GDB_Client::takePacket(std::string& payload)
+{
+    size_t pos = 0;
+
+    while (pos < this->rx.size())
+    {
+        char c = this->rx[pos];
+
+        if (c != '$' && c != '%')
+        {
+            // Acks ('+' / '-') and line noise
+            pos++;
+            continue;
+        }
+
+        size_t hash = this->rx.find('#', pos + 1);
+        if (hash == std::string::npos || hash + 2 >= this->rx.size())
+        {
+            break; // Not all there yet
+        }
+
+        const bool notification = (c == '%');
+        const bool sumOk = unframe(this->rx.data() + pos, hash + 3 - pos, payload);
+        pos = hash + 3;
+
+        // Without acks nobody resends it, every later reply would be matched to the wrong request
+        if (this->noAck && !notification && !sumOk)
+        {
+            this->drop("Reply with a bad checksum");
+            return false;
+        }
+
+        if (!this->noAck && !notification)
+        {
+            this->sendRaw(sumOk ? "+" : "-");
+        }
+        if (notification || !sumOk)
+        {
+            continue;
+        }
+
+        this->rx.erase(0, pos);
+        return true;
+    }
+
+    this->rx.erase(0, pos);
+    return false;
+}
+
+bool GDB_Client::readPacket(std::string& payload, int timeoutMs)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    char buffer[4096];
+
+    while (true)
+    {
+        while (this->takePacket(payload))
+        {
+            if (!isConsolePacket(payload))
+            {
+                return true;
+            }
+
+            std::vector<uint8_t> text;
+            if (hexToBytes(payload.substr(1), text))
+            {
+                this->consoleOutput.append(text.begin(), text.end());
+            }
+        }
+        if (this->skt == InvalidSocket)
+        {
+            return false; // takePacket gave up on the stream
+        }
+
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+        if (left <= 0)
+        {
+            return this->drop("Timed out waiting for reply");
+        }
+
+        int w = socketWait(this->skt, false, left);
+        if (w < 0)
+        {
+            return this->drop("Socket error: " + socketLastError());
+        }
+        if (w == 0)
+        {
+            continue;
+        }
+
+        int n = socketRecv(this->skt, buffer, sizeof(buffer));
+        if (n == 0)
+        {
+            this->disconnect();
+            return this->fail("Connection closed by gdb server");
+        }
+        if (n == -2)
+        {
+            return this->drop("Receive failed: " + socketLastError());
+        }
+        if (n > 0)
+        {
+            this->rx.append(buffer, (size_t)n);
+        }
+    }
+}
+
+// ------------------------------
+// Connection
+// ------------------------------
+bool GDB_Client::connect(const char* host, int port, int timeoutMs)
+{
+    this->disconnect();
+
+    if (!socketInit())
+    {
+        return this->fail("Failed to initialize sockets");
+    }
+
+    std::string err;
+    this->skt = socketConnect(host, port, timeoutMs, err);
+    if (this->skt == InvalidSocket)
+    {
+        socketCleanup();
+        return this->fail(err);
+    }
+
+    this->timeoutMs = timeoutMs;
+    this->rx.clear();
+    this->packetSize = 400;
+    this->noAck = false;
+    this->running = false;
+
+    // gdb opens with an ack, some stubs wait for it
+    this->sendRaw("+");
+
+    std::string reply;
+    if (!this->transact("qSupported:swbreak+;hwbreak+", reply))
+    {
+        this->disconnect();
+        return false;
+    }
+
+    bool noAckSupported = false;
+    size_t start = 0;
+    while (start <= reply.size())
+    {
+        size_t end = reply.find(';', start);
+        if (end == std::string::npos) end = reply.size();
+        std::string feature = reply.substr(start, end - start);
+
+        if (feature.rfind("PacketSize=", 0) == 0)
+        {
+            size_t size = (size_t)strtoul(feature.c_str() + 11, nullptr, 16);
+            if (size >= 64) this->packetSize = size;
+        }
+        else if (feature == "QStartNoAckMode+")
+        {
+            noAckSupported = true;
+        }
+
+        start = end + 1;
+    }
+
+    // TCP already makes sure nothing gets lost, acks are just an extra byte each way
+    if (noAckSupported && this->transact("QStartNoAckMode", reply) && reply == "OK")
+    {
+        this->noAck = true;
+    }
+
+    // A server that never answered is gone again by now
+    return this->isConnected();
+}
+
+void GDB_Client::disconnect()
+{
+    if (this->skt == InvalidSocket)
+    {
+        return;
+    }
+
+    // Detach lets OpenOCD resume the target instead of leaving it stuck
+    std::string detach = frame("D");
+    socketSendAll(this->skt, detach.data(), detach.size(), 100);
+
+    socketClose(this->skt);
+    socketCleanup();
+
+    this->skt = InvalidSocket;
+    this->running = false;
+    this->rx.clear();
+}
+
+// ------------------------------
+// Requests
+// ------------------------------
+bool GDB_Client::transact(const std::string& cmd, std::string& reply)
+{
+    if (this->running)
+    {
+        return this->fail("Target is running");
+    }
+    if (!this->sendPacket(cmd))
+    {
+        return false;
+    }
+    return this->readPacket(reply, this->timeoutMs);
+}
+
+bool GDB_Client::transactMany(const std::vector<std::string>& cmds, std::vector<std::string>& replies)
+{
+    if (this->running)
+    {
+        return this->fail("Target is running");
+    }
+
+    replies.assign(cmds.size(), std::string());
+
+    size_t sent = 0;
+    size_t received = 0;
+    std::string batch;
+
+    while (received < cmds.size())
+    {
+        // Keep the pipe full, the server answers in order
+        batch.clear();
+        while (sent < cmds.size() && sent - received < PipelineDepth)
+        {
+            batch += frame(cmds[sent]);
+            sent++;
+        }
+        if (!batch.empty() && !this->sendRaw(batch))
+        {
+            return false;
+        }
+
+        if (!this->readPacket(replies[received], this->timeoutMs))
+        {
+            return false;
+        }
+        received++;
+    }
+
+    return true;
+}
+
+bool GDB_Client::readRegisters(std::vector<uint32_t>& regs)
+{
+    std::string reply;
+    if (!this->transact("g", reply))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes;
+    if (isErrorReply(reply) || !hexToBytes(reply, bytes))
+    {
+        return this->fail("Bad register reply: " + reply);
+    }
+
+    // Target byte order is little endian on every Cortex-M
+    regs.resize(bytes.size() / 4);
+    for (size_t i = 0; i < regs.size(); i++)
+    {
+        regs[i] = (uint32_t)bytes[4 * i] | ((uint32_t)bytes[4 * i + 1] << 8) |
+                  ((uint32_t)bytes[4 * i + 2] << 16) | ((uint32_t)bytes[4 * i + 3] << 24);
+    }
+    return true;
+}
+
+bool GDB_Client::readMemory(uint32_t addr, uint32_t len, std::vector<uint8_t>& out)
+{
+    std::vector<std::vector<uint8_t>> results;
+    if (!this->readMemoryBatch({GdbMemRange{addr, len}}, results))
+    {
+        return false;
+    }
+    if (results[0].size() != len)
+    {
+        return false; // lastError says why
+    }
+    out.swap(results[0]);
+    return true;
+}
+
+bool GDB_Client::readMemoryBatch(const std::vector<GdbMemRange>& ranges, std::vector<std::vector<uint8_t>>& out)
+{
+    // Each reply is 2 hex chars per byte plus framing, it has to fit in one packet
+    uint32_t maxChunk = (uint32_t)((this->packetSize - 16) / 2);
+
+    std::vector<std::string> cmds;
+    std::vector<size_t> owner; // Which range each command belongs to
+    char cmd[32];
+
+    for (size_t r = 0; r < ranges.size(); r++)
+    {
+        uint32_t done = 0;
+        while (done < ranges[r].len)
+        {
+            uint32_t n = ranges[r].len - done;
+            if (n > maxChunk) n = maxChunk;
+
+            snprintf(cmd, sizeof(cmd), "m%x,%x", ranges[r].addr + done, n);
+            cmds.push_back(cmd);
+            owner.push_back(r);
+            done += n;
+        }
+    }
+
+    std::vector<std::string> replies;
+    if (!this->transactMany(cmds, replies))
+    {
+        return false;
+    }
+
+    out.assign(ranges.size(), std::vector<uint8_t>());
+    std::vector<bool> failed(ranges.size(), false);
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < replies.size(); i++)
+    {
+        const size_t r = owner[i];
+        if (failed[r])
+        {
+            continue;
+        }
+
+        // One bad address (unmapped, or a merged read reaching into a hole) only costs its own range
+        if (isErrorReply(replies[i]) || !hexToBytes(replies[i], bytes))
+        {
+            this->fail("Memory read failed: " + replies[i]);
+            failed[r] = true;
+            out[r].clear();
+            continue;
+        }
+        out[r].insert(out[r].end(), bytes.begin(), bytes.end());
+    }
+    return true;
+}
+
+bool GDB_Client::writeMemory(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    uint32_t maxChunk = (uint32_t)((this->packetSize - 32) / 2);
+
+    std::vector<std::string> cmds;
+    char head[32];
+    for (uint32_t done = 0; done < len; )
+    {
+        uint32_t n = len - done;
+        if (n > maxChunk) n = maxChunk;
+
+        snprintf(head, sizeof(head), "M%x,%x:", addr + done, n);
+        cmds.push_back(head + bytesToHex(data + done, n));
+        done += n;
+    }
+
+    std::vector<std::string> replies;
+    if (!this->transactMany(cmds, replies))
+    {
+        return false;
+    }
+    for (const auto& r : replies)
+    {
+        if (r != "OK") return this->fail("Memory write failed: " + r);
+    }
+    return true;
+}
+
+// ------------------------------
+// Execution control
+// ------------------------------
+bool GDB_Client::queryStop(GdbStopReply& stop)
+{
+    std::string reply;
+    if (!this->transact("?", reply))
+    {
+        return false;
+    }
+    return parseStopReply(reply, stop) || this->fail("Bad stop reply: " + reply);
+}
+
+bool GDB_Client::continueTarget()
+{
+    if (this->running)
+    {
+        return true;
+    }
+    if (!this->sendPacket("c"))
+    {
+        return false;
+    }
+
+    // No reply until the target stops again
+    this->running = true;
+    return true;
+}
+
+bool GDB_Client::pollStop(GdbStopReply& stop, bool& stopped)
+{
+    stopped = false;
+    if (!this->running)
+    {
+        return true;
+    }
+
+    // Grab whatever is there without waiting
+    char buffer[4096];
+    while (true)
+    {
+        int n = socketRecv(this->skt, buffer, sizeof(buffer));
+        if (n > 0)
+        {
+            this->rx.append(buffer, (size_t)n);
+            continue;
+        }
+        if (n == 0)
+        {
+            this->disconnect();
+            return this->fail("Connection closed by gdb server");
+        }
+        if (n == -2)
+        {
+            return this->drop("Receive failed: " + socketLastError());
+        }
+        break;
+    }
+
+    std::string payload;
+    while (this->takePacket(payload))
+    {
+        std::vector<uint8_t> text;
+        if (isConsolePacket(payload))
+        {
+            if (hexToBytes(payload.substr(1), text))
+            {
+                this->consoleOutput.append(text.begin(), text.end());
+            }
+            continue;
+        }
+
+        if (parseStopReply(payload, stop))
+        {
+            this->running = false;
+            stopped = true;
+            return true;
+        }
+    }
+    return this->skt != InvalidSocket;
+}
+
+bool GDB_Client::interrupt(GdbStopReply& stop)
+{
+    if (!this->running)
+    {
+        return this->queryStop(stop);
+    }
+
+    // Ctrl-C goes out as a bare byte, not as a packet
+    if (!this->sendRaw(std::string(1, '\x03')))
+    {
+        return false;
+    }
+
+    std::string reply;
+    if (!this->readPacket(reply, this->timeoutMs))
+    {
+        return false;
+    }
+
+    this->running = false;
+    return parseStopReply(reply, stop) || this->fail("Bad stop reply: " + reply);
+}
+
+bool GDB_Client::step(GdbStopReply& stop)
+{
+    std::string reply;
+    if (!this->transact("s", reply))
+    {
+        return false;
+    }
+    return parseStopReply(reply, stop) || this->fail("Bad stop reply: " + reply);
+}
+
+bool GDB_Client::monitor(const std::string& cmd, std::string& output)
+{
+    this->consoleOutput.clear();
+
+    std::string reply;
+    if (!this->transact("qRcmd," + bytesToHex((const uint8_t*)cmd.data(), cmd.size()), reply))
+    {
+        return false;
+    }
+
+    output = this->consoleOutput;
+
+    if (isErrorReply(reply))
+    {
+        return this->fail("Monitor command failed: " + reply);
+    }
+
+    // Some servers hand the output back hex encoded in the reply itself
+    std::vector<uint8_t> text;
+    if (reply != "OK" && hexToBytes(reply, text))
+    {
+        output.append(text.begin(), text.end());
+    }
+    return true;
+}
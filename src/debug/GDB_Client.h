@@ -0,0 +1,128 @@
+/* =============== GDB_Client.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: GDB Remote Serial Protocol client
+
+    Description:
+        Talks the GDB remote protocol straight to OpenOCD's gdb port (3333),
+        no arm-none-eabi-gdb process in between. After the handshake we use
+        the PacketSize OpenOCD gives us, turn acks off (QStartNoAckMode), and
+        send several m/g requests before reading any reply, so a batch of
+        reads costs one round trip instead of one per read.
+*/
+
+#ifndef GDB_CLIENT_H
+#define GDB_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Socket.h"
+
+/**
+  * @brief Parsed stop reply ('S', 'T', 'W' or 'X' packet)
+  - signal: the signal number the target stopped with (5 = SIGTRAP for breakpoints/steps)
+  - exited: true for 'W'/'X', the target is gone
+*/
+struct GdbStopReply
+{
+    char kind = 0;
+    int signal = 0;
+    bool exited = false;
+    std::string raw;
+};
+
+// One memory region to read
+struct GdbMemRange
+{
+    uint32_t addr = 0;
+    uint32_t len = 0;
+};
+
+/**
+  * @brief Native RSP client
+
+  All calls are made from one thread (the UI thread right now). While the target is running
+  after continueTarget(), the protocol only allows an interrupt, so everything else fails
+  until pollStop() or interrupt() sees the stop reply. A timeout or a lost reply closes the
+  connection, so isConnected() tells whether anything after the error can still be trusted.
+*/
+class GDB_Client
+{
+    private:
+
+        SocketType skt = InvalidSocket;
+        std::string rx; // Received bytes that are not a full packet yet
+
+        size_t packetSize = 400; // What gdb assumes until the server tells us otherwise
+        bool noAck = false;
+        bool running = false;
+        int timeoutMs = 1000;
+
+        std::string lastError;
+        std::string consoleOutput; // Text from 'O' packets (monitor output)
+
+        bool sendRaw(const std::string& data);
+        bool sendPacket(const std::string& payload);
+        bool readPacket(std::string& payload, int timeoutMs);
+        bool takePacket(std::string& payload);
+        bool fail(const std::string& msg);
+        // For errors after which replies can't be matched to requests anymore (timeout, lost or
+        // corrupt packet): a late reply would be taken as the answer to the next request
+        bool drop(const std::string& msg);
+
+    public:
+
+        // Outstanding requests allowed on the wire at once when pipelining
+        static constexpr size_t PipelineDepth = 32;
+
+        GDB_Client() = default;
+        ~GDB_Client();
+
+        GDB_Client(const GDB_Client&) = delete;
+        GDB_Client& operator=(const GDB_Client&) = delete;
+
+        // Connects and runs the qSupported / QStartNoAckMode handshake
+        bool connect(const char* host = "127.0.0.1", int port = 3333, int timeoutMs = 1000);
+        void disconnect();
+        bool isConnected() const {return this->skt != InvalidSocket;}
+        bool isRunning() const {return this->running;}
+
+        // One request, one reply
+        bool transact(const std::string& cmd, std::string& reply);
+
+        // Sends every command back to back (up to PipelineDepth in flight) and collects the replies in order
+        bool transactMany(const std::vector<std::string>& cmds, std::vector<std::string>& replies);
+
+        // Registers as returned by 'g' (r0-r12, sp, lr, pc, xPSR on Cortex-M)
+        bool readRegisters(std::vector<uint32_t>& regs);
+        bool readMemory(uint32_t addr, uint32_t len, std::vector<uint8_t>& out);
+        // All ranges pipelined. A range the target refused (Exx) comes back empty, only a broken
+        // connection fails the whole batch.
+        bool readMemoryBatch(const std::vector<GdbMemRange>& ranges, std::vector<std::vector<uint8_t>>& out);
+        bool writeMemory(uint32_t addr, const uint8_t* data, uint32_t len);
+
+        // Execution control
+        bool queryStop(GdbStopReply& stop);          // '?'
+        bool continueTarget();                       // 'c', does not wait
+        bool pollStop(GdbStopReply& stop, bool& stopped); // Non-blocking check after continueTarget()
+        bool interrupt(GdbStopReply& stop);          // Ctrl-C, waits for the stop reply
+        bool step(GdbStopReply& stop);               // 's'
+
+        // "monitor <cmd>" (qRcmd), output is whatever OpenOCD printed
+        bool monitor(const std::string& cmd, std::string& output);
+
+        size_t getPacketSize() const {return this->packetSize;}
+        bool isNoAck() const {return this->noAck;}
+        const std::string& getLastError() const {return this->lastError;}
+
+        // Packet helpers, public so they can be checked on their own
+        static std::string frame(const std::string& payload);
+        // One whole "$body#cs" packet -> payload, false on a bad checksum
+        static bool unframe(const char* packet, size_t len, std::string& payload);
+        static bool parseStopReply(const std::string& payload, GdbStopReply& stop);
+        static bool hexToBytes(const std::string& hex, std::vector<uint8_t>& out);
+        static std::string bytesToHex(const uint8_t* data, size_t len);
+};
+
+#endif // GDB_CLIENT_H
@@ -0,0 +1,371 @@
+/* =============== ItmDecoder.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: ITM / DWT trace decoder
+
+    Description:
+        Header classification and payload / continuation collection, and the
+        packet to plot row mapping.
+*/
+
+#include "ItmDecoder.h"
+
+#include <cstring>
+
+void ItmDecoder::reset()
+{
+    this->state = State::HEADER;
+    this->current = ItmPacket();
+    this->needed = 0;
+    this->got = 0;
+    this->zeros = 0;
+    this->timestamp = 0;
+    this->timestampSeen = false;
+    this->packets = 0;
+    this->overflows = 0;
+    this->invalid = 0;
+}
+
+// Payload is complete, work out what the hardware packet actually was
+void ItmDecoder::finish(ItmPacket& out)
+{
+    if (this->current.type == ItmPacketType::EVENT_COUNTER)
+    {
+        // Hardware source, current.channel still holds the discriminator
+        const uint8_t id = this->current.channel;
+        this->current.channel = 0;
+
+        if (id == 0)
+        {
+            this->current.type = ItmPacketType::EVENT_COUNTER;
+        }
+        else if (id == 1)
+        {
+            this->current.type = ItmPacketType::EXCEPTION;
+            this->current.control = (uint8_t)((this->current.value >> 12) & 0x3);
+            this->current.value &= 0x1FF;
+        }
+        else if (id == 2)
+        {
+            this->current.type = ItmPacketType::PC_SAMPLE;
+        }
+        else if (id >= 8 && id <= 15)
+        {
+            this->current.type = (id & 1) ? ItmPacketType::DATA_ADDRESS : ItmPacketType::DATA_PC;
+            this->current.channel = (uint8_t)((id - 8) >> 1);
+        }
+        else if (id >= 16 && id <= 23)
+        {
+            this->current.type = ItmPacketType::DATA_VALUE;
+            this->current.channel = (uint8_t)((id - 16) >> 1);
+            this->current.write = (id & 1) != 0;
+        }
+        else
+        {
+            this->current.type = ItmPacketType::INVALID;
+            this->invalid++;
+        }
+    }
+    else if (this->current.type == ItmPacketType::LOCAL_TIMESTAMP)
+    {
+        this->timestamp += this->current.value;
+        this->timestampSeen = true;
+    }
+
+    out = this->current;
+    this->packets++;
+    this->state = State::HEADER;
+}
+
+bool ItmDecoder::push(uint8_t b, ItmPacket& out)
+{
+    // Sync (47+ zero bits, then a one) wins over whatever packet was open, that is how the
+    // decoder finds its way back after joining a stream midway or losing bytes
+    const bool sync = (b == 0x80 && this->zeros >= 5);
+    if (b == 0x00)
+    {
+        if (this->zeros < 255) this->zeros++;
+    }
+    else
+    {
+        this->zeros = 0;
+    }
+
+    if (sync)
+    {
+        this->current = ItmPacket();
+        this->current.type = ItmPacketType::SYNC;
+        this->finish(out);
+        return true;
+    }
+
+    switch (this->state)
+    {
+        case State::PAYLOAD:
+            this->current.value |= (uint32_t)b << (8 * this->got);
+            this->got++;
+            if (this->got < this->needed)
+            {
+                return false;
+            }
+            this->finish(out);
+            return true;
+
+        case State::CONTINUATION:
+            // 7 bits per byte, the top bit says whether another one follows
+            if (this->got < 5)
+            {
+                this->current.value |= (uint32_t)(b & 0x7F) << (7 * this->got);
+            }
+            this->got++;
+            this->current.size++;
+            if ((b & 0x80) && this->got < this->maxContinuation)
+            {
+                return false;
+            }
+            this->finish(out);
+            return true;
+
+        case State::HEADER:
+        default:
+            break;
+    }
+
+    // Header byte, zeros are the start of a sync
+    if (b == 0x00)
+    {
+        return false;
+    }
+
+    this->current = ItmPacket();
+    this->got = 0;
+
+    if (b == 0x70)
+    {
+        this->current.type = ItmPacketType::OVERFLOW;
+        this->overflows++;
+        this->finish(out);
+        return true;
+    }
+
+    const uint8_t ss = b & 0x03;
+    if (ss != 0)
+    {
+        // Source packet, the payload decides nothing about the type so it is sorted out in finish()
+        this->current.size = (ss == 3) ? 4 : ss;
+        this->current.channel = (uint8_t)(b >> 3);
+        this->current.type = (b & 0x04) ? ItmPacketType::EVENT_COUNTER : ItmPacketType::INSTRUMENTATION;
+        this->needed = this->current.size;
+        this->state = State::PAYLOAD;
+        return false;
+    }
+
+    if ((b & 0x0F) == 0x00)
+    {
+        this->current.type = ItmPacketType::LOCAL_TIMESTAMP;
+
+        if (!(b & 0x80))
+        {
+            // Format 2: the delta (1-6) sits in the header itself
+            this->current.value = (b >> 4) & 0x07;
+            this->finish(out);
+            return true;
+        }
+
+        this->current.control = (uint8_t)((b >> 4) & 0x03);
+        this->maxContinuation = 4;
+        this->state = State::CONTINUATION;
+        return false;
+    }
+
+    if (b == 0x94 || b == 0xB4)
+    {
+        this->current.type = ItmPacketType::GLOBAL_TIMESTAMP;
+        this->current.control = (b == 0x94) ? 1 : 2;
+        this->maxContinuation = (b == 0x94) ? 4 : 6;
+        this->state = State::CONTINUATION;
+        return false;
+    }
+
+    if ((b & 0x0B) == 0x08)
+    {
+        this->current.type = ItmPacketType::EXTENSION;
+        this->current.value = (b >> 4) & 0x07;
+        this->current.control = (b >> 2) & 0x01; // SH bit
+        if (b & 0x80)
+        {
+            this->maxContinuation = 4;
+            this->state = State::CONTINUATION;
+            return false;
+        }
+        this->finish(out);
+        return true;
+    }
+
+    // Reserved encoding: count it and treat the next byte as a header again
+    this->current.type = ItmPacketType::INVALID;
+    this->current.value = b;
+    this->invalid++;
+    this->finish(out);
+    return true;
+}
+
+// ------------------------------
+// Plot rows
+// ------------------------------
+void ItmRowBuilder::reset(size_t channels, double timeOffset, double timestampHz)
+{
+    this->decoder.reset();
+    this->channels = channels;
+    this->timeOffset = timeOffset;
+    this->timestampHz = (timestampHz > 0.0) ? timestampHz : 1.0;
+    this->last.assign(channels, 0.0);
+
+    for (int i = 0; i < 32; i++) this->portColumn[i] = (i < (int)channels) ? i : -1;
+    for (int i = 0; i < 4; i++) this->comparatorColumn[i] = -1;
+
+    this->pcSamples.store(0, std::memory_order_relaxed);
+    this->sleepSamples.store(0, std::memory_order_relaxed);
+    this->lastPc.store(0, std::memory_order_relaxed);
+}
+
+void ItmRowBuilder::mapPort(unsigned port, int column)
+{
+    if (port < 32) this->portColumn[port] = (column < (int)this->channels) ? column : -1;
+}
+
+void ItmRowBuilder::mapComparator(unsigned comparator, int column)
+{
+    if (comparator < 4) this->comparatorColumn[comparator] = (column < (int)this->channels) ? column : -1;
+}
+
+// true when a new row was started, false when the value went into the open one
+bool ItmRowBuilder::emit(int column, double value, double hostTime, std::vector<double>& rows)
+{
+    this->last[column] = value;
+
+    double t = hostTime;
+    if (this->decoder.hasTimestamps())
+    {
+        t = this->timeOffset + (double)this->decoder.localTime() / this->timestampHz;
+    }
+
+    const uint64_t bit = (uint64_t)1 << (column & 63);
+    if (this->rowOpen && t == this->rowTime && !(this->rowColumns & bit))
+    {
+        rows[rows.size() - this->channels + column] = value;
+        this->rowColumns |= bit;
+        return false;
+    }
+
+    rows.push_back(t);
+    rows.insert(rows.end(), this->last.begin(), this->last.end());
+    this->rowOpen = true;
+    this->rowTime = t;
+    this->rowColumns = bit;
+    return true;
+}
+
+size_t ItmRowBuilder::feed(const uint8_t* data, size_t len, double hostTime, std::vector<double>& rows)
+{
+    size_t count = 0;
+    this->rowOpen = false; // The caller owns rows, it may have been handed on since last time
+
+    this->decoder.feed(data, len, [&](const ItmPacket& pkt)
+    {
+        switch (pkt.type)
+        {
+            case ItmPacketType::INSTRUMENTATION:
+            {
+                int column = this->portColumn[pkt.channel & 31];
+                if (column < 0) return;
+
+                double v = pkt.value;
+                if (pkt.size == 4)
+                {
+                    float f;
+                    memcpy(&f, &pkt.value, 4);
+                    v = f;
+                }
+
+                if (this->emit(column, v, hostTime, rows)) count++;
+                break;
+            }
+
+            case ItmPacketType::DATA_VALUE:
+            {
+                int column = this->comparatorColumn[pkt.channel & 3];
+                if (column < 0) return;
+
+                if (this->emit(column, (double)pkt.value, hostTime, rows)) count++;
+                break;
+            }
+
+            case ItmPacketType::PC_SAMPLE:
+                this->pcSamples.fetch_add(1, std::memory_order_relaxed);
+                if (pkt.size == 1)
+                {
+                    this->sleepSamples.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    this->lastPc.store(pkt.value, std::memory_order_relaxed);
+                }
+                break;
+
+            default:
+                break;
+        }
+    });
+
+    return count;
+}
+
+size_t ItmRowBuilder::encodeStimulus(unsigned port, uint32_t value, uint8_t* out)
+{
+    out[0] = (uint8_t)(((port & 31) << 3) | 0x03);
+    out[1] = (uint8_t)value;
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)(value >> 16);
+    out[4] = (uint8_t)(value >> 24);
+    return 5;
+}
+
+size_t ItmRowBuilder::encodeTimestamp(uint32_t delta, uint8_t* out)
+{
+    // Short form when it fits in the header
+    if (delta >= 1 && delta <= 6)
+    {
+        out[0] = (uint8_t)(delta << 4);
+        return 1;
+    }
+
+    // Format 1, TC = 0 (in sync), 7 bits per continuation byte
+    size_t n = 0;
+    out[n++] = 0xC0;
+    do
+    {
+        uint8_t b = delta & 0x7F;
+        delta >>= 7;
+        if (delta && n < 4) b |= 0x80;
+        out[n++] = b;
+    } while (delta && n < 5);
+    return n;
+}
+
+size_t ItmRowBuilder::encodePcSample(uint32_t pc, bool sleeping, uint8_t* out)
+{
+    // Hardware source, discriminator 2
+    if (sleeping)
+    {
+        out[0] = 0x15;
+        out[1] = 0x00;
+        return 2;
+    }
+
+    out[0] = 0x17;
+    out[1] = (uint8_t)pc;
+    out[2] = (uint8_t)(pc >> 8);
+    out[3] = (uint8_t)(pc >> 16);
+    out[4] = (uint8_t)(pc >> 24);
+    return 5;
+}
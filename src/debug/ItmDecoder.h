@@ -0,0 +1,185 @@
+/* =============== ItmDecoder.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: ITM / DWT trace decoder
+
+    Description:
+        Packet parser for the ITM byte stream that comes out of the SWO pin
+        (OpenOCD's tpiu/swo capture, to a file or a TCP port). It is a byte
+        at a time state machine, so packets can be split anywhere between
+        reads, and it never allocates: a packet is a small struct handed to a
+        callback.
+
+        Header byte cheat sheet (ARMv7-M ARM, appendix D4):
+            0x00 x5+, 0x80      sync
+            0x70                overflow
+            cccc 0000           local timestamp (c = 0 and 7 are other packets)
+            0x94 / 0xB4         global timestamp 1 / 2
+            Cxxx 1S00           extension
+            aaaa a0ss           instrumentation (software) port a, ss = 1/2/4 bytes
+            iiii i1ss           hardware source (DWT), i = discriminator
+*/
+
+#ifndef ITMDECODER_H
+#define ITMDECODER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class ItmPacketType
+{
+    SYNC,
+    OVERFLOW,
+    INSTRUMENTATION, // channel = stimulus port
+    LOCAL_TIMESTAMP, // value = delta in timestamp clocks, control = TC bits
+    GLOBAL_TIMESTAMP, // value = low or high bits, control = 1 or 2 (GTS1 / GTS2)
+    EXTENSION,
+    EVENT_COUNTER, // value = counter wrap bits (CPI, EXC, SLEEP, LSU, FOLD, CYC)
+    EXCEPTION, // value = exception number, control = function (1 enter, 2 exit, 3 return)
+    PC_SAMPLE, // value = PC, size 1 means the core was asleep
+    DATA_PC, // channel = comparator, value = PC of the access
+    DATA_ADDRESS, // channel = comparator, value = low 16 bits of the address
+    DATA_VALUE, // channel = comparator, write tells read from write
+    INVALID // Reserved header, the decoder drops it and keeps going
+};
+
+struct ItmPacket
+{
+    ItmPacketType type = ItmPacketType::INVALID;
+    uint8_t channel = 0;
+    uint8_t size = 0; // Payload bytes
+    uint8_t control = 0;
+    bool write = false;
+    uint32_t value = 0;
+};
+
+/**
+  * @brief Incremental ITM packet parser
+
+  push() takes one byte and returns true when it finished a packet. feed() does that over a whole
+  buffer and hands each packet to a callback. Local timestamps are summed up in localTime() so
+  the consumer can put packets on a time axis.
+*/
+class ItmDecoder
+{
+    private:
+
+        enum class State {HEADER, PAYLOAD, CONTINUATION};
+
+        State state = State::HEADER;
+        ItmPacket current;
+        uint8_t needed = 0; // Payload bytes still missing
+        uint8_t got = 0;
+        uint8_t maxContinuation = 0;
+        uint8_t zeros = 0; // Zero bytes in a row, 5 and then 0x80 is a sync
+
+        uint64_t timestamp = 0;
+        bool timestampSeen = false;
+
+        uint64_t packets = 0;
+        uint64_t overflows = 0;
+        uint64_t invalid = 0;
+
+        void finish(ItmPacket& out);
+
+    public:
+
+        ItmDecoder() = default;
+
+        void reset();
+
+        // true when b completed a packet (it is in out then)
+        bool push(uint8_t b, ItmPacket& out);
+
+        template <typename Fn>
+        size_t feed(const uint8_t* data, size_t len, Fn&& onPacket)
+        {
+            size_t count = 0;
+            ItmPacket pkt;
+            for (size_t i = 0; i < len; i++)
+            {
+                if (this->push(data[i], pkt))
+                {
+                    onPacket(pkt);
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        // Sum of all local timestamp deltas so far (timestamp clock ticks)
+        uint64_t localTime() const {return this->timestamp;}
+        bool hasTimestamps() const {return this->timestampSeen;}
+
+        uint64_t packetCount() const {return this->packets;}
+        uint64_t overflowCount() const {return this->overflows;}
+        uint64_t invalidCount() const {return this->invalid;}
+};
+
+/**
+  * @brief Turns ITM packets into plot rows
+
+  Stimulus port n goes to plot column portColumn[n], DWT data trace comparator n to
+  comparatorColumn[n] (-1 = not plotted). Rows are [t, ch0, ch1, ...] with every column holding
+  its last value, so a slow signal does not turn into gaps. Packets with the same time stamp go into
+  one row until a column repeats, so firmware writing all ports once per sample gives one row per sample.
+
+  Values: a 4 byte port write is read as a float (firmware does ITM->PORT[n].u32 = bits of the
+  float), 1 and 2 byte writes and data trace values as unsigned integers.
+
+  Time: when the stream has local timestamps (ITM_TCR.TSENA) they are used, divided by
+  timestampHz. Without them every packet gets the host time passed to feed(). Timestamp packets
+  follow the packets they belong to; here they are applied to what comes after them, which is off by
+  at most one timestamp interval and keeps the rows monotonic.
+
+  PC samples are counted with atomics so the UI thread can show where the core spends its time
+  while the stream runs.
+*/
+class ItmRowBuilder
+{
+    private:
+
+        ItmDecoder decoder;
+        size_t channels = 0;
+        double timeOffset = 0.0;
+        double timestampHz = 1.0;
+        int portColumn[32];
+        int comparatorColumn[4];
+        std::vector<double> last; // Sample and hold per column
+        uint64_t rowColumns = 0; // Columns written into the open row (the last one in rows)
+        double rowTime = 0.0;
+        bool rowOpen = false;
+
+        std::atomic<uint64_t> pcSamples{0};
+        std::atomic<uint64_t> sleepSamples{0};
+        std::atomic<uint32_t> lastPc{0};
+
+        bool emit(int column, double value, double hostTime, std::vector<double>& rows);
+
+    public:
+
+        ItmRowBuilder() {this->reset(0);}
+
+        // Ports 0..channels-1 map to columns 0..channels-1 after a reset, comparators are not plotted
+        void reset(size_t channels, double timeOffset = 0.0, double timestampHz = 1.0);
+        void mapPort(unsigned port, int column);
+        void mapComparator(unsigned comparator, int column);
+
+        // Appends rows for every mapped packet in data, returns how many
+        size_t feed(const uint8_t* data, size_t len, double hostTime, std::vector<double>& rows);
+
+        const ItmDecoder& getDecoder() const {return this->decoder;}
+
+        // Safe to read from any thread
+        uint64_t pcSampleCount() const {return this->pcSamples.load(std::memory_order_relaxed);}
+        uint64_t sleepSampleCount() const {return this->sleepSamples.load(std::memory_order_relaxed);}
+        uint32_t lastSampledPc() const {return this->lastPc.load(std::memory_order_relaxed);}
+
+        // Firmware side, for the simulated target. Return the bytes written (at most 5).
+        static size_t encodeStimulus(unsigned port, uint32_t value, uint8_t* out);
+        static size_t encodeTimestamp(uint32_t delta, uint8_t* out);
+        static size_t encodePcSample(uint32_t pc, bool sleeping, uint8_t* out);
+};
+
+#endif // ITMDECODER_H
@@ -0,0 +1,93 @@
+/* =============== MockServer.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Test helpers
+
+    Description:
+        Loopback listening socket for the test programs. The mock servers
+        (RSP, telnet) run on a thread of the test itself, accept the one
+        connection the client under test makes and script the replies.
+*/
+
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "Socket.h"
+#include "TestCheck.h"
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+#endif
+
+// Listens on 127.0.0.1 on a free port, port gets the one the OS picked
+static inline SocketType mockListen(int& port)
+{
+    socketInit();
+
+    SocketType skt = socket(AF_INET, SOCK_STREAM, 0);
+    if (skt == InvalidSocket)
+    {
+        return InvalidSocket;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    socklen_t addrLen = sizeof(addr);
+    if (bind(skt, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(skt, 1) != 0 ||
+        getsockname(skt, (sockaddr*)&addr, &addrLen) != 0)
+    {
+        socketClose(skt);
+        return InvalidSocket;
+    }
+
+    port = ntohs(addr.sin_port);
+    return skt;
+}
+
+// Blocking accept, the listener is closed afterwards
+static inline SocketType mockAccept(SocketType listener)
+{
+    SocketType skt = accept(listener, nullptr, nullptr);
+    socketClose(listener);
+    return skt;
+}
+
+static inline bool mockSend(SocketType skt, const std::string& data)
+{
+    return socketSendAll(skt, data.data(), data.size(), 1000);
+}
+
+// Waits up to timeoutMs for data, appends it to rx. False once the peer is gone.
+static inline bool mockRecv(SocketType skt, std::string& rx, int timeoutMs)
+{
+    const int w = socketWait(skt, false, timeoutMs);
+    if (w <= 0)
+    {
+        return w == 0;
+    }
+
+    char buffer[4096];
+    int n = (int)recv(skt, buffer, sizeof(buffer), 0);
+    if (n <= 0)
+    {
+        return false;
+    }
+    rx.append(buffer, (size_t)n);
+    return true;
+}
+
+static inline void mockPause(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+#endif // MOCKSERVER_H
@@ -0,0 +1,458 @@
+/* =============== OpenOCDProcess.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD process supervisor
+
+    Description:
+        Spawning, the output pipe, reaping and the restart loop. The
+        platform specific parts are spawn(), readOutput(), reap() and the
+        signalling in stop().
+*/
+
+#include "OpenOCDProcess.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <spawn.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+    #include <errno.h>
+
+    extern char** environ;
+#endif
+
+OpenOCDProcess::~OpenOCDProcess()
+{
+    this->stop();
+}
+
+// ------------------------------
+// State
+// ------------------------------
+void OpenOCDProcess::setState(State s, const std::string& err)
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->state = s;
+        if (!err.empty()) this->lastError = err;
+    }
+    this->changed.notify_all();
+}
+
+OpenOCDProcess::State OpenOCDProcess::getState() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->state;
+}
+
+int OpenOCDProcess::getGeneration() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->generation;
+}
+
+int OpenOCDProcess::restartCount() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->restarts;
+}
+
+std::string OpenOCDProcess::getLastError() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->lastError;
+}
+
+std::vector<std::string> OpenOCDProcess::recentOutput() const
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    return std::vector<std::string>(this->output.begin(), this->output.end());
+}
+
+// ------------------------------
+// Lifecycle
+// ------------------------------
+bool OpenOCDProcess::start(const OpenOCDLaunch& launch, std::string& err)
+{
+    this->stop();
+
+    this->launch = launch;
+    this->stopping.store(false);
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->output.clear();
+        this->lastError.clear();
+        this->restarts = 0;
+        this->state = State::STARTING;
+    }
+
+    if (!this->spawn(err))
+    {
+        this->setState(State::FAILED, err);
+        return false;
+    }
+
+    this->supervisor = std::thread(&OpenOCDProcess::supervise, this);
+    return true;
+}
+
+bool OpenOCDProcess::waitReady(int timeoutMs, std::string& err)
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+    const bool settled = this->changed.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this]()
+    {
+        return this->state == State::READY || this->state == State::FAILED || this->state == State::STOPPED;
+    });
+
+    if (this->state == State::READY)
+    {
+        return true;
+    }
+
+    err = !settled ? "OpenOCD did not open its port within " + std::to_string(timeoutMs) + " ms"
+                   : (this->lastError.empty() ? std::string("OpenOCD exited") : this->lastError);
+    return false;
+}
+
+void OpenOCDProcess::stop(int graceMs)
+{
+    if (!this->supervisor.joinable())
+    {
+        return;
+    }
+
+    this->stopping.store(true);
+    this->changed.notify_all(); // Cuts a restart delay short
+
+    // Politely first, OpenOCD puts the probe back in a sane state on SIGTERM
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+#ifdef _WIN32
+        if (this->processHandle) TerminateProcess((HANDLE)this->processHandle, 1);
+#else
+        if (this->pid > 0) kill(this->pid, SIGTERM);
+#endif
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(this->lock);
+        const bool exited = this->changed.wait_for(guard, std::chrono::milliseconds(graceMs), [this]()
+        {
+            return this->state == State::STOPPED || this->state == State::FAILED;
+        });
+
+#ifndef _WIN32
+        if (!exited && this->pid > 0)
+        {
+            kill(this->pid, SIGKILL);
+        }
+#else
+        (void)exited;
+#endif
+    }
+
+    this->supervisor.join();
+}
+
+void OpenOCDProcess::supervise()
+{
+    using clock = std::chrono::steady_clock;
+    auto spawnedAt = clock::now();
+
+    while (true)
+    {
+        this->readOutput();
+        const int code = this->reap();
+
+        if (this->stopping.load())
+        {
+            this->setState(State::STOPPED);
+            return;
+        }
+
+        std::string why = "OpenOCD exited (code " + std::to_string(code) + ")";
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (!this->lastError.empty()) why += ": " + this->lastError;
+
+            // A run that lasted a while was not a crash loop
+            if (clock::now() - spawnedAt > std::chrono::seconds(10)) this->restarts = 0;
+        }
+
+        if (!this->launch.autoRestart || this->restartCount() >= this->launch.maxRestarts)
+        {
+            this->setState(State::FAILED, why);
+            return;
+        }
+
+        int attempt;
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            attempt = ++this->restarts;
+        }
+        this->setState(State::RESTARTING);
+
+        // 250 ms, 500 ms, 1 s ... up to 5 s between attempts, stop() wakes us up
+        const auto delay = std::chrono::milliseconds(std::min(250 << std::min(attempt - 1, 5), 5000));
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->changed.wait_for(guard, delay, [this]() { return this->stopping.load(); });
+        }
+        if (this->stopping.load())
+        {
+            this->setState(State::STOPPED);
+            return;
+        }
+
+        std::string err;
+        if (!this->spawn(err))
+        {
+            this->setState(State::FAILED, err);
+            return;
+        }
+        spawnedAt = clock::now();
+    }
+}
+
+void OpenOCDProcess::handleLine(const std::string& line)
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->output.push_back(line);
+        if (this->output.size() > MaxOutputLines) this->output.pop_front();
+
+        if (line.compare(0, 6, "Error:") == 0)
+        {
+            this->lastError = line;
+        }
+
+        // "Info : Listening on port 6666 for tcl connections"
+        const size_t at = line.find("Listening on port ");
+        if (at != std::string::npos && this->state != State::READY)
+        {
+            const int port = atoi(line.c_str() + at + 18);
+            if (this->launch.readyPort == 0 || port == this->launch.readyPort)
+            {
+                this->state = State::READY;
+                this->changed.notify_all();
+            }
+        }
+    }
+
+    if (this->onLine)
+    {
+        this->onLine(line);
+    }
+}
+
+// ------------------------------
+// Platform
+// ------------------------------
+#ifdef _WIN32
+
+static std::string quoteArg(const std::string& arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+    {
+        return arg;
+    }
+
+    std::string q = "\"";
+    for (char c : arg)
+    {
+        if (c == '"') q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+bool OpenOCDProcess::spawn(std::string& err)
+{
+    SECURITY_ATTRIBUTES sa = {sizeof(sa), nullptr, TRUE};
+    HANDLE readEnd = nullptr, writeEnd = nullptr;
+    if (!CreatePipe(&readEnd, &writeEnd, &sa, 0))
+    {
+        err = "CreatePipe failed";
+        return false;
+    }
+    SetHandleInformation(readEnd, HANDLE_FLAG_INHERIT, 0); // Only the write end goes to the child
+
+    std::string cmd = quoteArg(this->launch.executable);
+    for (const auto& a : this->launch.args)
+    {
+        cmd += " " + quoteArg(a);
+    }
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.hStdOutput = writeEnd;
+    si.hStdError = writeEnd;
+
+    PROCESS_INFORMATION pi = {};
+    std::vector<char> cmdLine(cmd.begin(), cmd.end());
+    cmdLine.push_back('\0');
+    const BOOL ok = CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr,
+                                   &si, &pi);
+    CloseHandle(writeEnd);
+    if (!ok)
+    {
+        CloseHandle(readEnd);
+        err = "Can't start " + this->launch.executable + " (error " + std::to_string(GetLastError()) + ")";
+        return false;
+    }
+    CloseHandle(pi.hThread);
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->processHandle = pi.hProcess;
+    this->pipeRead = readEnd;
+    this->generation++;
+    this->state = State::STARTING;
+    return true;
+}
+
+void OpenOCDProcess::readOutput()
+{
+    std::string pending;
+    char buffer[1024];
+    DWORD n = 0;
+    while (ReadFile((HANDLE)this->pipeRead, buffer, sizeof(buffer), &n, nullptr) && n > 0)
+    {
+        pending.append(buffer, n);
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, nl);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            pending.erase(0, nl + 1);
+            this->handleLine(line);
+        }
+    }
+    if (!pending.empty()) this->handleLine(pending);
+
+    CloseHandle((HANDLE)this->pipeRead);
+    this->pipeRead = nullptr;
+}
+
+int OpenOCDProcess::reap()
+{
+    HANDLE h = (HANDLE)this->processHandle;
+    WaitForSingleObject(h, INFINITE);
+    DWORD code = 0;
+    GetExitCodeProcess(h, &code);
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    CloseHandle(h);
+    this->processHandle = nullptr;
+    return (int)code;
+}
+
+#else
+
+bool OpenOCDProcess::spawn(std::string& err)
+{
+    // Both ends close on exec, so an instance started by another object never holds our
+    // pipe open (that would keep us from ever seeing EOF when this process dies)
+    int fds[2];
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0)
+#else
+    if (pipe(fds) != 0 || fcntl(fds[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) != 0)
+#endif
+    {
+        err = std::string("pipe failed: ") + strerror(errno);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 2);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(this->launch.executable.c_str()));
+    for (const auto& a : this->launch.args)
+    {
+        argv.push_back(const_cast<char*>(a.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t child = -1;
+    const int rc = posix_spawnp(&child, this->launch.executable.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    if (rc != 0)
+    {
+        close(fds[0]);
+        err = "Can't start " + this->launch.executable + ": " + strerror(rc);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->pid = child;
+    this->pipeRead = fds[0];
+    this->generation++;
+    this->state = State::STARTING;
+    return true;
+}
+
+void OpenOCDProcess::readOutput()
+{
+    std::string pending;
+    char buffer[1024];
+    while (true)
+    {
+        const ssize_t n = read(this->pipeRead, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break; // EOF: the process is gone (or at least closed its output)
+        }
+
+        pending.append(buffer, (size_t)n);
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, nl);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            pending.erase(0, nl + 1);
+            this->handleLine(line);
+        }
+    }
+    if (!pending.empty()) this->handleLine(pending);
+
+    close(this->pipeRead);
+    this->pipeRead = -1;
+}
+
+int OpenOCDProcess::reap()
+{
+    // Wait without reaping first: until the pid is cleared below, stop() may still signal it,
+    // and it must not be recycled for some other process by then
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    while (waitid(P_PID, (id_t)this->pid, &info, WEXITED | WNOWAIT) != 0 && errno == EINTR)
+    {
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    int status = 0;
+    waitpid(this->pid, &status, 0);
+    this->pid = -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+#endif
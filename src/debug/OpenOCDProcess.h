@@ -0,0 +1,116 @@
+/* =============== OpenOCDProcess.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD process supervisor
+
+    Description:
+        Starts one OpenOCD instance as a child process (posix_spawn, or
+        CreateProcess on Windows) with its stdout/stderr on a pipe. A
+        thread per instance reads that pipe line by line: the instance is
+        ready as soon as OpenOCD prints "Listening on port N", so nobody has
+        to sleep and hope. If the process dies without being asked to, it is
+        started again (with a growing delay, up to a limit).
+
+        Every object owns exactly its own process and only ever signals that
+        pid, so several sessions / probes can each run their own OpenOCD
+        without stepping on each other.
+*/
+
+#ifndef OPENOCDPROCESS_H
+#define OPENOCDPROCESS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct OpenOCDLaunch
+{
+    std::string executable = "openocd"; // Looked up on PATH if it has no directory
+    std::vector<std::string> args;
+    int readyPort = 0; // "Listening on port <readyPort>" means ready, 0 = the first port that opens
+    bool autoRestart = true;
+    int maxRestarts = 5; // In a row, a run that lasted a while resets the count
+};
+
+/**
+  * @brief One supervised OpenOCD process
+
+  start() returns once the process is spawned, waitReady() blocks until it listens (or died).
+  After an automatic restart the instance has to become ready again, generation() goes up by
+  one each time so clients know their connections are stale.
+*/
+class OpenOCDProcess
+{
+    public:
+
+        enum class State {STOPPED, STARTING, READY, RESTARTING, FAILED};
+
+        using LineCallback = std::function<void(const std::string& line)>;
+
+        static constexpr size_t MaxOutputLines = 200;
+
+    private:
+
+        OpenOCDLaunch launch;
+        LineCallback onLine;
+
+        mutable std::mutex lock;
+        std::condition_variable changed;
+        State state = State::STOPPED;
+        std::string lastError;
+        std::deque<std::string> output; // Last MaxOutputLines lines
+        int generation = 0;
+        int restarts = 0;
+
+        // Current child, only touched under lock
+#ifdef _WIN32
+        void* processHandle = nullptr;
+        void* pipeRead = nullptr;
+#else
+        int pid = -1;
+        int pipeRead = -1;
+#endif
+
+        std::atomic<bool> stopping{false};
+        std::thread supervisor;
+
+        bool spawn(std::string& err);
+        void supervise();
+        void readOutput();
+        int reap(); // Waits for the current child, returns its exit code (-1 if killed / unknown)
+        void handleLine(const std::string& line);
+        void setState(State s, const std::string& err = "");
+
+    public:
+
+        OpenOCDProcess() = default;
+        ~OpenOCDProcess();
+
+        OpenOCDProcess(const OpenOCDProcess&) = delete;
+        OpenOCDProcess& operator=(const OpenOCDProcess&) = delete;
+
+        // Called on the supervisor thread for every output line, set before start()
+        void setLineCallback(LineCallback cb) {this->onLine = std::move(cb);}
+
+        bool start(const OpenOCDLaunch& launch, std::string& err);
+
+        // True once ready, false on timeout or if the process gave up (err says why)
+        bool waitReady(int timeoutMs, std::string& err);
+
+        // Terminates the process (politely first, then forcibly after graceMs), no restart
+        void stop(int graceMs = 2000);
+
+        State getState() const;
+        bool isReady() const {return this->getState() == State::READY;}
+        int getGeneration() const;
+        int restartCount() const;
+        std::string getLastError() const;
+        std::vector<std::string> recentOutput() const;
+};
+
+#endif // OPENOCDPROCESS_H
@@ -0,0 +1,328 @@
+/* =============== OpenOCDTcl.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD TCL RPC client
+
+    Description:
+        Batched reads are built as one TCL script and the result list is
+        parsed back here.
+*/
+
+#include "OpenOCDTcl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // strtoul
+
+OpenOCDTcl::~OpenOCDTcl()
+{
+    this->disconnect();
+}
+
+bool OpenOCDTcl::connect(const char* host, int port, int timeoutMs)
+{
+    this->disconnect();
+
+    if (!socketInit())
+    {
+        this->lastError = "Failed to initialize sockets";
+        return false;
+    }
+
+    std::string err;
+    this->skt = socketConnect(host, port, timeoutMs, err);
+    if (this->skt == InvalidSocket)
+    {
+        this->lastError = err;
+        socketCleanup();
+        return false;
+    }
+
+    // No banner on this port, it is ready right away
+    this->rx.clear();
+    return true;
+}
+
+void OpenOCDTcl::disconnect()
+{
+    if (this->skt == InvalidSocket)
+    {
+        return;
+    }
+
+    socketClose(this->skt);
+    socketCleanup();
+    this->skt = InvalidSocket;
+    this->rx.clear();
+}
+
+bool OpenOCDTcl::eval(const std::string& script, std::string& result, int timeoutMs)
+{
+    if (!this->isConnected())
+    {
+        this->lastError = "Not connected";
+        return false;
+    }
+
+    std::string msg = script;
+    msg += Terminator;
+    if (!socketSendAll(this->skt, msg.data(), msg.size(), timeoutMs))
+    {
+        // Part of the script may be out, whatever OpenOCD makes of it would answer the next one
+        this->lastError = "Send failed: " + socketLastError();
+        this->disconnect();
+        return false;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeoutMs);
+    char buffer[4096];
+
+    while (true)
+    {
+        size_t end = this->rx.find(Terminator);
+        if (end != std::string::npos)
+        {
+            result = this->rx.substr(0, end);
+            this->rx.erase(0, end + 1);
+            return true;
+        }
+
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+        if (left <= 0)
+        {
+            // The reply may still come, and would then be taken as the answer to the next command.
+            // Replies carry no id to tell them apart, so drop the connection instead.
+            this->lastError = "Timed out waiting for TCL reply";
+            this->disconnect();
+            return false;
+        }
+
+        int w = socketWait(this->skt, false, left);
+        if (w < 0)
+        {
+            this->lastError = "Socket error: " + socketLastError();
+            this->disconnect();
+            return false;
+        }
+        if (w == 0)
+        {
+            continue;
+        }
+
+        int n = socketRecv(this->skt, buffer, sizeof(buffer));
+        if (n == 0)
+        {
+            this->lastError = "OpenOCD closed the connection";
+            this->disconnect();
+            return false;
+        }
+        if (n == -2)
+        {
+            this->lastError = "Receive failed: " + socketLastError();
+            this->disconnect();
+            return false;
+        }
+        if (n > 0)
+        {
+            this->rx.append(buffer, (size_t)n);
+        }
+    }
+}
+
+// Splits the top level of a TCL list. {a b} groups come back without the braces.
+static std::vector<std::string> splitTclList(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t i = 0;
+
+    while (i < list.size())
+    {
+        while (i < list.size() && (list[i] == ' ' || list[i] == '\t' || list[i] == '\n' || list[i] == '\r'))
+        {
+            i++;
+        }
+        if (i >= list.size()) break;
+
+        if (list[i] == '{')
+        {
+            int depth = 1;
+            size_t start = ++i;
+            while (i < list.size() && depth > 0)
+            {
+                if (list[i] == '{') depth++;
+                else if (list[i] == '}') depth--;
+                i++;
+            }
+            items.push_back(list.substr(start, i - start - 1));
+        }
+        else
+        {
+            size_t start = i;
+            while (i < list.size() && list[i] != ' ' && list[i] != '\t' && list[i] != '\n' && list[i] != '\r')
+            {
+                i++;
+            }
+            items.push_back(list.substr(start, i - start));
+        }
+    }
+
+    return items;
+}
+
+bool OpenOCDTcl::readRanges(const std::vector<TclReadRange>& ranges, std::vector<std::vector<uint32_t>>& out,
+                            int timeoutMs)
+{
+    // foreach over address/count pairs, every read caught on its own
+    std::string script = "set r {}; foreach {a n} {";
+    char pair[40];
+    for (const auto& rg : ranges)
+    {
+        snprintf(pair, sizeof(pair), " 0x%08X %u", rg.addr, rg.words);
+        script += pair;
+    }
+    script += " } { if {[catch {read_memory $a 32 $n} v]} { lappend r {} } else { lappend r $v } }; set r";
+
+    std::string result;
+    if (!this->eval(script, result, timeoutMs))
+    {
+        return false;
+    }
+
+    std::vector<std::string> items = splitTclList(result);
+    if (items.size() != ranges.size())
+    {
+        this->lastError = "Unexpected TCL reply: " + result;
+        return false;
+    }
+
+    out.assign(ranges.size(), std::vector<uint32_t>());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        for (const auto& word : splitTclList(items[i]))
+        {
+            out[i].push_back((uint32_t)strtoul(word.c_str(), nullptr, 0));
+        }
+
+        // Short answer counts as a failed read
+        if (out[i].size() != ranges[i].words)
+        {
+            out[i].clear();
+        }
+    }
+    return true;
+}
+
+bool OpenOCDTcl::readWords(const std::vector<uint32_t>& addrs, std::vector<uint32_t>& values, std::vector<bool>& ok,
+                           int timeoutMs)
+{
+    std::vector<TclReadRange> ranges;
+    ranges.reserve(addrs.size());
+    for (uint32_t a : addrs)
+    {
+        ranges.push_back(TclReadRange{a, 1});
+    }
+
+    std::vector<std::vector<uint32_t>> out;
+    if (!this->readRanges(ranges, out, timeoutMs))
+    {
+        return false;
+    }
+
+    values.assign(addrs.size(), 0);
+    ok.assign(addrs.size(), false);
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        if (!out[i].empty())
+        {
+            values[i] = out[i][0];
+            ok[i] = true;
+        }
+    }
+    return true;
+}
+
+bool OpenOCDTcl::readMemory(uint32_t addr, uint32_t len, uint8_t* out)
+{
+    if (len == 0)
+    {
+        return true;
+    }
+
+    const uint32_t first = addr & ~3u;
+    const uint32_t words = (uint32_t)((((uint64_t)addr + len + 3) & ~(uint64_t)3) - first) / 4;
+
+    // Split so a single read_memory reply stays a sane size
+    const uint32_t maxWords = 4096;
+    std::vector<TclReadRange> ranges;
+    for (uint32_t w = 0; w < words; w += maxWords)
+    {
+        ranges.push_back(TclReadRange{first + w * 4, (words - w < maxWords) ? words - w : maxWords});
+    }
+
+    std::vector<std::vector<uint32_t>> result;
+    if (!this->readRanges(ranges, result))
+    {
+        return false;
+    }
+
+    uint32_t pos = 0; // Byte offset from first
+    for (size_t r = 0; r < result.size(); r++)
+    {
+        if (result[r].empty())
+        {
+            char msg[48];
+            snprintf(msg, sizeof(msg), "read_memory failed at 0x%08X", ranges[r].addr);
+            this->lastError = msg;
+            return false;
+        }
+
+        for (uint32_t word : result[r])
+        {
+            for (int b = 0; b < 4; b++, pos++)
+            {
+                uint32_t at = first + pos;
+                if (at >= addr && at - addr < len)
+                {
+                    out[at - addr] = (uint8_t)(word >> (8 * b));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool OpenOCDTcl::writeMemory(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    // Word writes when we can, the AP does those in one go. Bytes otherwise.
+    const bool words = (addr % 4 == 0) && (len % 4 == 0);
+
+    std::string script = "catch {write_memory " + std::to_string(addr) + (words ? " 32 {" : " 8 {");
+    char item[16];
+    for (uint32_t i = 0; i < len; i += (words ? 4 : 1))
+    {
+        if (words)
+        {
+            uint32_t v = (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) | ((uint32_t)data[i + 2] << 16) |
+                         ((uint32_t)data[i + 3] << 24);
+            snprintf(item, sizeof(item), " 0x%X", v);
+        }
+        else
+        {
+            snprintf(item, sizeof(item), " 0x%X", data[i]);
+        }
+        script += item;
+    }
+    script += " }}";
+
+    std::string result;
+    if (!this->eval(script, result))
+    {
+        return false;
+    }
+    if (result != "0")
+    {
+        this->lastError = "write_memory failed";
+        return false;
+    }
+    return true;
+}
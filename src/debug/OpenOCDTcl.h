@@ -0,0 +1,77 @@
+/* =============== OpenOCDTcl.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD TCL RPC client
+
+    Description:
+        Client for OpenOCD's TCL RPC port (6666). A request is a TCL script
+        ended by 0x1a, the reply is the script result ended by 0x1a. Since a
+        script can do as many reads as we like, a whole batch of reads costs
+        one round trip instead of one per address like on the telnet port.
+*/
+
+#ifndef OPENOCDTCL_H
+#define OPENOCDTCL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Socket.h"
+#include "TargetMemory.h"
+
+// A run of 32 bit words to read in one go
+struct TclReadRange
+{
+    uint32_t addr = 0;
+    uint32_t words = 1;
+};
+
+/**
+  * @brief Persistent TCL RPC connection
+
+  Reads use read_memory (OpenOCD 0.12+). Each address/range in a batch is wrapped in a catch,
+  so one bad address (bus fault, unpowered peripheral) only fails that entry and not the
+  whole batch. Unlike the gdb port this works while the core is running, which is what RTT needs.
+*/
+class OpenOCDTcl : public TargetMemory
+{
+    private:
+
+        SocketType skt = InvalidSocket;
+        std::string rx;
+        std::string lastError;
+
+    public:
+
+        static constexpr char Terminator = 0x1a;
+
+        OpenOCDTcl() = default;
+        ~OpenOCDTcl() override;
+
+        OpenOCDTcl(const OpenOCDTcl&) = delete;
+        OpenOCDTcl& operator=(const OpenOCDTcl&) = delete;
+
+        bool connect(const char* host = "127.0.0.1", int port = 6666, int timeoutMs = 1000);
+        void disconnect();
+        bool isConnected() const {return this->skt != InvalidSocket;}
+
+        // Runs a script and returns its result string. A timeout drops the connection, a late reply
+        // would otherwise be read as the answer to the next script.
+        bool eval(const std::string& script, std::string& result, int timeoutMs = 1000);
+
+        // One 32 bit read per address, all in one round trip. ok[i] is false where the read failed.
+        bool readWords(const std::vector<uint32_t>& addrs, std::vector<uint32_t>& values, std::vector<bool>& ok,
+                       int timeoutMs = 1000);
+
+        // Several word ranges in one round trip, out[i] holds range i (empty if that read failed)
+        bool readRanges(const std::vector<TclReadRange>& ranges, std::vector<std::vector<uint32_t>>& out,
+                        int timeoutMs = 1000);
+
+        // TargetMemory, byte ranges on top of word reads (widened to word alignment)
+        bool readMemory(uint32_t addr, uint32_t len, uint8_t* out) override;
+        bool writeMemory(uint32_t addr, const uint8_t* data, uint32_t len) override;
+
+        const std::string& getLastError() const {return this->lastError;}
+};
+
+#endif // OPENOCDTCL_H
@@ -0,0 +1,214 @@
+/* =============== OpenOCDTelnet.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD telnet connection
+
+    Description:
+        Prompt driven reads. OpenOCD ends every reply with "\r\n> " (or just
+        "> " for the welcome banner), so we wait on the socket until that
+        shows up or the deadline passes.
+*/
+
+#include "OpenOCDTelnet.h"
+
+#include <chrono>
+
+static const unsigned char TelnetIAC = 0xFF;
+
+OpenOCDTelnet::~OpenOCDTelnet()
+{
+    this->disconnect();
+}
+
+bool OpenOCDTelnet::connect(const char* host, int port, int timeoutMs)
+{
+    this->disconnect();
+
+    if (!socketInit())
+    {
+        this->lastError = "Failed to initialize sockets";
+        return false;
+    }
+
+    std::string err;
+    this->skt = socketConnect(host, port, timeoutMs, err);
+    if (this->skt == InvalidSocket)
+    {
+        this->lastError = err;
+        socketCleanup();
+        return false;
+    }
+
+    this->rx.clear();
+    this->iacSkip = 0;
+
+    // Welcome banner, we only care that the prompt came
+    std::string banner;
+    if (!this->readUntilPrompt(banner, timeoutMs))
+    {
+        this->disconnect();
+        return false;
+    }
+    return true;
+}
+
+void OpenOCDTelnet::disconnect()
+{
+    if (this->skt == InvalidSocket)
+    {
+        return;
+    }
+
+    socketClose(this->skt);
+    socketCleanup();
+    this->skt = InvalidSocket;
+}
+
+void OpenOCDTelnet::appendClean(const char* data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)data[i];
+
+        if (this->iacSkip > 0)
+        {
+            // Option negotiation is IAC + verb + option. Verbs below WILL (0xFB) are 2 byte commands.
+            if (this->iacSkip == 2 && c < 0xFB)
+            {
+                this->iacSkip = 0;
+                continue;
+            }
+            this->iacSkip--;
+            continue;
+        }
+
+        if (c == TelnetIAC)
+        {
+            this->iacSkip = 2;
+            continue;
+        }
+
+        // OpenOCD pads some output with NULs, they just get in the way
+        if (c == '\0')
+        {
+            continue;
+        }
+
+        this->rx += (char)c;
+    }
+}
+
+// Prompt = "> " at the very end, right after a line break (or at the start of the buffer)
+static size_t findPrompt(const std::string& text)
+{
+    size_t end = text.size();
+    while (end > 0 && text[end - 1] == ' ')
+    {
+        end--;
+    }
+    if (end == 0 || text[end - 1] != '>')
+    {
+        return std::string::npos;
+    }
+
+    size_t p = end - 1;
+    if (p == 0 || text[p - 1] == '\n' || text[p - 1] == '\r')
+    {
+        return p;
+    }
+    return std::string::npos;
+}
+
+bool OpenOCDTelnet::readUntilPrompt(std::string& out, int timeoutMs)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    char buffer[1024];
+
+    while (true)
+    {
+        size_t p = findPrompt(this->rx);
+        if (p != std::string::npos)
+        {
+            out = this->rx.substr(0, p);
+            this->rx.clear();
+            return true;
+        }
+
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+        if (left <= 0)
+        {
+            this->lastError = "Timed out waiting for OpenOCD prompt";
+            return false;
+        }
+
+        int w = socketWait(this->skt, false, left);
+        if (w < 0)
+        {
+            this->lastError = "Socket error: " + socketLastError();
+            return false;
+        }
+        if (w == 0)
+        {
+            continue;
+        }
+
+        // Drain everything that is there right now before checking for the prompt again
+        while (true)
+        {
+            int n = socketRecv(this->skt, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                this->appendClean(buffer, n);
+                continue;
+            }
+            if (n == 0)
+            {
+                this->lastError = "OpenOCD closed the connection";
+                this->disconnect();
+                return false;
+            }
+            if (n == -2)
+            {
+                this->lastError = "Receive failed: " + socketLastError();
+                return false;
+            }
+            break;
+        }
+    }
+}
+
+bool OpenOCDTelnet::command(const std::string& cmd, std::string& response, int timeoutMs)
+{
+    if (!this->isConnected())
+    {
+        this->lastError = "Not connected";
+        return false;
+    }
+
+    std::string line = cmd + "\r\n";
+    if (!socketSendAll(this->skt, line.data(), line.size(), timeoutMs))
+    {
+        this->lastError = "Send failed: " + socketLastError();
+        return false;
+    }
+
+    std::string raw;
+    if (!this->readUntilPrompt(raw, timeoutMs))
+    {
+        return false;
+    }
+
+    // OpenOCD echoes the command line back first, drop it
+    size_t echo = raw.find(cmd);
+    if (echo != std::string::npos)
+    {
+        raw.erase(0, echo + cmd.size());
+    }
+
+    // Trim the line breaks around the output
+    size_t first = raw.find_first_not_of("\r\n");
+    size_t last = raw.find_last_not_of("\r\n ");
+    response = (first == std::string::npos) ? std::string() : raw.substr(first, last - first + 1);
+    return true;
+}
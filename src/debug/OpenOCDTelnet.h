@@ -0,0 +1,56 @@
+/* =============== OpenOCDTelnet.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCD telnet connection
+
+    Description:
+        Keeps one connection to OpenOCD's telnet port (4444) open and runs
+        commands on it. Replies are read with poll() against a deadline and
+        returned the moment the "> " prompt shows up, no fixed sleeps.
+*/
+
+#ifndef OPENOCDTELNET_H
+#define OPENOCDTELNET_H
+
+#include <string>
+
+#include "Socket.h"
+
+/**
+  * @brief Persistent, prompt driven telnet session with OpenOCD
+
+  Telnet option negotiation (IAC sequences), NUL padding and the echoed command line are
+  stripped, so command() hands back just what OpenOCD printed for the command.
+*/
+class OpenOCDTelnet
+{
+    private:
+
+        SocketType skt = InvalidSocket;
+        std::string rx; // Cleaned up text not consumed yet
+        std::string lastError;
+
+        int iacSkip = 0; // Bytes of a telnet IAC sequence still to drop (can span reads)
+
+        bool readUntilPrompt(std::string& out, int timeoutMs);
+        void appendClean(const char* data, int len);
+
+    public:
+
+        OpenOCDTelnet() = default;
+        ~OpenOCDTelnet();
+
+        OpenOCDTelnet(const OpenOCDTelnet&) = delete;
+        OpenOCDTelnet& operator=(const OpenOCDTelnet&) = delete;
+
+        // Connects and eats the welcome banner (returns once the first prompt arrives)
+        bool connect(const char* host = "127.0.0.1", int port = 4444, int timeoutMs = 1000);
+        void disconnect();
+        bool isConnected() const {return this->skt != InvalidSocket;}
+
+        // Runs one command, response is the output without the echo and the prompt
+        bool command(const std::string& cmd, std::string& response, int timeoutMs = 1000);
+
+        const std::string& getLastError() const {return this->lastError;}
+};
+
+#endif // OPENOCDTELNET_H
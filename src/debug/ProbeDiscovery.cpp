@@ -0,0 +1,256 @@
+/* =============== ProbeDiscovery.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Multi probe discovery
+
+    Description:
+        USB enumeration, port planning and the worker pool that probes the
+        endpoints side by side.
+*/
+
+#include "ProbeDiscovery.h"
+#include "DetectionCache.h"
+#include "OpenOCDTcl.h"
+#include "Socket.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifdef __linux__
+    #include <filesystem>
+    #include <fstream>
+#endif
+
+ProbeEndpoint ProbeEndpoint::forInstance(size_t i, const std::string& serial)
+{
+    ProbeEndpoint ep;
+    ep.gdbPort += (int)i;
+    ep.telnetPort += (int)i;
+    ep.tclPort += (int)i;
+    ep.serial = serial;
+    return ep;
+}
+
+// ------------------------------
+// USB
+// ------------------------------
+#ifdef __linux__
+static std::string readSysfs(const std::filesystem::path& path)
+{
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r' || line.back() == ' '))
+    {
+        line.pop_back();
+    }
+    return line;
+}
+#endif
+
+std::vector<std::string> listStLinkSerials()
+{
+    std::vector<std::string> serials;
+
+#ifdef __linux__
+    // ST-LINK/V2, V2-1 (all flavours), V3 (all flavours)
+    static const char* const productIds[] = {"3748", "374a", "374b", "374d", "374e", "374f", "3752", "3753", "3754", "3757"};
+
+    std::error_code ec;
+    for (const auto& dev : std::filesystem::directory_iterator("/sys/bus/usb/devices", ec))
+    {
+        if (readSysfs(dev.path() / "idVendor") != "0483")
+        {
+            continue;
+        }
+
+        const std::string pid = readSysfs(dev.path() / "idProduct");
+        if (std::find_if(std::begin(productIds), std::end(productIds),
+                         [&pid](const char* p) { return pid == p; }) == std::end(productIds))
+        {
+            continue;
+        }
+
+        // Old V2 firmware reports the serial as raw bytes, OpenOCD wants those as hex
+        std::string serial = readSysfs(dev.path() / "serial");
+        bool printable = !serial.empty();
+        for (char c : serial)
+        {
+            if ((unsigned char)c < 0x20 || (unsigned char)c > 0x7e) printable = false;
+        }
+        if (!printable && !serial.empty())
+        {
+            std::string hex;
+            char byte[3];
+            for (char c : serial)
+            {
+                snprintf(byte, sizeof(byte), "%02X", (unsigned char)c);
+                hex += byte;
+            }
+            serial = hex;
+        }
+
+        if (!serial.empty())
+        {
+            serials.push_back(serial);
+        }
+    }
+
+    // Same order every run, so a probe keeps its ports
+    std::sort(serials.begin(), serials.end());
+#endif
+
+    return serials;
+}
+
+std::vector<ProbeEndpoint> planEndpoints(const std::vector<std::string>& serials)
+{
+    std::vector<ProbeEndpoint> endpoints;
+    endpoints.reserve(serials.size());
+    for (size_t i = 0; i < serials.size(); i++)
+    {
+        endpoints.push_back(ProbeEndpoint::forInstance(i, serials[i]));
+    }
+    return endpoints;
+}
+
+std::vector<std::string> openocdProbeArgs(const ProbeEndpoint& endpoint, const std::string& scriptsDir,
+                                          const std::string& targetCfg)
+{
+    std::vector<std::string> args;
+    if (!scriptsDir.empty())
+    {
+        args.push_back("-s");
+        args.push_back(scriptsDir);
+    }
+
+    args.push_back("-f");
+    args.push_back("interface/stlink.cfg");
+    if (!endpoint.serial.empty())
+    {
+        args.push_back("-c");
+        args.push_back("adapter serial " + endpoint.serial);
+    }
+
+    args.push_back("-c");
+    args.push_back("gdb_port " + std::to_string(endpoint.gdbPort));
+    args.push_back("-c");
+    args.push_back("telnet_port " + std::to_string(endpoint.telnetPort));
+    args.push_back("-c");
+    args.push_back("tcl_port " + std::to_string(endpoint.tclPort));
+
+    args.push_back("-f");
+    args.push_back("target/" + targetCfg);
+    return args;
+}
+
+// ------------------------------
+// Probing
+// ------------------------------
+
+// An instance that was just started takes a moment before it listens
+static bool connectWhenReady(OpenOCDTcl& tcl, const ProbeEndpoint& endpoint, const DiscoveryOptions& options)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(options.readyTimeoutMs);
+
+    while (true)
+    {
+        if (tcl.connect(endpoint.host.c_str(), endpoint.tclPort, options.timeoutMs))
+        {
+            return true;
+        }
+        if (clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+DetectedProbe probeEndpoint(const ProbeEndpoint& endpoint, const DiscoveryOptions& options)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    DetectedProbe probe;
+    probe.endpoint = endpoint;
+    probe.serial = endpoint.serial;
+
+    std::string err;
+    if (options.launcher && !options.launcher(endpoint, err))
+    {
+        probe.result.errMsg = "OpenOCD launch failed: " + err;
+    }
+    else
+    {
+        OpenOCDTcl tcl;
+        if (connectWhenReady(tcl, endpoint, options))
+        {
+            // Empty when the instance was not started with a serial, that is fine
+            std::string serial;
+            if (tcl.eval("if {[catch {adapter serial} s]} {set s {}} else {set s}", serial, options.timeoutMs) &&
+                !serial.empty())
+            {
+                probe.serial = serial;
+            }
+
+            probe.result = options.cache ? options.cache->detect(tcl, probe.serial, options.timeoutMs)
+                                         : DetectedSTM32Tcl(tcl);
+        }
+        else
+        {
+            // Older OpenOCD, or the TCL port is off: the telnet port still gets the IDCODE
+            probe.result = DetectedSTM32(endpoint.telnetPort, endpoint.host.c_str());
+            if (!probe.result.success)
+            {
+                probe.result.errMsg = "TCL port " + std::to_string(endpoint.tclPort) + ": " + tcl.getLastError() +
+                                      "; " + probe.result.errMsg;
+            }
+        }
+    }
+
+    probe.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return probe;
+}
+
+std::vector<DetectedProbe> discoverProbes(const std::vector<ProbeEndpoint>& endpoints, const DiscoveryOptions& options)
+{
+    std::vector<DetectedProbe> probes(endpoints.size());
+    if (endpoints.empty())
+    {
+        return probes;
+    }
+
+    // Held for the whole run, so the workers never race on the first WSAStartup
+    socketInit();
+
+    // Each worker takes the next endpoint nobody has yet. Probes spend nearly all their time
+    // waiting on sockets, so a thread each (up to maxThreads) is the simple way to overlap them.
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = next.fetch_add(1)) < endpoints.size())
+        {
+            probes[i] = probeEndpoint(endpoints[i], options);
+        }
+    };
+
+    const size_t threads = std::max<size_t>(1, std::min(options.maxThreads, endpoints.size()));
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker(); // This thread works too
+    for (auto& th : pool)
+    {
+        th.join();
+    }
+
+    socketCleanup();
+    return probes;
+}
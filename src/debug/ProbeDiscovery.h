@@ -0,0 +1,81 @@
+/* =============== ProbeDiscovery.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Multi probe discovery
+
+    Description:
+        Finds out what is on the end of every ST-LINK when there are many of
+        them on one host. Each probe gets its own OpenOCD instance on its own
+        set of ports (gdb 3333 + i, telnet 4444 + i, tcl 6666 + i), and all
+        instances are probed at the same time from a small pool of threads,
+        so the whole discovery takes as long as the slowest probe instead of
+        the sum of all of them.
+
+        Starting the OpenOCD instances is up to the caller (DiscoveryOptions
+        launcher), discovery just attaches, retrying until an instance that
+        is still starting up accepts the connection.
+*/
+
+#ifndef PROBEDISCOVERY_H
+#define PROBEDISCOVERY_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "STM32Detector.h"
+
+class DetectionCache;
+
+// Where one OpenOCD instance listens, and which probe it should drive
+struct ProbeEndpoint
+{
+    std::string host = "127.0.0.1";
+    int gdbPort = 3333;
+    int telnetPort = 4444;
+    int tclPort = 6666;
+    std::string serial; // Empty = whatever probe OpenOCD picks
+
+    // Ports for instance i, the default ports shifted by i
+    static ProbeEndpoint forInstance(size_t i, const std::string& serial = "");
+};
+
+// Outcome for one endpoint, in the order the endpoints were given
+struct DetectedProbe
+{
+    ProbeEndpoint endpoint;
+    DetectionResult result; // devID, configFileName, or errMsg
+    std::string serial; // What OpenOCD reports, the endpoint's serial if it reports nothing
+    double elapsedMs = 0.0;
+};
+
+// Starts (or makes sure there is) an OpenOCD for the endpoint, false + err if it could not
+using ProbeLauncher = std::function<bool(const ProbeEndpoint& endpoint, std::string& err)>;
+
+struct DiscoveryOptions
+{
+    size_t maxThreads = 16;
+    int timeoutMs = 1000; // Per connect attempt and per request
+    int readyTimeoutMs = 0; // How long to keep retrying the connect (0 = one attempt), for instances just started
+    ProbeLauncher launcher; // Called for each endpoint before probing it, on the worker thread
+    DetectionCache* cache = nullptr; // Known probes are confirmed with one read instead of probed (caller saves it)
+};
+
+// Serial numbers of the ST-LINKs on USB (Linux sysfs, empty elsewhere)
+std::vector<std::string> listStLinkSerials();
+
+// One endpoint per serial, instance ports in order
+std::vector<ProbeEndpoint> planEndpoints(const std::vector<std::string>& serials);
+
+// OpenOCD command line (without the executable) for an endpoint: interface, serial, ports, target
+std::vector<std::string> openocdProbeArgs(const ProbeEndpoint& endpoint, const std::string& scriptsDir,
+                                          const std::string& targetCfg);
+
+// Probes one endpoint: TCL port first, telnet if TCL does not answer
+DetectedProbe probeEndpoint(const ProbeEndpoint& endpoint, const DiscoveryOptions& options = DiscoveryOptions());
+
+// Probes all endpoints concurrently
+std::vector<DetectedProbe> discoverProbes(const std::vector<ProbeEndpoint>& endpoints,
+                                          const DiscoveryOptions& options = DiscoveryOptions());
+
+#endif // PROBEDISCOVERY_H
@@ -0,0 +1,234 @@
+/* =============== RttReader.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: SEGGER RTT
+
+    Description:
+        Control block search, ring buffer drain and record decoding.
+*/
+
+#include "RttReader.h"
+
+#include <cstring>
+
+static uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool RttReader::fail(const std::string& msg)
+{
+    this->lastError = msg;
+    return false;
+}
+
+bool RttReader::findControlBlock(TargetMemory& mem, uint32_t start, uint32_t size, uint32_t& cbAddr, uint32_t chunkSize)
+{
+    const uint32_t idLen = (uint32_t)strlen(ControlBlockId);
+    if (chunkSize <= idLen) chunkSize = 4096;
+
+    std::vector<uint8_t> chunk(chunkSize);
+    const uint64_t end = (uint64_t)start + size;
+
+    // Chunks overlap by the id length so an id sitting across a boundary is still found.
+    // The control block is word aligned, so only every 4th offset is checked.
+    for (uint64_t addr = start; addr + idLen <= end; addr += chunkSize - idLen)
+    {
+        uint32_t n = (uint32_t)((end - addr < chunkSize) ? end - addr : chunkSize);
+        if (!mem.readMemory((uint32_t)addr, n, chunk.data()))
+        {
+            continue; // Hole in the map, keep going
+        }
+
+        for (uint32_t i = (uint32_t)((4 - (addr & 3)) & 3); i + idLen <= n; i += 4)
+        {
+            if (memcmp(chunk.data() + i, ControlBlockId, idLen) == 0 && (i + idLen == n || chunk[i + idLen] == 0))
+            {
+                cbAddr = (uint32_t)addr + i;
+                return true;
+            }
+        }
+
+        if (n < chunkSize)
+        {
+            break;
+        }
+    }
+    return false;
+}
+
+bool RttReader::attach(TargetMemory& mem, uint32_t cbAddr)
+{
+    this->detach();
+
+    uint8_t header[HeaderSize];
+    if (!mem.readMemory(cbAddr, HeaderSize, header))
+    {
+        return this->fail("Can't read the RTT control block");
+    }
+
+    if (memcmp(header, ControlBlockId, strlen(ControlBlockId)) != 0)
+    {
+        return this->fail("No RTT control block at this address (firmware not initialized yet?)");
+    }
+
+    uint32_t up = get32(header + 16);
+    if (up == 0 || up > 32)
+    {
+        return this->fail("RTT control block has " + std::to_string(up) + " up buffers, looks corrupt");
+    }
+
+    this->mem = &mem;
+    this->cbAddr = cbAddr;
+    this->upCount = up;
+    return true;
+}
+
+void RttReader::detach()
+{
+    this->mem = nullptr;
+    this->cbAddr = 0;
+    this->upCount = 0;
+    this->totalBytes = 0;
+}
+
+bool RttReader::drain(unsigned channel, std::vector<uint8_t>& out)
+{
+    if (!this->mem)
+    {
+        return this->fail("Not attached");
+    }
+    if (channel >= this->upCount)
+    {
+        return this->fail("No up buffer " + std::to_string(channel));
+    }
+
+    // Whole descriptor every time, the firmware may (re)configure the buffer while we run
+    const uint32_t descAddr = this->cbAddr + HeaderSize + channel * DescriptorSize;
+    uint8_t desc[DescriptorSize];
+    if (!this->mem->readMemory(descAddr, DescriptorSize, desc))
+    {
+        return this->fail("RTT descriptor read failed");
+    }
+
+    const uint32_t buffer = get32(desc + 4);
+    const uint32_t size = get32(desc + 8);
+    const uint32_t wr = get32(desc + 12);
+    const uint32_t rd = get32(desc + 16);
+
+    if (size == 0 || buffer == 0)
+    {
+        return true; // Not configured yet
+    }
+    if (wr >= size || rd >= size)
+    {
+        return this->fail("RTT offsets out of range (WrOff " + std::to_string(wr) + ", RdOff " + std::to_string(rd) + ")");
+    }
+    if (wr == rd)
+    {
+        return true;
+    }
+
+    // Up to the write offset, or up to the end of the ring and then from the start
+    const size_t before = out.size();
+    const uint32_t firstLen = (wr > rd) ? wr - rd : size - rd;
+    const uint32_t secondLen = (wr > rd) ? 0 : wr;
+    out.resize(before + firstLen + secondLen);
+
+    if (!this->mem->readMemory(buffer + rd, firstLen, out.data() + before) ||
+        (secondLen && !this->mem->readMemory(buffer, secondLen, out.data() + before + firstLen)))
+    {
+        out.resize(before);
+        return this->fail("RTT buffer read failed");
+    }
+
+    // Hand the space back to the firmware
+    uint8_t newRd[4] = {(uint8_t)wr, (uint8_t)(wr >> 8), (uint8_t)(wr >> 16), (uint8_t)(wr >> 24)};
+    if (!this->mem->writeMemory(descAddr + 16, newRd, 4))
+    {
+        return this->fail("RTT RdOff write failed");
+    }
+
+    this->totalBytes += firstLen + secondLen;
+    return true;
+}
+
+// ------------------------------
+// Record decoding
+// ------------------------------
+void RttRecordDecoder::reset(size_t channels, double timeOffset)
+{
+    this->channels = channels;
+    this->partial.clear();
+    this->lastStamp = 0;
+    this->epochUs = 0;
+    this->first = true;
+    this->timeOffset = timeOffset;
+}
+
+size_t RttRecordDecoder::feed(const uint8_t* data, size_t len, std::vector<double>& rows)
+{
+    const size_t recSize = this->recordSize();
+    size_t records = 0;
+
+    auto decode = [&](const uint8_t* rec)
+    {
+        uint32_t stamp = get32(rec);
+
+        if (this->first)
+        {
+            // First record is t = timeOffset, whatever the target clock said
+            this->epochUs = 0 - (uint64_t)stamp;
+            this->first = false;
+        }
+        else if (stamp < this->lastStamp)
+        {
+            this->epochUs += (uint64_t)1 << 32;
+        }
+        this->lastStamp = stamp;
+
+        rows.push_back(this->timeOffset + (double)(this->epochUs + stamp) * 1e-6);
+        for (size_t c = 0; c < this->channels; c++)
+        {
+            float v;
+            memcpy(&v, rec + 4 + 4 * c, 4);
+            rows.push_back(v);
+        }
+        records++;
+    };
+
+    // Finish the record left over from last time first
+    if (!this->partial.empty())
+    {
+        size_t take = recSize - this->partial.size();
+        if (take > len) take = len;
+        this->partial.insert(this->partial.end(), data, data + take);
+        data += take;
+        len -= take;
+
+        if (this->partial.size() < recSize)
+        {
+            return 0;
+        }
+        decode(this->partial.data());
+        this->partial.clear();
+    }
+
+    while (len >= recSize)
+    {
+        decode(data);
+        data += recSize;
+        len -= recSize;
+    }
+
+    this->partial.assign(data, data + len);
+    return records;
+}
+
+void RttRecordDecoder::encode(uint32_t stampUs, const float* values, size_t channels, uint8_t* out)
+{
+    out[0] = (uint8_t)stampUs;
+    out[1] = (uint8_t)(stampUs >> 8);
+    out[2] = (uint8_t)(stampUs >> 16);
+    out[3] = (uint8_t)(stampUs >> 24);
+    memcpy(out + 4, values, 4 * channels);
+}
@@ -0,0 +1,107 @@
+/* =============== RttReader.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: SEGGER RTT
+
+    Description:
+        Host side of SEGGER RTT. The firmware writes into ring buffers in its
+        own RAM and we drain them with plain memory reads while the core keeps
+        running, so there is no halting and no per variable polling.
+
+        Control block (_SEGGER_RTT), 32 bit target:
+            +0   char acID[16]          "SEGGER RTT"
+            +16  int  MaxNumUpBuffers
+            +20  int  MaxNumDownBuffers
+            +24  up buffer descriptors, then down buffer descriptors
+        Descriptor (24 bytes):
+            +0 sName  +4 pBuffer  +8 SizeOfBuffer  +12 WrOff  +16 RdOff  +20 Flags
+*/
+
+#ifndef RTTREADER_H
+#define RTTREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TargetMemory.h"
+
+/**
+  * @brief Finds the control block and drains up buffers
+
+  A drain is one descriptor read, one or two data reads (two when the ring wrapped) and one
+  RdOff write, no matter how much data piled up since the last one.
+*/
+class RttReader
+{
+    private:
+
+        TargetMemory* mem = nullptr;
+        uint32_t cbAddr = 0;
+        uint32_t upCount = 0;
+        uint64_t totalBytes = 0;
+        std::string lastError;
+
+        bool fail(const std::string& msg);
+
+    public:
+
+        static constexpr const char* ControlBlockId = "SEGGER RTT";
+        static constexpr uint32_t HeaderSize = 24;
+        static constexpr uint32_t DescriptorSize = 24;
+
+        RttReader() = default;
+
+        // Scans [start, start + size) for the control block id. Reads in chunks, one round trip each.
+        static bool findControlBlock(TargetMemory& mem, uint32_t start, uint32_t size, uint32_t& cbAddr,
+                                     uint32_t chunkSize = 4096);
+
+        // Checks the id and the buffer count at cbAddr. mem has to outlive the reader.
+        bool attach(TargetMemory& mem, uint32_t cbAddr);
+        void detach();
+        bool isAttached() const {return this->mem != nullptr;}
+
+        uint32_t getAddress() const {return this->cbAddr;}
+        uint32_t upBufferCount() const {return this->upCount;}
+        uint64_t bytesRead() const {return this->totalBytes;}
+
+        // Appends everything pending in up buffer `channel` to out and frees it on the target
+        bool drain(unsigned channel, std::vector<uint8_t>& out);
+
+        const std::string& getLastError() const {return this->lastError;}
+};
+
+/**
+  * @brief Turns the RTT byte stream into plot rows
+
+  Record layout (little endian, no padding): uint32 timestamp in microseconds from the target's
+  clock, then one float32 per channel. The timestamp is unwrapped, so the 71 minute roll over of a
+  32 bit microsecond counter does not send the plot back in time. Records can be split across
+  drains, the tail is kept until the rest shows up.
+*/
+class RttRecordDecoder
+{
+    private:
+
+        size_t channels = 0;
+        std::vector<uint8_t> partial;
+        uint32_t lastStamp = 0;
+        uint64_t epochUs = 0; // Added to every stamp, grows by 2^32 at each wrap
+        bool first = true;
+        double timeOffset = 0.0;
+
+    public:
+
+        // timeOffset is added to every decoded time stamp (where the plot should continue from)
+        void reset(size_t channels, double timeOffset = 0.0);
+
+        size_t recordSize() const {return 4 + 4 * this->channels;}
+
+        // Appends [t, ch0, ch1, ...] rows, returns how many complete records there were
+        size_t feed(const uint8_t* data, size_t len, std::vector<double>& rows);
+
+        // Firmware side, for the simulated target
+        static void encode(uint32_t stampUs, const float* values, size_t channels, uint8_t* out);
+};
+
+#endif // RTTREADER_H
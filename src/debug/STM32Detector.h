@@ -3,6 +3,15 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+
+// One flash bank as OpenOCD's target config sets it up
+struct FlashBank
+{
+    std::string driver; // "stm32f2x", "stm32l4x", ...
+    uint32_t base = 0;
+    uint32_t size = 0; // Bytes, 0 if the bank could not be probed
+};
 
 struct DetectionResult
 {
@@ -10,9 +19,26 @@ struct DetectionResult
     uint16_t devID = 0;
     std::string configFileName;
     std::string errMsg;
+
+    uint32_t idcode = 0; // Whole DBGMCU IDCODE (rev ID in the top half)
+    uint32_t idcodeAddr = 0; // Where it was found
+    uint16_t flashSizeKb = 0; // Flash size register, only filled in by DetectionCache::detect() (0 = unknown)
+    std::vector<FlashBank> flashBanks; // Only filled in by DetectionCache::detect()
+    bool fromCache = false; // Confirmed against a DetectionCache entry instead of probed
 };
 
+class OpenOCDTcl;
+
 const char* getSTM32Config(uint16_t d_ID);
-DetectionResult DetectedSTM32(int telnetPort = 4444);
+DetectionResult DetectedSTM32(int telnetPort = 4444, const char* host = "127.0.0.1");
+
+// Same thing over the TCL RPC port, all IDCODE addresses are read in one round trip
+DetectionResult DetectedSTM32Tcl(int tclPort = 6666, const char* host = "127.0.0.1");
+
+// On a TCL connection that is already open (discovery asks it for more than the IDCODE)
+DetectionResult DetectedSTM32Tcl(OpenOCDTcl& tcl);
+
+// The flash banks of the running OpenOCD target, probed so the sizes are real
+bool readFlashBanks(OpenOCDTcl& tcl, std::vector<FlashBank>& banks, std::string& err);
 
 #endif
\ No newline at end of file
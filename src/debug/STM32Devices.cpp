@@ -0,0 +1,24 @@
+/* =============== STM32Devices.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: STM32 device database
+
+    Description:
+        The table itself is constexpr and lives in the header, this is only
+        for what is not worth inlining.
+*/
+
+#include "STM32Devices.h"
+
+const char* cortexCoreName(CortexCore core)
+{
+    switch (core)
+    {
+        case CortexCore::M0: return "Cortex-M0";
+        case CortexCore::M0PLUS: return "Cortex-M0+";
+        case CortexCore::M3: return "Cortex-M3";
+        case CortexCore::M4: return "Cortex-M4";
+        case CortexCore::M7: return "Cortex-M7";
+        case CortexCore::M33: return "Cortex-M33";
+    }
+    return "?";
+}
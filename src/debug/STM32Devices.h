@@ -0,0 +1,130 @@
+/* =============== STM32Devices.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: STM32 device database
+
+    Description:
+        Everything we know per DBGMCU dev ID (name, OpenOCD config, core,
+        flash size register, erase unit, RAM ranges), expanded at compile
+        time from STM32Devices.def. Lookup goes through a dense 4096 entry
+        table indexed by the 12 bit dev ID, built by the compiler too, so a
+        lookup is two array reads and nothing is set up at startup.
+*/
+
+#ifndef STM32DEVICES_H
+#define STM32DEVICES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class CortexCore : uint8_t {M0, M0PLUS, M3, M4, M7, M33};
+
+const char* cortexCoreName(CortexCore core); // "Cortex-M4", ...
+
+struct MemoryRange
+{
+    uint32_t base = 0;
+    uint32_t size = 0;
+};
+
+struct STM32Device
+{
+    uint16_t devID = 0;
+    const char* name = "";
+    const char* configFileName = "";
+    CortexCore core = CortexCore::M4;
+    uint32_t flashBase = 0x08000000;
+    uint32_t flashSizeReg = 0; // 16 bit register holding the flash size in KB
+    uint32_t pageSize = 0; // Bytes, smallest sector on sectored parts
+    bool sectored = false;
+    MemoryRange ram[3] = {}; // Main SRAM first, size 0 = unused
+
+    constexpr size_t ramCount() const
+    {
+        size_t n = 0;
+        while (n < 3 && this->ram[n].size != 0) n++;
+        return n;
+    }
+};
+
+namespace stm32_devices_detail
+{
+    constexpr uint32_t KB = 1024;
+
+    constexpr STM32Device make(uint16_t devID, const char* name, const char* config, CortexCore core,
+                               uint32_t flashSizeReg, uint32_t pageSize, bool sectored,
+                               MemoryRange ram0, MemoryRange ram1, MemoryRange ram2)
+    {
+        STM32Device d;
+        d.devID = devID;
+        d.name = name;
+        d.configFileName = config;
+        d.core = core;
+        d.flashSizeReg = flashSizeReg;
+        d.pageSize = pageSize;
+        d.sectored = sectored;
+        d.ram[0] = ram0;
+        d.ram[1] = ram1;
+        d.ram[2] = ram2;
+        return d;
+    }
+}
+
+inline constexpr STM32Device STM32_DEVICES[] =
+{
+    #define RAM(base, size) MemoryRange{(base), (size)}
+    #define NO_RAM MemoryRange{}
+    #define STM32_DEVICE(id, name, config, core, flashSizeReg, pageSize, sectored, ram0, ram1, ram2) \
+        stm32_devices_detail::make((id), (name), (config), CortexCore::core, (flashSizeReg), (pageSize), (sectored), ram0, ram1, ram2),
+    #define KB stm32_devices_detail::KB
+    #include "STM32Devices.def"
+    #undef KB
+    #undef STM32_DEVICE
+    #undef NO_RAM
+    #undef RAM
+};
+
+constexpr size_t STM32_DEVICE_COUNT = sizeof(STM32_DEVICES) / sizeof(STM32_DEVICES[0]);
+
+namespace stm32_devices_detail
+{
+    constexpr uint8_t NoDevice = 0xFF;
+    static_assert(STM32_DEVICE_COUNT < NoDevice, "Dev ID index is 8 bit");
+
+    // Dev ID (12 bits) -> position in STM32_DEVICES
+    constexpr std::array<uint8_t, 4096> buildIndex()
+    {
+        std::array<uint8_t, 4096> index = {};
+        for (auto& slot : index) slot = NoDevice;
+        for (size_t i = 0; i < STM32_DEVICE_COUNT; i++)
+        {
+            index[STM32_DEVICES[i].devID & 0xFFF] = (uint8_t)i;
+        }
+        return index;
+    }
+
+    constexpr bool uniqueIds()
+    {
+        for (size_t i = 0; i < STM32_DEVICE_COUNT; i++)
+        {
+            if (STM32_DEVICES[i].devID > 0xFFF) return false;
+            for (size_t j = i + 1; j < STM32_DEVICE_COUNT; j++)
+            {
+                if (STM32_DEVICES[i].devID == STM32_DEVICES[j].devID) return false;
+            }
+        }
+        return true;
+    }
+    static_assert(uniqueIds(), "STM32Devices.def: every dev ID once, 12 bits");
+
+    inline constexpr std::array<uint8_t, 4096> Index = buildIndex();
+}
+
+// nullptr for dev IDs we don't know
+constexpr const STM32Device* findSTM32Device(uint16_t devID)
+{
+    const uint8_t i = stm32_devices_detail::Index[devID & 0xFFF];
+    return (i == stm32_devices_detail::NoDevice) ? nullptr : &STM32_DEVICES[i];
+}
+
+#endif // STM32DEVICES_H
@@ -0,0 +1,138 @@
+/* =============== SimulatedTarget.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Simulated target memory
+
+    Description:
+        Region lookup and the RTT control block layout (see RttReader.h for
+        the field offsets).
+*/
+
+#include "SimulatedTarget.h"
+#include "RttReader.h"
+
+#include <cstring>
+
+void SimulatedTarget::addRegion(uint32_t base, uint32_t size)
+{
+    Region r;
+    r.base = base;
+    r.bytes.assign(size, 0);
+    this->regions.push_back(std::move(r));
+}
+
+uint8_t* SimulatedTarget::locate(uint32_t addr, uint32_t len)
+{
+    for (auto& r : this->regions)
+    {
+        if (addr >= r.base && (uint64_t)addr - r.base + len <= r.bytes.size())
+        {
+            return r.bytes.data() + (addr - r.base);
+        }
+    }
+    return nullptr;
+}
+
+bool SimulatedTarget::readMemory(uint32_t addr, uint32_t len, uint8_t* out)
+{
+    uint8_t* p = this->locate(addr, len);
+    if (!p)
+    {
+        return false;
+    }
+    memcpy(out, p, len);
+    return true;
+}
+
+bool SimulatedTarget::writeMemory(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+    uint8_t* p = this->locate(addr, len);
+    if (!p)
+    {
+        return false;
+    }
+    memcpy(p, data, len);
+    return true;
+}
+
+uint32_t SimulatedTarget::load32(uint32_t addr)
+{
+    uint8_t b[4] = {0, 0, 0, 0};
+    this->readMemory(addr, 4, b);
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+void SimulatedTarget::store32(uint32_t addr, uint32_t value)
+{
+    uint8_t b[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    this->writeMemory(addr, b, 4);
+}
+
+bool SimulatedTarget::setupRtt(uint32_t cbAddr, const std::vector<uint32_t>& upSizes)
+{
+    const uint32_t upCount = (uint32_t)upSizes.size();
+    const uint32_t downCount = 1; // Real firmware always has at least one, the reader has to skip past it
+    const uint32_t cbSize = RttReader::HeaderSize + (upCount + downCount) * RttReader::DescriptorSize;
+
+    uint32_t total = cbSize;
+    for (uint32_t s : upSizes) total += s;
+    if (!this->locate(cbAddr, total))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> zero(total, 0);
+    this->writeMemory(cbAddr, zero.data(), total);
+
+    this->store32(cbAddr + 16, upCount);
+    this->store32(cbAddr + 20, downCount);
+
+    uint32_t buffer = cbAddr + cbSize;
+    for (uint32_t i = 0; i < upCount; i++)
+    {
+        const uint32_t desc = cbAddr + RttReader::HeaderSize + i * RttReader::DescriptorSize;
+        this->store32(desc + 4, buffer);
+        this->store32(desc + 8, upSizes[i]);
+        buffer += upSizes[i];
+    }
+
+    // The id goes in last, a host scanning RAM must never see a half built block
+    this->writeMemory(cbAddr, (const uint8_t*)RttReader::ControlBlockId, (uint32_t)strlen(RttReader::ControlBlockId));
+
+    this->rttAddr = cbAddr;
+    this->rttUpCount = upCount;
+    return true;
+}
+
+bool SimulatedTarget::rttWrite(unsigned channel, const uint8_t* data, uint32_t len)
+{
+    if (this->rttAddr == 0 || channel >= this->rttUpCount)
+    {
+        return false;
+    }
+
+    const uint32_t desc = this->rttAddr + RttReader::HeaderSize + channel * RttReader::DescriptorSize;
+    const uint32_t buffer = this->load32(desc + 4);
+    const uint32_t size = this->load32(desc + 8);
+    uint32_t wr = this->load32(desc + 12);
+    const uint32_t rd = this->load32(desc + 16);
+
+    // One byte always stays free so WrOff == RdOff means empty
+    uint32_t space = (rd > wr) ? rd - wr - 1 : size - 1 - (wr - rd);
+    if (len > space)
+    {
+        return false;
+    }
+
+    uint32_t first = size - wr;
+    if (first > len) first = len;
+    this->writeMemory(buffer + wr, data, first);
+    if (len > first)
+    {
+        this->writeMemory(buffer, data + first, len - first);
+    }
+
+    wr += len;
+    if (wr >= size) wr -= size;
+    this->store32(desc + 12, wr);
+    return true;
+}
@@ -0,0 +1,64 @@
+/* =============== SimulatedTarget.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Simulated target memory
+
+    Description:
+        A few plain byte arrays standing in for target RAM, plus the
+        firmware side of SEGGER RTT (init + write) on top of them. Used when
+        no gdb server is around, and handy to check the RTT reader without
+        a board on the desk.
+*/
+
+#ifndef SIMULATEDTARGET_H
+#define SIMULATEDTARGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TargetMemory.h"
+
+/**
+  * @brief Memory image with RTT firmware helpers
+
+  Not thread safe, the fake firmware and whoever reads it have to run on the same thread
+  (the acquisition thread does both in turn).
+*/
+class SimulatedTarget : public TargetMemory
+{
+    private:
+
+        struct Region
+        {
+            uint32_t base = 0;
+            std::vector<uint8_t> bytes;
+        };
+
+        std::vector<Region> regions;
+        uint32_t rttAddr = 0;
+        uint32_t rttUpCount = 0;
+
+        uint8_t* locate(uint32_t addr, uint32_t len);
+        uint32_t load32(uint32_t addr);
+        void store32(uint32_t addr, uint32_t value);
+
+    public:
+
+        SimulatedTarget() = default;
+
+        // Zero filled RAM at [base, base + size)
+        void addRegion(uint32_t base, uint32_t size);
+
+        bool readMemory(uint32_t addr, uint32_t len, uint8_t* out) override;
+        bool writeMemory(uint32_t addr, const uint8_t* data, uint32_t len) override;
+
+        // Lays out _SEGGER_RTT at cbAddr like SEGGER_RTT_Init() would, one up buffer per size given.
+        // The ring buffers go right after the control block. Returns false if it does not fit in RAM.
+        bool setupRtt(uint32_t cbAddr, const std::vector<uint32_t>& upSizes);
+        uint32_t getRttAddress() const {return this->rttAddr;}
+
+        // Firmware side SEGGER_RTT_Write in NO_BLOCK_SKIP mode: all of it fits or nothing is written
+        bool rttWrite(unsigned channel, const uint8_t* data, uint32_t len);
+};
+
+#endif // SIMULATEDTARGET_H
@@ -0,0 +1,237 @@
+/* =============== Socket.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Sockets
+
+    Description:
+        Platform specific bits live here so the protocol code does not need
+        #ifdef _WIN32 everywhere.
+*/
+
+#include "Socket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+    #define poll WSAPoll
+    using PollCount = ULONG;
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <errno.h>
+    using PollCount = nfds_t;
+#endif
+
+// Writing to a closed socket should be an error code, not a SIGPIPE
+#ifdef MSG_NOSIGNAL
+    static const int SendFlags = MSG_NOSIGNAL;
+#else
+    static const int SendFlags = 0;
+#endif
+
+static std::atomic<int> initCount{0};
+
+bool socketInit()
+{
+    #ifdef _WIN32
+        if (initCount.fetch_add(1) == 0)
+        {
+            WSADATA wsaData;
+            if (WSAStartup(MAKEWORD(2,2), &wsaData) != 0)
+            {
+                initCount.fetch_sub(1);
+                return false;
+            }
+        }
+        return true;
+    #else
+        initCount.fetch_add(1);
+        return true;
+    #endif
+}
+
+void socketCleanup()
+{
+    #ifdef _WIN32
+        if (initCount.fetch_sub(1) == 1)
+        {
+            WSACleanup();
+        }
+    #else
+        initCount.fetch_sub(1);
+    #endif
+}
+
+std::string socketLastError()
+{
+    #ifdef _WIN32
+        int err = WSAGetLastError();
+        char buf[256];
+        FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, err, 0, buf, sizeof(buf), nullptr);
+        return std::string(buf);
+    #else
+        return std::string(strerror(errno));
+    #endif
+}
+
+static bool wouldBlock()
+{
+    #ifdef _WIN32
+        int err = WSAGetLastError();
+        return err == WSAEWOULDBLOCK || err == WSAEINPROGRESS;
+    #else
+        return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINPROGRESS;
+    #endif
+}
+
+static bool setNonBlocking(SocketType skt)
+{
+    #ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(skt, FIONBIO, &mode) == 0;
+    #else
+        int flags = fcntl(skt, F_GETFL, 0);
+        return flags != -1 && fcntl(skt, F_SETFL, flags | O_NONBLOCK) == 0;
+    #endif
+}
+
+void socketClose(SocketType skt)
+{
+    if (skt == InvalidSocket) return;
+
+    #ifdef _WIN32
+        closesocket(skt);
+    #else
+        close(skt);
+    #endif
+}
+
+int socketWait(SocketType skt, bool forWrite, int timeoutMs)
+{
+    pollfd pfd{};
+    pfd.fd = skt;
+    pfd.events = forWrite ? POLLOUT : POLLIN;
+
+    int r = poll(&pfd, (PollCount)1, timeoutMs);
+    if (r < 0)
+    {
+        return -1;
+    }
+    if (r == 0)
+    {
+        return 0;
+    }
+
+    // A hang up still counts as readable, recv() reports the close
+    if (pfd.revents & (POLLERR | POLLNVAL))
+    {
+        return -1;
+    }
+    return 1;
+}
+
+SocketType socketConnect(const char* host, int port, int timeoutMs, std::string& err)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* info = nullptr;
+    std::string portStr = std::to_string(port);
+    if (getaddrinfo(host, portStr.c_str(), &hints, &info) != 0 || info == nullptr)
+    {
+        err = std::string("Could not resolve ") + host;
+        return InvalidSocket;
+    }
+
+    SocketType skt = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (skt == InvalidSocket)
+    {
+        err = "Failed to create socket: " + socketLastError();
+        freeaddrinfo(info);
+        return InvalidSocket;
+    }
+
+    setNonBlocking(skt);
+
+    // Small request/response packets, Nagle would only add latency
+    int one = 1;
+    setsockopt(skt, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+
+    int r = connect(skt, info->ai_addr, (int)info->ai_addrlen);
+    freeaddrinfo(info);
+
+    if (r != 0)
+    {
+        if (!wouldBlock() || socketWait(skt, true, timeoutMs) != 1)
+        {
+            err = "Failed to connect to " + std::string(host) + ":" + portStr;
+            socketClose(skt);
+            return InvalidSocket;
+        }
+
+        // Writable does not mean connected, check what actually happened
+        int soErr = 0;
+        socklen_t len = sizeof(soErr);
+        getsockopt(skt, SOL_SOCKET, SO_ERROR, (char*)&soErr, &len);
+        if (soErr != 0)
+        {
+            err = "Failed to connect to " + std::string(host) + ":" + portStr;
+            socketClose(skt);
+            return InvalidSocket;
+        }
+    }
+
+    return skt;
+}
+
+bool socketSendAll(SocketType skt, const char* data, size_t len, int timeoutMs)
+{
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    size_t sent = 0;
+    while (sent < len)
+    {
+        int n = send(skt, data + sent, (int)(len - sent), SendFlags);
+        if (n > 0)
+        {
+            sent += (size_t)n;
+            continue;
+        }
+        if (n < 0 && !wouldBlock())
+        {
+            return false;
+        }
+
+        int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+        if (left <= 0 || socketWait(skt, true, left) != 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int socketRecv(SocketType skt, char* buf, size_t len)
+{
+    int n = recv(skt, buf, (int)len, 0);
+    if (n > 0)
+    {
+        return n;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    return wouldBlock() ? -1 : -2;
+}
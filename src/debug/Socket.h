@@ -0,0 +1,46 @@
+/* =============== Socket.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Sockets
+
+    Description:
+        Small cross platform wrapper around BSD sockets / winsock. Everything
+        here works on non-blocking sockets and waits with poll() and a
+        timeout, so nothing ever sits in a sleep hoping data shows up.
+*/
+
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <cstddef> // For size_t
+#include <string>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    using SocketType = SOCKET;
+    constexpr SocketType InvalidSocket = INVALID_SOCKET;
+#else
+    using SocketType = int;
+    constexpr SocketType InvalidSocket = -1;
+#endif
+
+// WSAStartup / WSACleanup on Windows, nothing elsewhere. Calls are reference counted.
+bool socketInit();
+void socketCleanup();
+
+std::string socketLastError();
+
+// Connects with a timeout. The socket comes back non-blocking with TCP_NODELAY set.
+SocketType socketConnect(const char* host, int port, int timeoutMs, std::string& err);
+void socketClose(SocketType skt);
+
+// Waits until the socket can be read (or written). 1 = ready, 0 = timeout, -1 = error
+int socketWait(SocketType skt, bool forWrite, int timeoutMs);
+
+// Sends everything, waiting for buffer space when needed
+bool socketSendAll(SocketType skt, const char* data, size_t len, int timeoutMs);
+
+// Non-blocking receive. > 0 bytes read, 0 = peer closed, -1 = nothing there yet, -2 = error
+int socketRecv(SocketType skt, char* buf, size_t len);
+
+#endif // SOCKET_H
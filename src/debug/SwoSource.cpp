@@ -0,0 +1,119 @@
+/* =============== SwoSource.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: SWO capture input
+
+    Description:
+        TCP or file input for the SWO byte stream.
+*/
+
+#include "SwoSource.h"
+
+#include <cstdlib> // strtol
+
+SwoSource::~SwoSource()
+{
+    this->close();
+}
+
+bool SwoSource::open(const std::string& spec, int timeoutMs)
+{
+    this->close();
+    this->totalBytes = 0;
+
+    // host:port with a numeric port is a socket, C:\capture.swo and the like are files
+    size_t colon = spec.rfind(':');
+    char* end = nullptr;
+    long port = (colon != std::string::npos) ? strtol(spec.c_str() + colon + 1, &end, 10) : 0;
+    const bool isSocket = colon != std::string::npos && end && *end == '\0' && port > 0 && port < 65536;
+
+    if (!isSocket)
+    {
+        this->file = fopen(spec.c_str(), "rb");
+        if (!this->file)
+        {
+            this->lastError = "Can't open " + spec;
+            return false;
+        }
+        return true;
+    }
+
+    if (!socketInit())
+    {
+        this->lastError = "Failed to initialize sockets";
+        return false;
+    }
+
+    std::string host = spec.substr(0, colon);
+    if (host.empty()) host = "127.0.0.1";
+
+    std::string err;
+    this->skt = socketConnect(host.c_str(), (int)port, timeoutMs, err);
+    if (this->skt == InvalidSocket)
+    {
+        this->lastError = err;
+        socketCleanup();
+        return false;
+    }
+    return true;
+}
+
+void SwoSource::close()
+{
+    if (this->file)
+    {
+        fclose(this->file);
+        this->file = nullptr;
+    }
+
+    if (this->skt != InvalidSocket)
+    {
+        socketClose(this->skt);
+        socketCleanup();
+        this->skt = InvalidSocket;
+    }
+}
+
+int SwoSource::read(uint8_t* buf, size_t len)
+{
+    if (this->file)
+    {
+        size_t n = fread(buf, 1, len, this->file);
+        if (n == 0)
+        {
+            if (ferror(this->file))
+            {
+                this->lastError = "Capture file read failed";
+                return -1;
+            }
+            // End of file for now, OpenOCD may still be appending to it
+            clearerr(this->file);
+        }
+        this->totalBytes += n;
+        return (int)n;
+    }
+
+    if (this->skt == InvalidSocket)
+    {
+        this->lastError = "Not open";
+        return -1;
+    }
+
+    int n = socketRecv(this->skt, (char*)buf, len);
+    if (n == 0)
+    {
+        this->lastError = "OpenOCD closed the SWO port";
+        return -1;
+    }
+    if (n == -2)
+    {
+        this->lastError = "Receive failed: " + socketLastError();
+        return -1;
+    }
+    if (n < 0)
+    {
+        return 0;
+    }
+
+    this->totalBytes += (uint64_t)n;
+    return n;
+}
@@ -0,0 +1,53 @@
+/* =============== SwoSource.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: SWO capture input
+
+    Description:
+        Raw SWO bytes from wherever OpenOCD puts them. With
+            $_TARGETNAME.tpiu configure -protocol uart -output :3344 -traceclk 168000000 -pin-freq 2000000
+        it serves them on a TCP port, with -output swo.bin it appends them to a
+        file. Both are read the same way here: whatever arrived since the last
+        read, never blocking. A finished capture file is read the same way too,
+        which is how recorded captures get replayed through the decoder.
+*/
+
+#ifndef SWOSOURCE_H
+#define SWOSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Socket.h"
+
+class SwoSource
+{
+    private:
+
+        SocketType skt = InvalidSocket;
+        FILE* file = nullptr;
+        std::string lastError;
+        uint64_t totalBytes = 0;
+
+    public:
+
+        SwoSource() = default;
+        ~SwoSource();
+
+        SwoSource(const SwoSource&) = delete;
+        SwoSource& operator=(const SwoSource&) = delete;
+
+        // "host:port" or ":port" connects, anything else is opened as a capture file
+        bool open(const std::string& spec, int timeoutMs = 500);
+        void close();
+        bool isOpen() const {return this->skt != InvalidSocket || this->file != nullptr;}
+
+        // > 0 bytes read, 0 = nothing new yet, -1 = error or the connection closed
+        int read(uint8_t* buf, size_t len);
+
+        uint64_t bytesRead() const {return this->totalBytes;}
+        const std::string& getLastError() const {return this->lastError;}
+};
+
+#endif // SWOSOURCE_H
@@ -0,0 +1,27 @@
+/* =============== TargetMemory.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Target memory access
+
+    Description:
+        The one thing RTT (and anything else that streams out of target RAM)
+        needs from a debug connection: read and write bytes. Lets the same
+        reader run against OpenOCD or against a simulated memory image.
+*/
+
+#ifndef TARGETMEMORY_H
+#define TARGETMEMORY_H
+
+#include <cstdint>
+
+class TargetMemory
+{
+    public:
+
+        virtual ~TargetMemory() = default;
+
+        // Both are all or nothing, false means nothing useful landed in out / on the target
+        virtual bool readMemory(uint32_t addr, uint32_t len, uint8_t* out) = 0;
+        virtual bool writeMemory(uint32_t addr, const uint8_t* data, uint32_t len) = 0;
+};
+
+#endif // TARGETMEMORY_H
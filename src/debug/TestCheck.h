@@ -0,0 +1,27 @@
+/* =============== TestCheck.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Test helpers
+
+    Description:
+        CHECK() for the test programs. A failed check prints where it was
+        and is counted, the test keeps going so one run shows every failure.
+*/
+
+#ifndef TESTCHECK_H
+#define TESTCHECK_H
+
+#include <cstdio>
+
+static int testFailures = 0;
+
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#endif // TESTCHECK_H
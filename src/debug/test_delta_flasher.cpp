@@ -0,0 +1,297 @@
+/* =============== test_delta_flasher.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: DeltaFlasher test
+
+    Description:
+        The host side of delta flashing: crc32 against known vectors, the
+        target CRC helper's nibble table against the host table (and its
+        loop run on the host), splitImage for gap fill, chunks spanning
+        sectors and segments outside flash, and readSectorLayout against a
+        mock TCL server for listed sectors and uniform pages.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DeltaFlasher.h"
+#include "MockServer.h"
+#include "OpenOCDTcl.h"
+#include "STM32Devices.h"
+#include "TestCheck.h"
+
+static uint32_t word(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static FlashImage::Chunk chunk(uint32_t addr, size_t len, uint8_t first)
+{
+    FlashImage::Chunk c;
+    c.addr = addr;
+    for (size_t i = 0; i < len; i++) c.data.push_back((uint8_t)(first + i));
+    return c;
+}
+
+// ------------------------------
+// CRC
+// ------------------------------
+static void testCrc()
+{
+    printf("CRC32 vectors...\n");
+
+    const char* check = "123456789";
+    const char* fox = "The quick brown fox jumps over the lazy dog";
+    CHECK(DeltaFlasher::crc32(nullptr, 0) == 0);
+    CHECK(DeltaFlasher::crc32((const uint8_t*)check, strlen(check)) == 0xCBF43926u);
+    CHECK(DeltaFlasher::crc32((const uint8_t*)fox, strlen(fox)) == 0x414FA339u);
+
+    const uint8_t zeros[4] = {};
+    CHECK(DeltaFlasher::crc32(zeros, sizeof(zeros)) == 0x2144DF1Cu);
+
+    // Fed in pieces, the way readback goes slice by slice
+    uint32_t crc = DeltaFlasher::crc32((const uint8_t*)fox, 10);
+    crc = DeltaFlasher::crc32((const uint8_t*)fox + 10, 1, crc);
+    crc = DeltaFlasher::crc32((const uint8_t*)fox + 11, strlen(fox) - 11, crc);
+    CHECK(crc == 0x414FA339u);
+}
+
+static void testCrcHelper()
+{
+    printf("Target CRC helper...\n");
+
+    const std::vector<uint8_t> image = DeltaFlasher::crcHelperImage();
+    CHECK(image.size() > 64 && image.size() % 4 == 0);
+    if (image.size() <= 64)
+    {
+        return;
+    }
+
+    // The first instruction is "adr r3, table": Align(pc, 4) + imm8 * 4, pc being 4 ahead
+    const size_t table = image.size() - 64;
+    CHECK(image[1] == 0xA3);
+    CHECK(4 + (size_t)image[0] * 4 == table);
+
+    // Entry i of the nibble table is entry i << 4 of the host's byte table. The byte table is
+    // read back through crc32() on one byte: crc32(b) = ~(T[b ^ 0xFF] ^ 0x00FFFFFF).
+    uint32_t nibbles[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        nibbles[i] = word(image.data() + table + 4 * i);
+        const uint8_t b = (uint8_t)((i << 4) ^ 0xFF);
+        CHECK(nibbles[i] == (~DeltaFlasher::crc32(&b, 1) ^ 0x00FFFFFFu));
+    }
+
+    // The helper's loop on the host, two nibbles per byte, and the final inversion done by the caller
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 131 + 7);
+    uint32_t r2 = 0xFFFFFFFF;
+    for (uint8_t b : data)
+    {
+        r2 ^= b;
+        r2 = (r2 >> 4) ^ nibbles[r2 & 15];
+        r2 = (r2 >> 4) ^ nibbles[r2 & 15];
+    }
+    CHECK(~r2 == DeltaFlasher::crc32(data.data(), data.size()));
+}
+
+// ------------------------------
+// Image split
+// ------------------------------
+static void testSplit()
+{
+    printf("Split along sectors...\n");
+
+    // 16K, 16K, 64K, then a sector the image doesn't touch
+    const std::vector<FlashSector> layout = {
+        {0x08000000, 0x4000}, {0x08004000, 0x4000}, {0x08010000, 0x10000}, {0x08020000, 0x4000}};
+
+    FlashImage image;
+    image.chunks.push_back(chunk(0x08000000, 0x100, 0x10));  // Start of sector 0
+    image.chunks.push_back(chunk(0x08003F00, 0x200, 0x20));  // Across sectors 0 and 1
+    image.chunks.push_back(chunk(0x08008000, 0x100, 0x30));  // In the hole between 1 and 2
+    image.chunks.push_back(chunk(0x08012000, 0x10, 0x40));   // Middle of sector 2
+    image.chunks.push_back(chunk(0x20000000, 0x80, 0x50));   // RAM (.data init), no sector
+
+    std::vector<FlashSector> sectors;
+    std::vector<uint8_t> contents;
+    DeltaFlasher::splitImage(image, layout, 0xFF, sectors, contents);
+
+    CHECK(sectors.size() == 3);
+    CHECK(contents.size() == 0x4000 + 0x4000 + 0x10000);
+    if (sectors.size() != 3 || contents.size() != 0x18000)
+    {
+        return;
+    }
+    CHECK(sectors[0].addr == 0x08000000 && sectors[1].addr == 0x08004000 && sectors[2].addr == 0x08010000);
+    CHECK(sectors[2].size == 0x10000);
+
+    const uint8_t* s0 = contents.data();
+    const uint8_t* s1 = s0 + 0x4000;
+    const uint8_t* s2 = s1 + 0x4000;
+
+    // Copied bytes, and the gaps around them filled
+    CHECK(s0[0] == 0x10 && s0[0xFF] == (uint8_t)(0x10 + 0xFF));
+    CHECK(s0[0x100] == 0xFF && s0[0x3EFF] == 0xFF);
+    CHECK(s0[0x3F00] == 0x20 && s0[0x3FFF] == (uint8_t)(0x20 + 0xFF));
+    CHECK(s1[0] == (uint8_t)(0x20 + 0x100) && s1[0xFF] == (uint8_t)(0x20 + 0x1FF));
+    CHECK(s1[0x100] == 0xFF && s1[0x3FFF] == 0xFF);
+    CHECK(s2[0x1FFF] == 0xFF && s2[0x2000] == 0x40 && s2[0x200F] == 0x4F && s2[0x2010] == 0xFF);
+
+    // Nothing from the hole or from RAM made it in
+    size_t filled = 0;
+    for (uint8_t b : contents) filled += (b == 0xFF);
+    size_t copiedFF = 0;
+    for (size_t k = 0; k < 4; k++)
+    {
+        if (k == 2) continue;
+        for (uint8_t b : image.chunks[k].data) copiedFF += (b == 0xFF);
+    }
+    CHECK(filled == contents.size() - 0x100 - 0x200 - 0x10 + copiedFF);
+
+    // Another fill value, and an image with no flash at all
+    DeltaFlasher::splitImage(image, layout, 0x00, sectors, contents);
+    CHECK(contents.size() == 0x18000 && contents[0x100] == 0x00);
+
+    FlashImage ramOnly;
+    ramOnly.chunks.push_back(chunk(0x20000000, 0x80, 0));
+    DeltaFlasher::splitImage(ramOnly, layout, 0xFF, sectors, contents);
+    CHECK(sectors.empty() && contents.empty());
+}
+
+// ------------------------------
+// Sector layout
+// ------------------------------
+class MockTclServer
+{
+    private:
+
+        SocketType listener = InvalidSocket;
+        std::thread worker;
+
+        static std::string reply(const std::string& script)
+        {
+            if (script == "flash info 0")
+            {
+                // Offsets from the bank base, the last one past the probed size
+                return "#0 : stm32f2x at 0x08000000, size 0x00020000, buswidth 0, chipwidth 0\n"
+                       "\t#  0: 0x00000000 (0x4000 16kB) not protected\n"
+                       "\t#  1: 0x00004000 (0x4000 16kB) not protected\n"
+                       "\t#  2: 0x00008000 (0x8000 32kB) not protected\n"
+                       "\t#  3: 0x00010000 (0x10000 64kB) not protected\n"
+                       "\t#  4: 0x00020000 (0x20000 128kB) not protected\n"
+                       "STM32F4xx - Rev: Z";
+            }
+            if (script == "flash info 1")
+            {
+                return "#1 : stm32l4x at 0x08080000, size 0x00001000, buswidth 0, chipwidth 0\n";
+            }
+            return "invalid command name \"" + script + "\"";
+        }
+
+        void run()
+        {
+            SocketType skt = mockAccept(this->listener);
+            if (skt == InvalidSocket)
+            {
+                return;
+            }
+
+            std::string rx;
+            while (mockRecv(skt, rx, 2000))
+            {
+                size_t end;
+                while ((end = rx.find(OpenOCDTcl::Terminator)) != std::string::npos)
+                {
+                    const std::string script = rx.substr(0, end);
+                    rx.erase(0, end + 1);
+                    mockSend(skt, reply(script) + OpenOCDTcl::Terminator);
+                }
+            }
+
+            socketClose(skt);
+        }
+
+    public:
+
+        ~MockTclServer()
+        {
+            if (this->worker.joinable())
+            {
+                this->worker.join();
+            }
+        }
+
+        bool start(int& port)
+        {
+            this->listener = mockListen(port);
+            if (this->listener == InvalidSocket)
+            {
+                return false;
+            }
+            this->worker = std::thread(&MockTclServer::run, this);
+            return true;
+        }
+};
+
+static void testSectorLayout()
+{
+    printf("Sector layout from flash info...\n");
+
+    MockTclServer server;
+    int port = 0;
+    if (!server.start(port))
+    {
+        printf("  FAIL: could not listen on loopback\n");
+        testFailures++;
+        return;
+    }
+
+    OpenOCDTcl tcl;
+    CHECK(tcl.connect("127.0.0.1", port, 1000));
+
+    STM32Device paged;
+    paged.pageSize = 0x800;
+    STM32Device mixed;
+    mixed.pageSize = 0x4000;
+    mixed.sectored = true;
+
+    // Listed sectors, and a bank without any that gets uniform pages. The unprobed bank is skipped.
+    const std::vector<FlashBank> banks = {
+        {"stm32f2x", 0x08000000, 0x20000}, {"stm32l4x", 0x08080000, 0x1000}, {"stm32l4x", 0x08100000, 0}};
+    std::vector<FlashSector> layout;
+    std::string err;
+    CHECK(DeltaFlasher::readSectorLayout(tcl, banks, &paged, layout, err));
+    CHECK(layout.size() == 4 + 2);
+    if (layout.size() == 6)
+    {
+        CHECK(layout[0].addr == 0x08000000 && layout[0].size == 0x4000);
+        CHECK(layout[2].addr == 0x08008000 && layout[2].size == 0x8000);
+        CHECK(layout[3].addr == 0x08010000 && layout[3].size == 0x10000);
+        CHECK(layout[4].addr == 0x08080000 && layout[4].size == 0x800);
+        CHECK(layout[5].addr == 0x08080800 && layout[5].size == 0x800);
+    }
+
+    // Mixed sector sizes can't be guessed, and without a device neither can pages
+    CHECK(DeltaFlasher::readSectorLayout(tcl, banks, &mixed, layout, err));
+    CHECK(layout.size() == 4);
+    CHECK(DeltaFlasher::readSectorLayout(tcl, banks, nullptr, layout, err));
+    CHECK(layout.size() == 4);
+
+    tcl.disconnect();
+}
+
+int main()
+{
+    printf("Testing DeltaFlasher...\n");
+
+    testCrc();
+    testCrcHelper();
+    testSplit();
+    testSectorLayout();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
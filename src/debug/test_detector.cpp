@@ -1,36 +1,34 @@
 #include <cstdio>
-#include <cstdlib>
-#include <thread>
-#include <chrono>
+#include <memory>
+#include <mutex>
 #include "raylib.h"
 #include "STM32Detector.h"
+#include "STM32Devices.h"
+#include "DetectionCache.h"
+#include "OpenOCDProcess.h"
+#include "ProbeDiscovery.h"
 
-int main()
-{
-    ChangeDirectory(GetApplicationDirectory());
-    printf("Testing STM32 Detector...\n");
-
-    #ifdef _WIN32
-        const char* cmd = "start /B ../../tools/openocd/bin/openocd -s ../../tools/openocd/openocd/scripts -f interface/stlink.cfg -f target/stm32wlx.cfg";
-    #else
-        const char* cmd = "../../tools/openocd/bin/openocd -s ../../tools/openocd/openocd/scripts -f interface/stlink.cfg -f target/stm32wlx.cfg &";
-    #endif
-
-    printf("Starting OpenOCD...\n");
-    system(cmd);
-
-    printf("Waiting for OpenOCD to initialize...\n");
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-
-    printf("Detecting STM32...\n");
-    DetectionResult res = DetectedSTM32(4444);
+static const char* const OpenOCDExe = "../../tools/openocd/bin/openocd";
+static const char* const ScriptsDir = "../../tools/openocd/openocd/scripts";
+static const char* const TargetCfg = "stm32wlx.cfg";
+static const int ReadyTimeoutMs = 10000;
 
+static void printResult(const DetectionResult& res)
+{
     printf("--------------------------------------\n");
     if (res.success)
     {
         printf("SUCCESS!\n");
-        printf("  Device ID: 0x%03X\n", res.devID);
+        printf("  Device ID: 0x%03X%s\n", res.devID, res.fromCache ? " (confirmed from cache)" : "");
         printf("  Config:    %s\n", res.configFileName.c_str());
+        if (const STM32Device* device = findSTM32Device(res.devID))
+        {
+            printf("  Device:    %s (%s)\n", device->name, cortexCoreName(device->core));
+        }
+        if (res.flashSizeKb != 0)
+        {
+            printf("  Flash:     %u KB\n", (unsigned)res.flashSizeKb);
+        }
     }
     else
     {
@@ -38,12 +36,111 @@ int main()
         printf("  Error: %s\n", res.errMsg.c_str());
     }
     printf("--------------------------------------\n");
+}
+
+// Probes seen before are confirmed with one read, the cache file is shared with the app
+static void loadCache(DetectionCache& cache)
+{
+    std::string err;
+    if (!cache.load(err))
+    {
+        printf("Detection cache not loaded: %s\n", err.c_str());
+    }
+    printf("Detection cache: %s (%zu probes)\n", cache.getPath().c_str(), cache.size());
+}
+
+static void saveCache(DetectionCache& cache)
+{
+    std::string err;
+    if (!cache.save(err))
+    {
+        printf("Detection cache not saved: %s\n", err.c_str());
+    }
+}
+
+// One OpenOCD per connected ST-LINK, each on its own ports
+static int testMultiProbe(const std::vector<std::string>& serials, DetectionCache& cache)
+{
+    std::mutex processesLock;
+    std::vector<std::unique_ptr<OpenOCDProcess>> processes;
+
+    DiscoveryOptions options;
+    options.cache = &cache;
+    options.launcher = [&](const ProbeEndpoint& endpoint, std::string& err)
+    {
+        OpenOCDLaunch launch;
+        launch.executable = OpenOCDExe;
+        launch.args = openocdProbeArgs(endpoint, ScriptsDir, TargetCfg);
+        launch.readyPort = endpoint.tclPort;
+
+        auto process = std::make_unique<OpenOCDProcess>();
+        const bool ok = process->start(launch, err) && process->waitReady(ReadyTimeoutMs, err);
+
+        std::lock_guard<std::mutex> guard(processesLock);
+        processes.push_back(std::move(process));
+        return ok;
+    };
+
+    printf("Starting %zu OpenOCD instances...\n", serials.size());
+    const auto probes = discoverProbes(planEndpoints(serials), options);
+
+    int failed = 0;
+    for (const auto& probe : probes)
+    {
+        printf("Probe %s (TCL port %d, %.0f ms)\n", probe.serial.c_str(), probe.endpoint.tclPort, probe.elapsedMs);
+        printResult(probe.result);
+        if (!probe.result.success) failed++;
+    }
+    saveCache(cache);
+
+    // Destructors stop each instance, and only that one
+    return failed == 0 ? 0 : 1;
+}
+
+int main()
+{
+    ChangeDirectory(GetApplicationDirectory());
+    printf("Testing STM32 Detector...\n");
+
+    DetectionCache cache;
+    loadCache(cache);
+
+    const auto serials = listStLinkSerials();
+    if (serials.size() > 1)
+    {
+        return testMultiProbe(serials, cache);
+    }
+
+    OpenOCDLaunch launch;
+    launch.executable = OpenOCDExe;
+    launch.args = {"-s", ScriptsDir, "-f", "interface/stlink.cfg", "-f", std::string("target/") + TargetCfg};
+    launch.readyPort = 6666;
+
+    OpenOCDProcess openocd;
+    std::string err;
+
+    printf("Starting OpenOCD...\n");
+    if (!openocd.start(launch, err) || !openocd.waitReady(ReadyTimeoutMs, err))
+    {
+        printf("OpenOCD did not come up: %s\n", err.c_str());
+        for (const auto& line : openocd.recentOutput())
+        {
+            printf("  | %s\n", line.c_str());
+        }
+        return 1;
+    }
+
+    // TCL port through the cache, telnet if that does not answer
+    printf("Detecting STM32...\n");
+    DiscoveryOptions options;
+    options.cache = &cache;
+    const DetectedProbe probe = probeEndpoint(ProbeEndpoint(), options);
+    const DetectionResult& res = probe.result;
 
-    #ifdef _WIN32
-        system("taskkill /F /IM openocd.exe >nul 2>&1");
-    #else
-        system("pkill openocd");
-    #endif
+    printf("Probe %s (%.0f ms)\n", probe.serial.empty() ? "?" : probe.serial.c_str(), probe.elapsedMs);
+    printResult(res);
+    saveCache(cache);
 
+    openocd.stop();
     return res.success ? 0 : 1;
-}
\ No newline at end of file
+}
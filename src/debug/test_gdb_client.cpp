@@ -0,0 +1,399 @@
+/* =============== test_gdb_client.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: GDB_Client test
+
+    Description:
+        Runs GDB_Client against a scripted RSP server on loopback. The mock
+        offers PacketSize and QStartNoAckMode, holds back 'm' replies until
+        the whole batch has arrived (so a client that waits for each reply
+        would stall and show up), answers one read run length encoded and
+        mixes 'O' console packets in with the replies.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GDB_Client.h"
+#include "MockServer.h"
+
+static const size_t MockPacketSize = 0x100; // Small, so reads get split
+static const uint32_t ZeroRegion = 0x20001000; // Read back as zeros, sent run length encoded
+static const uint32_t BadRegion = 0x30000000; // Unmapped, every read gets E01
+
+static uint8_t patternByte(uint32_t addr)
+{
+    return (uint8_t)(addr * 7 + 3);
+}
+
+static std::string hexString(const std::string& text)
+{
+    return GDB_Client::bytesToHex((const uint8_t*)text.data(), text.size());
+}
+
+// ------------------------------
+// Mock RSP server
+// ------------------------------
+class MockRspServer
+{
+    private:
+
+        SocketType listener = InvalidSocket;
+        SocketType skt = InvalidSocket;
+        std::thread worker;
+        bool noAck = false;
+        std::vector<std::string> pendingReads;
+
+        // Framing without escaping, so the run length encoded reply goes out as is
+        void sendPacket(const std::string& body)
+        {
+            uint8_t sum = 0;
+            for (char c : body) sum += (uint8_t)c;
+
+            char tail[4];
+            snprintf(tail, sizeof(tail), "#%02x", sum);
+            mockSend(this->skt, "$" + body + tail);
+        }
+
+        std::string readReply(const std::string& cmd)
+        {
+            unsigned addr = 0;
+            unsigned len = 0;
+            sscanf(cmd.c_str(), "m%x,%x", &addr, &len);
+
+            if (addr >= BadRegion && addr < BadRegion + 0x1000)
+            {
+                return "E01";
+            }
+            if (addr >= ZeroRegion && addr < ZeroRegion + 0x1000)
+            {
+                // '0' then "*<n+29>" repeats the previous char n times. n of 6 and 7 would give '#' and '$'.
+                std::string body = "0";
+                size_t left = (size_t)len * 2 - 1;
+                while (left > 0)
+                {
+                    if (left < 3)
+                    {
+                        body += '0';
+                        left--;
+                        continue;
+                    }
+                    size_t n = (left > 90) ? 90 : left;
+                    if (n == 6 || n == 7) n = 5;
+                    body += '*';
+                    body += (char)(n + 29);
+                    left -= n;
+                }
+                return body;
+            }
+
+            std::vector<uint8_t> bytes(len);
+            for (unsigned i = 0; i < len; i++) bytes[i] = patternByte(addr + i);
+            return GDB_Client::bytesToHex(bytes.data(), bytes.size());
+        }
+
+        void flushReads()
+        {
+            if (this->pendingReads.empty())
+            {
+                return;
+            }
+
+            this->maxReadsInFlight = std::max(this->maxReadsInFlight.load(), this->pendingReads.size());
+
+            // Console output in the middle of a batch, the client must skip it
+            this->sendPacket("O" + hexString("batch\n"));
+            for (const auto& cmd : this->pendingReads)
+            {
+                this->sendPacket(this->readReply(cmd));
+            }
+            this->pendingReads.clear();
+        }
+
+        void handle(const std::string& cmd)
+        {
+            if (cmd.rfind("qSupported", 0) == 0)
+            {
+                char reply[64];
+                snprintf(reply, sizeof(reply), "PacketSize=%zx;QStartNoAckMode+;swbreak+", MockPacketSize);
+                this->sendPacket(reply);
+            }
+            else if (cmd == "QStartNoAckMode")
+            {
+                this->sendPacket("OK");
+                this->noAck = true;
+            }
+            else if (cmd == "?")
+            {
+                this->sendPacket("S05");
+            }
+            else if (cmd[0] == 'm')
+            {
+                this->pendingReads.push_back(cmd);
+            }
+            else if (cmd[0] == 'M')
+            {
+                this->sendPacket("OK");
+            }
+            else if (cmd == "qRcmd," + hexString("slow"))
+            {
+                // Takes longer than the client waits, like a slow step or flash command
+            }
+            else if (cmd == "qRcmd," + hexString("corrupt"))
+            {
+                mockSend(this->skt, "$OK#00");
+            }
+            else if (cmd.rfind("qRcmd,", 0) == 0)
+            {
+                // OpenOCD sends monitor output in pieces, then OK
+                this->sendPacket("O" + hexString("target halted "));
+                this->sendPacket("O" + hexString("due to debug-request\n"));
+                this->sendPacket("OK");
+            }
+            else if (cmd == "D")
+            {
+                this->sendPacket("OK");
+            }
+
+            else
+            {
+                this->sendPacket("");
+            }
+        }
+
+        void run()
+        {
+            this->skt = mockAccept(this->listener);
+            if (this->skt == InvalidSocket)
+            {
+                return;
+            }
+
+            std::string rx;
+            while (true)
+            {
+                // While reads are queued, give the client a moment to send the rest of the batch
+                const int waitMs = this->pendingReads.empty() ? 2000 : 300;
+                const size_t before = rx.size();
+                if (!mockRecv(this->skt, rx, waitMs))
+                {
+                    break;
+                }
+                if (rx.size() == before)
+                {
+                    this->flushReads();
+                    continue;
+                }
+
+                size_t pos = 0;
+                while (pos < rx.size())
+                {
+                    if (rx[pos] == '+')
+                    {
+                        if (this->noAck) this->acksAfterNoAck++;
+                        pos++;
+                        continue;
+                    }
+                    if (rx[pos] != '$')
+                    {
+                        pos++;
+                        continue;
+                    }
+
+                    size_t hash = rx.find('#', pos);
+                    if (hash == std::string::npos || hash + 2 >= rx.size())
+                    {
+                        break;
+                    }
+
+                    std::string cmd = rx.substr(pos + 1, hash - pos - 1);
+                    pos = hash + 3;
+
+                    if (!this->noAck)
+                    {
+                        mockSend(this->skt, "+");
+                    }
+                    if (cmd[0] != 'm')
+                    {
+                        this->flushReads();
+                    }
+                    this->handle(cmd);
+                }
+                rx.erase(0, pos);
+
+                if (this->pendingReads.size() >= this->expectedReads.load())
+                {
+                    this->flushReads();
+                }
+            }
+
+            socketClose(this->skt);
+        }
+
+    public:
+
+        std::atomic<size_t> expectedReads{1}; // Batch size the test is about to send
+        std::atomic<size_t> maxReadsInFlight{0};
+        std::atomic<int> acksAfterNoAck{0};
+
+        ~MockRspServer()
+        {
+            if (this->worker.joinable())
+            {
+                this->worker.join();
+            }
+        }
+
+        bool start(int& port)
+        {
+            this->listener = mockListen(port);
+            if (this->listener == InvalidSocket)
+            {
+                return false;
+            }
+            this->worker = std::thread(&MockRspServer::run, this);
+            return true;
+        }
+};
+
+// ------------------------------
+// Tests
+// ------------------------------
+static void testFraming()
+{
+    printf("Framing...\n");
+
+    std::string payload;
+    std::string framed = GDB_Client::frame("a$b#c}d*e");
+    CHECK(GDB_Client::unframe(framed.data(), framed.size(), payload));
+    CHECK(payload == "a$b#c}d*e");
+
+    // Run length encoding: "0* " is '0' plus 3 more
+    const std::string rle = "$0* #7a";
+    CHECK(GDB_Client::unframe(rle.data(), rle.size(), payload));
+    CHECK(payload == "0000");
+
+    const std::string bad = "$OK#00";
+    CHECK(!GDB_Client::unframe(bad.data(), bad.size(), payload));
+
+    GdbStopReply stop;
+    CHECK(GDB_Client::parseStopReply("T05thread:1;", stop));
+    CHECK(stop.kind == 'T' && stop.signal == 5 && !stop.exited);
+    CHECK(GDB_Client::parseStopReply("W00", stop) && stop.exited);
+}
+
+static void testSession()
+{
+    printf("Session against the mock RSP server...\n");
+
+    MockRspServer server;
+    int port = 0;
+    if (!server.start(port))
+    {
+        printf("  FAIL: could not listen on loopback\n");
+        testFailures++;
+        return;
+    }
+
+    GDB_Client client;
+    CHECK(client.connect("127.0.0.1", port, 1000));
+    CHECK(client.isNoAck());
+    CHECK(client.getPacketSize() == MockPacketSize);
+
+    GdbStopReply stop;
+    CHECK(client.queryStop(stop));
+    CHECK(stop.kind == 'S' && stop.signal == 5);
+
+    // Every ack the client sent came before the server saw "?", so this is the baseline
+    const int acks = server.acksAfterNoAck.load();
+
+    // 300 bytes split into 120 + 120 + 60 at this packet size, one more range, and 200 zeros in two reads
+    const std::vector<GdbMemRange> ranges = {{0x08000000, 300}, {0x08001000, 16}, {ZeroRegion, 200}};
+    server.expectedReads.store(6);
+
+    std::vector<std::vector<uint8_t>> data;
+    CHECK(client.readMemoryBatch(ranges, data));
+    CHECK(server.maxReadsInFlight.load() == 6);
+    CHECK(data.size() == ranges.size());
+
+    bool contentsOk = (data.size() == ranges.size());
+    for (size_t r = 0; contentsOk && r < 2; r++)
+    {
+        contentsOk = (data[r].size() == ranges[r].len);
+        for (uint32_t i = 0; contentsOk && i < ranges[r].len; i++)
+        {
+            contentsOk = (data[r][i] == patternByte(ranges[r].addr + i));
+        }
+    }
+    CHECK(contentsOk);
+    CHECK(data.size() == 3 && data[2] == std::vector<uint8_t>(200, 0));
+
+    // A refused range comes back empty, the others in the same batch still arrive
+    const std::vector<GdbMemRange> mixed = {{0x08000000, 16}, {BadRegion, 16}, {0x08000100, 16}};
+    server.expectedReads.store(3);
+    CHECK(client.readMemoryBatch(mixed, data));
+    CHECK(data.size() == 3 && data[0].size() == 16 && data[1].empty() && data[2].size() == 16);
+    CHECK(data.size() == 3 && data[2][0] == patternByte(0x08000100));
+    CHECK(client.isConnected());
+
+    server.expectedReads.store(1);
+    std::vector<uint8_t> bytesOut;
+    CHECK(!client.readMemory(BadRegion, 4, bytesOut));
+    CHECK(client.isConnected());
+
+    std::string output;
+    CHECK(client.monitor("halt", output));
+    CHECK(output == "target halted due to debug-request\n");
+
+    const uint8_t bytes[4] = {1, 2, 3, 4};
+    CHECK(client.writeMemory(0x20000000, bytes, sizeof(bytes)));
+
+    CHECK(server.acksAfterNoAck.load() == acks);
+
+    client.disconnect();
+}
+
+// A reply that never came or did not survive must end the session, or the next
+// request would take it as its own answer
+static void testLostReplies()
+{
+    printf("Lost replies...\n");
+
+    for (const char* cmd : {"slow", "corrupt"})
+    {
+        MockRspServer server;
+        int port = 0;
+        if (!server.start(port))
+        {
+            printf("  FAIL: could not listen on loopback\n");
+            testFailures++;
+            return;
+        }
+
+        GDB_Client client;
+        CHECK(client.connect("127.0.0.1", port, 300));
+        CHECK(client.isNoAck());
+
+        std::string output;
+        CHECK(!client.monitor(cmd, output));
+        CHECK(!client.isConnected());
+
+        GdbStopReply stop;
+        CHECK(!client.queryStop(stop));
+    }
+}
+
+int main()
+{
+    printf("Testing GDB_Client...\n");
+
+    testFraming();
+    testSession();
+    testLostReplies();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
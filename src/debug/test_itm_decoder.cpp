@@ -0,0 +1,250 @@
+/* =============== test_itm_decoder.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: ItmDecoder / ItmRowBuilder test
+
+    Description:
+        Replays hand built ITM byte streams through the decoder and the row
+        builder: stimulus payloads of 1, 2 and 4 bytes, sync recovery after
+        joining a stream midway, overflow, local and global timestamps, and
+        the rows that come out of it.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ItmDecoder.h"
+#include "TestCheck.h"
+
+static std::vector<ItmPacket> decodeAll(ItmDecoder& decoder, const std::vector<uint8_t>& bytes)
+{
+    std::vector<ItmPacket> packets;
+    decoder.feed(bytes.data(), bytes.size(), [&](const ItmPacket& pkt) {packets.push_back(pkt);});
+    return packets;
+}
+
+static bool isStimulus(const ItmPacket& pkt, unsigned port, unsigned size, uint32_t value)
+{
+    return pkt.type == ItmPacketType::INSTRUMENTATION && pkt.channel == port && pkt.size == size && pkt.value == value;
+}
+
+static uint32_t floatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    return bits;
+}
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) < 1e-9;
+}
+
+static bool rowIs(const std::vector<double>& rows, size_t row, const std::vector<double>& expected)
+{
+    const size_t width = expected.size();
+    if (rows.size() < (row + 1) * width)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < width; i++)
+    {
+        if (!near(rows[row * width + i], expected[i])) return false;
+    }
+    return true;
+}
+
+// ------------------------------
+// Decoder
+// ------------------------------
+static void testStimulusSizes()
+{
+    printf("Stimulus payloads...\n");
+
+    // Port 0 one byte, port 1 two bytes, port 2 four bytes (little endian)
+    const std::vector<uint8_t> stream = {0x01, 0xAB, 0x0A, 0x34, 0x12, 0x13, 0x78, 0x56, 0x34, 0x12};
+
+    ItmDecoder decoder;
+    auto packets = decodeAll(decoder, stream);
+    CHECK(packets.size() == 3);
+    CHECK(packets.size() == 3 && isStimulus(packets[0], 0, 1, 0xAB));
+    CHECK(packets.size() == 3 && isStimulus(packets[1], 1, 2, 0x1234));
+    CHECK(packets.size() == 3 && isStimulus(packets[2], 2, 4, 0x12345678));
+
+    // One byte per feed(), packets split anywhere
+    ItmDecoder split;
+    std::vector<ItmPacket> pieces;
+    for (uint8_t b : stream)
+    {
+        split.feed(&b, 1, [&](const ItmPacket& pkt) {pieces.push_back(pkt);});
+    }
+    CHECK(pieces.size() == 3 && isStimulus(pieces[2], 2, 4, 0x12345678));
+
+    uint8_t encoded[5];
+    const size_t n = ItmRowBuilder::encodeStimulus(31, 0xDEADBEEF, encoded);
+    ItmDecoder roundTrip;
+    packets = decodeAll(roundTrip, std::vector<uint8_t>(encoded, encoded + n));
+    CHECK(packets.size() == 1 && isStimulus(packets[0], 31, 4, 0xDEADBEEF));
+}
+
+static void testSyncRecovery()
+{
+    printf("Sync recovery...\n");
+
+    // Joined midway: a 4 byte write with only one payload byte left, then a sync and a real packet
+    const std::vector<uint8_t> stream = {0x13, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x42};
+
+    ItmDecoder decoder;
+    auto packets = decodeAll(decoder, stream);
+    CHECK(packets.size() >= 2);
+    if (packets.size() >= 2)
+    {
+        CHECK(packets[packets.size() - 2].type == ItmPacketType::SYNC);
+        CHECK(isStimulus(packets.back(), 0, 1, 0x42));
+    }
+
+    // Idle padding, any number of zeros may come before the 0x80
+    ItmDecoder decoder2;
+    packets = decodeAll(decoder2, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x0A, 0x02, 0x01});
+    CHECK(packets.size() == 2);
+    CHECK(packets.size() == 2 && packets[0].type == ItmPacketType::SYNC);
+    CHECK(packets.size() == 2 && isStimulus(packets[1], 1, 2, 0x0102));
+
+    // Fewer than 47 zero bits is not a sync
+    ItmDecoder decoder3;
+    packets = decodeAll(decoder3, {0x00, 0x00, 0x00, 0x00, 0x80, 0x00});
+    for (const auto& pkt : packets)
+    {
+        CHECK(pkt.type != ItmPacketType::SYNC);
+    }
+}
+
+static void testOverflow()
+{
+    printf("Overflow...\n");
+
+    ItmDecoder decoder;
+    auto packets = decodeAll(decoder, {0x01, 0x05, 0x70, 0x01, 0x06});
+    CHECK(packets.size() == 3);
+    CHECK(packets.size() == 3 && packets[1].type == ItmPacketType::OVERFLOW);
+    CHECK(packets.size() == 3 && isStimulus(packets[2], 0, 1, 0x06));
+    CHECK(decoder.overflowCount() == 1);
+    CHECK(decoder.invalidCount() == 0);
+}
+
+static void testTimestamps()
+{
+    printf("Local and global timestamps...\n");
+
+    // Short form delta 3, then format 1 with two continuation bytes: 0x01 | 0x01 << 7 = 129
+    ItmDecoder decoder;
+    auto packets = decodeAll(decoder, {0x30, 0xC0, 0x81, 0x01});
+    CHECK(packets.size() == 2);
+    CHECK(packets.size() == 2 && packets[0].type == ItmPacketType::LOCAL_TIMESTAMP && packets[0].value == 3);
+    CHECK(packets.size() == 2 && packets[1].type == ItmPacketType::LOCAL_TIMESTAMP && packets[1].value == 129);
+    CHECK(decoder.hasTimestamps());
+    CHECK(decoder.localTime() == 132);
+
+    // GTS1 5 | 3 << 7 = 389, GTS2 1. Global timestamps leave the local time alone.
+    packets = decodeAll(decoder, {0x94, 0x85, 0x03, 0xB4, 0x01});
+    CHECK(packets.size() == 2);
+    CHECK(packets.size() == 2 && packets[0].type == ItmPacketType::GLOBAL_TIMESTAMP && packets[0].control == 1 &&
+          packets[0].value == 389);
+    CHECK(packets.size() == 2 && packets[1].type == ItmPacketType::GLOBAL_TIMESTAMP && packets[1].control == 2 &&
+          packets[1].value == 1);
+    CHECK(decoder.localTime() == 132);
+
+    // What the simulated target sends has to come back the same
+    uint8_t encoded[5];
+    for (uint32_t delta : {1u, 6u, 7u, 200u, 100000u})
+    {
+        ItmDecoder roundTrip;
+        const size_t n = ItmRowBuilder::encodeTimestamp(delta, encoded);
+        decodeAll(roundTrip, std::vector<uint8_t>(encoded, encoded + n));
+        CHECK(roundTrip.localTime() == delta);
+    }
+}
+
+// ------------------------------
+// Row builder
+// ------------------------------
+static void append(std::vector<uint8_t>& stream, const uint8_t* bytes, size_t n)
+{
+    stream.insert(stream.end(), bytes, bytes + n);
+}
+
+static void testRowsWithTimestamps()
+{
+    printf("Rows on the trace time axis...\n");
+
+    ItmRowBuilder builder;
+    builder.reset(3, 10.0, 1000.0);
+    builder.mapComparator(0, 2);
+
+    std::vector<uint8_t> stream;
+    uint8_t buf[5];
+
+    // t = 10.1: float on port 0, 16 bit on port 1, 8 bit on port 2, all one row
+    append(stream, buf, ItmRowBuilder::encodeTimestamp(100, buf));
+    append(stream, buf, ItmRowBuilder::encodeStimulus(0, floatBits(1.5f), buf));
+    stream.insert(stream.end(), {0x0A, 0x02, 0x01, 0x11, 0x07});
+
+    // Port 0 again at the same time starts a new row, the others hold their value
+    append(stream, buf, ItmRowBuilder::encodeStimulus(0, floatBits(2.5f), buf));
+
+    // t = 10.15: port 1, then a DWT data trace write on comparator 0 (discriminator 17, 1 byte)
+    append(stream, buf, ItmRowBuilder::encodeTimestamp(50, buf));
+    stream.insert(stream.end(), {0x0A, 0x2C, 0x01, 0x8D, 0x09});
+
+    std::vector<double> rows;
+    const size_t count = builder.feed(stream.data(), stream.size(), 99.0, rows);
+    CHECK(count == 3);
+    CHECK(rows.size() == 3 * 4);
+    CHECK(rowIs(rows, 0, {10.1, 1.5, 258.0, 7.0}));
+    CHECK(rowIs(rows, 1, {10.1, 2.5, 258.0, 7.0}));
+    CHECK(rowIs(rows, 2, {10.15, 2.5, 300.0, 9.0}));
+}
+
+static void testRowsWithoutTimestamps()
+{
+    printf("Rows on host time...\n");
+
+    ItmRowBuilder builder;
+    builder.reset(2);
+    builder.mapPort(5, 1);
+
+    std::vector<double> rows;
+    const uint8_t first[] = {0x01, 0x03, 0x29, 0x04}; // Port 0 = 3, port 5 = 4
+    const uint8_t second[] = {0x29, 0x08}; // Port 5 = 8
+    CHECK(builder.feed(first, sizeof(first), 5.0, rows) == 1);
+    CHECK(builder.feed(second, sizeof(second), 6.0, rows) == 1);
+    CHECK(rows.size() == 2 * 3);
+    CHECK(rowIs(rows, 0, {5.0, 3.0, 4.0}));
+    CHECK(rowIs(rows, 1, {6.0, 3.0, 8.0}));
+
+    // Unmapped ports and PC samples make no rows, PC samples are counted
+    uint8_t buf[5];
+    std::vector<uint8_t> stream = {0x39, 0x01}; // Port 7
+    append(stream, buf, ItmRowBuilder::encodePcSample(0x08000123, false, buf));
+    append(stream, buf, ItmRowBuilder::encodePcSample(0, true, buf));
+    CHECK(builder.feed(stream.data(), stream.size(), 7.0, rows) == 0);
+    CHECK(builder.pcSampleCount() == 2);
+    CHECK(builder.sleepSampleCount() == 1);
+    CHECK(builder.lastSampledPc() == 0x08000123);
+}
+
+int main()
+{
+    printf("Testing ItmDecoder...\n");
+
+    testStimulusSizes();
+    testSyncRecovery();
+    testOverflow();
+    testTimestamps();
+    testRowsWithTimestamps();
+    testRowsWithoutTimestamps();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
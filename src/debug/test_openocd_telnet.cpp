@@ -0,0 +1,156 @@
+/* =============== test_openocd_telnet.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: OpenOCDTelnet test
+
+    Description:
+        Runs OpenOCDTelnet against a scripted telnet server on loopback that
+        behaves like OpenOCD: IAC negotiation in front of the banner, the
+        command line echoed back, NUL padding, replies cut into pieces with
+        the prompt split across them, a "> " that is not a prompt, and a
+        command that never gets an answer.
+*/
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "OpenOCDTelnet.h"
+#include "MockServer.h"
+
+// ------------------------------
+// Mock OpenOCD telnet server
+// ------------------------------
+class MockTelnetServer
+{
+    private:
+
+        SocketType listener = InvalidSocket;
+        std::thread worker;
+
+        void reply(SocketType skt, const std::string& cmd)
+        {
+            // Echo first, like OpenOCD's line editor
+            mockSend(skt, cmd + "\r\n");
+
+            if (cmd == "mdw 0x08000000")
+            {
+                mockSend(skt, std::string("0x08000000: 20005000 ", 21) + std::string(3, '\0'));
+                mockPause(20);
+                mockSend(skt, "\r\n\r");
+                mockPause(20);
+                mockSend(skt, "\n>");
+                mockPause(20);
+                mockSend(skt, " ");
+            }
+            else if (cmd == "echo {a > b}")
+            {
+                // Ends in '>' but not after a line break, not a prompt yet
+                mockSend(skt, "a >");
+                mockPause(50);
+                mockSend(skt, " b\r\n> ");
+            }
+            else if (cmd == "hang")
+            {
+                // Nothing until the next command comes in
+            }
+            else
+            {
+                mockSend(skt, "invalid command name \"" + cmd + "\"\r\n> ");
+            }
+        }
+
+        void run()
+        {
+            SocketType skt = mockAccept(this->listener);
+            if (skt == InvalidSocket)
+            {
+                return;
+            }
+
+            // WILL ECHO, WILL SUPPRESS-GO-AHEAD, DO LINEMODE, then the banner split before the prompt
+            mockSend(skt, "\xff\xfb\x01\xff\xfb\x03\xff\xfd\x22");
+            mockPause(20);
+            mockSend(skt, "Open On-Chip Debugger\r\n");
+            mockPause(20);
+            mockSend(skt, "> ");
+
+            std::string rx;
+            while (mockRecv(skt, rx, 2000))
+            {
+                size_t end;
+                while ((end = rx.find("\r\n")) != std::string::npos)
+                {
+                    std::string cmd = rx.substr(0, end);
+                    rx.erase(0, end + 2);
+                    this->reply(skt, cmd);
+                }
+            }
+
+            socketClose(skt);
+        }
+
+    public:
+
+        ~MockTelnetServer()
+        {
+            if (this->worker.joinable())
+            {
+                this->worker.join();
+            }
+        }
+
+        bool start(int& port)
+        {
+            this->listener = mockListen(port);
+            if (this->listener == InvalidSocket)
+            {
+                return false;
+            }
+            this->worker = std::thread(&MockTelnetServer::run, this);
+            return true;
+        }
+};
+
+// ------------------------------
+// Tests
+// ------------------------------
+static void testSession()
+{
+    printf("Session against the mock telnet server...\n");
+
+    MockTelnetServer server;
+    int port = 0;
+    if (!server.start(port))
+    {
+        printf("  FAIL: could not listen on loopback\n");
+        testFailures++;
+        return;
+    }
+
+    OpenOCDTelnet telnet;
+    CHECK(telnet.connect("127.0.0.1", port, 1000));
+
+    std::string response;
+    CHECK(telnet.command("mdw 0x08000000", response));
+    CHECK(response == "0x08000000: 20005000");
+
+    CHECK(telnet.command("echo {a > b}", response));
+    CHECK(response == "a > b");
+
+    // The missing reply must fail, not hang
+    CHECK(!telnet.command("hang", response, 200));
+    CHECK(telnet.getLastError() == "Timed out waiting for OpenOCD prompt");
+
+    telnet.disconnect();
+    CHECK(!telnet.command("mdw 0x08000000", response));
+}
+
+int main()
+{
+    printf("Testing OpenOCDTelnet...\n");
+
+    testSession();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+/* =============== test_recording.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: RecordingWriter / RecordingReader test
+
+    Description:
+        Writes a recording with one channel of every SampleType, raw and
+        delta varint, and reads it back through the index footer. Then the
+        same file cut off in the middle of a chunk (a crash while recording)
+        has to come back from the chunk header scan, and a chunk header with
+        a nonsense row count has to be refused instead of allocated.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "recording/RecordingReader.h"
+#include "recording/RecordingWriter.h"
+#include "TestCheck.h"
+
+static const size_t Rows = 10000; // A bit over two full chunks
+static const size_t Channels = 5;
+
+static std::vector<RecordingChannel> testChannels()
+{
+    const SampleType types[Channels] = {SampleType::U8, SampleType::I16, SampleType::U32, SampleType::F32, SampleType::F64};
+    const char* names[Channels] = {"u8", "i16", "u32", "f32", "f64"};
+
+    std::vector<RecordingChannel> channels;
+    for (size_t c = 0; c < Channels; c++)
+    {
+        RecordingChannel ch;
+        ch.name = names[c];
+        ch.format.type = types[c];
+        ch.format.scale = 0.5 * (double)(c + 1);
+        ch.format.offset = -(double)c;
+        channels.push_back(ch);
+    }
+    return channels;
+}
+
+// [t, u8, i16, u32, f32, f64], values that use the whole range of each type
+static std::vector<double> testRow(size_t i)
+{
+    return {
+        1000.0 + (double)i * 1e-3,
+        (double)(i % 256),
+        (double)((int)((i * 37) % 65536) - 32768),
+        4000000000.0 + (double)i * 3.0, // Above 2^24, must not come back rounded
+        (double)(float)std::sin((double)i * 0.01),
+        1e9 + (double)i * 0.125,
+    };
+}
+
+static std::vector<uint8_t> readFile(const std::string& path)
+{
+    std::vector<uint8_t> bytes;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return bytes;
+    fseek(f, 0, SEEK_END);
+    bytes.resize((size_t)ftell(f));
+    fseek(f, 0, SEEK_SET);
+    if (fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) bytes.clear();
+    fclose(f);
+    return bytes;
+}
+
+static bool writeFile(const std::string& path, const uint8_t* data, size_t len)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = fwrite(data, 1, len, f) == len;
+    fclose(f);
+    return ok;
+}
+
+// Decodes every chunk and compares it with testRow(), starting at row 0
+static bool rowsMatch(const RecordingReader& reader, size_t& rowsRead)
+{
+    rowsRead = 0;
+    std::vector<double> times;
+    std::vector<double> values;
+    for (size_t i = 0; i < reader.getChunks().size(); i++)
+    {
+        if (!reader.readChunk(i, times, values) || values.size() != times.size() * Channels)
+        {
+            return false;
+        }
+        for (size_t r = 0; r < times.size(); r++, rowsRead++)
+        {
+            const std::vector<double> expected = testRow(rowsRead);
+            if (times[r] != expected[0]) return false;
+            for (size_t c = 0; c < Channels; c++)
+            {
+                if (values[c * times.size() + r] != expected[c + 1]) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::string writeRecording(bool compress)
+{
+    const std::string path = (std::filesystem::temp_directory_path() /
+                              (compress ? "test_recording_delta.stmrec" : "test_recording_raw.stmrec")).string();
+
+    RecordingWriter writer;
+    std::string err;
+    CHECK(writer.open(path, testChannels(), compress, err));
+
+    // Small batches, the way the UI hands rows over each frame
+    std::vector<double> batch;
+    for (size_t i = 0; i < Rows; i++)
+    {
+        const std::vector<double> row = testRow(i);
+        batch.insert(batch.end(), row.begin(), row.end());
+        if (batch.size() == 100 * (Channels + 1) || i + 1 == Rows)
+        {
+            writer.append(batch.data(), batch.size() / (Channels + 1));
+            batch.clear();
+        }
+    }
+    writer.close();
+
+    CHECK(!writer.hasFailed());
+    CHECK(writer.droppedRows() == 0);
+    CHECK(writer.rowCount() == Rows);
+    return path;
+}
+
+// ------------------------------
+// Tests
+// ------------------------------
+static void testRoundTrip(bool compress)
+{
+    printf("Round trip, %s...\n", compress ? "delta varint" : "raw");
+
+    const std::string path = writeRecording(compress);
+
+    RecordingReader reader;
+    std::string err;
+    CHECK(reader.open(path, err));
+    CHECK(!reader.wasRecovered());
+    CHECK(reader.rowCount() == Rows);
+    CHECK(reader.getChunks().size() > 2);
+
+    const std::vector<RecordingChannel> channels = testChannels();
+    CHECK(reader.channelCount() == Channels);
+    for (size_t c = 0; c < Channels && c < reader.channelCount(); c++)
+    {
+        const RecordingChannel& ch = reader.getChannels()[c];
+        CHECK(ch.name == channels[c].name);
+        CHECK(ch.format.type == channels[c].format.type);
+        CHECK(ch.format.scale == channels[c].format.scale && ch.format.offset == channels[c].format.offset);
+    }
+
+    size_t rowsRead = 0;
+    CHECK(rowsMatch(reader, rowsRead));
+    CHECK(rowsRead == Rows);
+
+    // Time lookups through the index
+    CHECK(reader.firstTime() == testRow(0)[0]);
+    CHECK(reader.lastTime() == testRow(Rows - 1)[0]);
+    CHECK(reader.findChunk(0.0) == 0);
+    CHECK(reader.findChunk(1e12) == reader.getChunks().size() - 1);
+    const size_t mid = reader.findChunk(testRow(5000)[0]);
+    CHECK(reader.getChunks()[mid].firstTime <= testRow(5000)[0] && reader.getChunks()[mid].lastTime >= testRow(5000)[0]);
+
+    reader.close();
+    std::filesystem::remove(path);
+}
+
+static void testTruncated()
+{
+    printf("Cut off mid chunk...\n");
+
+    const std::string path = writeRecording(true);
+    const std::vector<uint8_t> bytes = readFile(path);
+
+    size_t lastChunk = 0;
+    size_t chunkCount = 0;
+    {
+        RecordingReader reader;
+        std::string err;
+        CHECK(reader.open(path, err));
+        chunkCount = reader.getChunks().size();
+        lastChunk = chunkCount ? (size_t)reader.getChunks().back().offset : 0;
+    }
+    CHECK(chunkCount > 2 && lastChunk > 0 && bytes.size() > lastChunk + 40);
+
+    // No footer and half a chunk at the end, like after a crash
+    const std::string cut = path + ".cut";
+    CHECK(writeFile(cut, bytes.data(), lastChunk + 40));
+
+    RecordingReader reader;
+    std::string err;
+    CHECK(reader.open(cut, err));
+    CHECK(reader.wasRecovered());
+    CHECK(reader.getChunks().size() == chunkCount - 1);
+
+    size_t rowsRead = 0;
+    CHECK(rowsMatch(reader, rowsRead));
+    CHECK(rowsRead == reader.rowCount() && rowsRead > 0 && rowsRead < Rows);
+
+    reader.close();
+    std::filesystem::remove(cut);
+    std::filesystem::remove(path);
+}
+
+static void testCorruptRowCount()
+{
+    printf("Corrupt chunk header...\n");
+
+    const std::string path = writeRecording(true);
+    std::vector<uint8_t> bytes = readFile(path);
+
+    uint64_t first = 0;
+    {
+        RecordingReader reader;
+        std::string err;
+        CHECK(reader.open(path, err));
+        first = reader.getChunks().empty() ? 0 : reader.getChunks()[0].offset;
+    }
+    CHECK(first > 0 && first + 8 <= bytes.size());
+    if (first == 0 || first + 8 > bytes.size())
+    {
+        return;
+    }
+
+    // 2^31 rows in a chunk of a few KB
+    bytes[first + 4] = 0x00;
+    bytes[first + 5] = 0x00;
+    bytes[first + 6] = 0x00;
+    bytes[first + 7] = 0x80;
+    const std::string bad = path + ".bad";
+    CHECK(writeFile(bad, bytes.data(), bytes.size()));
+
+    RecordingReader reader;
+    std::string err;
+    CHECK(reader.open(bad, err));
+    std::vector<double> times;
+    std::vector<double> values;
+    CHECK(!reader.readChunk(0, times, values));
+    CHECK(reader.readChunk(1, times, values));
+
+    reader.close();
+    std::filesystem::remove(bad);
+    std::filesystem::remove(path);
+}
+
+int main()
+{
+    printf("Testing recordings...\n");
+
+    testRoundTrip(false);
+    testRoundTrip(true);
+    testTruncated();
+    testCorruptRowCount();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
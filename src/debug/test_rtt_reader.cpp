@@ -0,0 +1,203 @@
+/* =============== test_rtt_reader.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: RttReader / RttRecordDecoder test
+
+    Description:
+        Runs the RTT reader against SimulatedTarget: the control block scan
+        (in small chunks, past a decoy id and a hole in the map), draining a
+        ring that wrapped around, a full ring where the firmware drops what
+        does not fit, and the record decoder on top.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "RttReader.h"
+#include "SimulatedTarget.h"
+#include "TestCheck.h"
+
+static const uint32_t RamBase = 0x20000000;
+static const uint32_t RamSize = 0x4000;
+static const uint32_t ControlBlock = RamBase + 0x1A40;
+
+static std::vector<uint8_t> counting(uint8_t first, size_t n)
+{
+    std::vector<uint8_t> bytes(n);
+    for (size_t i = 0; i < n; i++) bytes[i] = (uint8_t)(first + i);
+    return bytes;
+}
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) < 1e-9;
+}
+
+// ------------------------------
+// Reader
+// ------------------------------
+static void testScan()
+{
+    printf("Control block scan...\n");
+
+    SimulatedTarget target;
+    target.addRegion(RamBase, RamSize);
+    CHECK(target.setupRtt(ControlBlock, {256}));
+
+    // Same id without the terminator, and one that is not word aligned. Neither is the control block.
+    const char decoy[] = "SEGGER RTTX";
+    target.writeMemory(RamBase + 0x100, (const uint8_t*)decoy, sizeof(decoy));
+    target.writeMemory(RamBase + 0x202, (const uint8_t*)RttReader::ControlBlockId, 11);
+
+    // Small chunks, so the id sits across chunk boundaries on the way
+    uint32_t found = 0;
+    CHECK(RttReader::findControlBlock(target, RamBase, RamSize, found, 64));
+    CHECK(found == ControlBlock);
+
+    // Starting in unmapped memory, the chunks that fail are skipped
+    found = 0;
+    CHECK(RttReader::findControlBlock(target, RamBase - 0x400, RamSize + 0x400, found, 256));
+    CHECK(found == ControlBlock);
+
+    CHECK(!RttReader::findControlBlock(target, RamBase, 0x1000, found, 256));
+
+    RttReader reader;
+    CHECK(!reader.attach(target, RamBase + 0x100));
+    CHECK(!reader.isAttached());
+    CHECK(reader.attach(target, ControlBlock));
+    CHECK(reader.upBufferCount() == 1);
+
+    std::vector<uint8_t> out;
+    CHECK(!reader.drain(1, out));
+    CHECK(reader.getLastError() == "No up buffer 1");
+}
+
+static void testWrapAround()
+{
+    printf("Ring wrap around...\n");
+
+    SimulatedTarget target;
+    target.addRegion(RamBase, RamSize);
+    CHECK(target.setupRtt(ControlBlock, {64}));
+
+    RttReader reader;
+    CHECK(reader.attach(target, ControlBlock));
+
+    const std::vector<uint8_t> first = counting(0, 40);
+    const std::vector<uint8_t> second = counting(40, 40);
+
+    std::vector<uint8_t> out;
+    CHECK(target.rttWrite(0, first.data(), (uint32_t)first.size()));
+    CHECK(reader.drain(0, out));
+    CHECK(out == first);
+
+    // WrOff is at 40, so 24 bytes go to the end of the ring and 16 to the start. One drain gets both, in order.
+    out.clear();
+    CHECK(target.rttWrite(0, second.data(), (uint32_t)second.size()));
+    CHECK(reader.drain(0, out));
+    CHECK(out == second);
+
+    // Nothing new, nothing read
+    out.clear();
+    CHECK(reader.drain(0, out));
+    CHECK(out.empty());
+    CHECK(reader.bytesRead() == 80);
+}
+
+static void testFullRing()
+{
+    printf("Full ring...\n");
+
+    SimulatedTarget target;
+    target.addRegion(RamBase, RamSize);
+    CHECK(target.setupRtt(ControlBlock, {64}));
+
+    RttReader reader;
+    CHECK(reader.attach(target, ControlBlock));
+
+    // One byte always stays free, 63 fit
+    const std::vector<uint8_t> fill = counting(0, 63);
+    const uint8_t extra[8] = {0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE};
+    CHECK(target.rttWrite(0, fill.data(), 60));
+    CHECK(!target.rttWrite(0, extra, sizeof(extra))); // 3 bytes left, the whole write is dropped
+    CHECK(target.rttWrite(0, fill.data() + 60, 3));
+    CHECK(!target.rttWrite(0, extra, 1));
+
+    std::vector<uint8_t> out;
+    CHECK(reader.drain(0, out));
+    CHECK(out == fill);
+
+    // Drained, the firmware can write again
+    out.clear();
+    CHECK(target.rttWrite(0, extra, sizeof(extra)));
+    CHECK(reader.drain(0, out));
+    CHECK(out == std::vector<uint8_t>(extra, extra + sizeof(extra)));
+}
+
+// ------------------------------
+// Records
+// ------------------------------
+static void testRecords()
+{
+    printf("Records...\n");
+
+    RttRecordDecoder decoder;
+    decoder.reset(2, 5.0);
+    CHECK(decoder.recordSize() == 12);
+
+    // Three records, the last stamp after the 32 bit counter rolled over
+    const uint32_t stamps[3] = {0xFFFFFC18, 0xFFFFFFFF, 0x000003E8};
+    const float values[3][2] = {{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}};
+    std::vector<uint8_t> stream(3 * 12);
+    for (size_t r = 0; r < 3; r++)
+    {
+        RttRecordDecoder::encode(stamps[r], values[r], 2, stream.data() + r * 12);
+    }
+
+    // Records split across feeds
+    std::vector<double> rows;
+    size_t count = decoder.feed(stream.data(), 7, rows);
+    count += decoder.feed(stream.data() + 7, 20, rows);
+    count += decoder.feed(stream.data() + 27, 9, rows);
+    CHECK(count == 3);
+    CHECK(rows.size() == 3 * 3);
+    if (rows.size() == 3 * 3)
+    {
+        CHECK(near(rows[0], 5.0) && rows[1] == 1.0 && rows[2] == 2.0);
+        CHECK(near(rows[3], 5.000999) && rows[4] == 3.0 && rows[5] == 4.0);
+        CHECK(near(rows[6], 5.002) && rows[7] == 5.0 && rows[8] == 6.0);
+    }
+
+    // Through the simulated target and the reader
+    SimulatedTarget target;
+    target.addRegion(RamBase, RamSize);
+    CHECK(target.setupRtt(ControlBlock, {64}));
+    RttReader reader;
+    CHECK(reader.attach(target, ControlBlock));
+
+    decoder.reset(2);
+    rows.clear();
+    std::vector<uint8_t> bytes;
+    for (size_t r = 0; r < 3; r++)
+    {
+        CHECK(target.rttWrite(0, stream.data() + r * 12, 12));
+        bytes.clear();
+        CHECK(reader.drain(0, bytes));
+        decoder.feed(bytes.data(), bytes.size(), rows);
+    }
+    CHECK(rows.size() == 3 * 3 && rows[7] == 5.0);
+}
+
+int main()
+{
+    printf("Testing RttReader...\n");
+
+    testScan();
+    testWrapAround();
+    testFullRing();
+    testRecords();
+
+    printf("%s (%d failed)\n", testFailures == 0 ? "PASSED" : "FAILED", testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
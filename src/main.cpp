@@ -4,10 +4,16 @@
 #include "implot.h"
 
 #include "SessionManager.h"
+#include "recording/RecordingWriter.h"
+#include "recording/RecordingReader.h"
+#include "util/Profiler.h"
 
 #include <vector>
 #include <string>
+#include <map>
+#include <cstring>
 #include <cmath>
+#include <cstdio>
 
 //------------------------------------------------------------------------------
 // Theme Setup
@@ -206,10 +212,23 @@ static void DrawLeftControls(SessionManager& session)
 static void DrawDebugControls(SessionManager& session)
 {
     const bool connected = (session.getConnectionState() == ConnectionState::CONNECTED);
+    const bool flashing = session.isFlashing();
     ImGui::BeginDisabled(!connected);
 
-    if (ImGui::SmallButton("Flash")) session.flashTarget();
+    if (flashing) {
+        // Progress of the current phase, the worker thread updates it
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%s %.0f%%", flashPhaseName(session.getFlashPhase()),
+                 session.getFlashFraction() * 100.0f);
+        ImGui::ProgressBar(session.getFlashFraction(), ImVec2(160.0f, ImGui::GetTextLineHeight()), overlay);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Cancel")) session.cancelFlash();
+    } else {
+        if (ImGui::SmallButton("Flash")) session.flashTarget();
+    }
     ImGui::SameLine();
+
+    ImGui::BeginDisabled(flashing);
     if (ImGui::SmallButton("Reset")) session.resetTarget();
     ImGui::SameLine();
     if (ImGui::SmallButton("Halt"))  session.haltTarget();
@@ -231,6 +250,7 @@ static void DrawDebugControls(SessionManager& session)
     if (ImGui::SmallButton("Step Over")) session.stepOver();
     ImGui::SameLine();
     if (ImGui::SmallButton("Step Out"))  session.stepOut();
+    ImGui::EndDisabled();
 
     ImGui::EndDisabled();
 }
@@ -330,11 +350,64 @@ static void DrawToolbar(SessionManager& session, int rows)
 //------------------------------------------------------------------------------
 // Panels
 //------------------------------------------------------------------------------
-static void DrawSidebar(SessionManager& /*session*/)
+static void DrawWatchTab(SessionManager& session)
 {
+    static char exprBuf[128] = "";
+
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - 45.0f);
+    bool submit = ImGui::InputTextWithHint("##watchExpr", "var.member[2]", exprBuf, sizeof(exprBuf),
+                                           ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    if ((ImGui::SmallButton("Add") || submit) && exprBuf[0] != '\0') {
+        if (session.addWatch(exprBuf)) exprBuf[0] = '\0';
+    }
+
+    const auto& watches = session.getWatches();
+    if (watches.empty()) {
+        ImGui::TextDisabled(session.hasSymbols() ? "No watches yet." : "Load an ELF to add watches.");
+        return;
+    }
+
+    int removeIndex = -1;
+    if (ImGui::BeginTable("##Watches", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupColumn("Expression");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("Type");
+        ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 20.0f);
+        ImGui::TableHeadersRow();
+
+        for (size_t i = 0; i < watches.size(); i++) {
+            const auto& w = watches[i];
+            ImGui::PushID((int)i);
+            ImGui::TableNextRow();
+
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(w.expression.c_str());
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("0x%08X, %u bytes", w.target.addr, w.target.size);
+
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(w.value.c_str());
+
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextDisabled("%s", w.typeName.c_str());
+
+            ImGui::TableSetColumnIndex(3);
+            if (ImGui::SmallButton("x")) removeIndex = (int)i;
+
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+
+    if (removeIndex >= 0) session.removeWatch((size_t)removeIndex);
+}
+
+static void DrawSidebar(SessionManager& session)
+{
+    PROFILE_FUNCTION();
     if (ImGui::BeginTabBar("SidebarTabs")) {
         if (ImGui::BeginTabItem("Breakpoints")) { ImGui::TextDisabled("Coming soon..."); ImGui::EndTabItem(); }
-        if (ImGui::BeginTabItem("Watch"))       { ImGui::TextDisabled("Coming soon..."); ImGui::EndTabItem(); }
+        if (ImGui::BeginTabItem("Watch"))       { DrawWatchTab(session); ImGui::EndTabItem(); }
         if (ImGui::BeginTabItem("Registers"))   { ImGui::TextDisabled("Coming soon..."); ImGui::EndTabItem(); }
         if (ImGui::BeginTabItem("Memory"))      { ImGui::TextDisabled("Coming soon..."); ImGui::EndTabItem(); }
         if (ImGui::BeginTabItem("Peripherals")) { ImGui::TextDisabled("Coming soon..."); ImGui::EndTabItem(); }
@@ -342,41 +415,247 @@ static void DrawSidebar(SessionManager& /*session*/)
     }
 }
 
-static void DrawPlotPanel(SessionManager& /*session*/)
+static void DrawRecordingControls(SessionManager& session)
+{
+    const AppConfig& config = session.getAppConfig();
+
+    static char recPathBuf[256] = "";
+    if (recPathBuf[0] == '\0') snprintf(recPathBuf, sizeof(recPathBuf), "%s", config.recordingPath.c_str());
+
+    if (session.isRecording()) {
+        if (ImGui::SmallButton("Stop rec")) session.stopRecording();
+    } else if (ImGui::SmallButton("Record")) {
+        session.startRecording(std::string(recPathBuf));
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(220);
+    ImGui::InputText("##recpath", recPathBuf, sizeof(recPathBuf));
+
+    ImGui::SameLine();
+    if (session.isReplaying()) {
+        if (ImGui::SmallButton("Close replay")) session.closeReplay();
+    } else if (ImGui::SmallButton("Replay")) {
+        session.openReplay(std::string(recPathBuf));
+    }
+
+    if (const RecordingWriter* rec = session.getRecorder()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("REC %llu samples, %.1f MB", (unsigned long long)rec->rowCount(), rec->byteCount() / (1024.0 * 1024.0));
+    }
+
+    if (const RecordingReader* replay = session.getReplay()) {
+        // Position of the plot window inside the recording, only reloads once the slider is let go
+        static double seekTo = 0.0;
+        static bool seeking = false;
+        const SignalBuffer& buffer = session.getSignalBuffer();
+        if (!seeking && !buffer.empty()) seekTo = buffer.timeAt(0);
+
+        double first = replay->firstTime();
+        double last = replay->lastTime();
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(-1);
+        ImGui::SliderScalar("##seek", ImGuiDataType_Double, &seekTo, &first, &last, "%.2f s");
+        seeking = ImGui::IsItemActive();
+        if (ImGui::IsItemDeactivatedAfterEdit()) session.seekReplay(seekTo);
+    }
+}
+
+static void DrawPlotPanel(SessionManager& session)
 {
-    static std::vector<float> t, a, b, c;
-    if (t.empty()) {
-        t.resize(600); a.resize(600); b.resize(600); c.resize(600);
-        for (int i = 0; i < 600; i++) {
-            float x = i * 0.012f;
-            t[i] = x;
-            a[i] = 0.2f + 0.9f * (1.0f / (1.0f + expf(-(x - 2.5f) * 3.0f))) + 0.02f * sinf(x * 10.0f);
-            b[i] = 0.15f + 1.0f * (1.0f / (1.0f + expf(-(x - 3.0f) * 2.5f))) + 0.03f * sinf(x * 8.0f + 0.5f);
-            c[i] = 1.5f - 0.3f * (1.0f / (1.0f + expf(-(x - 2.0f) * 4.0f))) + 0.2f * (1.0f / (1.0f + expf(-(x - 5.0f) * 2.0f))) + 0.01f * sinf(x * 15.0f);
+    PROFILE_FUNCTION();
+    const SignalBuffer& buffer = session.getSignalBuffer();
+    const auto& signals = session.getPlotSignals();
+    AppConfig& config = session.getAppConfigRef();
+
+    // One reusable output per signal so decimation does not allocate every frame
+    static std::vector<DecimatedSeries> series;
+    static int pointsDrawn = 0;
+    static int lodLevel = 0;
+    if (series.size() < signals.size()) series.resize(signals.size());
+
+    ImGui::AlignTextToFramePadding();
+    ImGui::TextUnformatted("Decimation");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+
+    int modeIndex = (int)config.plotDecimation;
+    const char* modes[] = { "Min/Max", "LTTB" };
+    if (ImGui::Combo("##decimation", &modeIndex, modes, IM_ARRAYSIZE(modes))) {
+        config.plotDecimation = static_cast<DecimationMode>(modeIndex);
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    int sourceIndex = (int)config.plotSource;
+    const char* sources[] = { "Sampled", "RTT", "SWO" };
+    if (ImGui::Combo("##source", &sourceIndex, sources, IM_ARRAYSIZE(sources))) {
+        session.setPlotSource(static_cast<PlotSource>(sourceIndex));
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Sampled: read the signals at the sample rate\n"
+                          "RTT: stream records from SEGGER RTT up buffer %u\n"
+                          "SWO: ITM stimulus port n -> signal n, from %s", config.rttChannel, config.swoInput.c_str());
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(90);
+    double rate = config.sampleRateHz;
+    if (ImGui::InputDouble("Hz##rate", &rate, 0.0, 0.0, "%.0f", ImGuiInputTextFlags_EnterReturnsTrue)) {
+        session.setSampleRate(rate);
+    }
+
+    if (session.isSimulated()) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(90);
+        if (ImGui::BeginCombo("##generator", "+ Signal")) {
+            for (GeneratorKind kind : {GeneratorKind::SINE, GeneratorKind::CHIRP, GeneratorKind::NOISE,
+                                       GeneratorKind::STEP, GeneratorKind::SAWTOOTH, GeneratorKind::BURST}) {
+                if (ImGui::Selectable(generatorKindName(kind))) session.addGeneratorSignal(kind);
+            }
+            ImGui::EndCombo();
         }
     }
 
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d points drawn, %zu samples stored, LOD %d", pointsDrawn, buffer.size(), lodLevel);
+
+    ImGui::SameLine();
+    float rawKB = buffer.rawMemoryBytes() / 1024.0f;
+    float lodKB = buffer.lodMemoryBytes() / 1024.0f;
+    ImGui::TextDisabled("| Memory: %.0f KB raw + %.0f KB pyramid (%.0f%%)", rawKB, lodKB,
+                        rawKB > 0.0f ? 100.0f * lodKB / rawKB : 0.0f);
+
+    DrawRecordingControls(session);
+
     if (ImPlot::BeginPlot("##LiveSignals", ImVec2(-1, -1), ImPlotFlags_Crosshairs)) {
         ImPlot::SetupAxes("Time (s)", "Value");
-        ImPlot::PlotLine("adc_filtered", t.data(), a.data(), (int)t.size());
-        ImPlot::PlotLine("motor_rpm",     t.data(), b.data(), (int)t.size());
-        ImPlot::PlotLine("battery_v",     t.data(), c.data(), (int)t.size());
+
+        // Follow the newest data while the target is running (a replay stays where the user put it)
+        if (session.getTargetState() == TargetState::RUNNING && !session.isReplaying() && !buffer.empty()) {
+            ImPlot::SetupAxisLimits(ImAxis_X1, buffer.timeAt(0), buffer.timeAt(buffer.size() - 1), ImGuiCond_Always);
+        }
+
+        // Only what is visible gets decimated, down to about 2 points per pixel column
+        ImPlotRect limits = ImPlot::GetPlotLimits();
+        int columns = (int)ImPlot::GetPlotSize().x;
+
+        pointsDrawn = 0;
+        lodLevel = 0;
+        for (size_t i = 0; i < signals.size(); i++) {
+            const auto& sig = signals[i];
+            if (!sig.visible) continue;
+
+            int level = decimateSignal(buffer, sig.channel, limits.X.Min, limits.X.Max, columns, config.plotDecimation, series[i]);
+            if (level > lodLevel) lodLevel = level;
+            {
+                PROFILE_SCOPE("PlotLine");
+                ImPlot::PlotLine(sig.name.c_str(), series[i].xs.data(), series[i].ys.data(), series[i].size());
+            }
+            pointsDrawn += series[i].size();
+
+            // Right click on the legend entry: storage type and the raw -> shown conversion
+            if (ImPlot::BeginLegendPopup(sig.name.c_str())) {
+                const ChannelFormat& fmt = buffer.format(sig.channel);
+                double scale = fmt.scale;
+                double offset = fmt.offset;
+                ImGui::TextDisabled("%s, shown = raw * scale + offset", sampleTypeName(fmt.type));
+                ImGui::SetNextItemWidth(120);
+                bool changed = ImGui::InputDouble("Scale", &scale, 0.0, 0.0, "%g");
+                ImGui::SetNextItemWidth(120);
+                changed |= ImGui::InputDouble("Offset", &offset, 0.0, 0.0, "%g");
+                if (changed) session.setSignalScale(i, scale, offset);
+                ImPlot::EndLegendPopup();
+            }
+        }
         ImPlot::EndPlot();
     }
 }
 
+static void DrawConsoleFilters(SessionManager& session, LogView& view)
+{
+    const LogStore& log = session.getLog();
+    LogFilter filter = view.getFilter();
+
+    ImGui::SetNextItemWidth(80);
+    int level = (int)filter.minLevel;
+    const char* levels[] = { "Debug", "Info", "Warn", "Error" };
+    if (ImGui::Combo("##loglevel", &level, levels, IM_ARRAYSIZE(levels))) filter.minLevel = static_cast<LogLevel>(level);
+
+    for (size_t i = 0; i < LogSourceCount; i++) {
+        bool on = (filter.sources >> i) & 1;
+        ImGui::SameLine();
+        if (ImGui::Checkbox(logSourceName(static_cast<LogSource>(i)), &on)) filter.sources ^= 1u << i;
+    }
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(90);
+    if (ImGui::BeginCombo("##logtopics", "Topics")) {
+        for (size_t i = 0; i < LogCategory::count(); i++) {
+            bool on = (filter.categories >> i) & 1;
+            if (ImGui::Checkbox(LogCategory::name((uint16_t)i), &on)) filter.categories ^= 1ull << i;
+        }
+        ImGui::EndCombo();
+    }
+
+    view.setFilter(filter);
+    view.update(log);
+
+    ImGui::SameLine();
+    ImGui::TextDisabled("%zu / %zu lines", view.size(log), log.size());
+    if (log.droppedCount() > 0) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("(%llu dropped)", (unsigned long long)log.droppedCount());
+    }
+
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Clear")) session.clearLog();
+}
+
 static void DrawConsolePanel(SessionManager& session)
 {
-    ImGui::BeginChild("ConsoleLog", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true);
+    PROFILE_FUNCTION();
+    static LogView view;
+    DrawConsoleFilters(session, view);
 
-    const auto& logs = session.getLogMessages();
-    if (logs.empty()) {
+    ImGui::BeginChild("ConsoleLog", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true, ImGuiWindowFlags_HorizontalScrollbar);
+
+    const LogStore& log = session.getLog();
+    if (log.empty()) {
         ImGui::TextDisabled("No logs yet. Click Connect to start.");
     } else {
-        for (const auto& line : logs) {
-            ImGui::TextWrapped("%s", line.c_str());
+        // Only the lines on screen get submitted (and only those get their prefix formatted), so
+        // a million lines cost the same as ten. Lines don't wrap, every row has the same height and
+        // the clipper can skip straight to them.
+        static uint64_t seenLines = 0;
+        const bool atBottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)view.size(log), ImGui::GetTextLineHeightWithSpacing());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const LogRecord r = log.record(view.recordIndex((size_t)row, log));
+
+                char prefix[48];
+                snprintf(prefix, sizeof(prefix), "%9.3f [%s][%s] ", r.timeUs * 1e-6, logSourceName(r.source), logLevelName(r.level));
+
+                ImVec4 color = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+                if (r.level == LogLevel::DEBUG) color = ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled);
+                else if (r.level == LogLevel::WARN) color = ImVec4(1.0f, 0.8f, 0.0f, 1.0f);
+                else if (r.level == LogLevel::ERROR) color = ImVec4(1.0f, 0.3f, 0.3f, 1.0f);
+
+                ImGui::PushStyleColor(ImGuiCol_Text, color);
+                ImGui::TextUnformatted(prefix);
+                ImGui::SameLine(0.0f, 0.0f);
+                ImGui::TextUnformatted(r.text.data(), r.text.data() + r.text.size());
+                ImGui::PopStyleColor();
+            }
         }
-        ImGui::SetScrollHereY(1.0f);
+        clipper.End();
+
+        // Follow new lines, unless the user scrolled up to read something
+        if (log.collectedCount() != seenLines && atBottom) ImGui::SetScrollHereY(1.0f);
+        seenLines = log.collectedCount();
     }
 
     ImGui::EndChild();
@@ -388,6 +667,8 @@ static void DrawConsolePanel(SessionManager& session)
     ImGui::Button("Send");
 }
 
+static bool showProfiler = false;
+
 static void DrawStatusPanel(SessionManager& session)
 {
     const auto& info = session.getTargetInfo();
@@ -396,6 +677,10 @@ static void DrawStatusPanel(SessionManager& session)
     ImGui::Separator();
 
     ImGui::Text("PC:");   ImGui::SameLine(60); ImGui::Text("0x%08X", info.pc);
+    if (const char* func = session.getSymbolAt(info.pc)) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", func);
+    }
     ImGui::Text("SP:");   ImGui::SameLine(60); ImGui::Text("0x%08X", info.sp);
     ImGui::Text("xPSR:"); ImGui::SameLine(60); ImGui::Text("0x%08X", info.xpsr);
 
@@ -412,6 +697,183 @@ static void DrawStatusPanel(SessionManager& session)
     ImGui::Spacing();
     ImGui::Text("Load: %.0f%%", info.cpuLoad * 100.0f);
     ImGui::ProgressBar(info.cpuLoad, ImVec2(-1, 0), "");
+
+    ImGui::Spacing();
+    ImGui::Checkbox("Profiler (F3)", &showProfiler);
+}
+
+//------------------------------------------------------------------------------
+// Profiler
+//------------------------------------------------------------------------------
+
+// Same name, same color, so a scope is easy to follow from frame to frame
+static ImU32 ProfileColor(const char* name)
+{
+    uint32_t h = 2166136261u;
+    for (const char* p = name; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    return ImColor::HSV((float)(h % 360) / 360.0f, 0.55f, 0.75f);
+}
+
+// One lane per thread, nested scopes stacked below their parent
+static void DrawProfilerTimeline(uint64_t viewStart, uint64_t viewEnd)
+{
+    const auto& events = Profiler::history();
+    const size_t threads = Profiler::threadCount();
+
+    static std::vector<int> laneDepth;
+    laneDepth.assign(threads, 0);
+    for (const ProfileEvent& e : events) {
+        if (e.endNs < viewStart || e.startNs > viewEnd || e.thread >= threads) continue;
+        if (e.depth + 1 > laneDepth[e.thread]) laneDepth[e.thread] = e.depth + 1;
+    }
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float labelWidth = 110.0f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = ImGui::GetContentRegionAvail().x - labelWidth;
+    if (width <= 0.0f) return;
+
+    const double pxPerNs = width / (double)(viewEnd - viewStart);
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    const ImVec2 mouse = ImGui::GetMousePos();
+
+    float y = origin.y;
+    for (size_t t = 0; t < threads; t++) {
+        if (laneDepth[t] == 0) continue;
+        const float laneHeight = rowHeight * laneDepth[t];
+
+        dl->AddText(ImVec2(origin.x, y + 2.0f), ImGui::GetColorU32(ImGuiCol_TextDisabled), Profiler::threadName((uint16_t)t).c_str());
+        dl->AddLine(ImVec2(origin.x, y + laneHeight), ImVec2(origin.x + labelWidth + width, y + laneHeight),
+                    ImGui::GetColorU32(ImGuiCol_Separator));
+
+        const float x0 = origin.x + labelWidth;
+        dl->PushClipRect(ImVec2(x0, y), ImVec2(x0 + width, y + laneHeight), true);
+        for (const ProfileEvent& e : events) {
+            if (e.thread != t || e.endNs < viewStart || e.startNs > viewEnd) continue;
+
+            float a = x0 + (float)((double)((int64_t)e.startNs - (int64_t)viewStart) * pxPerNs);
+            float b = x0 + (float)((double)((int64_t)e.endNs - (int64_t)viewStart) * pxPerNs);
+            if (b - a < 1.0f) b = a + 1.0f;
+            const float top = y + rowHeight * e.depth;
+            const ImVec2 pMin(a, top + 1.0f), pMax(b, top + rowHeight - 1.0f);
+
+            dl->AddRectFilled(pMin, pMax, ProfileColor(e.name));
+            if (b - a > ImGui::CalcTextSize(e.name).x + 6.0f) {
+                dl->AddText(ImVec2(a + 3.0f, top + 2.0f), IM_COL32(20, 20, 25, 255), e.name);
+            }
+
+            if (ImGui::IsWindowHovered() && mouse.x >= pMin.x && mouse.x < pMax.x && mouse.y >= pMin.y && mouse.y < pMax.y) {
+                ImGui::SetTooltip("%s\n%.3f ms", e.name, (e.endNs - e.startNs) / 1e6);
+            }
+        }
+        dl->PopClipRect();
+
+        y += laneHeight;
+    }
+
+    ImGui::Dummy(ImVec2(labelWidth + width, y - origin.y));
+}
+
+static void DrawProfilerWindow(SessionManager& session)
+{
+    PROFILE_FUNCTION();
+
+    ImGui::SetNextWindowSize(ImVec2(900, 420), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", &showProfiler)) {
+        ImGui::End();
+        return;
+    }
+
+    const auto& events = Profiler::history();
+
+    // Unchecking capture also freezes what is shown, nothing new comes in to push it out
+    bool capture = Profiler::isEnabled();
+    if (ImGui::Checkbox("Capture", &capture)) Profiler::setEnabled(capture);
+    ImGui::SameLine();
+    static int framesShown = 3;
+    ImGui::SetNextItemWidth(120);
+    ImGui::SliderInt("Frames", &framesShown, 1, 30);
+    ImGui::SameLine();
+    if (ImGui::Button("Save trace")) {
+        std::string err;
+        if (Profiler::exportChromeTrace("profile.json", err)) {
+            session.Log(LogSource::APP, LogLevel::INFO, "Profile saved to profile.json (%zu events)", events.size());
+        } else {
+            session.Log(LogSource::APP, LogLevel::ERROR, "Profile save failed: %s", err.c_str());
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) Profiler::clear();
+
+    // Frames give the time window: the last few of them, side by side
+    static std::vector<const ProfileEvent*> frames;
+    frames.clear();
+    double frameSum = 0.0, frameMax = 0.0;
+    for (const ProfileEvent& e : events) {
+        if (e.depth != 0 || strcmp(e.name, "Frame") != 0) continue;
+        frames.push_back(&e);
+        double ms = (e.endNs - e.startNs) / 1e6;
+        frameSum += ms;
+        if (ms > frameMax) frameMax = ms;
+    }
+
+    ImGui::SameLine();
+    if (!frames.empty()) {
+        ImGui::TextDisabled("Frame %.2f ms avg, %.2f ms max (%zu frames) | %zu events, %llu dropped",
+                            frameSum / frames.size(), frameMax, frames.size(), events.size(),
+                            (unsigned long long)Profiler::droppedCount());
+    } else {
+        ImGui::TextDisabled("%s", capture ? "Waiting for frames..." : "Check Capture to start recording");
+    }
+
+    if (frames.empty()) {
+        ImGui::End();
+        return;
+    }
+
+    size_t first = frames.size() > (size_t)framesShown ? frames.size() - framesShown : 0;
+    uint64_t viewStart = frames[first]->startNs;
+    uint64_t viewEnd = frames.back()->endNs;
+
+    ImGui::BeginChild("##ProfilerTimeline", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.5f), true);
+    DrawProfilerTimeline(viewStart, viewEnd);
+    ImGui::EndChild();
+
+    // Whole history per scope and thread
+    struct ScopeStats { uint64_t calls = 0; uint64_t totalNs = 0; uint64_t maxNs = 0; };
+    std::map<std::pair<std::string, uint16_t>, ScopeStats> stats;
+    for (const ProfileEvent& e : events) {
+        ScopeStats& st = stats[{e.name, e.thread}];
+        uint64_t ns = e.endNs - e.startNs;
+        st.calls++;
+        st.totalNs += ns;
+        if (ns > st.maxNs) st.maxNs = ns;
+    }
+
+    if (ImGui::BeginTable("##ProfilerStats", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV |
+                          ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Thread");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableSetupColumn("Total ms");
+        ImGui::TableHeadersRow();
+
+        for (const auto& [key, st] : stats) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(key.first.c_str());
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(Profiler::threadName(key.second).c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)st.calls);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", st.totalNs / 1e6 / st.calls);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", st.maxNs / 1e6);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", st.totalNs / 1e6);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
 }
 
 //------------------------------------------------------------------------------
@@ -436,8 +898,16 @@ int main()
     const float statusPanelWidth = 220.0f;
     const float consoleHeight = 200.0f;
 
+    Profiler::setThreadName("main");
+
     while (!WindowShouldClose())
     {
+        // Last frame's events (all threads) into the profiler history
+        Profiler::collect();
+        PROFILE_SCOPE("Frame");
+
+        if (IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+
         float dt = GetFrameTime();
         session.update(dt);
 
@@ -511,8 +981,17 @@ int main()
         DrawConsolePanel(session);
         ImGui::End();
 
-        rlImGuiEnd();
-        EndDrawing();
+        if (showProfiler) DrawProfilerWindow(session);
+
+        {
+            PROFILE_SCOPE("rlImGuiEnd");
+            rlImGuiEnd();
+        }
+        {
+            // Includes the wait for the next frame (SetTargetFPS)
+            PROFILE_SCOPE("EndDrawing");
+            EndDrawing();
+        }
     }
 
     session.shutdown();
@@ -0,0 +1,319 @@
+/* =============== Decimator.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Plot Decimation
+
+    Description:
+        Min/max envelope and LTTB decimation over a SignalBuffer range.
+        Zoomed out views read LodPyramid blocks instead of raw samples.
+*/
+
+#include "Decimator.h"
+#include "SignalBuffer.h"
+#include "util/Profiler.h"
+
+#include <cmath> // fabs
+
+// A raw sample or a LodBlock, in double so a u32 counter keeps its low bits when zoomed in
+struct RangeItem
+{
+    double minT = 0.0;
+    double minV = 0.0;
+    double maxT = 0.0;
+    double maxV = 0.0;
+    double mean = 0.0;
+};
+
+// Copies samples [first, last) as they are
+static void copyRaw(const SignalBuffer& buffer, size_t channel, size_t first, size_t last, DecimatedSeries& out)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        out.xs.push_back(buffer.timeAt(i));
+        out.ys.push_back(buffer.rawAt(channel, i));
+    }
+}
+
+/*
+    Min/max per pixel column over items [first, last). getItem(i, item) fills a RangeItem,
+    for a raw sample that is just min == max == the sample.
+*/
+template <typename GetItem>
+static void decimateMinMax(size_t first, size_t last, double xMin, double xMax, int columns,
+                           GetItem getItem, DecimatedSeries& out)
+{
+    const double scale = (double)columns / (xMax - xMin);
+
+    int curCol = -1;
+    RangeItem col;
+    bool haveValue = false;
+
+    auto flush = [&]()
+    {
+        if (!haveValue) return;
+
+        // Keep time order so the line does not zig zag backwards
+        bool minFirst = col.minT <= col.maxT;
+        out.xs.push_back(minFirst ? col.minT : col.maxT);
+        out.ys.push_back(minFirst ? col.minV : col.maxV);
+        if (col.minT != col.maxT || col.minV != col.maxV)
+        {
+            out.xs.push_back(minFirst ? col.maxT : col.minT);
+            out.ys.push_back(minFirst ? col.maxV : col.minV);
+        }
+        haveValue = false;
+    };
+
+    RangeItem item;
+    for (size_t i = first; i < last; i++)
+    {
+        if (!getItem(i, item)) continue;
+
+        int c = (int)((item.minT - xMin) * scale);
+        if (c < 0) c = 0;
+        if (c >= columns) c = columns - 1;
+
+        if (c != curCol)
+        {
+            flush();
+            curCol = c;
+        }
+
+        if (item.mean != item.mean) continue; // NaN, nothing to compare
+
+        if (!haveValue)
+        {
+            col = item;
+            haveValue = true;
+            continue;
+        }
+
+        if (item.minV < col.minV)
+        {
+            col.minV = item.minV;
+            col.minT = item.minT;
+        }
+        if (item.maxV > col.maxV)
+        {
+            col.maxV = item.maxV;
+            col.maxT = item.maxT;
+        }
+    }
+    flush();
+}
+
+/*
+    Largest Triangle Three Buckets over points [first, last). getPoint(i, x, y) returns false
+    for points that do not exist (overwritten LOD blocks), those are skipped.
+*/
+template <typename GetPoint>
+static void decimateLttb(size_t first, size_t last, int threshold, GetPoint getPoint, DecimatedSeries& out)
+{
+    const size_t n = last - first;
+    double x = 0.0, y = 0.0;
+
+    // First point always stays
+    if (getPoint(first, x, y))
+    {
+        out.xs.push_back(x);
+        out.ys.push_back(y);
+    }
+
+    // threshold - 2 buckets between the fixed first and last points
+    const double bucketSize = (double)(n - 2) / (double)(threshold - 2);
+    double ax = x, ay = y;
+
+    for (int b = 0; b < threshold - 2; b++)
+    {
+        // Average of the next bucket is the third corner of the triangle
+        size_t nextStart = first + 1 + (size_t)((b + 1) * bucketSize);
+        size_t nextEnd = first + 1 + (size_t)((b + 2) * bucketSize);
+        if (nextEnd > last) nextEnd = last;
+        if (nextStart >= nextEnd) nextStart = nextEnd - 1;
+
+        double avgX = 0.0, avgY = 0.0;
+        int avgCount = 0;
+        for (size_t i = nextStart; i < nextEnd; i++)
+        {
+            if (!getPoint(i, x, y) || y != y) continue;
+            avgX += x;
+            avgY += y;
+            avgCount++;
+        }
+        if (avgCount > 0)
+        {
+            avgX /= avgCount;
+            avgY /= avgCount;
+        }
+
+        // Pick the point in this bucket with the biggest triangle
+        size_t start = first + 1 + (size_t)(b * bucketSize);
+        size_t end = first + 1 + (size_t)((b + 1) * bucketSize);
+        if (end > last - 1) end = last - 1;
+
+        double bestArea = -1.0;
+        double bestX = 0.0, bestY = 0.0;
+        for (size_t i = start; i < end; i++)
+        {
+            if (!getPoint(i, x, y) || y != y) continue;
+
+            double area = std::fabs((ax - avgX) * (y - ay) - (ax - x) * (avgY - ay));
+            if (area > bestArea)
+            {
+                bestArea = area;
+                bestX = x;
+                bestY = y;
+            }
+        }
+
+        if (bestArea >= 0.0)
+        {
+            out.xs.push_back(bestX);
+            out.ys.push_back(bestY);
+            ax = bestX;
+            ay = bestY;
+        }
+    }
+
+    // Last point always stays
+    if (getPoint(last - 1, x, y))
+    {
+        out.xs.push_back(x);
+        out.ys.push_back(y);
+    }
+}
+
+// Raw to shown values, only over what is about to be drawn
+static void applyScale(const SignalBuffer& buffer, size_t channel, DecimatedSeries& out)
+{
+    const ChannelFormat& f = buffer.format(channel);
+    if (f.scale == 1.0 && f.offset == 0.0)
+    {
+        return;
+    }
+    for (double& y : out.ys)
+    {
+        y = y * f.scale + f.offset;
+    }
+}
+
+static int decimateRaw(const SignalBuffer& buffer, size_t channel, double xMin, double xMax, int columns,
+                       DecimationMode mode, DecimatedSeries& out)
+{
+    out.clear();
+
+    if (buffer.empty() || channel >= buffer.channelCount() || !(xMax > xMin))
+    {
+        return 0;
+    }
+    if (columns < 1) columns = 1;
+
+    // Visible range, plus one neighbour on each side
+    size_t first = buffer.lowerBound(xMin);
+    size_t last = buffer.lowerBound(xMax);
+    if (first > 0) first--;
+    if (last < buffer.size()) last++;
+
+    const size_t n = last - first;
+    const size_t budget = (size_t)columns * 2;
+
+    if (n <= budget)
+    {
+        copyRaw(buffer, channel, first, last, out);
+        return 0;
+    }
+
+    out.xs.reserve(budget + 2);
+    out.ys.reserve(budget + 2);
+
+    // Zoomed out far enough? Use the coarsest-but-still-detailed pyramid level, so the work
+    // stays around a few blocks per column no matter how many samples are in range.
+    const LodPyramid& lod = buffer.lod(channel);
+    size_t level = 0;
+    for (size_t l = 1; l <= lod.levelCount(); l++)
+    {
+        if ((n >> lod.levelShift(l)) < budget) break;
+        level = l;
+    }
+
+    // The edge neighbours sit outside the columns, keep them as they are
+    copyRaw(buffer, channel, first, first + 1, out);
+
+    if (level == 0)
+    {
+        if (mode == DecimationMode::LTTB)
+        {
+            auto getPoint = [&](size_t i, double& x, double& y)
+            {
+                x = buffer.timeAt(i);
+                y = buffer.rawAt(channel, i);
+                return true;
+            };
+            decimateLttb(first + 1, last - 1, (int)budget, getPoint, out);
+        }
+        else
+        {
+            auto getItem = [&](size_t i, RangeItem& item)
+            {
+                item.minT = item.maxT = buffer.timeAt(i);
+                item.minV = item.maxV = item.mean = buffer.rawAt(channel, i);
+                return true;
+            };
+            decimateMinMax(first + 1, last - 1, xMin, xMax, columns, getItem, out);
+        }
+    }
+    else
+    {
+        // Work in block numbers of the chosen level
+        const unsigned shift = lod.levelShift(level);
+        const uint64_t b0 = buffer.absoluteIndex(first + 1) >> shift;
+        const uint64_t b1 = (buffer.absoluteIndex(last - 2) >> shift) + 1;
+
+        if (mode == DecimationMode::LTTB)
+        {
+            // A block is drawn as its mean, halfway between where its min and max happened
+            auto getPoint = [&](size_t b, double& x, double& y)
+            {
+                LodBlock blk;
+                if (!lod.block(level, b, blk)) return false;
+                x = 0.5 * (blk.minT + blk.maxT);
+                y = blk.mean;
+                return true;
+            };
+            if (b1 - b0 > 2)
+            {
+                decimateLttb((size_t)b0, (size_t)b1, (int)budget, getPoint, out);
+            }
+        }
+        else
+        {
+            auto getItem = [&](size_t b, RangeItem& item)
+            {
+                LodBlock blk;
+                if (!lod.block(level, b, blk)) return false;
+                item.minT = blk.minT;
+                item.maxT = blk.maxT;
+                item.minV = blk.minV;
+                item.maxV = blk.maxV;
+                item.mean = blk.mean;
+                return true;
+            };
+            decimateMinMax((size_t)b0, (size_t)b1, xMin, xMax, columns, getItem, out);
+        }
+    }
+
+    copyRaw(buffer, channel, last - 1, last, out);
+    return (int)level;
+}
+
+int decimateSignal(const SignalBuffer& buffer, size_t channel, double xMin, double xMax, int columns,
+                   DecimationMode mode, DecimatedSeries& out)
+{
+    PROFILE_SCOPE("decimate");
+
+    int level = decimateRaw(buffer, channel, xMin, xMax, columns, mode, out);
+    if (!out.ys.empty())
+    {
+        applyScale(buffer, channel, out);
+    }
+    return level;
+}
@@ -0,0 +1,54 @@
+/* =============== Decimator.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Plot Decimation
+
+    Description:
+        Shrinks the visible part of a signal down to roughly one or two points
+        per pixel column before it goes to ImPlot. Draw cost then depends on
+        the plot width, not on how many samples we recorded.
+*/
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <cstddef> // For size_t
+#include <vector>
+
+class SignalBuffer;
+
+/**
+  * @brief How a signal gets reduced for drawing
+
+  - MINMAX: for every pixel column keep the lowest and highest sample (in time order).
+            A single sample spike always survives, this is the default for a reason.
+  - LTTB: Largest Triangle Three Buckets. Looks smoother, but a spike can lose against
+          a bigger neighbour in the same bucket.
+*/
+enum class DecimationMode {MINMAX, LTTB};
+
+// Output of a decimation pass, reused frame to frame so it does not reallocate.
+// ys are already scaled (raw * scale + offset), ready to draw.
+struct DecimatedSeries
+{
+    std::vector<double> xs;
+    std::vector<double> ys;
+
+    int size() const {return (int)this->xs.size();}
+    void clear() {this->xs.clear(); this->ys.clear();}
+};
+
+/**
+  * @brief Decimates one channel of a SignalBuffer for the time range [xMin, xMax]
+
+  One sample on each side of the range is kept so the line runs off the plot edge instead
+  of stopping short. If the range already has few enough samples they are copied as is.
+  When the range holds many more samples than columns, the channel's LodPyramid is used
+  instead of the raw samples, so the cost stays bounded by the plot width.
+  Decimation runs on raw values; min/max and the LTTB triangle choice don't change under
+  y * scale + offset, so only the points that come out get converted.
+  columns is the plot width in pixels. Returns the LOD level used (0 = raw samples).
+*/
+int decimateSignal(const SignalBuffer& buffer, size_t channel, double xMin, double xMax, int columns,
+                   DecimationMode mode, DecimatedSeries& out);
+
+#endif // DECIMATOR_H
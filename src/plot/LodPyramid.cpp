@@ -0,0 +1,175 @@
+/* =============== LodPyramid.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Plot LOD Pyramid
+
+    Description:
+        Every raw sample goes into the level 1 block in progress. When a block
+        fills up it is stored and fed into the level above, so the work per
+        sample is 1 + 1/8 + 1/64 + ... block updates.
+*/
+
+#include "LodPyramid.h"
+
+#include <cmath> // NAN
+
+LodPyramid::LodPyramid(size_t rawCapacity)
+{
+    this->reset(rawCapacity);
+}
+
+void LodPyramid::reset(size_t rawCapacity, uint64_t startSample)
+{
+    this->levels.clear();
+    this->pushed = startSample;
+
+    // Blocks from before this pyramid existed read back as gaps
+    LodBlock empty;
+    empty.minV = empty.maxV = empty.mean = NAN;
+
+    unsigned shift = FactorShift;
+    while ((rawCapacity >> shift) >= MinBlocks)
+    {
+        Level level;
+        level.shift = shift;
+        level.blocks.assign(rawCapacity >> shift, empty);
+        level.mask = level.blocks.size() - 1; // rawCapacity is a power of two, so this is too
+
+        // Children of the current block that already went by
+        level.partialInputs = (uint32_t)((startSample >> (shift - FactorShift)) & ((1u << FactorShift) - 1));
+        this->levels.push_back(level);
+
+        shift += FactorShift;
+    }
+}
+
+void LodPyramid::clear()
+{
+    this->pushed = 0;
+    for (auto& level : this->levels)
+    {
+        level.partialInputs = 0;
+        level.partialValid = 0;
+        level.partialSum = 0.0;
+    }
+}
+
+void LodPyramid::accumulate(Level& level, const LodBlock& in)
+{
+    level.partialInputs++;
+
+    if (in.mean != in.mean) // NaN, nothing to merge
+    {
+        return;
+    }
+
+    if (level.partialValid == 0)
+    {
+        level.partial = in;
+        level.partialSum = in.mean;
+        level.partialValid = 1;
+        return;
+    }
+
+    if (in.minV < level.partial.minV)
+    {
+        level.partial.minV = in.minV;
+        level.partial.minT = in.minT;
+    }
+    if (in.maxV > level.partial.maxV)
+    {
+        level.partial.maxV = in.maxV;
+        level.partial.maxT = in.maxT;
+    }
+
+    level.partialSum += in.mean;
+    level.partialValid++;
+    level.partial.mean = level.partialSum / (double)level.partialValid;
+}
+
+void LodPyramid::completeBlock(size_t levelIndex)
+{
+    Level& level = this->levels[levelIndex];
+
+    LodBlock done = level.partial;
+    if (level.partialValid == 0)
+    {
+        done.minV = done.maxV = done.mean = NAN;
+    }
+
+    uint64_t b = (this->pushed >> level.shift) - 1;
+    level.blocks[b & level.mask] = done;
+
+    level.partialInputs = 0;
+    level.partialValid = 0;
+    level.partialSum = 0.0;
+
+    // Completed blocks are the inputs of the next level up
+    if (levelIndex + 1 < this->levels.size())
+    {
+        Level& up = this->levels[levelIndex + 1];
+        accumulate(up, done);
+
+        if (up.partialInputs == (1u << FactorShift))
+        {
+            this->completeBlock(levelIndex + 1);
+        }
+    }
+}
+
+void LodPyramid::push(double t, double v)
+{
+    if (this->levels.empty())
+    {
+        this->pushed++;
+        return;
+    }
+
+    LodBlock sample;
+    sample.minT = sample.maxT = t;
+    sample.minV = sample.maxV = sample.mean = v;
+
+    accumulate(this->levels[0], sample);
+    this->pushed++;
+
+    if (this->levels[0].partialInputs == (1u << FactorShift))
+    {
+        this->completeBlock(0);
+    }
+}
+
+bool LodPyramid::block(size_t level, uint64_t b, LodBlock& out) const
+{
+    if (level == 0 || level > this->levels.size())
+    {
+        return false;
+    }
+
+    const Level& lv = this->levels[level - 1];
+    const uint64_t completed = this->pushed >> lv.shift;
+
+    if (b == completed)
+    {
+        // Block still filling up
+        if (lv.partialValid == 0) return false;
+        out = lv.partial;
+        return true;
+    }
+
+    if (b > completed || b + lv.blocks.size() < completed)
+    {
+        return false;
+    }
+
+    out = lv.blocks[b & lv.mask];
+    return true;
+}
+
+size_t LodPyramid::memoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& level : this->levels)
+    {
+        bytes += level.blocks.size() * sizeof(LodBlock) + sizeof(Level);
+    }
+    return bytes;
+}
@@ -0,0 +1,88 @@
+/* =============== LodPyramid.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Plot LOD Pyramid
+
+    Description:
+        Mipmap style summary of one signal. Level 1 blocks cover 8 samples,
+        level 2 blocks cover 64, and so on. It is updated as samples come in,
+        so a zoomed out plot can be drawn from a few hundred blocks instead of
+        walking every raw sample.
+*/
+
+#ifndef LODPYRAMID_H
+#define LODPYRAMID_H
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+#include <vector>
+
+// Summary of a run of samples. min/max keep the time they happened so a plot can put them in order.
+// Values are raw channel values (before scale/offset), so changing the scale never invalidates a block.
+// They are doubles like the decimator's, a u32 counter or an f64 channel must not show float steps zoomed out.
+struct LodBlock
+{
+    double minT = 0.0;
+    double maxT = 0.0;
+    double minV = 0.0;
+    double maxV = 0.0;
+    double mean = 0.0;
+};
+
+/**
+  * @brief Incremental min/max/mean pyramid over a ring buffer channel
+
+  Blocks are aligned to absolute sample numbers: block b of level L covers samples
+  [b * 8^L, (b + 1) * 8^L). Every level is its own ring sized so it spans the same history
+  as the raw ring (rawCapacity / 8^L blocks), which keeps the memory cost around 1/7 of the
+  raw column per stored field.
+  The block still being filled is readable too, so the newest samples show up right away.
+*/
+class LodPyramid
+{
+    public:
+
+        static constexpr int FactorShift = 3; // 8 children per block
+        static constexpr size_t MinBlocks = 16; // Levels smaller than this are not worth keeping
+
+    private:
+
+        struct Level
+        {
+            std::vector<LodBlock> blocks; // Ring of completed blocks
+            size_t mask = 0;
+            unsigned shift = 0; // log2 of samples per block
+
+            // Block being filled right now
+            LodBlock partial;
+            double partialSum = 0.0;
+            uint32_t partialValid = 0;  // Inputs that were not NaN
+            uint32_t partialInputs = 0; // Inputs fed so far (children or samples)
+        };
+
+        std::vector<Level> levels; // levels[0] is level 1 (8 samples per block)
+        uint64_t pushed = 0;       // Raw samples seen
+
+        static void accumulate(Level& level, const LodBlock& in);
+        void completeBlock(size_t levelIndex);
+
+    public:
+
+        explicit LodPyramid(size_t rawCapacity = 0);
+
+        // startSample lines the blocks up with a buffer that already has history (new channel)
+        void reset(size_t rawCapacity, uint64_t startSample = 0);
+        void clear();
+
+        void push(double t, double v);
+
+        // Levels counted from 1, level 0 means raw samples (not stored here)
+        size_t levelCount() const {return this->levels.size();}
+        unsigned levelShift(size_t level) const {return this->levels[level - 1].shift;}
+
+        // Fetches block b of a level (absolute block number). False if it was overwritten or does not exist yet.
+        bool block(size_t level, uint64_t b, LodBlock& out) const;
+
+        size_t memoryBytes() const;
+};
+
+#endif // LODPYRAMID_H
@@ -0,0 +1,277 @@
+/* =============== SignalBuffer.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Signal Buffer
+
+    Description:
+        Ring buffer implementation. Nothing in here ever shifts data around,
+        the head index just walks forward and wraps with the mask.
+*/
+
+#include "SignalBuffer.h"
+
+#include <cmath> // NAN, floor
+#include <cstring> // memcpy
+
+size_t sampleTypeSize(SampleType type)
+{
+    switch (type)
+    {
+        case SampleType::U8:  return 1;
+        case SampleType::I16: return 2;
+        case SampleType::U32: return 4;
+        case SampleType::F32: return 4;
+        case SampleType::F64: return 8;
+    }
+    return 4;
+}
+
+const char* sampleTypeName(SampleType type)
+{
+    switch (type)
+    {
+        case SampleType::U8:  return "u8";
+        case SampleType::I16: return "i16";
+        case SampleType::U32: return "u32";
+        case SampleType::F32: return "f32";
+        case SampleType::F64: return "f64";
+    }
+    return "?";
+}
+
+// Round to the nearest integer in [lo, hi], NaN becomes 0
+static double saturate(double v, double lo, double hi)
+{
+    if (!(v == v)) return 0.0;
+    v = std::floor(v + 0.5);
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+double toSampleType(SampleType type, double v)
+{
+    switch (type)
+    {
+        case SampleType::U8:  return saturate(v, 0.0, 255.0);
+        case SampleType::I16: return saturate(v, -32768.0, 32767.0);
+        case SampleType::U32: return saturate(v, 0.0, 4294967295.0);
+        case SampleType::F32: return (float)v;
+        case SampleType::F64: return v;
+    }
+    return v;
+}
+
+SignalBuffer::SignalBuffer(size_t capacity, size_t channelCount)
+{
+    this->reset(capacity, channelCount);
+}
+
+size_t SignalBuffer::roundUpPow2(size_t v)
+{
+    size_t p = 1;
+    while (p < v)
+    {
+        p <<= 1;
+    }
+    return p;
+}
+
+void SignalBuffer::allocate(Channel& ch, bool gaps)
+{
+    const size_t width = sampleTypeSize(ch.format.type);
+    ch.bytes.assign(this->cap * width, 0);
+
+    if (!gaps)
+    {
+        return;
+    }
+
+    // Float channels can show missing history as a gap (ImPlot skips NaN)
+    for (size_t i = 0; i < this->cap; i++)
+    {
+        store(ch, i, NAN);
+    }
+}
+
+void SignalBuffer::reset(size_t capacity, size_t channelCount)
+{
+    // Need at least 2 so a line has something to draw
+    if (capacity < 2) capacity = 2;
+
+    this->cap = roundUpPow2(capacity);
+    this->mask = this->cap - 1;
+
+    this->times.assign(this->cap, 0.0);
+    this->channels.resize(channelCount);
+    for (auto& ch : this->channels)
+    {
+        this->allocate(ch, false);
+    }
+    this->pyramids.assign(channelCount, LodPyramid(this->cap));
+
+    this->head = 0;
+    this->count = 0;
+    this->pushed = 0;
+}
+
+void SignalBuffer::clear()
+{
+    this->head = 0;
+    this->count = 0;
+    this->pushed = 0;
+
+    for (auto& lod : this->pyramids)
+    {
+        lod.clear();
+    }
+}
+
+size_t SignalBuffer::addChannel(const ChannelFormat& format)
+{
+    // Samples that already exist have no value for this channel
+    Channel ch;
+    ch.format = format;
+    this->allocate(ch, true);
+    this->channels.push_back(std::move(ch));
+
+    this->pyramids.emplace_back();
+    this->pyramids.back().reset(this->cap, this->pushed);
+    return this->channels.size() - 1;
+}
+
+void SignalBuffer::setScale(size_t channel, double scale, double offset)
+{
+    this->channels[channel].format.scale = scale;
+    this->channels[channel].format.offset = offset;
+}
+
+void SignalBuffer::store(Channel& ch, size_t slot, double raw)
+{
+    switch (ch.format.type)
+    {
+        case SampleType::U8:
+            ch.bytes[slot] = (uint8_t)saturate(raw, 0.0, 255.0);
+            break;
+        case SampleType::I16:
+        {
+            int16_t v = (int16_t)saturate(raw, -32768.0, 32767.0);
+            memcpy(&ch.bytes[slot * 2], &v, 2);
+            break;
+        }
+        case SampleType::U32:
+        {
+            uint32_t v = (uint32_t)saturate(raw, 0.0, 4294967295.0);
+            memcpy(&ch.bytes[slot * 4], &v, 4);
+            break;
+        }
+        case SampleType::F32:
+        {
+            float v = (float)raw;
+            memcpy(&ch.bytes[slot * 4], &v, 4);
+            break;
+        }
+        case SampleType::F64:
+            memcpy(&ch.bytes[slot * 8], &raw, 8);
+            break;
+    }
+}
+
+double SignalBuffer::load(const Channel& ch, size_t slot)
+{
+    switch (ch.format.type)
+    {
+        case SampleType::U8:
+            return ch.bytes[slot];
+        case SampleType::I16:
+        {
+            int16_t v;
+            memcpy(&v, &ch.bytes[slot * 2], 2);
+            return v;
+        }
+        case SampleType::U32:
+        {
+            uint32_t v;
+            memcpy(&v, &ch.bytes[slot * 4], 4);
+            return v;
+        }
+        case SampleType::F32:
+        {
+            float v;
+            memcpy(&v, &ch.bytes[slot * 4], 4);
+            return v;
+        }
+        case SampleType::F64:
+        {
+            double v;
+            memcpy(&v, &ch.bytes[slot * 8], 8);
+            return v;
+        }
+    }
+    return 0.0;
+}
+
+void SignalBuffer::push(double t, const double* values)
+{
+    size_t slot;
+
+    if (this->count < this->cap)
+    {
+        slot = (this->head + this->count) & this->mask;
+        this->count++;
+    }
+    else
+    {
+        // Full, overwrite the oldest sample and move the head forward
+        slot = this->head;
+        this->head = (this->head + 1) & this->mask;
+    }
+
+    this->times[slot] = t;
+    for (size_t c = 0; c < this->channels.size(); c++)
+    {
+        store(this->channels[c], slot, values[c]);
+        // The pyramid sees what was stored, so it agrees with the raw column
+        this->pyramids[c].push(t, load(this->channels[c], slot));
+    }
+
+    this->pushed++;
+}
+
+size_t SignalBuffer::lowerBound(double t) const
+{
+    size_t lo = 0;
+    size_t hi = this->count;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (this->timeAt(mid) < t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+size_t SignalBuffer::rawMemoryBytes() const
+{
+    size_t bytes = this->times.size() * sizeof(double);
+    for (const auto& ch : this->channels)
+    {
+        bytes += ch.bytes.size();
+    }
+    return bytes;
+}
+
+size_t SignalBuffer::lodMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& lod : this->pyramids)
+    {
+        bytes += lod.memoryBytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,128 @@
+/* =============== SignalBuffer.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Signal Buffer
+
+    Description:
+        Fixed capacity ring buffer for the live plot. One shared time column
+        plus one value column per signal. The capacity is always a power of two
+        so wrapping is just a mask, and appending / trimming are O(1).
+
+        Time is a double, a float runs out of resolution after a few hours
+        (at t = 2^14 s one step is already ~2 ms). Each channel is stored in
+        its native type (a u8 flag costs 1 byte per sample, a u32 counter keeps
+        every bit) with a scale/offset that is only applied to the points that
+        actually get drawn.
+*/
+
+#ifndef SIGNALBUFFER_H
+#define SIGNALBUFFER_H
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+#include <vector>
+
+#include "LodPyramid.h"
+
+// Storage type of a channel (what the target variable is)
+enum class SampleType : uint8_t {U8, I16, U32, F32, F64};
+
+size_t sampleTypeSize(SampleType type);
+const char* sampleTypeName(SampleType type);
+
+// What v turns into when stored as type (integers round and saturate, NaN becomes 0)
+double toSampleType(SampleType type, double v);
+
+/**
+  * @brief How a channel is stored and shown
+
+  Pushed values are raw (the number the target had), the plot shows raw * scale + offset.
+  Changing scale/offset is free, nothing stored has to be converted.
+*/
+struct ChannelFormat
+{
+    SampleType type = SampleType::F32;
+    double scale = 1.0;
+    double offset = 0.0;
+};
+
+/**
+  * @brief Multi channel ring buffer with a shared time column
+
+  Once the buffer is full every push() overwrites the oldest sample, so trimming the
+  history is free. Logical index 0 is always the oldest sample still in the buffer,
+  size() - 1 the newest.
+  Integer channels have no NaN, samples from before an integer channel was added read as 0.
+*/
+class SignalBuffer
+{
+    private:
+
+        struct Channel
+        {
+            ChannelFormat format;
+            std::vector<uint8_t> bytes; // cap * sampleTypeSize(format.type)
+        };
+
+        std::vector<double> times;        // Shared time column (capacity entries)
+        std::vector<Channel> channels;    // One value column per signal
+        std::vector<LodPyramid> pyramids; // Zoomed out summary of each channel (raw values)
+
+        size_t cap = 0;   // Always a power of two
+        size_t mask = 0;  // cap - 1
+        size_t head = 0;  // Storage index of the oldest sample
+        size_t count = 0; // Number of valid samples
+
+        uint64_t pushed = 0; // Total samples ever pushed (never wraps back down)
+
+        void allocate(Channel& ch, bool gaps);
+        static void store(Channel& ch, size_t slot, double raw);
+        static double load(const Channel& ch, size_t slot);
+
+    public:
+
+        explicit SignalBuffer(size_t capacity = 4096, size_t channelCount = 0);
+
+        // Drops all samples and reallocates. Capacity gets rounded up to a power of two.
+        // Channels that still exist keep their format, new ones are F32.
+        void reset(size_t capacity, size_t channelCount);
+        void clear();
+
+        // Adds a new (empty history) channel and returns its index
+        size_t addChannel(const ChannelFormat& format = ChannelFormat());
+
+        const ChannelFormat& format(size_t channel) const {return this->channels[channel].format;}
+        void setScale(size_t channel, double scale, double offset);
+
+        // values must point at channelCount() raw values. Integer channels round and saturate.
+        void push(double t, const double* values);
+
+        size_t size() const {return this->count;}
+        size_t capacity() const {return this->cap;}
+        size_t channelCount() const {return this->channels.size();}
+        bool empty() const {return this->count == 0;}
+        uint64_t totalPushed() const {return this->pushed;}
+
+        // Logical access, i = 0 is the oldest sample
+        double timeAt(size_t i) const {return this->times[(this->head + i) & this->mask];}
+        double rawAt(size_t channel, size_t i) const {return load(this->channels[channel], (this->head + i) & this->mask);}
+        double valueAt(size_t channel, size_t i) const
+        {
+            const ChannelFormat& f = this->channels[channel].format;
+            return this->rawAt(channel, i) * f.scale + f.offset;
+        }
+
+        const LodPyramid& lod(size_t channel) const {return this->pyramids[channel];}
+
+        // Absolute sample number of logical index i (what the LOD blocks are aligned to)
+        uint64_t absoluteIndex(size_t i) const {return this->pushed - this->count + i;}
+
+        size_t rawMemoryBytes() const;
+        size_t lodMemoryBytes() const;
+
+        // First logical index with timeAt(i) >= t (time stamps only ever go up). O(log n)
+        size_t lowerBound(double t) const;
+
+        static size_t roundUpPow2(size_t v);
+};
+
+#endif // SIGNALBUFFER_H
@@ -0,0 +1,131 @@
+/* =============== RecordingFormat.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Session recording
+
+    Description:
+        On-disk layout of a recording (.stmrec), little endian throughout.
+        The file is only ever appended to, so a crash mid soak test loses at
+        most the chunk that was being filled; the reader rebuilds the index by
+        walking the chunk headers when the footer is missing.
+
+        File header:
+            +0   char magic[8]        "STMREC01"
+            +8   u32  version         2 (1 = no types, everything f32)
+            +12  u32  channelCount
+            +16  u32  flags           (unused, 0)
+            +20  u32  channelBytes
+            +24  channels             u16 name length, name, u8 SampleType, f64 scale, f64 offset
+
+        Chunk (a few thousand rows, columnar):
+            +0   u32  magic           "CHNK"
+            +4   u32  rows
+            +8   u32  encoding        ChunkRaw / ChunkDeltaVarint
+            +12  u32  payloadBytes    everything after this 32 byte header
+            +16  f64  firstTime
+            +24  f64  lastTime
+            then channelCount + 1 columns, time first, each a u32 byte count + data.
+            Raw: time f64, values in their SampleType. Delta varint: time as the
+            delta of the delta of its bit pattern (steady sampling = 1 byte per
+            row), integer channels as the delta of the value, float channels as
+            the delta of their bit pattern, all zigzag + LEB128.
+
+        Footer (written on close):
+            index entries        u64 offset, u32 rows, u32 reserved, f64 firstTime, f64 lastTime
+            u64 indexOffset, u32 chunkCount, u32 magic "INDX"
+*/
+
+#ifndef RECORDINGFORMAT_H
+#define RECORDINGFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "plot/SignalBuffer.h"
+
+// One recorded signal
+struct RecordingChannel
+{
+    std::string name;
+    ChannelFormat format;
+};
+
+namespace RecordingFormat
+{
+    constexpr char Magic[8] = {'S', 'T', 'M', 'R', 'E', 'C', '0', '1'};
+    constexpr uint32_t Version = 2;
+    constexpr uint32_t HeaderSize = 24; // Before the names
+    constexpr uint32_t ChunkMagic = 0x4B4E4843; // "CHNK"
+    constexpr uint32_t ChunkHeaderSize = 32;
+    constexpr uint32_t IndexMagic = 0x58444E49; // "INDX"
+    constexpr uint32_t IndexEntrySize = 32;
+    constexpr uint32_t TrailerSize = 16;
+
+    constexpr uint32_t ChunkRaw = 0;
+    constexpr uint32_t ChunkDeltaVarint = 1;
+
+    inline void put32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+    }
+
+    inline void put64(std::vector<uint8_t>& out, uint64_t v)
+    {
+        for (int i = 0; i < 8; i++) out.push_back((uint8_t)(v >> (8 * i)));
+    }
+
+    inline void putDouble(std::vector<uint8_t>& out, double d)
+    {
+        uint64_t v;
+        memcpy(&v, &d, 8);
+        put64(out, v);
+    }
+
+    inline uint32_t get32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    inline uint64_t get64(const uint8_t* p)
+    {
+        return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32);
+    }
+
+    inline double getDouble(const uint8_t* p)
+    {
+        uint64_t v = get64(p);
+        double d;
+        memcpy(&d, &v, 8);
+        return d;
+    }
+
+    inline void putVarint(std::vector<uint8_t>& out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+
+    // false when the varint runs past end
+    inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    inline uint64_t zigzag(int64_t v) {return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);}
+    inline int64_t unzigzag(uint64_t v) {return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);}
+}
+
+#endif // RECORDINGFORMAT_H
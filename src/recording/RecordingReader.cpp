@@ -0,0 +1,307 @@
+/* =============== RecordingReader.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Session recording
+
+    Description:
+        Header / index parsing, crash recovery and chunk decoding.
+*/
+
+#include "RecordingReader.h"
+
+#include <algorithm>
+
+using namespace RecordingFormat;
+
+bool RecordingReader::open(const std::string& path, std::string& err)
+{
+    this->close();
+
+    if (!this->file.open(path, err))
+    {
+        return false;
+    }
+
+    const uint8_t* base = this->file.data();
+    const size_t size = this->file.size();
+
+    if (size < HeaderSize || memcmp(base, Magic, 8) != 0)
+    {
+        err = path + " is not a recording";
+        this->close();
+        return false;
+    }
+    this->version = get32(base + 8);
+    if (this->version < 1 || this->version > Version)
+    {
+        err = "Unsupported recording version " + std::to_string(this->version);
+        this->close();
+        return false;
+    }
+
+    const uint32_t count = get32(base + 12);
+    const uint32_t tableBytes = get32(base + 20);
+    if ((uint64_t)HeaderSize + tableBytes > size)
+    {
+        err = "Recording header is cut off";
+        this->close();
+        return false;
+    }
+
+    // Version 1 only has names, all f32
+    const size_t typeBytes = (this->version >= 2) ? 17 : 0;
+    const uint8_t* p = base + HeaderSize;
+    const uint8_t* end = p + tableBytes;
+    for (uint32_t c = 0; c < count; c++)
+    {
+        size_t len = (end - p >= 2) ? ((size_t)p[0] | ((size_t)p[1] << 8)) : 0;
+        if (end - p < 2 || (size_t)(end - p - 2) < len + typeBytes)
+        {
+            err = "Recording channel table is cut off";
+            this->close();
+            return false;
+        }
+        p += 2;
+
+        RecordingChannel ch;
+        ch.name.assign((const char*)p, len);
+        p += len;
+        if (typeBytes)
+        {
+            if (p[0] > (uint8_t)SampleType::F64)
+            {
+                err = "Unknown sample type in channel " + ch.name;
+                this->close();
+                return false;
+            }
+            ch.format.type = (SampleType)p[0];
+            ch.format.scale = getDouble(p + 1);
+            ch.format.offset = getDouble(p + 9);
+            p += typeBytes;
+        }
+        this->channels.push_back(ch);
+    }
+
+    const size_t dataStart = HeaderSize + tableBytes;
+    if (!this->readIndex(dataStart))
+    {
+        this->scanChunks(dataStart);
+        this->recovered = true;
+    }
+
+    for (const auto& c : this->chunks) this->rows += c.rows;
+    return true;
+}
+
+void RecordingReader::close()
+{
+    this->file.close();
+    this->version = 0;
+    this->channels.clear();
+    this->chunks.clear();
+    this->rows = 0;
+    this->recovered = false;
+}
+
+bool RecordingReader::readIndex(size_t dataStart)
+{
+    const uint8_t* base = this->file.data();
+    const size_t size = this->file.size();
+    if (size < dataStart + TrailerSize)
+    {
+        return false;
+    }
+
+    const uint8_t* trailer = base + size - TrailerSize;
+    if (get32(trailer + 12) != IndexMagic)
+    {
+        return false;
+    }
+
+    const uint64_t indexOffset = get64(trailer);
+    const uint32_t count = get32(trailer + 8);
+    if (indexOffset < dataStart || indexOffset + (uint64_t)count * IndexEntrySize != size - TrailerSize)
+    {
+        return false;
+    }
+
+    this->chunks.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t* e = base + indexOffset + (uint64_t)i * IndexEntrySize;
+        RecordingChunk& c = this->chunks[i];
+        c.offset = get64(e);
+        c.rows = get32(e + 8);
+        c.firstTime = getDouble(e + 16);
+        c.lastTime = getDouble(e + 24);
+
+        if (c.offset < dataStart || c.offset + ChunkHeaderSize > indexOffset || get32(base + c.offset) != ChunkMagic)
+        {
+            this->chunks.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Recording that was never closed: hop from chunk header to chunk header until the data runs out
+void RecordingReader::scanChunks(size_t dataStart)
+{
+    const uint8_t* base = this->file.data();
+    const size_t size = this->file.size();
+
+    uint64_t off = dataStart;
+    while (off + ChunkHeaderSize <= size)
+    {
+        const uint8_t* h = base + off;
+        const uint64_t payload = get32(h + 12);
+        if (get32(h) != ChunkMagic || off + ChunkHeaderSize + payload > size)
+        {
+            break; // The chunk that was being written when it died
+        }
+
+        RecordingChunk c;
+        c.offset = off;
+        c.rows = get32(h + 4);
+        c.firstTime = getDouble(h + 16);
+        c.lastTime = getDouble(h + 24);
+        this->chunks.push_back(c);
+
+        off += ChunkHeaderSize + payload;
+    }
+}
+
+size_t RecordingReader::findChunk(double t) const
+{
+    if (this->chunks.empty())
+    {
+        return 0;
+    }
+
+    auto it = std::lower_bound(this->chunks.begin(), this->chunks.end(), t,
+                               [](const RecordingChunk& c, double value) {return c.lastTime < value;});
+    if (it == this->chunks.end())
+    {
+        return this->chunks.size() - 1;
+    }
+    return (size_t)(it - this->chunks.begin());
+}
+
+// A stored word (native width, zero extended) back to its value
+static double decodeWord(SampleType type, uint64_t word)
+{
+    switch (type)
+    {
+        case SampleType::U8:  return (double)(uint8_t)word;
+        case SampleType::I16: return (double)(int16_t)(uint16_t)word;
+        case SampleType::U32: return (double)(uint32_t)word;
+        case SampleType::F32:
+        {
+            uint32_t bits = (uint32_t)word;
+            float f;
+            memcpy(&f, &bits, 4);
+            return f;
+        }
+        case SampleType::F64:
+        {
+            double d;
+            memcpy(&d, &word, 8);
+            return d;
+        }
+    }
+    return 0.0;
+}
+
+bool RecordingReader::readChunk(size_t i, std::vector<double>& times, std::vector<double>& values) const
+{
+    if (i >= this->chunks.size())
+    {
+        return false;
+    }
+
+    const RecordingChunk& info = this->chunks[i];
+    const uint8_t* h = this->file.data() + info.offset;
+    const uint32_t rows = get32(h + 4);
+    const uint32_t encoding = get32(h + 8);
+    const uint64_t payload = get32(h + 12);
+    if (info.offset + ChunkHeaderSize + payload > this->file.size())
+    {
+        return false;
+    }
+    const uint8_t* p = h + ChunkHeaderSize;
+    const uint8_t* end = p + payload;
+
+    // Every row takes at least a byte per column in both encodings, a bigger count is a corrupt
+    // header and must not turn into a huge allocation
+    const size_t channels = this->channels.size();
+    if ((uint64_t)rows * (channels + 1) > payload)
+    {
+        return false;
+    }
+    times.resize(rows);
+    values.resize(channels * rows);
+
+    for (size_t col = 0; col <= channels; col++)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+        const uint32_t bytes = get32(p);
+        p += 4;
+        if ((size_t)(end - p) < bytes)
+        {
+            return false;
+        }
+        const uint8_t* c = p;
+        const uint8_t* cEnd = p + bytes;
+        p = cEnd;
+
+        const SampleType type = (col == 0) ? SampleType::F64 : this->channels[col - 1].format.type;
+        const size_t width = sampleTypeSize(type);
+        double* dst = (col == 0) ? times.data() : values.data() + (col - 1) * rows;
+
+        if (encoding == ChunkRaw)
+        {
+            if (bytes != rows * width)
+            {
+                return false;
+            }
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                uint64_t word = 0;
+                for (size_t b = 0; b < width; b++) word |= (uint64_t)c[r * width + b] << (8 * b);
+                dst[r] = decodeWord(type, word);
+            }
+            continue;
+        }
+
+        if (encoding != ChunkDeltaVarint)
+        {
+            return false;
+        }
+
+        uint64_t prev = 0;
+        int64_t prevDelta = 0;
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            uint64_t v;
+            if (!getVarint(c, cEnd, v))
+            {
+                return false;
+            }
+
+            if (col == 0)
+            {
+                // Time is delta of delta
+                prevDelta += unzigzag(v);
+                prev += (uint64_t)prevDelta;
+            }
+            else
+            {
+                prev += (uint64_t)unzigzag(v);
+            }
+            dst[r] = decodeWord(type, prev);
+        }
+    }
+    return true;
+}
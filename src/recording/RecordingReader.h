@@ -0,0 +1,69 @@
+/* =============== RecordingReader.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Session recording
+
+    Description:
+        Opens a recording by memory mapping it. Only the header and the
+        index are read up front, so a multi GB overnight capture opens as
+        fast as a small one; chunks are decoded when something asks for them.
+*/
+
+#ifndef RECORDINGREADER_H
+#define RECORDINGREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/MappedFile.h"
+#include "RecordingFormat.h"
+
+struct RecordingChunk
+{
+    uint64_t offset = 0;
+    uint32_t rows = 0;
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+};
+
+class RecordingReader
+{
+    private:
+
+        MappedFile file;
+        uint32_t version = 0;
+        std::vector<RecordingChannel> channels;
+        std::vector<RecordingChunk> chunks;
+        uint64_t rows = 0;
+        bool recovered = false; // No footer, the index was rebuilt from the chunk headers
+
+        bool readIndex(size_t dataStart);
+        void scanChunks(size_t dataStart);
+
+    public:
+
+        RecordingReader() = default;
+
+        bool open(const std::string& path, std::string& err);
+        void close();
+        bool isOpen() const {return this->file.isOpen();}
+
+        const std::vector<RecordingChannel>& getChannels() const {return this->channels;}
+        size_t channelCount() const {return this->channels.size();}
+        const std::vector<RecordingChunk>& getChunks() const {return this->chunks;}
+        uint64_t rowCount() const {return this->rows;}
+        bool wasRecovered() const {return this->recovered;}
+        size_t fileSize() const {return this->file.size();}
+
+        double firstTime() const {return this->chunks.empty() ? 0.0 : this->chunks.front().firstTime;}
+        double lastTime() const {return this->chunks.empty() ? 0.0 : this->chunks.back().lastTime;}
+
+        // Chunk that holds time t (the first one ending at or after it, the last one past the end). O(log n)
+        size_t findChunk(double t) const;
+
+        // times gets rows entries, values is column major (raw values): values[c * rows + r]
+        bool readChunk(size_t i, std::vector<double>& times, std::vector<double>& values) const;
+};
+
+#endif // RECORDINGREADER_H
@@ -0,0 +1,326 @@
+/* =============== RecordingWriter.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Session recording
+
+    Description:
+        Writer thread, chunk encoding and the index footer.
+*/
+
+#include "RecordingWriter.h"
+#include "util/Profiler.h"
+
+#include <chrono>
+
+using namespace RecordingFormat;
+
+RecordingWriter::~RecordingWriter()
+{
+    this->close();
+}
+
+bool RecordingWriter::open(const std::string& path, const std::vector<RecordingChannel>& channels, bool compress, std::string& err)
+{
+    this->close();
+
+    this->file = fopen(path.c_str(), "wb");
+    if (!this->file)
+    {
+        err = "Can't create " + path;
+        return false;
+    }
+
+    this->channels = channels.size();
+    this->types.clear();
+    for (const auto& ch : channels) this->types.push_back(ch.format.type);
+    this->compress = compress;
+    this->times.clear();
+    this->columns.assign(this->channels, std::vector<double>());
+    this->index.clear();
+    this->fileOffset = 0;
+    this->lastError.clear();
+    this->failed.store(false);
+    this->rowsWritten.store(0);
+    this->bytesWritten.store(0);
+    this->dropped.store(0);
+
+    std::vector<uint8_t> header(Magic, Magic + 8);
+    put32(header, Version);
+    put32(header, (uint32_t)this->channels);
+    put32(header, 0);
+
+    std::vector<uint8_t> table;
+    for (const auto& ch : channels)
+    {
+        uint16_t len = (uint16_t)(ch.name.size() < 0xFFFF ? ch.name.size() : 0xFFFF);
+        table.push_back((uint8_t)len);
+        table.push_back((uint8_t)(len >> 8));
+        table.insert(table.end(), ch.name.begin(), ch.name.begin() + len);
+        table.push_back((uint8_t)ch.format.type);
+        putDouble(table, ch.format.scale);
+        putDouble(table, ch.format.offset);
+    }
+    put32(header, (uint32_t)table.size());
+    header.insert(header.end(), table.begin(), table.end());
+
+    if (!this->writeBytes(header))
+    {
+        err = "Can't write " + path;
+        fclose(this->file);
+        this->file = nullptr;
+        return false;
+    }
+
+    // 16 chunks of slack between the UI and the disk, tens of ms even at 1 MS/s (SWO)
+    this->queue.reset(this->chunkRows * 16 * (this->channels + 1));
+
+    this->running.store(true);
+    this->worker = std::thread(&RecordingWriter::run, this);
+    return true;
+}
+
+void RecordingWriter::close()
+{
+    if (!this->file)
+    {
+        return;
+    }
+
+    // The worker drains the queue and flushes the last chunk on its way out
+    this->running.store(false);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+
+    if (!this->failed.load())
+    {
+        std::vector<uint8_t> footer;
+        for (const auto& e : this->index)
+        {
+            put64(footer, e.offset);
+            put32(footer, e.rows);
+            put32(footer, 0);
+            putDouble(footer, e.firstTime);
+            putDouble(footer, e.lastTime);
+        }
+        put64(footer, this->fileOffset);
+        put32(footer, (uint32_t)this->index.size());
+        put32(footer, IndexMagic);
+        this->writeBytes(footer);
+    }
+
+    fclose(this->file);
+    this->file = nullptr;
+}
+
+void RecordingWriter::append(const double* rows, size_t rowCount)
+{
+    if (!this->running.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    const size_t rowSize = this->channels + 1;
+    if (!this->queue.tryPush(rows, rowCount * rowSize))
+    {
+        // Row by row gets in whatever still fits
+        for (size_t r = 0; r < rowCount; r++)
+        {
+            if (!this->queue.tryPush(rows + r * rowSize, rowSize))
+            {
+                this->dropped.fetch_add(rowCount - r, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+}
+
+void RecordingWriter::run()
+{
+    using clock = std::chrono::steady_clock;
+    PROFILE_THREAD("recorder");
+
+    const size_t rowSize = this->channels + 1;
+    std::vector<double> scratch(256 * rowSize);
+    auto chunkStarted = clock::now();
+
+    while (true)
+    {
+        // Read the flag first, so nothing pushed before close() can be missed
+        const bool keepGoing = this->running.load();
+
+        size_t n;
+        while ((n = this->queue.pop(scratch.data(), scratch.size())) > 0)
+        {
+            for (size_t r = 0; r + rowSize <= n; r += rowSize)
+            {
+                if (this->times.empty()) chunkStarted = clock::now();
+
+                this->times.push_back(scratch[r]);
+                for (size_t c = 0; c < this->channels; c++)
+                {
+                    this->columns[c].push_back(scratch[r + 1 + c]);
+                }
+
+                if (this->times.size() >= this->chunkRows && !this->flushChunk())
+                {
+                    return;
+                }
+            }
+        }
+
+        if (!this->times.empty() && (!keepGoing || clock::now() - chunkStarted > std::chrono::seconds(1)))
+        {
+            if (!this->flushChunk())
+            {
+                return;
+            }
+        }
+
+        if (!keepGoing)
+        {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+bool RecordingWriter::writeBytes(const std::vector<uint8_t>& bytes)
+{
+    if (fwrite(bytes.data(), 1, bytes.size(), this->file) != bytes.size())
+    {
+        return false;
+    }
+    this->fileOffset += bytes.size();
+    this->bytesWritten.store(this->fileOffset, std::memory_order_relaxed);
+    return true;
+}
+
+void RecordingWriter::encodeTimes(std::vector<uint8_t>& out) const
+{
+    if (!this->compress)
+    {
+        for (double t : this->times) putDouble(out, t);
+        return;
+    }
+
+    uint64_t prev = 0;
+    int64_t prevDelta = 0;
+    for (double t : this->times)
+    {
+        uint64_t bits;
+        memcpy(&bits, &t, 8);
+        int64_t delta = (int64_t)(bits - prev);
+        putVarint(out, zigzag(delta - prevDelta));
+        prev = bits;
+        prevDelta = delta;
+    }
+}
+
+void RecordingWriter::encodeColumn(SampleType type, const std::vector<double>& col, std::vector<uint8_t>& out) const
+{
+    // Integers as themselves, floats as their bit pattern. Either way the delta of two
+    // neighbours is what goes into the varint.
+    uint64_t prev = 0;
+    for (double d : col)
+    {
+        double v = toSampleType(type, d);
+        uint64_t word = 0;
+        int64_t delta = 0;
+
+        switch (type)
+        {
+            case SampleType::U8:
+            case SampleType::U32:
+                word = (uint64_t)v;
+                delta = (int64_t)(word - prev);
+                break;
+            case SampleType::I16:
+                word = (uint64_t)(int64_t)v;
+                delta = (int64_t)(word - prev);
+                break;
+            case SampleType::F32:
+            {
+                float f = (float)v;
+                uint32_t bits;
+                memcpy(&bits, &f, 4);
+                word = bits;
+                delta = (int32_t)(bits - (uint32_t)prev);
+                break;
+            }
+            case SampleType::F64:
+                memcpy(&word, &v, 8);
+                delta = (int64_t)(word - prev);
+                break;
+        }
+
+        if (!this->compress)
+        {
+            // Native width, little endian
+            for (size_t i = 0; i < sampleTypeSize(type); i++) out.push_back((uint8_t)(word >> (8 * i)));
+        }
+        else
+        {
+            putVarint(out, zigzag(delta));
+        }
+        prev = word;
+    }
+}
+
+bool RecordingWriter::flushChunk()
+{
+    PROFILE_SCOPE("write chunk");
+
+    const uint32_t rows = (uint32_t)this->times.size();
+
+    // Columns first, the header needs the payload size
+    this->chunk.clear();
+    this->chunk.resize(ChunkHeaderSize);
+
+    std::vector<uint8_t> col;
+    auto addColumn = [&]()
+    {
+        put32(this->chunk, (uint32_t)col.size());
+        this->chunk.insert(this->chunk.end(), col.begin(), col.end());
+    };
+
+    col.clear();
+    this->encodeTimes(col);
+    addColumn();
+    for (size_t c = 0; c < this->channels; c++)
+    {
+        col.clear();
+        this->encodeColumn(this->types[c], this->columns[c], col);
+        addColumn();
+    }
+
+    std::vector<uint8_t> header;
+    put32(header, ChunkMagic);
+    put32(header, rows);
+    put32(header, this->compress ? ChunkDeltaVarint : ChunkRaw);
+    put32(header, (uint32_t)(this->chunk.size() - ChunkHeaderSize));
+    putDouble(header, this->times.front());
+    putDouble(header, this->times.back());
+    memcpy(this->chunk.data(), header.data(), ChunkHeaderSize);
+
+    IndexEntry entry;
+    entry.offset = this->fileOffset;
+    entry.rows = rows;
+    entry.firstTime = this->times.front();
+    entry.lastTime = this->times.back();
+
+    if (!this->writeBytes(this->chunk) || fflush(this->file) != 0)
+    {
+        this->lastError = "Recording write failed (disk full?)";
+        this->failed.store(true);
+        this->running.store(false);
+        return false;
+    }
+
+    this->index.push_back(entry);
+    this->rowsWritten.fetch_add(rows, std::memory_order_relaxed);
+
+    this->times.clear();
+    for (auto& c : this->columns) c.clear();
+    return true;
+}
@@ -0,0 +1,100 @@
+/* =============== RecordingWriter.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Session recording
+
+    Description:
+        Writes plot rows to a recording file (layout in RecordingFormat.h)
+        from its own thread. The UI thread only copies rows into a lock free
+        queue, compression and disk IO never show up in the frame time.
+*/
+
+#ifndef RECORDINGWRITER_H
+#define RECORDINGWRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "acquisition/SpscQueue.h"
+#include "RecordingFormat.h"
+
+/**
+  * @brief Background chunk writer
+
+  Rows are [t, ch0, ch1, ...] like everywhere else. A chunk goes to disk when it has chunkRows
+  rows or when it is a second old, so a crash loses at most about a second. The index footer is
+  written by close(). If the disk can't keep up and the queue fills, rows are dropped and counted
+  rather than stalling the UI.
+*/
+class RecordingWriter
+{
+    private:
+
+        struct IndexEntry
+        {
+            uint64_t offset = 0;
+            uint32_t rows = 0;
+            double firstTime = 0.0;
+            double lastTime = 0.0;
+        };
+
+        FILE* file = nullptr;
+        size_t channels = 0;
+        std::vector<SampleType> types;
+        bool compress = true;
+        size_t chunkRows = 4096;
+
+        SpscQueue<double> queue;
+        std::thread worker;
+        std::atomic<bool> running{false};
+        std::atomic<bool> failed{false};
+        std::string lastError; // Set by the worker before failed, read after it
+
+        std::atomic<uint64_t> rowsWritten{0};
+        std::atomic<uint64_t> bytesWritten{0};
+        std::atomic<uint64_t> dropped{0};
+
+        // Worker side
+        std::vector<double> times;
+        std::vector<std::vector<double>> columns;
+        std::vector<uint8_t> chunk;
+        std::vector<IndexEntry> index;
+        uint64_t fileOffset = 0;
+
+        void run();
+        bool flushChunk();
+        bool writeBytes(const std::vector<uint8_t>& bytes);
+        void encodeTimes(std::vector<uint8_t>& out) const;
+        void encodeColumn(SampleType type, const std::vector<double>& col, std::vector<uint8_t>& out) const;
+
+    public:
+
+        RecordingWriter() = default;
+        ~RecordingWriter();
+
+        RecordingWriter(const RecordingWriter&) = delete;
+        RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+        // Creates the file (truncating it) and starts the writer thread
+        bool open(const std::string& path, const std::vector<RecordingChannel>& channels, bool compress, std::string& err);
+        // Writes what is queued, the footer, and closes the file
+        void close();
+        bool isOpen() const {return this->file != nullptr;}
+
+        // UI thread: queues rowCount rows of channelCount() + 1 raw values
+        void append(const double* rows, size_t rowCount);
+
+        size_t channelCount() const {return this->channels;}
+        bool hasFailed() const {return this->failed.load();}
+        const std::string& getLastError() const {return this->lastError;}
+
+        uint64_t rowCount() const {return this->rowsWritten.load(std::memory_order_relaxed);}
+        uint64_t byteCount() const {return this->bytesWritten.load(std::memory_order_relaxed);}
+        uint64_t droppedRows() const {return this->dropped.load(std::memory_order_relaxed);}
+};
+
+#endif // RECORDINGWRITER_H
@@ -0,0 +1,348 @@
+/* =============== LogStore.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Log store
+
+    Description:
+        Category interning, ring claim / publish, the chunked history and the
+        filtered view.
+*/
+
+#include "LogStore.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+const char* logLevelName(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARN: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+    }
+    return "?";
+}
+
+const char* logSourceName(LogSource source)
+{
+    switch (source)
+    {
+        case LogSource::APP: return "App";
+        case LogSource::GDB: return "GDB";
+        case LogSource::OPENOCD: return "OpenOCD";
+    }
+    return "?";
+}
+
+// ------------------------------
+// Categories
+// ------------------------------
+
+// Names are written once under the lock and then only read, count is published last
+namespace
+{
+    struct CategoryTable
+    {
+        std::mutex lock;
+        char names[LogCategory::Max][24] = {{"general"}};
+        std::atomic<size_t> count{1};
+    };
+
+    CategoryTable& categories()
+    {
+        static CategoryTable table;
+        return table;
+    }
+}
+
+LogCategory LogCategory::intern(const char* name)
+{
+    CategoryTable& table = categories();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    const size_t n = table.count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (strncmp(table.names[i], name, sizeof(table.names[i]) - 1) == 0)
+        {
+            return LogCategory{(uint16_t)i};
+        }
+    }
+
+    if (n >= Max)
+    {
+        return LogCategory{0};
+    }
+
+    snprintf(table.names[n], sizeof(table.names[n]), "%s", name);
+    table.count.store(n + 1, std::memory_order_release);
+    return LogCategory{(uint16_t)n};
+}
+
+const char* LogCategory::name(uint16_t id)
+{
+    CategoryTable& table = categories();
+    return (id < table.count.load(std::memory_order_acquire)) ? table.names[id] : "?";
+}
+
+size_t LogCategory::count()
+{
+    return categories().count.load(std::memory_order_acquire);
+}
+
+// ------------------------------
+// Ring
+// ------------------------------
+LogStore::LogStore(size_t maxLines, size_t ringSlots)
+{
+    size_t cap = 2;
+    while (cap < ringSlots)
+    {
+        cap <<= 1;
+    }
+
+    this->slots.reset(new Slot[cap]);
+    this->mask = cap - 1;
+    for (size_t i = 0; i < cap; i++)
+    {
+        this->slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    this->epoch = std::chrono::steady_clock::now();
+    this->setMaxLines(maxLines);
+}
+
+LogStore::Slot* LogStore::claim(size_t& pos)
+{
+    // Slot pos is free for us when its sequence is pos, ahead of that someone else got it first,
+    // behind means the consumer has not got to it yet (full)
+    pos = this->enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot* slot = &this->slots[pos & this->mask];
+        const size_t seq = slot->seq.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                return slot;
+            }
+        }
+        else if (diff < 0)
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            pos = this->enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogStore::publish(Slot* slot, size_t pos, LogSource source, LogLevel level, uint16_t category, size_t len)
+{
+    slot->timeUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - this->epoch).count();
+    slot->len = (uint16_t)len;
+    slot->category = category;
+    slot->level = level;
+    slot->source = source;
+
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool LogStore::write(LogSource source, LogLevel level, LogCategory category, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const bool ok = this->vwrite(source, level, category, fmt, args);
+    va_end(args);
+    return ok;
+}
+
+bool LogStore::vwrite(LogSource source, LogLevel level, LogCategory category, const char* fmt, va_list args)
+{
+    size_t pos;
+    Slot* slot = this->claim(pos);
+    if (!slot)
+    {
+        return false;
+    }
+
+    // A claimed slot has to be published no matter what, the consumer waits on it
+    int n = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    size_t len = (n < 0) ? 0 : (size_t)n;
+    if (len > MaxLineBytes) len = MaxLineBytes;
+
+    this->publish(slot, pos, source, level, category.id, len);
+    return true;
+}
+
+bool LogStore::writeText(LogSource source, LogLevel level, LogCategory category, const char* text, size_t len)
+{
+    size_t pos;
+    Slot* slot = this->claim(pos);
+    if (!slot)
+    {
+        return false;
+    }
+
+    if (len > MaxLineBytes) len = MaxLineBytes;
+    memcpy(slot->text, text, len);
+
+    this->publish(slot, pos, source, level, category.id, len);
+    return true;
+}
+
+// ------------------------------
+// History
+// ------------------------------
+size_t LogStore::collect()
+{
+    size_t count = 0;
+    while (true)
+    {
+        Slot& slot = this->slots[this->dequeuePos & this->mask];
+        if (slot.seq.load(std::memory_order_acquire) != this->dequeuePos + 1)
+        {
+            break; // Empty, or the producer that claimed it is still formatting
+        }
+
+        if (this->chunks.empty() || this->chunks.back().meta.size() == ChunkLines)
+        {
+            // Most lines are well under 64 characters, so this rarely has to grow
+            this->chunks.emplace_back();
+            this->chunks.back().text.reserve(ChunkLines * 64);
+            this->chunks.back().meta.reserve(ChunkLines);
+        }
+        Chunk& chunk = this->chunks.back();
+        chunk.text.append(slot.text, slot.len);
+
+        Meta m;
+        m.end = (uint32_t)chunk.text.size();
+        m.category = slot.category;
+        m.level = slot.level;
+        m.source = slot.source;
+        m.timeUs = slot.timeUs;
+        chunk.meta.push_back(m);
+
+        // Hand it back for the next lap
+        slot.seq.store(this->dequeuePos + this->mask + 1, std::memory_order_release);
+        this->dequeuePos++;
+        this->lines++;
+        count++;
+    }
+
+    // Full chunks beyond the limit go, the newest maxLines are always kept
+    while (this->chunks.size() > 1 && this->lines - this->chunks.front().meta.size() >= this->maxLines)
+    {
+        this->lines -= this->chunks.front().meta.size();
+        this->chunks.pop_front();
+    }
+
+    this->total += count;
+    return count;
+}
+
+void LogStore::clear()
+{
+    this->collect();
+    this->chunks.clear();
+    this->lines = 0;
+}
+
+void LogStore::setMaxLines(size_t maxLines)
+{
+    this->maxLines = (maxLines > 0) ? maxLines : 1;
+}
+
+LogRecord LogStore::record(size_t i) const
+{
+    // Every chunk but the last is full
+    const Chunk& chunk = this->chunks[i / ChunkLines];
+    const size_t n = i % ChunkLines;
+    const Meta& m = chunk.meta[n];
+    const uint32_t begin = (n == 0) ? 0 : chunk.meta[n - 1].end;
+
+    LogRecord r;
+    r.text = std::string_view(chunk.text.data() + begin, m.end - begin);
+    r.timeUs = m.timeUs;
+    r.level = m.level;
+    r.source = m.source;
+    r.category = m.category;
+    return r;
+}
+
+size_t LogStore::memoryBytes() const
+{
+    size_t bytes = (this->mask + 1) * sizeof(Slot);
+    for (const Chunk& chunk : this->chunks)
+    {
+        bytes += chunk.text.capacity() + chunk.meta.capacity() * sizeof(Meta);
+    }
+    return bytes;
+}
+
+// ------------------------------
+// Filtered view
+// ------------------------------
+void LogView::setFilter(const LogFilter& filter)
+{
+    if (filter != this->filter)
+    {
+        this->filter = filter;
+        this->dirty = true;
+    }
+}
+
+void LogView::update(const LogStore& store)
+{
+    if (this->filter.passesAll())
+    {
+        this->matches.clear();
+        this->scanned = store.endIndex();
+        this->dirty = false;
+        return;
+    }
+
+    if (this->dirty)
+    {
+        this->matches.clear();
+        this->scanned = store.firstIndex();
+        this->dirty = false;
+    }
+
+    // Evicted records are gone from the front of the index too
+    while (!this->matches.empty() && this->matches.front() < store.firstIndex())
+    {
+        this->matches.pop_front();
+    }
+    if (this->scanned < store.firstIndex())
+    {
+        this->scanned = store.firstIndex();
+    }
+
+    for (; this->scanned < store.endIndex(); this->scanned++)
+    {
+        const LogRecord r = store.record((size_t)(this->scanned - store.firstIndex()));
+        if (this->filter.passes(r.level, r.source, r.category))
+        {
+            this->matches.push_back(this->scanned);
+        }
+    }
+}
+
+size_t LogView::size(const LogStore& store) const
+{
+    return this->filter.passesAll() ? store.size() : this->matches.size();
+}
+
+size_t LogView::recordIndex(size_t row, const LogStore& store) const
+{
+    return this->filter.passesAll() ? row : (size_t)(this->matches[row] - store.firstIndex());
+}
@@ -0,0 +1,223 @@
+/* =============== LogStore.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Log store
+
+    Description:
+        Where log records go. Any thread (UI, acquisition, recorder, ...) can
+        write a record into a lock free ring without ever waiting or touching
+        the heap: the message is printf formatted straight into a ring slot,
+        the rest (source, level, category, time) are plain fields. Once per
+        frame the UI thread moves what came in into the history, which keeps
+        up to a configurable number of records (a million by default) in big
+        text chunks, so looking up record i is O(1) and the console only has
+        to touch the lines on screen. The "[GDB][INFO]" part is never stored,
+        the console draws it from the fields.
+*/
+
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lets gcc / clang check the arguments of printf style log calls
+#if defined(__GNUC__)
+    #define LOG_PRINTF(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+    #define LOG_PRINTF(fmtIndex, argIndex)
+#endif
+
+enum class LogLevel : uint8_t {DEBUG, INFO, WARN, ERROR};
+enum class LogSource : uint8_t {APP, GDB, OPENOCD};
+
+constexpr size_t LogSourceCount = 3;
+
+const char* logLevelName(LogLevel level); // "INFO"
+const char* logSourceName(LogSource source); // "OpenOCD"
+
+/**
+  * @brief Interned topic of a record ("rtt", "watch", ...)
+
+  Ids are process wide and never go away, so call sites intern once into a static and records carry
+  2 bytes instead of a string. Id 0 is "general", what records without a category get.
+*/
+struct LogCategory
+{
+    uint16_t id = 0;
+
+    static constexpr size_t Max = 64; // Filters keep one bit per category
+
+    // Thread safe, the same name always gives the same id. Past Max everything lands in "general".
+    static LogCategory intern(const char* name);
+    static const char* name(uint16_t id);
+    static size_t count();
+};
+
+// One record in the history, text points into the store (valid until the next collect())
+struct LogRecord
+{
+    std::string_view text;
+    uint64_t timeUs = 0; // Since the store was created
+    LogLevel level = LogLevel::INFO;
+    LogSource source = LogSource::APP;
+    uint16_t category = 0;
+};
+
+/**
+  * @brief MPSC ring of log records + the UI side history
+
+  The ring is a bounded queue with a sequence number per slot (Vyukov style): producers claim a
+  slot with one CAS, format into it and publish it by bumping the slot's sequence. A full ring
+  drops the record and counts it instead of blocking. Messages longer than MaxLineBytes are cut.
+
+  History: chunks of ChunkLines records, each one preallocated text arena + per record fields. Old
+  records go a whole chunk at a time, so record(i) is a division and two array lookups. Records are
+  also numbered from the very first one ever collected (absolute index), which does not shift when
+  old ones are dropped, LogView uses that.
+*/
+class LogStore
+{
+    public:
+
+        static constexpr size_t MaxLineBytes = 499;
+        static constexpr size_t ChunkLines = 4096;
+        // Records all threads together may write between two collect() calls. The UI collects once
+        // per frame, this covers a frame stalled for a second at ~16k records/s (about 9 MB of slots).
+        static constexpr size_t DefaultRingSlots = 1 << 14;
+
+    private:
+
+        struct alignas(64) Slot
+        {
+            std::atomic<size_t> seq{0};
+            uint64_t timeUs = 0;
+            uint16_t len = 0;
+            uint16_t category = 0;
+            LogLevel level = LogLevel::INFO;
+            LogSource source = LogSource::APP;
+            char text[MaxLineBytes + 1]; // + the terminator vsnprintf always writes
+        };
+
+        struct Meta
+        {
+            uint32_t end = 0; // Text of record n is text[meta[n - 1].end, meta[n].end)
+            uint16_t category = 0;
+            LogLevel level = LogLevel::INFO;
+            LogSource source = LogSource::APP;
+            uint64_t timeUs = 0;
+        };
+
+        struct Chunk
+        {
+            std::string text;
+            std::vector<Meta> meta;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) size_t dequeuePos = 0; // Consumer only
+        std::atomic<uint64_t> dropped{0};
+        std::chrono::steady_clock::time_point epoch;
+
+        std::deque<Chunk> chunks;
+        size_t maxLines = 0;
+        size_t lines = 0;
+        uint64_t total = 0; // Every record ever collected
+
+        Slot* claim(size_t& pos);
+        void publish(Slot* slot, size_t pos, LogSource source, LogLevel level, uint16_t category, size_t len);
+
+    public:
+
+        // ringSlots is rounded up to a power of two
+        explicit LogStore(size_t maxLines = 1 << 20, size_t ringSlots = DefaultRingSlots);
+
+        LogStore(const LogStore&) = delete;
+        LogStore& operator=(const LogStore&) = delete;
+
+        // Any thread, no allocation. false when the ring was full and the record got dropped.
+        bool write(LogSource source, LogLevel level, LogCategory category, const char* fmt, ...) LOG_PRINTF(5, 6);
+        bool vwrite(LogSource source, LogLevel level, LogCategory category, const char* fmt, va_list args);
+        bool writeText(LogSource source, LogLevel level, LogCategory category, const char* text, size_t len);
+
+        // UI thread: moves pending records into the history, returns how many
+        size_t collect();
+        void clear();
+        void setMaxLines(size_t maxLines);
+
+        // UI thread, 0 is the oldest record still kept
+        size_t size() const {return this->lines;}
+        bool empty() const {return this->lines == 0;}
+        LogRecord record(size_t i) const;
+        std::string_view line(size_t i) const {return this->record(i).text;}
+
+        // Absolute index of record(0), and one past the newest
+        uint64_t firstIndex() const {return this->total - this->lines;}
+        uint64_t endIndex() const {return this->total;}
+
+        uint64_t collectedCount() const {return this->total;}
+        uint64_t droppedCount() const {return this->dropped.load(std::memory_order_relaxed);}
+        size_t memoryBytes() const;
+};
+
+// What the console shows, compared on the record fields only
+struct LogFilter
+{
+    LogLevel minLevel = LogLevel::DEBUG;
+    uint32_t sources = ~0u; // Bit per LogSource
+    uint64_t categories = ~0ull; // Bit per category id
+
+    bool passes(LogLevel level, LogSource source, uint16_t category) const
+    {
+        return level >= this->minLevel && (this->sources >> (unsigned)source & 1) &&
+               (category >= 64 || (this->categories >> category & 1));
+    }
+
+    bool passesAll() const {return this->minLevel == LogLevel::DEBUG && this->sources == ~0u && this->categories == ~0ull;}
+
+    bool operator==(const LogFilter& o) const
+    {
+        return this->minLevel == o.minLevel && this->sources == o.sources && this->categories == o.categories;
+    }
+    bool operator!=(const LogFilter& o) const {return !(*this == o);}
+};
+
+/**
+  * @brief Filtered rows over a LogStore
+
+  Keeps the absolute indices of the matching records. Only new records are looked at each frame,
+  the whole history is scanned again only when the filter changes. With nothing filtered out it
+  keeps no index at all and row i is just record i.
+*/
+class LogView
+{
+    private:
+
+        LogFilter filter;
+        bool dirty = true;
+        std::deque<uint64_t> matches;
+        uint64_t scanned = 0; // Absolute index of the next record to look at
+
+    public:
+
+        const LogFilter& getFilter() const {return this->filter;}
+        void setFilter(const LogFilter& filter);
+
+        // After the store collected, before drawing
+        void update(const LogStore& store);
+
+        size_t size(const LogStore& store) const;
+        // Row -> index for LogStore::record()
+        size_t recordIndex(size_t row, const LogStore& store) const;
+};
+
+#endif // LOGSTORE_H
@@ -0,0 +1,123 @@
+/* =============== MappedFile.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Memory mapped files
+
+    Description:
+        mmap() on POSIX, CreateFileMapping/MapViewOfFile on Windows.
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+MappedFile::~MappedFile()
+{
+    this->close();
+}
+
+bool MappedFile::open(const std::string& path, std::string& err)
+{
+    this->close();
+
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            err = "Cannot open " + path;
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            err = "Empty or unreadable file: " + path;
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            err = "Cannot map " + path;
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr)
+        {
+            err = "Cannot map " + path;
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        this->fileHandle = file;
+        this->mapHandle = mapping;
+        this->base = (const uint8_t*)view;
+        this->length = (size_t)size.QuadPart;
+    #else
+        int f = ::open(path.c_str(), O_RDONLY);
+        if (f < 0)
+        {
+            err = "Cannot open " + path + ": " + strerror(errno);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(f, &st) != 0 || st.st_size == 0)
+        {
+            err = "Empty or unreadable file: " + path;
+            ::close(f);
+            return false;
+        }
+
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+        if (view == MAP_FAILED)
+        {
+            err = "Cannot map " + path + ": " + strerror(errno);
+            ::close(f);
+            return false;
+        }
+
+        this->fd = f;
+        this->base = (const uint8_t*)view;
+        this->length = (size_t)st.st_size;
+    #endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->base == nullptr)
+    {
+        return;
+    }
+
+    #ifdef _WIN32
+        UnmapViewOfFile(this->base);
+        CloseHandle((HANDLE)this->mapHandle);
+        CloseHandle((HANDLE)this->fileHandle);
+        this->mapHandle = nullptr;
+        this->fileHandle = nullptr;
+    #else
+        munmap((void*)this->base, this->length);
+        ::close(this->fd);
+        this->fd = -1;
+    #endif
+
+    this->base = nullptr;
+    this->length = 0;
+}
@@ -0,0 +1,47 @@
+/* =============== MappedFile.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Memory mapped files
+
+    Description:
+        Read only memory mapping of a whole file. Opening is basically free
+        no matter how big the file is, the OS pages in only what we touch.
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+    private:
+
+        const uint8_t* base = nullptr;
+        size_t length = 0;
+
+        #ifdef _WIN32
+            void* fileHandle = nullptr;
+            void* mapHandle = nullptr;
+        #else
+            int fd = -1;
+        #endif
+
+    public:
+
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path, std::string& err);
+        void close();
+
+        bool isOpen() const {return this->base != nullptr;}
+        const uint8_t* data() const {return this->base;}
+        size_t size() const {return this->length;}
+};
+
+#endif // MAPPEDFILE_H
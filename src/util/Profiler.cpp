@@ -0,0 +1,240 @@
+/* =============== Profiler.cpp ==================
+    Project: STM32 Debugger + Plotter
+    Module: Profiler
+
+    Description:
+        Per thread queues, the registry they hang off, history trimming and
+        the Chrome trace writer.
+*/
+
+#include "Profiler.h"
+
+#include "acquisition/SpscQueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+std::atomic<bool> Profiler::enabled{false};
+thread_local uint16_t ProfileScope::depth = 0;
+
+namespace
+{
+    // One per thread that ever recorded. The thread only pushes, the UI thread only pops.
+    struct ThreadQueue
+    {
+        SpscQueue<ProfileEvent> queue{8192};
+        uint16_t id = 0;
+        std::atomic<bool> finished{false};
+    };
+
+    struct Registry
+    {
+        std::mutex lock; // Taken by a thread once, when it registers, and by the UI thread
+        std::vector<std::shared_ptr<ThreadQueue>> queues;
+        std::vector<std::string> names; // By thread id, kept after the thread is gone
+        std::deque<ProfileEvent> history; // UI thread only
+        std::vector<ProfileEvent> scratch;
+        std::atomic<uint64_t> dropped{0};
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    // Lets the UI thread know when a queue will never get anything new
+    struct ThreadHandle
+    {
+        std::shared_ptr<ThreadQueue> queue;
+
+        ~ThreadHandle()
+        {
+            if (this->queue) this->queue->finished.store(true, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadHandle handle;
+
+    ThreadQueue* threadQueue()
+    {
+        if (!handle.queue)
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+
+            handle.queue = std::make_shared<ThreadQueue>();
+            handle.queue->id = (uint16_t)r.names.size();
+            r.names.push_back("thread " + std::to_string(r.names.size()));
+            r.queues.push_back(handle.queue);
+        }
+        return handle.queue.get();
+    }
+
+    // Names are literals, but escape anyway so a stray quote can't break the file
+    void writeJsonString(FILE* f, const char* s)
+    {
+        fputc('"', f);
+        for (; *s; s++)
+        {
+            if (*s == '"' || *s == '\\') fputc('\\', f);
+            if ((unsigned char)*s >= 0x20) fputc(*s, f);
+        }
+        fputc('"', f);
+    }
+}
+
+void Profiler::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now()
+{
+    // +1 so no real time stamp is ever 0 (ProfileScope uses 0 for "not recording")
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().epoch).count() + 1;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs, uint16_t depth)
+{
+    ThreadQueue* q = threadQueue();
+
+    ProfileEvent e;
+    e.name = name;
+    e.startNs = startNs;
+    e.endNs = endNs;
+    e.depth = depth;
+    e.thread = q->id;
+
+    if (!q->queue.tryPush(&e, 1))
+    {
+        registry().dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadQueue* q = threadQueue();
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.names[q->id] = name;
+}
+
+void Profiler::collect(double keepSeconds)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+
+    r.scratch.resize(1024);
+    uint64_t newest = 0;
+    for (size_t i = 0; i < r.queues.size();)
+    {
+        ThreadQueue& q = *r.queues[i];
+        const bool finished = q.finished.load(std::memory_order_acquire); // Before draining, so nothing is missed
+
+        size_t n;
+        while ((n = q.queue.pop(r.scratch.data(), r.scratch.size())) > 0)
+        {
+            for (size_t k = 0; k < n; k++)
+            {
+                r.history.push_back(r.scratch[k]);
+                if (r.scratch[k].endNs > newest) newest = r.scratch[k].endNs;
+            }
+        }
+
+        if (finished)
+        {
+            r.queues.erase(r.queues.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Events come in roughly in end time order, close enough for dropping the old ones
+    const uint64_t keepNs = (uint64_t)(keepSeconds * 1e9);
+    const size_t maxEvents = 1 << 20;
+    while (!r.history.empty() && (r.history.size() > maxEvents ||
+           (newest > keepNs && r.history.front().endNs < newest - keepNs)))
+    {
+        r.history.pop_front();
+    }
+}
+
+const std::deque<ProfileEvent>& Profiler::history()
+{
+    return registry().history;
+}
+
+std::string Profiler::threadName(uint16_t thread)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    return (thread < r.names.size()) ? r.names[thread] : std::string("?");
+}
+
+size_t Profiler::threadCount()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    return r.names.size();
+}
+
+uint64_t Profiler::droppedCount()
+{
+    return registry().dropped.load(std::memory_order_relaxed);
+}
+
+void Profiler::clear()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.history.clear();
+}
+
+bool Profiler::exportChromeTrace(const std::string& path, std::string& err)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        err = "can't create " + path;
+        return false;
+    }
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    bool first = true;
+    for (size_t t = 0; t < r.names.size(); t++)
+    {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", first ? "" : ",\n", t);
+        writeJsonString(f, r.names[t].c_str());
+        fputs("}}", f);
+        first = false;
+    }
+
+    for (const ProfileEvent& e : r.history)
+    {
+        fputs(first ? "{\"name\":" : ",\n{\"name\":", f);
+        writeJsonString(f, e.name ? e.name : "?");
+        fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", (unsigned)e.thread,
+                e.startNs / 1000.0, (e.endNs - e.startNs) / 1000.0);
+        first = false;
+    }
+    fputs("\n]}\n", f);
+
+    const bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok)
+    {
+        err = "write to " + path + " failed";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,125 @@
+/* =============== Profiler.h ==================
+    Project: STM32 Debugger + Plotter
+    Module: Profiler
+
+    Description:
+        Scoped timers for finding out where a frame (or a sample batch)
+        goes. PROFILE_SCOPE("name") times the rest of the block and, while
+        capturing is on, pushes one event into a queue owned by the calling
+        thread. The UI thread drains every thread's queue once per frame into
+        a short history that the profiler window draws as a timeline and
+        that can be saved as Chrome trace JSON (chrome://tracing, Perfetto).
+
+        Capturing is off by default. Off, a scope costs one relaxed atomic
+        load and a branch. Building with -DNO_PROFILER (make PROFILER=0)
+        removes the macros completely.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct ProfileEvent
+{
+    const char* name = nullptr; // Has to live forever, in practice a string literal or __func__
+    uint64_t startNs = 0; // Profiler::now() time base
+    uint64_t endNs = 0;
+    uint16_t depth = 0; // Nesting inside the thread, 0 = outermost
+    uint16_t thread = 0; // Profiler::threadName(thread)
+};
+
+/**
+  * @brief Process wide event collection
+
+  Everything is static: scopes can sit anywhere (plot code, acquisition thread, recorder thread)
+  without passing an object around. Producers never lock, each thread has its own SPSC queue
+  (registered under a mutex the first time it records), and a full queue drops the event.
+*/
+class Profiler
+{
+    private:
+
+        static std::atomic<bool> enabled;
+
+    public:
+
+        static bool isEnabled() {return enabled.load(std::memory_order_relaxed);}
+        static void setEnabled(bool on);
+
+        // Nanoseconds since the profiler's epoch
+        static uint64_t now();
+
+        // Producer side, called by ProfileScope
+        static void record(const char* name, uint64_t startNs, uint64_t endNs, uint16_t depth);
+        static void setThreadName(const char* name);
+
+        // UI thread: drains every thread's queue into the history, keeps the last keepSeconds
+        static void collect(double keepSeconds = 2.0);
+        static const std::deque<ProfileEvent>& history();
+        static std::string threadName(uint16_t thread); // A copy, setThreadName() may replace it meanwhile
+        static size_t threadCount();
+        static uint64_t droppedCount();
+        static void clear();
+
+        // Whole history as Chrome trace JSON ("X" complete events + thread names)
+        static bool exportChromeTrace(const std::string& path, std::string& err);
+};
+
+/**
+  * @brief Times its own lifetime
+
+  Only records when capturing was on when it was created, so switching it on in the middle of a
+  scope does not produce an event with a garbage start.
+*/
+class ProfileScope
+{
+    private:
+
+        const char* name;
+        uint64_t start = 0;
+
+        static thread_local uint16_t depth;
+
+    public:
+
+        explicit ProfileScope(const char* name) : name(name)
+        {
+            if (Profiler::isEnabled())
+            {
+                this->start = Profiler::now();
+                depth++;
+            }
+        }
+
+        ~ProfileScope()
+        {
+            if (this->start != 0)
+            {
+                depth--;
+                Profiler::record(this->name, this->start, Profiler::now(), depth);
+            }
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#ifndef NO_PROFILER
+    #define PROFILE_CONCAT_INNER(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+    #define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+    #define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+    #define PROFILE_SCOPE(name) ((void)0)
+    #define PROFILE_FUNCTION() ((void)0)
+    #define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif // PROFILER_H